@@ -10,21 +10,174 @@
 #include "glm/glm.hpp"
 #include "glm/gtc/matrix_transform.hpp"
 
+// std
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <future>
+
 AsepriteRenderHook::AsepriteRenderHook()
 {
 	wrengine::EngineConfigInfo configInfo{};
 	configInfo.height = HEIGHT;
 	configInfo.width = WIDTH;
 	configInfo.windowName = "Aseprite Render Hook";
+	// the sprite only changes when aseprite sends an update, or on input
+	configInfo.idleMode = true;
 	m_engine = std::make_shared<wrengine::Engine>(configInfo);
 }
 
+/**
+* Loads the sprite from an .aseprite file rather than waiting on the lua client.
+* The first frame of the "Albedo" and "Normal" layers is used, as the client
+* sends.
+*
+* @param filePath The file path of the .aseprite file.
+*/
+void AsepriteRenderHook::openFile(const std::string& filePath)
+{
+	auto start = std::chrono::steady_clock::now();
+	wrengine::AsepriteFile file{ filePath };
+
+	int albedoLayer = file.findLayer("Albedo");
+	int normalLayer = file.findLayer("Normal");
+	if (albedoLayer < 0 || normalLayer < 0)
+	{
+		throw std::runtime_error("aseprite file has no Albedo and Normal layers: " + filePath);
+	}
+
+	m_spriteWidth = static_cast<int>(file.getWidth());
+	m_spriteHeight = static_cast<int>(file.getHeight());
+	if (m_engine->exceedsTextureLimits(m_spriteWidth, m_spriteHeight))
+	{
+		m_engine->addVirtualTexture(
+			"canvas",
+			file.composeLayer(albedoLayer, 0),
+			file.composeLayer(normalLayer, 0),
+			m_spriteWidth,
+			m_spriteHeight);
+		m_virtualCanvas = true;
+		m_fileOpened = true;
+		std::cout << "opened " << filePath << " as a virtual texture\n";
+		return;
+	}
+
+	auto albedo = m_engine->loadTextureAsync(
+		"albedo",
+		file.composeLayer(albedoLayer, 0),
+		m_spriteWidth,
+		m_spriteHeight,
+		{ .filterType = WR_FILTER_NEAREST });
+	auto normal = m_engine->loadTextureAsync(
+		"normal",
+		file.composeLayer(normalLayer, 0),
+		m_spriteWidth,
+		m_spriteHeight,
+		{ .filterType = WR_FILTER_NEAREST, .format = WR_FORMAT_RG8_UNORM, .isNormalMap = true });
+	albedo.get();
+	normal.get();
+	m_fileOpened = true;
+
+	auto elapsed = std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - start).count();
+	std::cout << "opened " << filePath << " (" << file.getFrameCount()
+		<< " frames) in " << elapsed << " ms\n";
+}
+
+/**
+* Loads the sprite from exported albedo and normal images in a directory, then
+* watches the directory, reloading an image whenever it is written. This
+* replaces the lua client for editors other than aseprite.
+*
+* @param directory The directory holding albedo.png and normal.png.
+*/
+void AsepriteRenderHook::watchDirectory(const std::string& directory)
+{
+	std::filesystem::path root{ directory };
+	auto albedoData = std::async(std::launch::async, wrengine::Texture::decodeFile, (root / ALBEDO_FILE).string());
+	auto normalData = std::async(std::launch::async, wrengine::Texture::decodeFile, (root / NORMAL_FILE).string());
+	wrengine::TextureData albedo = albedoData.get();
+	wrengine::TextureData normal = normalData.get();
+
+	m_spriteWidth = albedo.width;
+	m_spriteHeight = albedo.height;
+	auto albedoTexture = m_engine->loadTextureAsync(
+		"albedo",
+		std::move(albedo.pixels),
+		albedo.width,
+		albedo.height,
+		{ .filterType = WR_FILTER_NEAREST });
+	auto normalTexture = m_engine->loadTextureAsync(
+		"normal",
+		std::move(normal.pixels),
+		normal.width,
+		normal.height,
+		{ .filterType = WR_FILTER_NEAREST, .format = WR_FORMAT_RG8_UNORM, .isNormalMap = true });
+	albedoTexture.get();
+	normalTexture.get();
+	m_fileOpened = true;
+
+	m_decodePool = std::make_unique<wrengine::ThreadPool>(2);
+	m_fileWatcher = std::make_unique<wrengine::FileWatcher>(
+		directory,
+		[this, directory](const std::string& fileName) { fileChangedHandler(directory, fileName); });
+	std::cout << "watching " << directory << " for changes\n";
+}
+
+/**
+* Called on the watcher thread when a file in the watched directory is written.
+* The image is decoded on the decode pool, so further events are not held up,
+* and passed to the engine, which uploads only the region that changed. A
+* decode that finishes after a newer one for the same file is discarded.
+*
+* @param directory The watched directory. Passed in rather than read from the
+* watcher, which may call this before the watcher member is assigned.
+* @param fileName The name of the file that was written.
+*/
+void AsepriteRenderHook::fileChangedHandler(const std::string& directory, const std::string& fileName)
+{
+	std::string handle;
+	if (fileName == ALBEDO_FILE) handle = "albedo";
+	else if (fileName == NORMAL_FILE) handle = "normal";
+	else return;
+
+	uint64_t generation;
+	{
+		std::scoped_lock<std::mutex> lock(m_reloadMutex);
+		generation = ++m_reloadGenerations[handle];
+	}
+
+	std::string filePath = (std::filesystem::path{ directory } / fileName).string();
+	m_decodePool->submit([this, handle, filePath, generation]()
+		{
+			wrengine::TextureData data;
+			try
+			{
+				data = wrengine::Texture::decodeFile(filePath);
+			}
+			catch (const std::exception& e)
+			{
+				std::cout << "failed to reload " << filePath << ": " << e.what() << "\n";
+				return;
+			}
+
+			std::scoped_lock<std::mutex> lock(m_reloadMutex);
+			if (m_reloadGenerations[handle] != generation) return;
+
+			std::cout << "reloaded " << filePath << "\n";
+			m_engine->updateTextureData(handle, std::move(data.pixels), data.width, data.height);
+		});
+}
+
 void AsepriteRenderHook::run()
 {
 	initServer();
-	std::unique_lock lock(m_conditionMutex);
-	std::cout << "waiting on init msg from aseprite\n";
-	m_initCondition.wait(lock);
+	if (!m_fileOpened)
+	{
+		std::unique_lock lock(m_conditionMutex);
+		std::cout << "waiting on init msg from aseprite\n";
+		m_initCondition.wait(lock);
+	}
 
 	initEngine();
 	m_engine->run();
@@ -44,13 +197,19 @@ void AsepriteRenderHook::initEngine()
 		m_server.sendAll("READY");
 	});
 
-	m_engine->addTextureDependency(
-		{
-			{"light",  "Resources/light.png"},
-		});
+	// cooked by the CookResources target, textures fall back to their files
+	if (std::filesystem::exists("Resources/textures.wrar"))
+	{
+		m_engine->openTextureArchive("Resources/textures.wrar");
+	}
 	m_engine->loadTextures();
-	m_engine->createMaterial("main material", "albedo", "normal");
-	m_engine->createMaterial("light material", "light", "light");
+	if (!m_virtualCanvas)
+	{
+		m_engine->createMaterial("main material", "albedo", "normal");
+	}
+
+	// small sprites share pages of the engine atlas
+	m_engine->addAtlasSprite("light", "Resources/light.png");
 	std::shared_ptr<wrengine::Scene> activeScene = m_engine->getActiveScene();
 
 	// the sprite
@@ -58,11 +217,23 @@ void AsepriteRenderHook::initEngine()
 	auto& spriteRenderComponent = spriteEntity.addComponent<wrengine::SpriteRenderComponent>();
 	auto& spriteTransformComponent = spriteEntity.addComponent<wrengine::TransformComponent>();
 	spriteEntity.addComponent<wrengine::ScriptComponent>().bind<SpriteController>();
-	spriteRenderComponent.material.albedo = m_engine->getTextureByName("albedo");
-	spriteRenderComponent.material.normalMap = m_engine->getTextureByName("normal");
+	if (m_virtualCanvas)
+	{
+		m_engine->applyVirtualTexture("canvas", spriteRenderComponent);
+	}
+	else
+	{
+		spriteRenderComponent.material.albedo = m_engine->getTextureByName("albedo");
+		spriteRenderComponent.material.normalMap = m_engine->getTextureByName("normal");
+	}
 	spriteRenderComponent.material.shaderConfig = wrengine::ShaderConfig::NormalMapped;
 	spriteTransformComponent.scale = glm::vec3(m_spriteWidth, m_spriteHeight, 1.0f);
 
+	// tilemap layers, drawn under the sprite once the client sends a tileset
+	wrengine::Entity tilemapEntity = activeScene->createEntity("tilemap");
+	tilemapEntity.addComponent<wrengine::TransformComponent>();
+	tilemapEntity.addComponent<wrengine::TilemapComponent>(m_engine->getTilemap(TILEMAP_NAME));
+
 	// point light
 	wrengine::Entity lightEntity = activeScene->createEntity("light");
 	lightEntity.addComponent<wrengine::PointLightComponent>();
@@ -70,9 +241,8 @@ void AsepriteRenderHook::initEngine()
 	auto& lightTransformComponent = lightEntity.addComponent<wrengine::TransformComponent>();
 	auto& lightRenderComponent = lightEntity.addComponent<wrengine::SpriteRenderComponent>();
 	lightTransformComponent.scale = glm::vec3(0.2f);
-	lightRenderComponent.material.albedo = m_engine->getTextureByName("light");
-	lightRenderComponent.material.normalMap = m_engine->getTextureByName("light");
 	lightRenderComponent.material.shaderConfig = wrengine::ShaderConfig::Emissive;
+	m_engine->applyAtlasSprite("light", lightRenderComponent);
 
 	// the camera
 	wrengine::Entity cameraEntity = activeScene->createEntity("camera");
@@ -103,6 +273,8 @@ void AsepriteRenderHook::messageHandler(WebsocketServer::MessageType message)
 	*/
 	static int diffuseCount = 0;
 	static int normalCount = 0;
+	if (tilemapMessageHandler(message->get_payload())) return;
+
 	unsigned long* hdr = (unsigned long*)message->get_payload().c_str();
 
 	auto begin = message->get_payload().begin() + 12;
@@ -112,28 +284,138 @@ void AsepriteRenderHook::messageHandler(WebsocketServer::MessageType message)
 	int height = hdr[2];
 	std::stringstream ss;
 
-	std::vector<uint8_t> payloadAlbd(begin, begin + (width * height * 4));
-	std::vector<uint8_t> payloadNorm(begin + (width * height * 4), end);
+	// the canvas may be resized in aseprite, so the payload size is checked
+	// against the header rather than the size of the existing textures
+	size_t imageBytes = static_cast<size_t>(width) * height * 4;
+	if (width <= 0 ||
+		height <= 0 ||
+		static_cast<size_t>(end - begin) != 2 * imageBytes)
+	{
+		std::cout << "ignoring malformed sprite msg\n";
+		return;
+	}
+
+	std::vector<uint8_t> payloadAlbd(begin, begin + imageBytes);
+	std::vector<uint8_t> payloadNorm(begin + imageBytes, end);
 	
 	if (hdr[0] == 'R')
 	{
+		if (width != m_spriteWidth || height != m_spriteHeight)
+		{
+			std::cout << "sprite resized to " << width << "x" << height << "\n";
+		}
 		m_spriteWidth = width;
 		m_spriteHeight = height;
 		std::cout << "recieved sprite update msg" << std::endl;
-		m_engine->updateTextureData("albedo", std::move(payloadAlbd));
-		m_engine->updateTextureData("normal", std::move(payloadNorm));
+		m_engine->updateTextureData("albedo", std::move(payloadAlbd), width, height);
+		m_engine->updateTextureData("normal", std::move(payloadNorm), width, height);
 	}
 	else if (hdr[0] == 'I')
 	{
 		std::cout << "recieved init msg" << std::endl;
 		m_spriteWidth = width;
 		m_spriteHeight = height;
-		m_engine->loadTexture("albedo", payloadAlbd.data(), width, height, { .filterType = WR_FILTER_NEAREST });
-		m_engine->loadTexture("normal", payloadNorm.data(), width, height, { .filterType = WR_FILTER_NEAREST });
+		auto albedo = m_engine->loadTextureAsync("albedo", std::move(payloadAlbd), width, height, { .filterType = WR_FILTER_NEAREST });
+		auto normal = m_engine->loadTextureAsync("normal", std::move(payloadNorm), width, height, { .filterType = WR_FILTER_NEAREST, .format = WR_FORMAT_RG8_UNORM, .isNormalMap = true });
+		albedo.get();
+		normal.get();
 		m_initCondition.notify_one();
 	}
 	std::cout << ss.str();
 
 	std::cout << hdr[0] << "\n";
 	std::cout << "width/height: " << hdr[1] << " " << hdr[2] << "\n";
+}
+
+/**
+* Handles the tilemap messages of the lua client. Each starts with a uint32
+* message type, followed by uint32 fields:
+*	'T' tileset: width, height, tile width, tile height, then the albedo and
+*	normal tileset images as RGBA.
+*	'M' grid: columns, rows, then columns * rows tile values.
+*	'E' edit: count, then count sets of column, row and tile value.
+* Tile values are as aseprite stores them, the index with flip flags above.
+*
+* @param payload The message payload.
+*
+* @return False if the message is not a tilemap message.
+*/
+bool AsepriteRenderHook::tilemapMessageHandler(const std::string& payload)
+{
+	auto field = [&payload](size_t index)
+		{
+			uint32_t value = 0;
+			std::memcpy(&value, payload.data() + index * sizeof(uint32_t), sizeof(uint32_t));
+			return value;
+		};
+
+	if (payload.size() < sizeof(uint32_t)) return false;
+
+	uint32_t type = field(0);
+	if (type != 'T' && type != 'M' && type != 'E') return false;
+
+	if (type == 'T' && payload.size() >= 5 * sizeof(uint32_t))
+	{
+		uint32_t width = field(1);
+		uint32_t height = field(2);
+		uint32_t tileWidth = field(3);
+		uint32_t tileHeight = field(4);
+		size_t imageBytes = static_cast<size_t>(width) * height * 4;
+		auto begin = payload.begin() + 5 * sizeof(uint32_t);
+
+		// the tileset must hold a whole tile, and tile sizes fit the 16 bit
+		// fields the engine stores them in
+		bool validTiles =
+			tileWidth > 0 && tileHeight > 0 &&
+			tileWidth <= width && tileHeight <= height &&
+			tileWidth <= 0xFFFF && tileHeight <= 0xFFFF;
+		if (imageBytes > 0 &&
+			static_cast<size_t>(payload.end() - begin) == 2 * imageBytes &&
+			validTiles &&
+			!m_engine->exceedsTextureLimits(static_cast<int>(width), static_cast<int>(height)))
+		{
+			std::cout << "recieved tileset msg" << std::endl;
+			m_engine->updateTileset(
+				TILEMAP_NAME,
+				std::vector<uint8_t>(begin, begin + imageBytes),
+				std::vector<uint8_t>(begin + imageBytes, payload.end()),
+				width,
+				height,
+				tileWidth,
+				tileHeight);
+			return true;
+		}
+	}
+	else if (type == 'M' && payload.size() >= 3 * sizeof(uint32_t))
+	{
+		uint32_t columns = field(1);
+		uint32_t rows = field(2);
+		size_t count = static_cast<size_t>(columns) * rows;
+		if (count > 0 &&
+			payload.size() == (3 + count) * sizeof(uint32_t) &&
+			!m_engine->exceedsTextureLimits(static_cast<int>(columns), static_cast<int>(rows)))
+		{
+			std::vector<uint32_t> tiles(count);
+			std::memcpy(tiles.data(), payload.data() + 3 * sizeof(uint32_t), count * sizeof(uint32_t));
+			m_engine->updateTilemap(TILEMAP_NAME, std::move(tiles), columns, rows);
+			return true;
+		}
+	}
+	else if (type == 'E' && payload.size() >= 2 * sizeof(uint32_t))
+	{
+		size_t count = field(1);
+		if (payload.size() == (2 + 3 * count) * sizeof(uint32_t))
+		{
+			std::vector<wrengine::TileEdit> edits(count);
+			for (size_t i = 0; i < count; ++i)
+			{
+				edits[i] = { field(2 + i * 3), field(3 + i * 3), field(4 + i * 3) };
+			}
+			m_engine->editTilemap(TILEMAP_NAME, std::move(edits));
+			return true;
+		}
+	}
+
+	std::cout << "ignoring malformed tilemap msg\n";
+	return true;
 }
\ No newline at end of file
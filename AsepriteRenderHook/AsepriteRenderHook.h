@@ -10,6 +10,8 @@
 #include <iostream>
 #include <memory>
 #include <vector>
+#include <map>
+#include <string>
 #include <mutex>
 #include <condition_variable>
 
@@ -19,6 +21,8 @@ class AsepriteRenderHook
 public:
 	AsepriteRenderHook();
 
+	void openFile(const std::string& filePath);
+	void watchDirectory(const std::string& directory);
 	void run();
 
 private:
@@ -26,6 +30,8 @@ private:
 	void initEngine();
 
 	void messageHandler(WebsocketServer::MessageType message);
+	bool tilemapMessageHandler(const std::string& payload);
+	void fileChangedHandler(const std::string& directory, const std::string& fileName);
 
 	// image dimensions
 	const uint32_t WIDTH = 800;
@@ -44,4 +50,25 @@ private:
 	std::vector<uint8_t> m_normalData;
 	int m_spriteWidth = 0;
 	int m_spriteHeight = 0;
+	bool m_fileOpened = false;
+
+	// set when the opened canvas is too large for a texture, and is drawn from
+	// the "canvas" virtual texture instead
+	bool m_virtualCanvas = false;
+
+	// tilemap layers are sent as a tileset and a grid of tile indices, drawn
+	// from the "tilemap" engine tilemap
+	const std::string TILEMAP_NAME = "tilemap";
+
+	// exported layer images, reloaded when written to the watched directory
+	const std::string ALBEDO_FILE = "albedo.png";
+	const std::string NORMAL_FILE = "normal.png";
+
+	std::mutex m_reloadMutex;
+	std::map<std::string, uint64_t> m_reloadGenerations;
+
+	// declared after the engine and the reload state, so pending reloads finish
+	// before anything they use is freed, and after the pool the watcher feeds
+	std::unique_ptr<wrengine::ThreadPool> m_decodePool;
+	std::unique_ptr<wrengine::FileWatcher> m_fileWatcher;
 };
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "MainWindow.h"
+#include "PointLightController.h"
 #include "imgui.h"
 
 //std
@@ -9,8 +10,6 @@ void MainWindow::onAttach()
 	m_spriteTransform = &m_mainSprite.getComponent<wrengine::TransformComponent>();
 	m_lightTransform = &m_light.getComponent<wrengine::TransformComponent>();
 
-	m_spriteUnitX = m_spriteTransform->scale.x;
-	m_spriteUnitY = m_spriteTransform->scale.y;
 }
 
 void MainWindow::onDetatch()
@@ -78,6 +77,7 @@ void MainWindow::onUIRender()
 			{
 				m_spriteTransform->translation.x = spriteX;
 				m_spriteTransform->translation.y = spriteY;
+				m_mainSprite.markChanged<wrengine::TransformComponent>();
 			}
 			ImGui::TreePop();
 		}
@@ -95,6 +95,13 @@ void MainWindow::onUIRender()
 			{
 				// update light position
 			}
+
+			// the orbit keeps the engine rendering, pausing it lets it idle
+			auto& script = m_light.getComponent<wrengine::ScriptComponent>();
+			if (auto* controller = dynamic_cast<PointLightController*>(script.instance.get()))
+			{
+				ImGui::Checkbox("Pause light", &controller->m_paused);
+			}
 			ImGui::TreePop();
 		}
 	}
@@ -103,8 +110,56 @@ void MainWindow::onUIRender()
 	static int scaleIndex = 2;
 	if (ImGui::Combo("Sprite Scales", &scaleIndex, m_scaleStrings, IM_ARRAYSIZE(m_scaleStrings)))
 	{
-		m_spriteTransform->scale.x = m_spriteUnitX * m_scaleValues[scaleIndex];
-		m_spriteTransform->scale.y = m_spriteUnitY * m_scaleValues[scaleIndex];
+		// derive the unit scale from the texture, as the canvas may be resized
+		auto& albedo = m_mainSprite.getComponent<wrengine::SpriteRenderComponent>()
+			.material.albedo;
+		m_spriteTransform->scale.x = albedo->getWidth() * m_scaleValues[scaleIndex];
+		m_spriteTransform->scale.y = albedo->getHeight() * m_scaleValues[scaleIndex];
+		m_mainSprite.markChanged<wrengine::TransformComponent>();
+	}
+
+	ImGui::Separator();
+	if (ImGui::CollapsingHeader("Presentation"))
+	{
+		int profileIndex = static_cast<int>(m_engine->getPresentProfile());
+		if (ImGui::Combo("Profile", &profileIndex, m_profileStrings, IM_ARRAYSIZE(m_profileStrings)))
+		{
+			m_engine->setPresentProfile(static_cast<wrengine::PresentProfile>(profileIndex));
+		}
+
+		ImGui::Text("Input to present latency:");
+		for (int i = 0; i < IM_ARRAYSIZE(m_profileStrings); ++i)
+		{
+			wrengine::LatencyStats stats =
+				m_engine->getLatencyStats(static_cast<wrengine::PresentProfile>(i));
+			if (stats.sampleCount == 0)
+			{
+				ImGui::Text("%s: not measured", m_profileStrings[i]);
+				continue;
+			}
+			ImGui::Text("%s: %.1f ms (%.1f - %.1f ms, %llu frames)",
+				m_profileStrings[i],
+				stats.averageMs,
+				stats.minMs,
+				stats.maxMs,
+				static_cast<unsigned long long>(stats.sampleCount));
+		}
+	}
+
+	ImGui::Separator();
+	if (ImGui::CollapsingHeader("Memory Statistics"))
+	{
+		wrengine::AllocatorStats stats = m_engine->getMemoryStats();
+		constexpr float MB = 1024.0f * 1024.0f;
+		ImGui::Text("Device allocations: %u", stats.deviceMemoryCount);
+		ImGui::Text("Resources: %u (%u dedicated)",
+			stats.allocationCount,
+			stats.dedicatedCount);
+		ImGui::Text("Slabs: %u", stats.slabCount);
+		ImGui::Text("Used: %.2f / %.2f MB",
+			stats.usedBytes / MB,
+			stats.reservedBytes / MB);
+		ImGui::Text("Staging in flight: %.2f MB", stats.stagingBytes / MB);
 	}
 
 	ImGui::End();
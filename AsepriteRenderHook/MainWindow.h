@@ -50,6 +50,7 @@ private:
 	// scaling
 	const char* m_scaleStrings[5] = { "0.25", "0.5", "1", "2", "3" };
 	const float m_scaleValues[5] = { 0.25, 0.5, 1.0, 2.0, 3.0 };
-	float m_spriteUnitX = 1.0f;
-	float m_spriteUnitY = 1.0f;
+
+	// present profiles, in wrengine::PresentProfile order
+	const char* m_profileStrings[3] = { "Low latency", "Smooth", "Power saver" };
 };
\ No newline at end of file
@@ -7,14 +7,21 @@ void PointLightController::onCreate()
 	m_transformComponent = &getComponent<wrengine::TransformComponent>();
 	m_transformComponent->scale = glm::vec3(64.0f);
 	m_transformComponent->translation = glm::vec3(200.0f, -200.0f, 0.5f);
+	markChanged<wrengine::TransformComponent>();
 }
 
 void PointLightController::onUpdate(float deltaTime)
 {
+	// an orbiting light changes every frame, so keeps an idle engine rendering
+	bool orbiting = !m_paused && m_rotationSpeed != 0.0f;
+	setAnimating(orbiting);
+	if (!orbiting) return;
+
 	m_lightAngle += deltaTime * m_rotationSpeed;
 	m_lightAngle = std::fmod(m_lightAngle, 360.f);
 	float s = std::sin(m_lightAngle);
 	float c = std::cos(m_lightAngle);
 
 	m_transformComponent->translation = 100.0f * glm::vec3(s * m_radius, c * m_radius, 0.0f);
+	markChanged<wrengine::TransformComponent>();
 }
\ No newline at end of file
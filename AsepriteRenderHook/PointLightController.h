@@ -12,4 +12,7 @@ public:
 	float m_lightAngle = 0.0f;
 	float m_rotationSpeed = 0.5f;
 	float m_radius = 2.0f;
+
+	// holds the light still, so an idle engine can sleep between edits
+	bool m_paused = false;
 };
\ No newline at end of file
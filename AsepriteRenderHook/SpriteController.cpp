@@ -4,6 +4,7 @@ void SpriteController::onCreate()
 {
 	m_transformComponent = &getComponent<wrengine::TransformComponent>();
 	m_transformComponent->translation = { 0.0f, 0.0f, 0.5f };
+	markChanged<wrengine::TransformComponent>();
 	//m_transformComponent->scale = { 512.0f, 512.0f, 512.0f };
 }
 
@@ -2,12 +2,24 @@
 
 // std
 #include <stdexcept>
+#include <string>
 
-int main()
+int main(int argc, char** argv)
 {
 	try
 	{
 		AsepriteRenderHook app{};
+
+		// an .aseprite file may be given to preview it without the lua client,
+		// or a directory of exported images to watch for changes
+		if (argc > 2 && std::string(argv[1]) == "--watch")
+		{
+			app.watchDirectory(argv[2]);
+		}
+		else if (argc > 1)
+		{
+			app.openFile(argv[1]);
+		}
 		app.run();
 	}
 	catch (const std::exception& e)
@@ -7,8 +7,15 @@ local spr = app.activeSprite
 local albdBuf = Image(spr.width, spr.height, ColorMode.RGB)
 local normBuf = Image(spr.width, spr.height, ColorMode.RGB)
 
+-- last tileset and tile grid sent, so only changes are sent again
+local tilesetBytes
+local tileGrid
+local gridColumns
+local gridRows
+
 local sendImage
 local sendInit
+local sendTilemap
 local onSiteChange
 
 local function finish()
@@ -20,6 +27,117 @@ local function finish()
   spr = nil
 end
 
+-- tilemap layers are sent as a tileset strip, one tile below another, and a
+-- grid of tile values rather than flattened into the sprite buffers
+local function findTilemapLayers()
+	local albedo
+	local normal
+	for _,layer in ipairs(spr.layers) do
+		if layer.isTilemap and layer.name == "Albedo" then albedo = layer end
+		if layer.isTilemap and layer.name == "Normal" then normal = layer end
+	end
+	return albedo, normal
+end
+
+local function tilesetStrip(tileset, count, tileSize)
+	local strip = Image(tileSize.width, tileSize.height * count, ColorMode.RGB)
+	for i = 0, math.min(count, #tileset) - 1 do
+		strip:drawImage(tileset:getTile(i), Point(0, i * tileSize.height))
+	end
+	return strip
+end
+
+local function packTiles(header, tiles)
+	local parts = { header }
+	for i = 1, #tiles do
+		parts[#parts + 1] = string.pack("<I4", tiles[i])
+	end
+	return table.concat(parts)
+end
+
+local function sendTileset(albedo, normal)
+	local tileset = albedo.tileset
+	local tileSize = tileset.grid.tileSize
+	local count = #tileset
+
+	local albdStrip = tilesetStrip(tileset, count, tileSize)
+	local normStrip
+	if normal ~= nil
+	then
+		normStrip = tilesetStrip(normal.tileset, count, tileSize)
+	else
+		normStrip = Image(albdStrip.width, albdStrip.height, ColorMode.RGB)
+		normStrip:clear(Color{ r=128, g=128, b=255, a=255 })
+	end
+
+	local bytes = albdStrip.bytes .. normStrip.bytes
+	if bytes == tilesetBytes then return end
+	tilesetBytes = bytes
+
+	ws:sendBinary(
+		string.pack("<I4I4I4I4I4", string.byte("T"), albdStrip.width, albdStrip.height, tileSize.width, tileSize.height),
+		albdStrip.bytes,
+		normStrip.bytes)
+end
+
+local function sendTiles(albedo)
+	local tileSize = albedo.tileset.grid.tileSize
+	local columns = math.ceil(spr.width / tileSize.width)
+	local rows = math.ceil(spr.height / tileSize.height)
+
+	local tiles = {}
+	for i = 1, columns * rows do tiles[i] = 0 end
+
+	local cel = albedo.cels[1]
+	if cel ~= nil
+	then
+		local originX = cel.position.x // tileSize.width
+		local originY = cel.position.y // tileSize.height
+		for it in cel.image:pixels() do
+			local x = originX + it.x
+			local y = originY + it.y
+			if x >= 0 and x < columns and y >= 0 and y < rows
+			then
+				-- the renderer has no flipped tiles, so drop the flip flags
+				-- rather than sending an index it treats as out of range
+				tiles[y * columns + x + 1] = app.pixelColor.tileI(it())
+			end
+		end
+	end
+
+	if tileGrid == nil or columns ~= gridColumns or rows ~= gridRows
+	then
+		ws:sendBinary(packTiles(string.pack("<I4I4I4", string.byte("M"), columns, rows), tiles))
+	else
+		-- only changed cells, as column, row and tile value
+		local edits = {}
+		for i = 1, #tiles do
+			if tiles[i] ~= tileGrid[i]
+			then
+				edits[#edits + 1] = (i - 1) % columns
+				edits[#edits + 1] = (i - 1) // columns
+				edits[#edits + 1] = tiles[i]
+			end
+		end
+		if #edits > 0
+		then
+			ws:sendBinary(packTiles(string.pack("<I4I4", string.byte("E"), #edits // 3), edits))
+		end
+	end
+
+	tileGrid = tiles
+	gridColumns = columns
+	gridRows = rows
+end
+
+sendTilemap = function()
+	local albedo, normal = findTilemapLayers()
+	if albedo == nil then return end
+
+	sendTileset(albedo, normal)
+	sendTiles(albedo)
+end
+
 sendInit = function()
 	if albdBuf.width ~= spr.width or albdBuf.height	~= spr.height
 	then
@@ -32,13 +150,13 @@ sendInit = function()
 	end
 	
 	for _,layer in ipairs(spr.layers) do
-		if layer.name == "Normal"
+		if layer.name == "Normal" and not layer.isTilemap
 		then
 			normBuf:clear()
 			normBuf:drawImage(layer.cels[1].image, layer.cels[1].position)
 		end
 
-		if layer.name == "Albedo"
+		if layer.name == "Albedo" and not layer.isTilemap
 		then
 			albdBuf:clear()
 			albdBuf:drawImage(layer.cels[1].image, layer.cels[1].position)
@@ -49,6 +167,11 @@ sendInit = function()
 		string.pack("<LLL", string.byte("I"), albdBuf.width, albdBuf.height),
 		albdBuf.bytes,
 		normBuf.bytes)
+
+	-- the server may be new, so send the whole tilemap again
+	tilesetBytes = nil
+	tileGrid = nil
+	sendTilemap()
 end
 
 sendImage = function()
@@ -63,13 +186,13 @@ sendImage = function()
 	end
 	
 	for _,layer in ipairs(spr.layers) do
-		if layer.name == "Normal"
+		if layer.name == "Normal" and not layer.isTilemap
 		then
 			normBuf:clear()
 			normBuf:drawImage(layer.cels[1].image, layer.cels[1].position)
 		end
 
-		if layer.name == "Albedo"
+		if layer.name == "Albedo" and not layer.isTilemap
 		then
 			albdBuf:clear()
 			albdBuf:drawImage(layer.cels[1].image, layer.cels[1].position)
@@ -80,6 +203,7 @@ sendImage = function()
 		string.pack("<LLL", string.byte("R"), albdBuf.width, albdBuf.height),
 		albdBuf.bytes,
 		normBuf.bytes)
+	sendTilemap()
 end
 
 local frame = -1
@@ -0,0 +1,180 @@
+#include "AssetArchive.h"
+#include "MipChain.h"
+#include "PixelKernels.h"
+
+#include <vulkan/vulkan_core.h>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+// std
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Converts image files into a cooked asset archive of GPU ready textures with
+// precomputed mip chains, for Engine::openTextureArchive.
+//
+// usage: WrengineCooker -o <archive> [--no-mips] [--normal] <name>=<image> ...
+//
+// --normal applies to the next texture only, and stores it as a renormalized
+// two channel normal map. Other textures are stored as sRGB RGBA8.
+
+using namespace wrengine;
+
+struct CookOptions
+{
+	std::string name;
+	std::string filePath;
+	bool isNormalMap = false;
+};
+
+static void printUsage()
+{
+	std::cerr << "usage: WrengineCooker -o <archive> [--no-mips] "
+		"[--normal] <name>=<image> ...\n";
+}
+
+/**
+* Decodes an image and builds the texel data of each mip level in its cooked
+* format.
+*/
+static void cookTexture(
+	AssetArchiveWriter& writer,
+	const CookOptions& options,
+	bool generateMips)
+{
+	int width;
+	int height;
+	int numChannels;
+	stbi_uc* pixels = stbi_load(
+		options.filePath.c_str(),
+		&width,
+		&height,
+		&numChannels,
+		STBI_rgb_alpha);
+	if (!pixels)
+	{
+		throw std::runtime_error(
+			"failed to load " + options.filePath + " - " + stbi_failure_reason());
+	}
+
+	uint32_t levelCount = generateMips ?
+		mipLevelCount(static_cast<uint32_t>(width), static_cast<uint32_t>(height)) :
+		1;
+	uint32_t texelSize = options.isNormalMap ? 2 : 4;
+	size_t texelCount = static_cast<size_t>(width) * height;
+
+	std::vector<std::vector<uint8_t>> levels(levelCount);
+	levels[0].resize(texelCount * texelSize);
+	if (options.isNormalMap)
+	{
+		getPixelKernels().packNormalsRG(pixels, levels[0].data(), texelCount);
+	}
+	else
+	{
+		levels[0].assign(pixels, pixels + texelCount * 4);
+	}
+	stbi_image_free(pixels);
+
+	for (uint32_t level = 1; level < levelCount; ++level)
+	{
+		uint32_t srcWidth = mipExtent(width, level - 1);
+		uint32_t srcHeight = mipExtent(height, level - 1);
+		uint32_t dstWidth = mipExtent(width, level);
+		uint32_t dstHeight = mipExtent(height, level);
+		levels[level].resize(static_cast<size_t>(dstWidth) * dstHeight * texelSize);
+
+		PixelRect rect{ 0, 0, dstWidth, dstHeight };
+		if (options.isNormalMap)
+		{
+			downsampleNormalsRG(
+				levels[level - 1].data(), srcWidth, srcHeight,
+				levels[level].data(), dstWidth, rect);
+		}
+		else
+		{
+			downsampleRGBA8(
+				levels[level - 1].data(), srcWidth, srcHeight,
+				levels[level].data(), dstWidth, rect, true);
+		}
+	}
+
+	writer.addTexture(
+		options.name,
+		options.isNormalMap ? VK_FORMAT_R8G8_UNORM : VK_FORMAT_R8G8B8A8_SRGB,
+		static_cast<uint32_t>(width),
+		static_cast<uint32_t>(height),
+		texelSize,
+		options.isNormalMap ? ARCHIVE_FLAG_NORMAL_MAP : 0,
+		levels);
+
+	std::cout << options.name << ": " << width << "x" << height << ", "
+		<< levelCount << " levels" << (options.isNormalMap ? ", normal map" : "")
+		<< "\n";
+}
+
+int main(int argc, char** argv)
+{
+	std::string outputPath;
+	bool generateMips = true;
+	bool nextIsNormalMap = false;
+	std::vector<CookOptions> textures;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg = argv[i];
+		if (arg == "-o" && i + 1 < argc)
+		{
+			outputPath = argv[++i];
+		}
+		else if (arg == "--no-mips")
+		{
+			generateMips = false;
+		}
+		else if (arg == "--normal")
+		{
+			nextIsNormalMap = true;
+		}
+		else
+		{
+			size_t separator = arg.find('=');
+			if (separator == std::string::npos || separator == 0)
+			{
+				printUsage();
+				return EXIT_FAILURE;
+			}
+			textures.push_back({
+				arg.substr(0, separator),
+				arg.substr(separator + 1),
+				nextIsNormalMap });
+			nextIsNormalMap = false;
+		}
+	}
+
+	if (outputPath.empty() || textures.empty())
+	{
+		printUsage();
+		return EXIT_FAILURE;
+	}
+
+	try
+	{
+		AssetArchiveWriter writer{};
+		for (const CookOptions& options : textures)
+		{
+			cookTexture(writer, options, generateMips);
+		}
+		writer.write(outputPath);
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << '\n';
+		return EXIT_FAILURE;
+	}
+
+	std::cout << "wrote " << textures.size() << " textures to " << outputPath << "\n";
+	return EXIT_SUCCESS;
+}
\ No newline at end of file
@@ -0,0 +1,435 @@
+#include "AsepriteFile.h"
+
+#include "ThreadPool.h"
+
+#include "stb_image.h"
+
+// std
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <future>
+#include <iterator>
+#include <stdexcept>
+
+namespace wrengine
+{
+// file format constants
+constexpr uint16_t HEADER_MAGIC = 0xA5E0;
+constexpr uint16_t FRAME_MAGIC = 0xF1FA;
+constexpr size_t HEADER_SIZE = 128;
+constexpr size_t FRAME_HEADER_SIZE = 16;
+constexpr size_t CHUNK_HEADER_SIZE = 6;
+constexpr uint16_t CHUNK_LAYER = 0x2004;
+constexpr uint16_t CHUNK_CEL = 0x2005;
+constexpr uint16_t CHUNK_PALETTE = 0x2019;
+constexpr uint16_t CEL_RAW = 0;
+constexpr uint16_t CEL_LINKED = 1;
+constexpr uint16_t CEL_COMPRESSED = 2;
+constexpr uint16_t LAYER_FLAG_BACKGROUND = 8;
+constexpr uint16_t LAYER_TYPE_IMAGE = 0;
+
+/**
+* Little endian reader over a bounded range of the file, throwing a runtime
+* error on reads past the end of the range.
+*/
+struct ByteReader
+{
+	const std::vector<uint8_t>& data;
+	size_t offset;
+	size_t end;
+
+	void require(size_t size)
+	{
+		if (offset > end || size > end - offset)
+		{
+			throw std::runtime_error("malformed aseprite file");
+		}
+	}
+
+	uint8_t byte()
+	{
+		require(1);
+		return data[offset++];
+	}
+
+	uint16_t word()
+	{
+		require(2);
+		uint16_t value = static_cast<uint16_t>(data[offset] | (data[offset + 1] << 8));
+		offset += 2;
+		return value;
+	}
+
+	int16_t shortValue()
+	{
+		return static_cast<int16_t>(word());
+	}
+
+	uint32_t dword()
+	{
+		uint32_t low = word();
+		uint32_t high = word();
+		return low | (high << 16);
+	}
+
+	std::string string()
+	{
+		uint16_t length = word();
+		require(length);
+		std::string value(
+			reinterpret_cast<const char*>(data.data() + offset),
+			length);
+		offset += length;
+		return value;
+	}
+
+	void skip(size_t size)
+	{
+		require(size);
+		offset += size;
+	}
+};
+
+/**
+* Reads and decodes an Aseprite file. Will throw a runtime error if the file
+* cannot be read, is malformed, or uses an unsupported colour depth.
+*
+* @param filePath The file path of the .aseprite or .ase file.
+*/
+AsepriteFile::AsepriteFile(const std::string& filePath) : m_filePath{ filePath }
+{
+	std::ifstream stream{ filePath, std::ios::binary };
+	if (!stream)
+	{
+		throw std::runtime_error("failed to open aseprite file: " + filePath);
+	}
+	std::vector<uint8_t> file{
+		std::istreambuf_iterator<char>(stream),
+		std::istreambuf_iterator<char>() };
+
+	parse(file);
+	decodeCels(file);
+}
+
+/**
+* Finds an image layer by name. Group and tilemap layers have no image cels,
+* so are skipped even if their name matches.
+*
+* @param name The layer name.
+*
+* @return The layer index, or -1 if there is no such image layer.
+*/
+int AsepriteFile::findLayer(const std::string& name) const
+{
+	for (size_t i = 0; i < m_layers.size(); ++i)
+	{
+		if (m_layers[i].type == LAYER_TYPE_IMAGE && m_layers[i].name == name)
+		{
+			return static_cast<int>(i);
+		}
+	}
+	return -1;
+}
+
+/**
+* Draws the cel of a layer in a frame onto a transparent canvas of the sprite
+* size, as the Lua client does before sending a layer. Opacity is not applied.
+*
+* @param layerIndex The layer index.
+* @param frame The frame index.
+*
+* @return Canvas sized RGBA8 pixels.
+*/
+std::vector<uint8_t> AsepriteFile::composeLayer(
+	uint32_t layerIndex,
+	uint32_t frame) const
+{
+	std::vector<uint8_t> canvas(static_cast<size_t>(m_width) * m_height * 4, 0);
+	if (frame >= m_frames.size()) return canvas;
+
+	for (const AsepriteCel& cel : m_frames[frame].cels)
+	{
+		if (cel.layerIndex != layerIndex || !cel.pixels) continue;
+
+		// clip the cel to the canvas
+		int32_t x0 = std::max<int32_t>(cel.x, 0);
+		int32_t y0 = std::max<int32_t>(cel.y, 0);
+		int32_t x1 = std::min<int32_t>(cel.x + cel.width, static_cast<int32_t>(m_width));
+		int32_t y1 = std::min<int32_t>(cel.y + cel.height, static_cast<int32_t>(m_height));
+		if (x0 >= x1 || y0 >= y1) continue;
+
+		for (int32_t y = y0; y < y1; ++y)
+		{
+			const uint8_t* src = cel.pixels->data() +
+				(static_cast<size_t>(y - cel.y) * cel.width + (x0 - cel.x)) * 4;
+			uint8_t* dst = canvas.data() + (static_cast<size_t>(y) * m_width + x0) * 4;
+			std::memcpy(dst, src, static_cast<size_t>(x1 - x0) * 4);
+		}
+	}
+	return canvas;
+}
+
+/**
+* Walks the header, frames and chunks, recording layers, the palette and the
+* location of each cel's pixel data.
+*
+* @param file The file contents.
+*/
+void AsepriteFile::parse(const std::vector<uint8_t>& file)
+{
+	ByteReader header{ file, 0, file.size() };
+	header.require(HEADER_SIZE);
+	header.dword(); // file size
+	if (header.word() != HEADER_MAGIC)
+	{
+		throw std::runtime_error("not an aseprite file: " + m_filePath);
+	}
+	uint16_t frameCount = header.word();
+	m_width = header.word();
+	m_height = header.word();
+	m_colorDepth = header.word();
+	header.skip(14); // flags, speed, reserved
+	m_transparentIndex = header.byte();
+
+	if (m_colorDepth != 32 && m_colorDepth != 16 && m_colorDepth != 8)
+	{
+		throw std::runtime_error("unsupported aseprite colour depth: " + m_filePath);
+	}
+
+	m_frames.resize(frameCount);
+	size_t frameOffset = HEADER_SIZE;
+	for (uint32_t f = 0; f < frameCount; ++f)
+	{
+		ByteReader frameHeader{ file, frameOffset, file.size() };
+		frameHeader.require(FRAME_HEADER_SIZE);
+		uint32_t frameSize = frameHeader.dword();
+		if (frameHeader.word() != FRAME_MAGIC || frameSize < FRAME_HEADER_SIZE)
+		{
+			throw std::runtime_error("malformed aseprite frame: " + m_filePath);
+		}
+		uint32_t chunkCount = frameHeader.word();
+		m_frames[f].duration = frameHeader.word();
+		frameHeader.skip(2);
+		uint32_t newChunkCount = frameHeader.dword();
+		if (newChunkCount != 0) chunkCount = newChunkCount;
+
+		size_t frameEnd = frameOffset + frameSize;
+		frameHeader.offset = frameOffset;
+		frameHeader.require(frameSize);
+
+		size_t chunkOffset = frameOffset + FRAME_HEADER_SIZE;
+		for (uint32_t c = 0; c < chunkCount; ++c)
+		{
+			ByteReader chunkHeader{ file, chunkOffset, frameEnd };
+			uint32_t chunkSize = chunkHeader.dword();
+			uint16_t chunkType = chunkHeader.word();
+			if (chunkSize < CHUNK_HEADER_SIZE || chunkSize > frameEnd - chunkOffset)
+			{
+				throw std::runtime_error("malformed aseprite chunk: " + m_filePath);
+			}
+
+			size_t chunkEnd = chunkOffset + chunkSize;
+			ByteReader chunk{ file, chunkOffset + CHUNK_HEADER_SIZE, chunkEnd };
+
+			if (chunkType == CHUNK_LAYER)
+			{
+				AsepriteLayer layer{};
+				layer.flags = chunk.word();
+				layer.type = chunk.word();
+				chunk.skip(8); // child level, default size, blend mode
+				layer.opacity = chunk.byte();
+				chunk.skip(3);
+				layer.name = chunk.string();
+				m_layers.push_back(std::move(layer));
+			}
+			else if (chunkType == CHUNK_PALETTE)
+			{
+				uint32_t paletteSize = chunk.dword();
+				uint32_t first = chunk.dword();
+				uint32_t last = chunk.dword();
+				chunk.skip(8);
+				if (last < first || last >= paletteSize || paletteSize > 65536)
+				{
+					throw std::runtime_error("malformed aseprite palette: " + m_filePath);
+				}
+
+				m_palette.resize(static_cast<size_t>(paletteSize) * 4, 0);
+				for (uint32_t i = first; i <= last; ++i)
+				{
+					uint16_t entryFlags = chunk.word();
+					for (int channel = 0; channel < 4; ++channel)
+					{
+						m_palette[i * 4 + channel] = chunk.byte();
+					}
+					if (entryFlags & 1) chunk.string(); // colour name
+				}
+			}
+			else if (chunkType == CHUNK_CEL)
+			{
+				AsepriteCel cel{};
+				cel.layerIndex = chunk.word();
+				cel.x = chunk.shortValue();
+				cel.y = chunk.shortValue();
+				cel.opacity = chunk.byte();
+				uint16_t celType = chunk.word();
+				chunk.skip(7); // z index, reserved
+
+				PendingCel pending{};
+				pending.frame = f;
+				pending.cel = m_frames[f].cels.size();
+				pending.layerIndex = cel.layerIndex;
+
+				if (celType == CEL_LINKED)
+				{
+					pending.linked = true;
+					pending.linkedFrame = chunk.word();
+				}
+				else if (celType == CEL_RAW || celType == CEL_COMPRESSED)
+				{
+					cel.width = chunk.word();
+					cel.height = chunk.word();
+					pending.width = cel.width;
+					pending.height = cel.height;
+					pending.dataOffset = chunk.offset;
+					pending.dataSize = chunkEnd - chunk.offset;
+					pending.compressed = celType == CEL_COMPRESSED;
+				}
+				else
+				{
+					// tilemap cels are not supported
+					chunkOffset = chunkEnd;
+					continue;
+				}
+
+				m_frames[f].cels.push_back(cel);
+				m_pendingCels.push_back(pending);
+			}
+
+			chunkOffset = chunkEnd;
+		}
+
+		frameOffset = frameEnd;
+	}
+}
+
+/**
+* Decodes the pixels of every cel, inflating compressed cels in parallel, then
+* resolves linked cels to the pixels of the cels they link to.
+*
+* @param file The file contents.
+*/
+void AsepriteFile::decodeCels(const std::vector<uint8_t>& file)
+{
+	size_t decodeCount = std::count_if(
+		m_pendingCels.begin(),
+		m_pendingCels.end(),
+		[](const PendingCel& pending) { return !pending.linked; });
+
+	// declared before the results, so it outlives them if a decode throws
+	ThreadPool pool{ decodeCount > 1 ? 0u : 1u };
+	std::vector<std::future<std::vector<uint8_t>>> results(m_pendingCels.size());
+	for (size_t i = 0; i < m_pendingCels.size(); ++i)
+	{
+		if (m_pendingCels[i].linked) continue;
+		results[i] = pool.submit(
+			[this, &file, i]() { return decodeCel(file, m_pendingCels[i]); });
+	}
+
+	for (size_t i = 0; i < m_pendingCels.size(); ++i)
+	{
+		const PendingCel& pending = m_pendingCels[i];
+		if (pending.linked) continue;
+		m_frames[pending.frame].cels[pending.cel].pixels =
+			std::make_shared<const std::vector<uint8_t>>(results[i].get());
+	}
+
+	for (const PendingCel& pending : m_pendingCels)
+	{
+		if (!pending.linked || pending.linkedFrame >= m_frames.size()) continue;
+
+		AsepriteCel& cel = m_frames[pending.frame].cels[pending.cel];
+		for (const AsepriteCel& source : m_frames[pending.linkedFrame].cels)
+		{
+			if (source.layerIndex != cel.layerIndex || !source.pixels) continue;
+
+			// linked cels share position, opacity and pixels with their source
+			cel = source;
+			break;
+		}
+	}
+	m_pendingCels.clear();
+}
+
+/**
+* Decodes the pixels of a single cel to RGBA8. Called from worker threads.
+*
+* @param file The file contents.
+* @param pending The cel to decode.
+*
+* @return The RGBA8 pixels.
+*/
+std::vector<uint8_t> AsepriteFile::decodeCel(
+	const std::vector<uint8_t>& file,
+	const PendingCel& pending) const
+{
+	size_t texelCount = static_cast<size_t>(pending.width) * pending.height;
+	size_t bytesPerTexel = m_colorDepth / 8;
+	size_t rawSize = texelCount * bytesPerTexel;
+
+	std::vector<uint8_t> inflated;
+	const uint8_t* raw = file.data() + pending.dataOffset;
+	if (pending.compressed)
+	{
+		inflated.resize(rawSize);
+		int size = stbi_zlib_decode_buffer(
+			reinterpret_cast<char*>(inflated.data()),
+			static_cast<int>(rawSize),
+			reinterpret_cast<const char*>(raw),
+			static_cast<int>(pending.dataSize));
+		if (size != static_cast<int>(rawSize))
+		{
+			throw std::runtime_error("failed to inflate aseprite cel: " + m_filePath);
+		}
+		raw = inflated.data();
+	}
+	else if (pending.dataSize < rawSize)
+	{
+		throw std::runtime_error("truncated aseprite cel: " + m_filePath);
+	}
+
+	if (m_colorDepth == 32)
+	{
+		if (pending.compressed) return inflated;
+		return std::vector<uint8_t>(raw, raw + rawSize);
+	}
+
+	std::vector<uint8_t> pixels(texelCount * 4);
+	if (m_colorDepth == 16)
+	{
+		for (size_t i = 0; i < texelCount; ++i)
+		{
+			pixels[i * 4 + 0] = raw[i * 2];
+			pixels[i * 4 + 1] = raw[i * 2];
+			pixels[i * 4 + 2] = raw[i * 2];
+			pixels[i * 4 + 3] = raw[i * 2 + 1];
+		}
+		return pixels;
+	}
+
+	// indexed, where the transparent index is only opaque on the background
+	bool background = pending.layerIndex < m_layers.size() &&
+		(m_layers[pending.layerIndex].flags & LAYER_FLAG_BACKGROUND);
+	for (size_t i = 0; i < texelCount; ++i)
+	{
+		uint8_t index = raw[i];
+		if ((index == m_transparentIndex && !background) ||
+			static_cast<size_t>(index) * 4 >= m_palette.size())
+		{
+			continue;
+		}
+		std::memcpy(&pixels[i * 4], &m_palette[index * 4], 4);
+	}
+	return pixels;
+}
+} // namespace wrengine
\ No newline at end of file
@@ -0,0 +1,99 @@
+#pragma once
+
+//std
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace wrengine
+{
+/**
+* A layer of an Aseprite file.
+*/
+struct AsepriteLayer
+{
+	std::string name;
+	uint16_t flags = 0;
+	uint16_t type = 0; // 0 normal, 1 group, 2 tilemap
+	uint8_t opacity = 255;
+};
+
+/**
+* An image placed on a layer in one frame. Linked cels share their pixels with
+* the cel they link to.
+*/
+struct AsepriteCel
+{
+	uint16_t layerIndex = 0;
+	int16_t x = 0;
+	int16_t y = 0;
+	uint8_t opacity = 255;
+	uint16_t width = 0;
+	uint16_t height = 0;
+	std::shared_ptr<const std::vector<uint8_t>> pixels; // RGBA8
+};
+
+/**
+* A frame of an Aseprite file.
+*/
+struct AsepriteFrame
+{
+	uint16_t duration = 0; // milliseconds
+	std::vector<AsepriteCel> cels;
+};
+
+/**
+* Reader for the native .aseprite/.ase file format. The chunk structure is
+* parsed serially, then the zlib compressed cels of every frame are inflated in
+* parallel on a worker pool, and converted from the sprite colour depth to
+* RGBA8. Tilemap cels are not supported and are skipped.
+*/
+class AsepriteFile
+{
+public:
+	AsepriteFile(const std::string& filePath);
+
+	int findLayer(const std::string& name) const;
+	std::vector<uint8_t> composeLayer(uint32_t layerIndex, uint32_t frame) const;
+
+	// getters
+	uint32_t getWidth() const { return m_width; }
+	uint32_t getHeight() const { return m_height; }
+	uint32_t getFrameCount() const { return static_cast<uint32_t>(m_frames.size()); }
+	const std::vector<AsepriteLayer>& getLayers() const { return m_layers; }
+	const std::vector<AsepriteFrame>& getFrames() const { return m_frames; }
+
+private:
+	// a cel whose pixels are still to be decoded
+	struct PendingCel
+	{
+		uint32_t frame = 0;
+		size_t cel = 0;
+		uint16_t layerIndex = 0;
+		uint16_t width = 0;
+		uint16_t height = 0;
+		size_t dataOffset = 0;
+		size_t dataSize = 0;
+		bool compressed = false;
+		bool linked = false;
+		uint16_t linkedFrame = 0;
+	};
+
+	void parse(const std::vector<uint8_t>& file);
+	void decodeCels(const std::vector<uint8_t>& file);
+	std::vector<uint8_t> decodeCel(
+		const std::vector<uint8_t>& file,
+		const PendingCel& pending) const;
+
+	std::string m_filePath;
+	uint32_t m_width = 0;
+	uint32_t m_height = 0;
+	uint16_t m_colorDepth = 32;
+	uint8_t m_transparentIndex = 0;
+	std::vector<uint8_t> m_palette; // RGBA8 per index
+	std::vector<AsepriteLayer> m_layers;
+	std::vector<AsepriteFrame> m_frames;
+	std::vector<PendingCel> m_pendingCels;
+};
+} // namespace wrengine
\ No newline at end of file
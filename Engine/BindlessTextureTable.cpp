@@ -0,0 +1,181 @@
+#include "BindlessTextureTable.h"
+
+// std
+#include <algorithm>
+#include <stdexcept>
+
+namespace wrengine
+{
+/**
+* Creates the texture array set, sized to MAX_TEXTURES or the device limit for
+* update after bind samplers if lower.
+*
+* @param device The device to create the set on.
+*/
+BindlessTextureTable::BindlessTextureTable(Device& device) : m_device{ device }
+{
+	VkPhysicalDeviceDescriptorIndexingProperties indexingProperties{};
+	indexingProperties.sType =
+		VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+
+	VkPhysicalDeviceProperties2 properties{};
+	properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+	properties.pNext = &indexingProperties;
+	vkGetPhysicalDeviceProperties2(m_device.getPhysicalDevice(), &properties);
+
+	m_capacity = std::min({
+		MAX_TEXTURES,
+		indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages,
+		indexingProperties.maxDescriptorSetUpdateAfterBindSamplers,
+		indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+		indexingProperties.maxPerStageDescriptorUpdateAfterBindSamplers });
+
+	m_setLayout = DescriptorSetLayout::Builder(m_device)
+		.addBinding(
+			0,
+			VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+			VK_SHADER_STAGE_FRAGMENT_BIT,
+			m_capacity)
+		.setBindingFlags(
+			0,
+			VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
+			VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+			VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT)
+		.build();
+
+	m_pool = DescriptorPool::Builder(m_device)
+		.setPoolFlags(VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT)
+		.setMaxSets(1)
+		.addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_capacity)
+		.build();
+
+	if (!m_pool->allocateDescriptor(
+		m_setLayout->getDescriptorSetLayout(),
+		m_descriptorSet))
+	{
+		throw std::runtime_error("failed to allocate bindless texture set!");
+	}
+}
+
+/**
+* Gets the slot of a texture, writing it into a new slot on first use. Will
+* throw a runtime error if every slot is in use.
+*
+* @param texture The texture.
+*
+* @return The slot of the texture in the shader texture array.
+*/
+uint32_t BindlessTextureTable::acquire(const std::shared_ptr<Texture>& texture)
+{
+	std::scoped_lock<std::mutex> lock(m_mutex);
+	auto found = m_slots.find(texture.get());
+	if (found != m_slots.end())
+	{
+		if (found->second.texture.lock() == texture) return found->second.index;
+
+		// the slot belonged to a destroyed texture at the same address
+		retireSlot(found->second.index);
+		m_slots.erase(found);
+	}
+
+	uint32_t index = allocateSlot();
+	writeSlot(index, *texture);
+	m_slots[texture.get()] = Slot{ texture, index };
+	return index;
+}
+
+/**
+* Moves a texture to a new slot after its image view has changed. Frames in
+* flight may be reading the old slot, so it is retired rather than rewritten,
+* and materials using the texture must take the new slot.
+*
+* @param texture The texture whose image view has changed.
+*
+* @return The new slot of the texture.
+*/
+uint32_t BindlessTextureTable::refresh(const std::shared_ptr<Texture>& texture)
+{
+	std::scoped_lock<std::mutex> lock(m_mutex);
+	auto found = m_slots.find(texture.get());
+	if (found != m_slots.end())
+	{
+		retireSlot(found->second.index);
+		m_slots.erase(found);
+	}
+
+	uint32_t index = allocateSlot();
+	writeSlot(index, *texture);
+	m_slots[texture.get()] = Slot{ texture, index };
+	return index;
+}
+
+/**
+* Retires the slots of destroyed textures. Called once per frame.
+*/
+void BindlessTextureTable::collect()
+{
+	std::scoped_lock<std::mutex> lock(m_mutex);
+	for (auto slot = m_slots.begin(); slot != m_slots.end();)
+	{
+		if (!slot->second.texture.expired())
+		{
+			++slot;
+			continue;
+		}
+		retireSlot(slot->second.index);
+		slot = m_slots.erase(slot);
+	}
+}
+
+/**
+* Takes a free slot, preferring reused slots over never used ones.
+*
+* @return The slot index.
+*/
+uint32_t BindlessTextureTable::allocateSlot()
+{
+	{
+		std::scoped_lock<std::mutex> lock(m_freeSlots->mutex);
+		if (!m_freeSlots->slots.empty())
+		{
+			uint32_t index = m_freeSlots->slots.back();
+			m_freeSlots->slots.pop_back();
+			return index;
+		}
+	}
+
+	if (m_nextSlot == m_capacity)
+	{
+		throw std::runtime_error("bindless texture table is full!");
+	}
+	return m_nextSlot++;
+}
+
+/**
+* Writes a texture into a slot of the set.
+*
+* @param index The slot index.
+* @param texture The texture to write.
+*/
+void BindlessTextureTable::writeSlot(uint32_t index, Texture& texture)
+{
+	VkDescriptorImageInfo imageInfo = texture.descriptorInfo();
+	DescriptorWriter(*m_setLayout, *m_pool)
+		.writeImage(0, &imageInfo, index)
+		.overwrite(m_descriptorSet);
+}
+
+/**
+* Returns a slot to the free list once no frame in flight can read it.
+*
+* @param index The slot index.
+*/
+void BindlessTextureTable::retireSlot(uint32_t index)
+{
+	m_device.retire([freeSlots = m_freeSlots, index]()
+		{
+			std::scoped_lock<std::mutex> lock(freeSlots->mutex);
+			freeSlots->slots.push_back(index);
+		});
+}
+} // namespace wrengine
\ No newline at end of file
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "Device.h"
+#include "Descriptors.h"
+#include "Texture.h"
+
+//std
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace wrengine
+{
+/**
+* A single descriptor set holding every texture in one array of combined image
+* samplers, indexed in shaders by slots passed per draw. The set is bound once
+* per frame. The array binding is partially bound and updated after bind, so
+* adding a texture writes one element without a new set or pool, even while
+* frames using other elements are in flight. A slot whose texture is replaced
+* or destroyed may still be read by frames in flight, so it is only reused once
+* the device has finished those frames. All methods are thread safe.
+*/
+class BindlessTextureTable
+{
+public:
+	static constexpr uint32_t MAX_TEXTURES = 4096;
+
+	BindlessTextureTable(Device& device);
+
+	// not copyable
+	BindlessTextureTable(const BindlessTextureTable&) = delete;
+	BindlessTextureTable& operator=(const BindlessTextureTable&) = delete;
+
+	uint32_t acquire(const std::shared_ptr<Texture>& texture);
+	uint32_t refresh(const std::shared_ptr<Texture>& texture);
+	void collect();
+
+	// getters
+	VkDescriptorSetLayout getSetLayout() const
+	{ return m_setLayout->getDescriptorSetLayout(); }
+	VkDescriptorSet getDescriptorSet() const { return m_descriptorSet; }
+	uint32_t getCapacity() const { return m_capacity; }
+
+private:
+	// slots waiting to be reused, shared with the retire callbacks so that
+	// slots retired during shutdown never outlive their list
+	struct FreeSlots
+	{
+		std::vector<uint32_t> slots;
+		std::mutex mutex;
+	};
+
+	struct Slot
+	{
+		std::weak_ptr<Texture> texture;
+		uint32_t index;
+	};
+
+	uint32_t allocateSlot();
+	void writeSlot(uint32_t index, Texture& texture);
+	void retireSlot(uint32_t index);
+
+	Device& m_device;
+	std::unique_ptr<DescriptorSetLayout> m_setLayout;
+	std::unique_ptr<DescriptorPool> m_pool;
+	VkDescriptorSet m_descriptorSet = VK_NULL_HANDLE;
+	uint32_t m_capacity = 0;
+
+	std::unordered_map<const Texture*, Slot> m_slots;
+	std::shared_ptr<FreeSlots> m_freeSlots = std::make_shared<FreeSlots>();
+	uint32_t m_nextSlot = 0;
+	std::mutex m_mutex;
+};
+} // namespace wrengine
\ No newline at end of file
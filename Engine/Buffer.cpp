@@ -51,13 +51,21 @@ Buffer::Buffer(
 
 Buffer::~Buffer() {
   unmap();
-  vkDestroyBuffer(m_device.device(), m_buffer, nullptr);
-  vkFreeMemory(m_device.device(), m_memory, nullptr);
+
+  // a frame in flight may still read this buffer, so defer its destruction
+  VkDevice device = m_device.device();
+  MemoryAllocator& allocator = m_device.getAllocator();
+  m_device.retire(
+    [device, &allocator, buffer = m_buffer, memory = m_memory]() mutable {
+      vkDestroyBuffer(device, buffer, nullptr);
+      allocator.free(memory);
+    });
 }
 
 /**
  * Map a memory range of this buffer. If successful, mapped points to the
- * specified buffer range.
+ * specified buffer range. Host visible allocations are persistently mapped by
+ * the allocator, so this only resolves the pointer into that mapping.
  *
  * @param size (Optional) Size of the memory range to map. Pass VK_WHOLE_SIZE to
  * map the complete buffer range.
@@ -67,22 +75,22 @@ Buffer::~Buffer() {
  */
 VkResult Buffer::map(VkDeviceSize size, VkDeviceSize offset)
 {
-  assert(m_buffer && m_memory && "Called map on buffer before create");
-  return vkMapMemory(m_device.device(), m_memory, offset, size, 0, &m_mapped);
+  assert(m_buffer && m_memory.memory && "Called map on buffer before create");
+  if (!m_memory.mapped)
+  {
+    return VK_ERROR_MEMORY_MAP_FAILED;
+  }
+  m_mapped = static_cast<char*>(m_memory.mapped) + offset;
+  return VK_SUCCESS;
 }
 
 /**
- * Unmap a mapped memory range
- *
- * @note Does not return a result as vkUnmapMemory can't fail
+ * Unmap a mapped memory range. The underlying memory stays mapped by the
+ * allocator for the lifetime of the allocation.
  */
 void Buffer::unmap()
 {
-  if (m_mapped)
-  {
-    vkUnmapMemory(m_device.device(), m_memory);
-    m_mapped = nullptr;
-  }
+  m_mapped = nullptr;
 }
 
 /**
@@ -124,12 +132,7 @@ void Buffer::writeToBuffer(void* data, VkDeviceSize size, VkDeviceSize offset)
  */
 VkResult Buffer::flush(VkDeviceSize size, VkDeviceSize offset)
 {
-  VkMappedMemoryRange mappedRange = {};
-  mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-  mappedRange.memory = m_memory;
-  mappedRange.offset = offset;
-  mappedRange.size = size;
-  return vkFlushMappedMemoryRanges(m_device.device(), 1, &mappedRange);
+  return m_device.getAllocator().flush(m_memory, size, offset);
 }
 
 /**
@@ -145,12 +148,7 @@ VkResult Buffer::flush(VkDeviceSize size, VkDeviceSize offset)
  */
 VkResult Buffer::invalidate(VkDeviceSize size, VkDeviceSize offset)
 {
-  VkMappedMemoryRange mappedRange = {};
-  mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-  mappedRange.memory = m_memory;
-  mappedRange.offset = offset;
-  mappedRange.size = size;
-  return vkInvalidateMappedMemoryRanges(m_device.device(), 1, &mappedRange);
+  return m_device.getAllocator().invalidate(m_memory, size, offset);
 }
 
 /**
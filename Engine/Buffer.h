@@ -71,7 +71,7 @@ private:
   Device& m_device;
   void* m_mapped = nullptr;
   VkBuffer m_buffer = VK_NULL_HANDLE;
-  VkDeviceMemory m_memory = VK_NULL_HANDLE;
+  Allocation m_memory{};
 
   VkDeviceSize m_bufferSize;
   uint32_t m_instanceCount;
@@ -0,0 +1,214 @@
+#include "CommandRecorder.h"
+
+// std
+#include <stdexcept>
+
+namespace wrengine
+{
+/**
+* Creates the command pools of every slot and frame in flight.
+*
+* @param device The device to record for.
+* @param slotCount The number of secondary buffers that may be recorded at
+* once, usually one per recording thread.
+*/
+CommandRecorder::CommandRecorder(Device& device, uint32_t slotCount) :
+	m_device{ device },
+	m_slotCount{ slotCount },
+	m_pools(static_cast<size_t>(slotCount) * Swapchain::MAX_FRAMES_IN_FLIGHT)
+{
+	for (SlotPool& pool : m_pools)
+	{
+		pool.pool = m_device.createCommandPool(VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+	}
+}
+
+CommandRecorder::~CommandRecorder()
+{
+	// command buffers in flight may have executed these secondaries
+	VkDevice device = m_device.device();
+	for (SlotPool& pool : m_pools)
+	{
+		m_device.retire([device, commandPool = pool.pool, reusablePool = pool.reusablePool]()
+			{
+				vkDestroyCommandPool(device, commandPool, nullptr);
+				if (reusablePool != VK_NULL_HANDLE)
+				{
+					vkDestroyCommandPool(device, reusablePool, nullptr);
+				}
+			});
+	}
+}
+
+/**
+* Resets the pools of a frame in flight. Must be called after the frame's fence
+* has been waited on, and before any slot is recorded on for the frame.
+*
+* @param frameIndex The frame being recorded.
+*/
+void CommandRecorder::beginFrame(int frameIndex)
+{
+	m_frameIndex = frameIndex;
+	for (uint32_t slot = 0; slot < m_slotCount; ++slot)
+	{
+		SlotPool& pool = slotPool(slot);
+		vkResetCommandPool(m_device.device(), pool.pool, 0);
+		pool.used = 0;
+	}
+}
+
+/**
+* Begins a secondary command buffer from a slot's pool, continuing the render
+* pass described by the inheritance info. Dynamic state is not inherited, so
+* the viewport and scissor must be set in the buffer.
+*
+* @param slot The recording slot, owned by the calling thread until end.
+* @param inheritanceInfo The render pass, subpass and framebuffer recorded into.
+*
+* @return The command buffer in the recording state.
+*/
+VkCommandBuffer CommandRecorder::begin(
+	uint32_t slot,
+	const VkCommandBufferInheritanceInfo& inheritanceInfo)
+{
+	SlotPool& pool = slotPool(slot);
+	if (pool.used == pool.commandBuffers.size())
+	{
+		VkCommandBufferAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+		allocInfo.commandPool = pool.pool;
+		allocInfo.commandBufferCount = 1;
+
+		VkCommandBuffer commandBuffer;
+		if (vkAllocateCommandBuffers(
+			m_device.device(),
+			&allocInfo,
+			&commandBuffer) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to allocate secondary command buffer!");
+		}
+		pool.commandBuffers.push_back(commandBuffer);
+	}
+	VkCommandBuffer commandBuffer = pool.commandBuffers[pool.used++];
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags =
+		VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT |
+		VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+	if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to begin secondary command buffer!");
+	}
+	return commandBuffer;
+}
+
+/**
+* Ends a secondary command buffer, ready to be executed by the frame's primary
+* command buffer.
+*
+* @param commandBuffer The command buffer to end.
+*/
+void CommandRecorder::end(VkCommandBuffer commandBuffer)
+{
+	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to record secondary command buffer!");
+	}
+}
+
+/**
+* Finds the reusable command buffer of a slot for the current frame, if it was
+* recorded from the given version of its owner's state.
+*
+* @param slot The recording slot.
+* @param version The version of the state the commands depend on.
+*
+* @return The recorded command buffer, or VK_NULL_HANDLE if it must be recorded.
+*/
+VkCommandBuffer CommandRecorder::findRecorded(uint32_t slot, uint64_t version)
+{
+	SlotPool& pool = slotPool(slot);
+	if (!pool.recorded || pool.version != version) return VK_NULL_HANDLE;
+	return pool.reusable;
+}
+
+/**
+* Begins recording the reusable command buffer of a slot for the current frame,
+* replacing its previous contents. The buffer is only used by one frame in
+* flight, and that frame's fence has been waited on, so it needs no simultaneous
+* use. The framebuffer is left out of the inheritance info, so the buffer can
+* be executed whichever swapchain image the frame renders to.
+*
+* @param slot The recording slot, owned by the calling thread until end.
+* @param version The version of the state the commands depend on.
+* @param inheritanceInfo The render pass and subpass recorded into.
+*
+* @return The command buffer in the recording state.
+*/
+VkCommandBuffer CommandRecorder::beginReusable(
+	uint32_t slot,
+	uint64_t version,
+	const VkCommandBufferInheritanceInfo& inheritanceInfo)
+{
+	SlotPool& pool = slotPool(slot);
+	if (pool.reusable == VK_NULL_HANDLE)
+	{
+		pool.reusablePool = m_device.createCommandPool(0);
+
+		VkCommandBufferAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+		allocInfo.commandPool = pool.reusablePool;
+		allocInfo.commandBufferCount = 1;
+
+		if (vkAllocateCommandBuffers(
+			m_device.device(),
+			&allocInfo,
+			&pool.reusable) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to allocate reusable command buffer!");
+		}
+	}
+	else
+	{
+		vkResetCommandPool(m_device.device(), pool.reusablePool, 0);
+	}
+	pool.version = version;
+	pool.recorded = true;
+
+	VkCommandBufferInheritanceInfo anyFramebuffer = inheritanceInfo;
+	anyFramebuffer.framebuffer = VK_NULL_HANDLE;
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+	beginInfo.pInheritanceInfo = &anyFramebuffer;
+
+	if (vkBeginCommandBuffer(pool.reusable, &beginInfo) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to begin reusable command buffer!");
+	}
+	return pool.reusable;
+}
+
+/**
+* Marks every reusable command buffer as needing to be recorded again, such as
+* when the render pass or extent they were recorded for changes.
+*/
+void CommandRecorder::invalidate()
+{
+	for (SlotPool& pool : m_pools)
+	{
+		pool.recorded = false;
+	}
+}
+
+CommandRecorder::SlotPool& CommandRecorder::slotPool(uint32_t slot)
+{
+	return m_pools[static_cast<size_t>(m_frameIndex) * m_slotCount + slot];
+}
+} // namespace wrengine
\ No newline at end of file
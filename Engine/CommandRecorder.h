@@ -0,0 +1,73 @@
+#pragma once
+
+#include "Device.h"
+#include "Swapchain.h"
+
+//std
+#include <vector>
+
+namespace wrengine
+{
+/**
+* Hands out secondary command buffers for recording render pass contents on
+* several threads. Each recording slot has a command pool per frame in flight,
+* and a slot must only be recorded on by one thread at a time, so pools need no
+* locking. Pools are reset as a whole at the start of their frame, once its
+* fence has been waited on, and their command buffers reused.
+*
+* Each slot also has a reusable command buffer per frame in flight, kept along
+* with the version of the state it was recorded from, and executed again for as
+* long as the recorder's owner reports the same version.
+*/
+class CommandRecorder
+{
+public:
+	CommandRecorder(Device& device, uint32_t slotCount);
+	~CommandRecorder();
+
+	// not copyable
+	CommandRecorder(const CommandRecorder&) = delete;
+	CommandRecorder& operator=(const CommandRecorder&) = delete;
+
+	void beginFrame(int frameIndex);
+	VkCommandBuffer begin(
+		uint32_t slot,
+		const VkCommandBufferInheritanceInfo& inheritanceInfo);
+	void end(VkCommandBuffer commandBuffer);
+
+	VkCommandBuffer findRecorded(uint32_t slot, uint64_t version);
+	VkCommandBuffer beginReusable(
+		uint32_t slot,
+		uint64_t version,
+		const VkCommandBufferInheritanceInfo& inheritanceInfo);
+	void invalidate();
+
+	uint32_t getSlotCount() const { return m_slotCount; }
+
+private:
+	/**
+	* A command pool and the secondary buffers allocated from it.
+	*/
+	struct SlotPool
+	{
+		VkCommandPool pool = VK_NULL_HANDLE;
+		std::vector<VkCommandBuffer> commandBuffers;
+		size_t used = 0;
+
+		// reusable buffer, in a pool of its own so it survives frame resets
+		VkCommandPool reusablePool = VK_NULL_HANDLE;
+		VkCommandBuffer reusable = VK_NULL_HANDLE;
+		uint64_t version = 0;
+		bool recorded = false;
+	};
+
+	SlotPool& slotPool(uint32_t slot);
+
+	Device& m_device;
+	uint32_t m_slotCount;
+	int m_frameIndex = 0;
+
+	// indexed by frame then slot
+	std::vector<SlotPool> m_pools;
+};
+} // namespace wrengine
\ No newline at end of file
@@ -0,0 +1,72 @@
+#include "ComputePipeline.h"
+
+// std
+#include <stdexcept>
+
+namespace wrengine
+{
+/**
+* Creates a compute pipeline from a SPIR-V shader file. Will throw a runtime
+* error on failure.
+*
+* @param device The device to create the pipeline on.
+* @param compFilepath Path to the SPIR-V compute shader code.
+* @param pipelineLayout The layout of the pipeline's sets and push constants.
+*/
+ComputePipeline::ComputePipeline(
+	Device& device,
+	const std::string& compFilepath,
+	VkPipelineLayout pipelineLayout) :
+	m_device{ device }
+{
+	PipelineCache& pipelineCache = m_device.getPipelineCache();
+	m_compShaderModule = pipelineCache.getShaderModule(compFilepath);
+
+	VkComputePipelineCreateInfo createInfo{};
+	createInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	createInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	createInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	createInfo.stage.module = m_compShaderModule;
+	createInfo.stage.pName = "main";
+	createInfo.layout = pipelineLayout;
+	createInfo.basePipelineIndex = -1;
+	createInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+	if (vkCreateComputePipelines(
+		m_device.device(),
+		pipelineCache.getCache(),
+		1,
+		&createInfo,
+		nullptr,
+		&m_computePipeline) != VK_SUCCESS)
+	{
+		throw std::runtime_error("unable to create compute pipeline!");
+	}
+}
+
+ComputePipeline::~ComputePipeline()
+{
+	// command buffers in flight may still be bound to this pipeline, the shader
+	// module is owned by the device's pipeline cache
+	VkDevice device = m_device.device();
+	m_device.retire(
+		[device, pipeline = m_computePipeline]()
+		{
+			vkDestroyPipeline(device, pipeline, nullptr);
+		});
+}
+
+/**
+* Submits a call to bind the pipeline ready for dispatch.
+*
+* @param commandBuffer The command buffer into which the bind command is
+* recorded.
+*/
+void ComputePipeline::bind(VkCommandBuffer commandBuffer)
+{
+	vkCmdBindPipeline(
+		commandBuffer,
+		VK_PIPELINE_BIND_POINT_COMPUTE,
+		m_computePipeline);
+}
+} // namespace wrengine
\ No newline at end of file
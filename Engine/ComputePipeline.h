@@ -0,0 +1,33 @@
+#pragma once
+
+#include "Device.h"
+
+// std
+#include <string>
+
+namespace wrengine
+{
+/**
+* Encapsulation for a vulkan compute pipeline object.
+*/
+class ComputePipeline
+{
+public:
+	ComputePipeline(
+		Device& device,
+		const std::string& compFilepath,
+		VkPipelineLayout pipelineLayout);
+	~ComputePipeline();
+
+	// should not be copied
+	ComputePipeline(const ComputePipeline&) = delete;
+	ComputePipeline& operator=(const ComputePipeline&) = delete;
+
+	void bind(VkCommandBuffer commandBuffer);
+
+private:
+	Device& m_device;
+	VkPipeline m_computePipeline;
+	VkShaderModule m_compShaderModule;
+};
+} // namespace wrengine
\ No newline at end of file
@@ -11,6 +11,12 @@
 #define WR_FILTER_CUBIC     VK_FILTER_CUBIC_EXT
 #define WR_FILTER_CUBIC_IMG VK_FILTER_CUBIC_EXT
 
+// texture format options
+#define WR_FORMAT_RGBA8_SRGB  VK_FORMAT_R8G8B8A8_SRGB
+#define WR_FORMAT_RGBA8_UNORM VK_FORMAT_R8G8B8A8_UNORM
+#define WR_FORMAT_RG8_UNORM   VK_FORMAT_R8G8_UNORM
+#define WR_FORMAT_R8_UNORM    VK_FORMAT_R8_UNORM
+
 #endif // WR_VULKAN
 
 namespace wrengine
@@ -0,0 +1,83 @@
+#include "DeletionQueue.h"
+
+namespace wrengine
+{
+DeletionQueue::~DeletionQueue()
+{
+	flush();
+}
+
+/**
+* Retires a resource. The deleter runs once the current frame has completed on
+* the device.
+*
+* @param deleter Callback destroying the resource.
+*/
+void DeletionQueue::push(std::function<void()> deleter)
+{
+	std::scoped_lock<std::mutex> lock(m_mutex);
+	m_entries.push_back({ m_frame, std::move(deleter) });
+}
+
+/**
+* Sets the number of the frame currently being recorded. Resources retired from
+* now on are tagged with this frame.
+*
+* @param frame The current frame number.
+*/
+void DeletionQueue::setFrame(uint64_t frame)
+{
+	std::scoped_lock<std::mutex> lock(m_mutex);
+	m_frame = frame;
+}
+
+/**
+* Runs the deleters of all resources retired on or before a completed frame.
+*
+* @param completedFrame Number of the latest frame known to have finished
+* executing on the device.
+*/
+void DeletionQueue::collect(uint64_t completedFrame)
+{
+	std::deque<Entry> expired;
+	{
+		std::scoped_lock<std::mutex> lock(m_mutex);
+		while (!m_entries.empty() && m_entries.front().frame <= completedFrame)
+		{
+			expired.push_back(std::move(m_entries.front()));
+			m_entries.pop_front();
+		}
+	}
+	run(expired);
+}
+
+/**
+* Runs every pending deleter, including any retired by the deleters themselves.
+* Only safe once the device is idle.
+*/
+void DeletionQueue::flush()
+{
+	while (true)
+	{
+		std::deque<Entry> expired;
+		{
+			std::scoped_lock<std::mutex> lock(m_mutex);
+			if (m_entries.empty()) return;
+			expired.swap(m_entries);
+		}
+		run(expired);
+	}
+}
+
+/**
+* Runs deleters outside of the lock, so that a deleter may itself retire
+* further resources.
+*/
+void DeletionQueue::run(std::deque<Entry>& entries)
+{
+	for (auto& entry : entries)
+	{
+		entry.deleter();
+	}
+}
+} // namespace wrengine
\ No newline at end of file
@@ -0,0 +1,47 @@
+#pragma once
+
+//std
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+namespace wrengine
+{
+/**
+* Queue of deferred destruction callbacks for GPU resources. Each callback is
+* tagged with the frame number that was being recorded when the resource was
+* retired, and is run once the renderer reports that frame as complete, so
+* resources that a frame in flight may still reference are never destroyed
+* underneath it. All methods are thread safe.
+*/
+class DeletionQueue
+{
+public:
+	DeletionQueue() = default;
+	~DeletionQueue();
+
+	// not copyable
+	DeletionQueue(const DeletionQueue&) = delete;
+	DeletionQueue& operator=(const DeletionQueue&) = delete;
+
+	void push(std::function<void()> deleter);
+	void setFrame(uint64_t frame);
+	void collect(uint64_t completedFrame);
+	void flush();
+
+private:
+	struct Entry
+	{
+		uint64_t frame;
+		std::function<void()> deleter;
+	};
+
+	void run(std::deque<Entry>& entries);
+
+	// frame numbers only increase, so entries are ordered by frame
+	std::deque<Entry> m_entries;
+	uint64_t m_frame = 0;
+	std::mutex m_mutex;
+};
+} // namespace wrengine
\ No newline at end of file
@@ -36,6 +36,25 @@ DescriptorSetLayout::Builder& DescriptorSetLayout::Builder::addBinding(
 	return *this;
 }
 
+/**
+* Sets descriptor indexing flags on a binding, such as partially bound or update
+* after bind. Layouts with update after bind bindings must be allocated from a
+* pool created with VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT.
+*
+* @param binding Index of the binding, which must already have been added.
+* @param flags The binding flags.
+*
+* @return Reference to the builder object.
+*/
+DescriptorSetLayout::Builder& DescriptorSetLayout::Builder::setBindingFlags(
+	uint32_t binding,
+	VkDescriptorBindingFlags flags)
+{
+	assert(m_bindings.count(binding) == 1 && "binding flags set on missing binding");
+	m_bindingFlags[binding] = flags;
+	return *this;
+}
+
 /**
 * Builds the descriptor set layout using configured bindings.
 * 
@@ -43,21 +62,38 @@ DescriptorSetLayout::Builder& DescriptorSetLayout::Builder::addBinding(
 */
 std::unique_ptr<DescriptorSetLayout> DescriptorSetLayout::Builder::build() const
 {
-	return std::make_unique<DescriptorSetLayout>(m_device, m_bindings);
+	return std::make_unique<DescriptorSetLayout>(m_device, m_bindings, m_bindingFlags);
 }
 
 // ---------------------- Descriptor Set Layout ----------------------
 
-DescriptorSetLayout::DescriptorSetLayout(Device& device, BindingMap bindings) :
+DescriptorSetLayout::DescriptorSetLayout(
+	Device& device,
+	BindingMap bindings,
+	BindingFlagsMap bindingFlags) :
 	m_device{ device },
 	m_bindings{ bindings }
 {
 	std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings{};
+	std::vector<VkDescriptorBindingFlags> setLayoutBindingFlags{};
+	bool updateAfterBind = false;
 	for (auto [binding, descriptorSetLayoutBinding] : bindings)
 	{
 		setLayoutBindings.push_back(descriptorSetLayoutBinding);
+
+		auto flags = bindingFlags.find(binding);
+		setLayoutBindingFlags.push_back(flags != bindingFlags.end() ? flags->second : 0);
+		updateAfterBind |= (setLayoutBindingFlags.back() &
+			VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT) != 0;
 	}
 
+	VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+	bindingFlagsInfo.sType =
+		VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+	bindingFlagsInfo.bindingCount =
+		static_cast<uint32_t>(setLayoutBindingFlags.size());
+	bindingFlagsInfo.pBindingFlags = setLayoutBindingFlags.data();
+
 	VkDescriptorSetLayoutCreateInfo descriptorSetLayoutInfo{};
 	descriptorSetLayoutInfo.sType =
 		VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
@@ -65,6 +101,16 @@ DescriptorSetLayout::DescriptorSetLayout(Device& device, BindingMap bindings) :
 		static_cast<uint32_t>(setLayoutBindings.size());
 	descriptorSetLayoutInfo.pBindings = setLayoutBindings.data();
 
+	if (!bindingFlags.empty())
+	{
+		descriptorSetLayoutInfo.pNext = &bindingFlagsInfo;
+	}
+	if (updateAfterBind)
+	{
+		descriptorSetLayoutInfo.flags =
+			VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+	}
+
 	if (vkCreateDescriptorSetLayout(
 		m_device.device(),
 		&descriptorSetLayoutInfo,
@@ -270,10 +316,12 @@ DescriptorWriter& DescriptorWriter::writeBuffer(
 * @param binding The binding location of the descriptor into which the image
 * info will be written.
 * @param bufferInfo Ptr to structure describing the image info to write.
+* @param arrayElement (Optional) Element of an arrayed binding to write.
 */
 DescriptorWriter& DescriptorWriter::writeImage(
 	uint32_t binding,
-	VkDescriptorImageInfo* imageInfo)
+	VkDescriptorImageInfo* imageInfo,
+	uint32_t arrayElement)
 {
 	assert(
 		m_descriptorSetLayout.m_bindings.count(binding) == 1 &&
@@ -282,13 +330,14 @@ DescriptorWriter& DescriptorWriter::writeImage(
 		m_descriptorSetLayout.m_bindings[binding];
 
 	assert(
-		bindingDescription.descriptorCount == 1 &&
-		"binding single descriptor info, but binding expects multiple");
+		arrayElement < bindingDescription.descriptorCount &&
+		"array element is outside the binding");
 
 	VkWriteDescriptorSet write{};
 	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
 	write.descriptorType = bindingDescription.descriptorType;
 	write.dstBinding = binding;
+	write.dstArrayElement = arrayElement;
 	write.pImageInfo = imageInfo;
 	write.descriptorCount = 1;
 
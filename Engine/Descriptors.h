@@ -28,6 +28,7 @@ namespace wrengine
 class DescriptorSetLayout
 {
 	typedef std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> BindingMap;
+	typedef std::unordered_map<uint32_t, VkDescriptorBindingFlags> BindingFlagsMap;
 
 public:
 	/**
@@ -45,16 +46,19 @@ public:
 			VkDescriptorType descriptorType,
 			VkShaderStageFlags stageFlags,
 			uint32_t count = 1);
+		Builder& setBindingFlags(uint32_t binding, VkDescriptorBindingFlags flags);
 		std::unique_ptr<DescriptorSetLayout> build() const;
 
 	private:
 		Device& m_device;
 		BindingMap m_bindings{};
+		BindingFlagsMap m_bindingFlags{};
 	};
 
 	DescriptorSetLayout(
 		Device& device,
-		BindingMap bindings);
+		BindingMap bindings,
+		BindingFlagsMap bindingFlags = BindingFlagsMap{});
 	~DescriptorSetLayout();
 
 	// not copyable
@@ -144,7 +148,8 @@ public:
 
 	DescriptorWriter& writeImage(
 		uint32_t binding,
-		VkDescriptorImageInfo* imageInfo);
+		VkDescriptorImageInfo* imageInfo,
+		uint32_t arrayElement = 0);
 
 	bool build(VkDescriptorSet& set);
 	void overwrite(VkDescriptorSet& set);
@@ -52,6 +52,35 @@ void DestroyDebugUtilsMessengerEXT(
 	}
 }
 
+/**
+* Releases the command pools of a thread when it exits, such as a worker of a
+* thread pool being destroyed. A thread may have used several devices.
+*/
+struct ThreadCommandPoolReleaser
+{
+	std::vector<std::weak_ptr<ThreadCommandPools>> registries;
+
+	~ThreadCommandPoolReleaser()
+	{
+		for (auto& registry : registries)
+		{
+			auto pools = registry.lock();
+			if (!pools) continue;
+
+			std::scoped_lock<std::mutex> lock(pools->mutex);
+			auto it = pools->pools.find(std::this_thread::get_id());
+			if (it == pools->pools.end()) continue;
+
+			if (pools->device != VK_NULL_HANDLE)
+			{
+				vkDestroyCommandPool(pools->device, it->second, nullptr);
+			}
+			pools->pools.erase(it);
+		}
+	}
+};
+static thread_local ThreadCommandPoolReleaser threadCommandPoolReleaser;
+
 Device::Device(Window& window) : m_window{ window }
 {
 	createInstance();
@@ -59,11 +88,37 @@ Device::Device(Window& window) : m_window{ window }
 	createSurface();
 	pickPhysicalDevice();
 	createLogicalDevice();
+	m_threadCommandPools->device = m_device;
+	m_allocator = std::make_unique<MemoryAllocator>(m_device, m_physicalDevice);
+	m_imagePool = std::make_unique<ImagePool>(*this);
+	m_pipelineCache = std::make_unique<PipelineCache>(
+		m_device,
+		m_properties,
+		PIPELINE_CACHE_FILE);
 	createCommandPool();
 }
 Device::~Device()
 {
+	// anything still queued for deletion may reference the allocator and pools
+	waitIdle();
+	m_deletionQueue.flush();
+
+	// pipelines compiled this launch are reused by the next
+	m_pipelineCache->save();
+	m_pipelineCache.reset();
+
+	{
+		std::scoped_lock<std::mutex> lock(m_threadCommandPools->mutex);
+		for (auto& [threadId, commandPool] : m_threadCommandPools->pools)
+		{
+			vkDestroyCommandPool(m_device, commandPool, nullptr);
+		}
+		m_threadCommandPools->pools.clear();
+		m_threadCommandPools->device = VK_NULL_HANDLE;
+	}
 	vkDestroyCommandPool(m_device, m_commandPool, nullptr);
+	m_imagePool.reset();
+	m_allocator.reset();
 	vkDestroyDevice(m_device, nullptr);
 
 	if (enableValidationLayers)
@@ -184,7 +239,8 @@ VkFormat Device::findSupportedFormat(
 }
 
 /**
-* Creates a VkBuffer object using provided VkBuffer and VkDeviceMemory pointers.
+* Creates a VkBuffer object and binds it to memory from the device allocator.
+* Host visible transfer source buffers are placed in the staging pool.
 * 
 * @param size Size in bytes of the buffer to be created.
 * @param usage Bitmask of VKBufferUsageFlagBits specifyiong allowed usages of
@@ -192,7 +248,7 @@ VkFormat Device::findSupportedFormat(
 * @param properties Bitmask of VkMemoryPropertyFlagBits specifying the required
 * memory properties of the buffer.
 * @param buffer Pointer to the created buffer, passed by reference.
-* @param bufferMemory Pointer to the memory of created buffer, passed by
+* @param bufferMemory Allocation backing the created buffer, passed by
 * reference.
 */
 void Device::createBuffer(
@@ -200,7 +256,7 @@ void Device::createBuffer(
 	VkBufferUsageFlags usage,
 	VkMemoryPropertyFlags properties,
 	VkBuffer& buffer,
-	VkDeviceMemory& bufferMemory)
+	Allocation& bufferMemory)
 {
 	VkBufferCreateInfo bufferInfo{};
 	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -216,29 +272,142 @@ void Device::createBuffer(
 	VkMemoryRequirements memRequirements;
 	vkGetBufferMemoryRequirements(m_device, buffer, &memRequirements);
 
-	VkMemoryAllocateInfo allocInfo{};
-	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	allocInfo.allocationSize = memRequirements.size;
-	allocInfo.memoryTypeIndex =
-		findMemoryType(
-			memRequirements.memoryTypeBits,
-			properties);
+	bool isStaging =
+		usage == VK_BUFFER_USAGE_TRANSFER_SRC_BIT &&
+		(properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+
+	bufferMemory = m_allocator->allocate(
+		memRequirements,
+		properties,
+		isStaging ? AllocationType::Staging : AllocationType::Buffer);
+
+	if (vkBindBufferMemory(
+		m_device,
+		buffer,
+		bufferMemory.memory,
+		bufferMemory.offset) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to bind buffer memory!");
+	}
+}
+
+/**
+* Submits work to the graphics queue. Queue access is externally synchronized,
+* so this may be called from any thread.
+* 
+* @param submitCount Number of submit info structures.
+* @param submits Pointer to the submit info structures.
+* @param fence Optional fence to signal on completion.
+* 
+* @return Result of the queue submission.
+*/
+VkResult Device::submitGraphics(
+	uint32_t submitCount,
+	const VkSubmitInfo* submits,
+	VkFence fence)
+{
+	std::scoped_lock<std::mutex> lock(m_queueMutex);
+	return vkQueueSubmit(m_graphicsQueue, submitCount, submits, fence);
+}
+
+/**
+* Queues an image for presentation on the present queue. Queue access is
+* externally synchronized, so this may be called from any thread. The present
+* queue is distinct from the graphics queue where the device allows, so that a
+* present blocking in the presentation engine, as FIFO presents may, only holds
+* the present lock. If the queues alias the graphics queue lock is held.
+* 
+* @param presentInfo The present info structure.
+* 
+* @return Result of the present call.
+*/
+VkResult Device::present(const VkPresentInfoKHR* presentInfo)
+{
+	std::mutex& mutex =
+		m_presentQueue == m_graphicsQueue ? m_queueMutex : m_presentMutex;
+	std::scoped_lock<std::mutex> lock(mutex);
+	return vkQueuePresentKHR(m_presentQueue, presentInfo);
+}
+
+/**
+* Blocks until the logical device is idle. Holds the queue locks while waiting,
+* as vkDeviceWaitIdle requires exclusive access to every queue.
+*/
+void Device::waitIdle()
+{
+	std::scoped_lock<std::mutex, std::mutex> lock(m_queueMutex, m_presentMutex);
+	vkDeviceWaitIdle(m_device);
+}
+
+/**
+* Defers the destruction of a resource until every frame that may reference it
+* has finished executing. May be called from any thread.
+*
+* @param deleter Callback destroying the resource.
+*/
+void Device::retire(std::function<void()> deleter)
+{
+	m_deletionQueue.push(std::move(deleter));
+}
+
+/**
+* Creates a command pool on the graphics queue family. Will throw a runtime
+* error if unable to.
+* 
+* @param flags Bitmask of VkCommandPoolCreateFlagBits for the new pool.
+* 
+* @return The created command pool. The caller owns the pool.
+*/
+VkCommandPool Device::createCommandPool(VkCommandPoolCreateFlags flags)
+{
+	QueueFamilyIndices queueFamilyIndices = findPhysicalQueueFamilies();
+
+	VkCommandPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily;
+	poolInfo.flags = flags;
 
-	if (vkAllocateMemory(
+	VkCommandPool commandPool;
+	if (vkCreateCommandPool(
 		m_device,
-		&allocInfo,
+		&poolInfo,
 		nullptr,
-		&bufferMemory) != VK_SUCCESS)
+		&commandPool) != VK_SUCCESS)
 	{
-		throw std::runtime_error("failed to allocate vertex buffer memory!");
+		throw std::runtime_error("failed to create command pool!");
 	}
+	return commandPool;
+}
 
-	vkBindBufferMemory(m_device, buffer, bufferMemory, 0);
+/**
+* Gets the transient command pool owned by the calling thread, creating it on
+* first use. Command pools are not thread safe, so each thread that records
+* single time commands gets its own. A pool is destroyed when its thread exits,
+* or with the Device if that comes first. Single time commands are waited on
+* before they end, so an exiting thread has none pending.
+* 
+* @return The command pool for the calling thread.
+*/
+VkCommandPool Device::getThreadCommandPool()
+{
+	std::scoped_lock<std::mutex> lock(m_threadCommandPools->mutex);
+	auto [it, inserted] = m_threadCommandPools->pools.try_emplace(
+		std::this_thread::get_id(),
+		VK_NULL_HANDLE);
+	if (inserted)
+	{
+		it->second = createCommandPool(
+			VK_COMMAND_POOL_CREATE_TRANSIENT_BIT |
+			VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
+		threadCommandPoolReleaser.registries.push_back(m_threadCommandPools);
+	}
+	return it->second;
 }
 
 /**
 * Allocates, creates, and readies a command buffer to be used to submit a queue
-* of single time commands.
+* of single time commands. The buffer is allocated from the calling thread's
+* command pool, so must be ended on the same thread.
 * 
 * @return The single time command buffer object.
 */
@@ -247,7 +416,7 @@ VkCommandBuffer Device::beginSingleTimeCommands()
 	VkCommandBufferAllocateInfo allocInfo{};
 	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
 	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-	allocInfo.commandPool = m_commandPool;
+	allocInfo.commandPool = getThreadCommandPool();
 	allocInfo.commandBufferCount = 1;
 
 	VkCommandBuffer commandBuffer;
@@ -263,7 +432,9 @@ VkCommandBuffer Device::beginSingleTimeCommands()
 
 /**
 * Ends, submits to graphics queue, and finally frees the provided command
-* buffer.
+* buffer. Waits on a fence for this submission only, rather than idling the
+* queue, so uploads from other threads and the render loop are not stalled.
+* Will throw a runtime error if the submission fails.
 * 
 * @param commandBuffer The command buffer to end and submit.
 */
@@ -271,15 +442,29 @@ void Device::endSingleTimeCommands(VkCommandBuffer commandBuffer)
 {
 	vkEndCommandBuffer(commandBuffer);
 
+	VkFenceCreateInfo fenceInfo{};
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+	VkFence fence;
+	if (vkCreateFence(m_device, &fenceInfo, nullptr, &fence) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create single time command fence!");
+	}
+
 	VkSubmitInfo submitInfo{};
 	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 	submitInfo.commandBufferCount = 1;
 	submitInfo.pCommandBuffers = &commandBuffer;
 
-	vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-	vkQueueWaitIdle(m_graphicsQueue);
+	if (submitGraphics(1, &submitInfo, fence) != VK_SUCCESS)
+	{
+		vkDestroyFence(m_device, fence, nullptr);
+		throw std::runtime_error("failed to submit single time commands!");
+	}
+	vkWaitForFences(m_device, 1, &fence, VK_TRUE, UINT64_MAX);
+	vkDestroyFence(m_device, fence, nullptr);
 
-	vkFreeCommandBuffers(m_device, m_commandPool, 1, &commandBuffer);
+	vkFreeCommandBuffers(m_device, getThreadCommandPool(), 1, &commandBuffer);
 }
 
 /**
@@ -347,18 +532,17 @@ void Device::copyBufferToImage(
 }
 
 /**
-* Creates an image object using the provided VkImage and VkDeviceMemory
-* pointers.
+* Creates an image object and binds it to memory from the device allocator.
 * @param imageInfo The image creation info specification struct.
 * @param properties Bitmask specifying the required device memory properties.
 * @param image The created VkImage.
-* @param imageMemory The device memory for the created VkImage.
+* @param imageMemory Allocation backing the created VkImage.
 */
 void Device::createImageWithInfo(
 	const VkImageCreateInfo& imageInfo,
 	VkMemoryPropertyFlags properties,
 	VkImage& image,
-	VkDeviceMemory& imageMemory)
+	Allocation& imageMemory)
 {
 	if (vkCreateImage(m_device, &imageInfo, nullptr, &image) != VK_SUCCESS)
 	{
@@ -368,24 +552,16 @@ void Device::createImageWithInfo(
 	VkMemoryRequirements memRequirements;
 	vkGetImageMemoryRequirements(m_device, image, &memRequirements);
 
-	VkMemoryAllocateInfo allocInfo{};
-	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	allocInfo.allocationSize = memRequirements.size;
-	allocInfo.memoryTypeIndex =
-		findMemoryType(
-			memRequirements.memoryTypeBits,
-			properties);
+	imageMemory = m_allocator->allocate(
+		memRequirements,
+		properties,
+		AllocationType::Image);
 
-	if (vkAllocateMemory(
+	if (vkBindImageMemory(
 		m_device,
-		&allocInfo,
-		nullptr,
-		&imageMemory) != VK_SUCCESS)
-	{
-		throw std::runtime_error("failed to allocate image memory!");
-	}
-
-	if (vkBindImageMemory(m_device, image, imageMemory, 0) != VK_SUCCESS)
+		image,
+		imageMemory.memory,
+		imageMemory.offset) != VK_SUCCESS)
 	{
 		throw std::runtime_error("failed to bind image memory!");
 	}
@@ -407,7 +583,7 @@ void Device::createInstance()
 	appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
 	appInfo.pEngineName = "No Engine";
 	appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-	appInfo.apiVersion = VK_API_VERSION_1_0;
+	appInfo.apiVersion = VK_API_VERSION_1_2;
 
 	VkInstanceCreateInfo createInfo{};
 	createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -528,22 +704,52 @@ void Device::createLogicalDevice()
 		indices.presentFamily
 	};
 
-	float queuePriority = 1.0f;
+	// presents get a queue of their own when the family presenting is also the
+	// graphics family and has a second queue, so they never wait on submits
+	uint32_t familyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(m_physicalDevice, &familyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> families(familyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(
+		m_physicalDevice,
+		&familyCount,
+		families.data());
+	bool separatePresentQueue =
+		indices.presentFamily == indices.graphicsFamily &&
+		families[indices.graphicsFamily].queueCount > 1;
+
+	const float queuePriorities[2] = { 1.0f, 1.0f };
 	for (uint32_t queueFamily : uniqueQueueFamilies)
 	{
 		VkDeviceQueueCreateInfo queueCreateInfo = {};
 		queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
 		queueCreateInfo.queueFamilyIndex = queueFamily;
-		queueCreateInfo.queueCount = 1;
-		queueCreateInfo.pQueuePriorities = &queuePriority;
+		queueCreateInfo.queueCount = separatePresentQueue ? 2 : 1;
+		queueCreateInfo.pQueuePriorities = queuePriorities;
 		queueCreateInfos.push_back(queueCreateInfo);
 	}
 
 	VkPhysicalDeviceFeatures deviceFeatures = {};
 	deviceFeatures.samplerAnisotropy = VK_TRUE;
 
+	// virtual texture feedback is written by fragment shaders
+	deviceFeatures.fragmentStoresAndAtomics = VK_TRUE;
+
+	// indirect sprite draws start at their run of the instance buffer
+	deviceFeatures.drawIndirectFirstInstance = VK_TRUE;
+
+	// descriptor indexing for the bindless texture table
+	VkPhysicalDeviceVulkan12Features vulkan12Features = {};
+	vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	vulkan12Features.descriptorIndexing = VK_TRUE;
+	vulkan12Features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+	vulkan12Features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+	vulkan12Features.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+	vulkan12Features.descriptorBindingPartiallyBound = VK_TRUE;
+	vulkan12Features.runtimeDescriptorArray = VK_TRUE;
+
 	VkDeviceCreateInfo createInfo = {};
 	createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+	createInfo.pNext = &vulkan12Features;
 
 	createInfo.queueCreateInfoCount =
 		static_cast<uint32_t>(queueCreateInfos.size());
@@ -577,31 +783,22 @@ void Device::createLogicalDevice()
 	}
 
 	vkGetDeviceQueue(m_device, indices.graphicsFamily, 0, &m_graphicsQueue);
-	vkGetDeviceQueue(m_device, indices.presentFamily, 0, &m_presentQueue);
+	vkGetDeviceQueue(
+		m_device,
+		indices.presentFamily,
+		separatePresentQueue ? 1 : 0,
+		&m_presentQueue);
 }
 
 /**
-* Creates the VkCommandPool object, or will throw a runtime error if unable to.
+* Creates the VkCommandPool object used for per frame command buffers, or will
+* throw a runtime error if unable to.
 */
 void Device::createCommandPool()
 {
-	QueueFamilyIndices queueFamilyIndices = findPhysicalQueueFamilies();
-
-	VkCommandPoolCreateInfo poolInfo = {};
-	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-	poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily;
-	poolInfo.flags =
+	m_commandPool = createCommandPool(
 		VK_COMMAND_POOL_CREATE_TRANSIENT_BIT |
-		VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-
-	if (vkCreateCommandPool(
-		m_device,
-		&poolInfo,
-		nullptr,
-		&m_commandPool) != VK_SUCCESS)
-	{
-		throw std::runtime_error("failed to create command pool!");
-	}
+		VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
 }
 
 /**
@@ -627,7 +824,36 @@ bool Device::isDeviceSuitable(VkPhysicalDevice device)
 	vkGetPhysicalDeviceFeatures(device, &supportedFeatures);
 
 	return indices.isComplete() && extensionsSupported && swapChainAdequate &&
-		supportedFeatures.samplerAnisotropy;
+		supportedFeatures.samplerAnisotropy &&
+		supportedFeatures.fragmentStoresAndAtomics &&
+		supportedFeatures.drawIndirectFirstInstance &&
+		supportsDescriptorIndexing(device);
+}
+
+/**
+* Checks that a physical device supports Vulkan 1.2 and the descriptor indexing
+* features used by the bindless texture table.
+*/
+bool Device::supportsDescriptorIndexing(VkPhysicalDevice device)
+{
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(device, &properties);
+	if (properties.apiVersion < VK_API_VERSION_1_2) return false;
+
+	VkPhysicalDeviceVulkan12Features vulkan12Features{};
+	vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+	VkPhysicalDeviceFeatures2 features{};
+	features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	features.pNext = &vulkan12Features;
+	vkGetPhysicalDeviceFeatures2(device, &features);
+
+	return vulkan12Features.descriptorIndexing &&
+		vulkan12Features.shaderSampledImageArrayNonUniformIndexing &&
+		vulkan12Features.descriptorBindingSampledImageUpdateAfterBind &&
+		vulkan12Features.descriptorBindingUpdateUnusedWhilePending &&
+		vulkan12Features.descriptorBindingPartiallyBound &&
+		vulkan12Features.runtimeDescriptorArray;
 }
 
 /**
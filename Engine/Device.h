@@ -1,10 +1,19 @@
 #pragma once
 
 #include "Window.h"
+#include "MemoryAllocator.h"
+#include "DeletionQueue.h"
+#include "ImagePool.h"
+#include "PipelineCache.h"
 
 //std
 #include <vector>
 #include <string>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <memory>
+#include <functional>
 
 namespace wrengine
 {
@@ -29,10 +38,28 @@ struct QueueFamilyIndices {
 	bool isComplete() { return graphicsFamilyHasValue && presentFamilyHasValue; }
 };
 
+/**
+* Transient command pools for single time commands, one per recording thread.
+* Shared between the Device and the threads using it, so a thread can release
+* its pool when it exits, and a pool outliving its device is never destroyed
+* twice. device is null once the Device has destroyed the pools.
+*/
+struct ThreadCommandPools
+{
+	std::mutex mutex;
+	VkDevice device = VK_NULL_HANDLE;
+	std::unordered_map<std::thread::id, VkCommandPool> pools;
+};
+
 /**
 * Abstraction over Vulkan physical and logical devices. Contains methods for
 * querying required device extensions and parameters. Operates validation layers
 * if NDEBUG is not defined, outputting to the standard error stream.
+*
+* The Device is the single owner of queue submission. All submits, presents and
+* idle waits go through the Device so that access to the shared queue is
+* serialized, and single time commands are recorded from a command pool owned
+* by the calling thread, allowing resources to be created from any thread.
 */
 class Device
 {
@@ -44,6 +71,9 @@ public:
 	static constexpr bool enableValidationLayers = true;
 #endif
 
+	// pipeline cache file, in the working directory alongside the shaders
+	static constexpr const char* PIPELINE_CACHE_FILE = "pipeline.cache";
+
 	Device(Window& window);
 	~Device();
 
@@ -61,6 +91,10 @@ public:
 	VkQueue presentQueue() { return m_presentQueue; }
 	VkInstance getInstance() { return m_instance; }
 	VkPhysicalDevice getPhysicalDevice() { return m_physicalDevice; }
+	MemoryAllocator& getAllocator() { return *m_allocator; }
+	DeletionQueue& getDeletionQueue() { return m_deletionQueue; }
+	ImagePool& getImagePool() { return *m_imagePool; }
+	PipelineCache& getPipelineCache() { return *m_pipelineCache; }
 	uint32_t getGraphicsQueueFamily();
 	VkPhysicalDeviceProperties getPhysicalDeviceProperties();
 	SwapChainSupportDetails getSwapChainSupport();
@@ -74,13 +108,28 @@ public:
 		VkImageTiling tiling,
 		VkFormatFeatureFlags features);
 
+	// thread safe queue access
+	VkResult submitGraphics(
+		uint32_t submitCount,
+		const VkSubmitInfo* submits,
+		VkFence fence);
+	VkResult present(const VkPresentInfoKHR* presentInfo);
+	void waitIdle();
+
+	// deferred destruction
+	void retire(std::function<void()> deleter);
+
+	// command pools
+	VkCommandPool createCommandPool(VkCommandPoolCreateFlags flags);
+	VkCommandPool getThreadCommandPool();
+
 	// buffer helper functions
 	void createBuffer(
 		VkDeviceSize size,
 		VkBufferUsageFlags usage,
 		VkMemoryPropertyFlags properties,
 		VkBuffer& buffer,
-		VkDeviceMemory& bufferMemory);
+		Allocation& bufferMemory);
 	VkCommandBuffer beginSingleTimeCommands();
 	void endSingleTimeCommands(VkCommandBuffer commandBuffer);
 	void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
@@ -95,7 +144,7 @@ public:
 		const VkImageCreateInfo& imageInfo,
 		VkMemoryPropertyFlags properties,
 		VkImage& image,
-		VkDeviceMemory& imageMemory);
+		Allocation& imageMemory);
 
 private:
 	void createInstance();
@@ -107,6 +156,7 @@ private:
 
 	// helper functions
 	bool isDeviceSuitable(VkPhysicalDevice device);
+	bool supportsDescriptorIndexing(VkPhysicalDevice device);
 	std::vector<const char*> getRequiredExtensions();
 	bool checkValidationLayerSupport();
 	QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device);
@@ -126,6 +176,20 @@ private:
 	VkQueue m_graphicsQueue;
 	VkQueue m_presentQueue;
 	VkPhysicalDeviceProperties m_properties;
+	std::unique_ptr<MemoryAllocator> m_allocator;
+	DeletionQueue m_deletionQueue;
+	std::unique_ptr<ImagePool> m_imagePool;
+	std::unique_ptr<PipelineCache> m_pipelineCache;
+
+	// guards the graphics queue, and the present queue when they alias. A
+	// present queue of its own has its own lock, so presents blocking in the
+	// presentation engine do not hold up submissions from loader threads
+	std::mutex m_queueMutex;
+	std::mutex m_presentMutex;
+
+	// transient pools for single time commands, released as threads exit
+	std::shared_ptr<ThreadCommandPools> m_threadCommandPools =
+		std::make_shared<ThreadCommandPools>();
 
 	const std::vector<const char*> validationLayers =
 	{
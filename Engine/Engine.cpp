@@ -7,6 +7,8 @@
 
 // systems
 #include "RenderSystem.h"
+#include "TilemapSystem.h"
+#include "CommandRecorder.h"
 #include "PointLightSystem.h"
 
 // imgui
@@ -14,17 +16,23 @@
 
 // std
 #include <stdexcept>
+#include <algorithm>
 #include <array>
 #include <iostream>
 #include <tuple>
 #include <chrono>
+#include <cstring>
+#include <iterator>
+#include <thread>
 
 namespace wrengine
 {
 Engine::Engine(const EngineConfigInfo configInfo) :
 	m_width{ configInfo.width },
 	m_height{ configInfo.height },
-	m_windowName{ configInfo.windowName }
+	m_windowName{ configInfo.windowName },
+	m_presentProfile{ configInfo.presentProfile },
+	m_idleMode{ configInfo.idleMode }
 {
 	m_globalDescriptorPool =
 		DescriptorPool::Builder(m_device)
@@ -35,8 +43,13 @@ Engine::Engine(const EngineConfigInfo configInfo) :
 		.addPoolSize(
 			VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
 			Swapchain::MAX_FRAMES_IN_FLIGHT)
+		.addPoolSize(
+			VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			3 * Swapchain::MAX_FRAMES_IN_FLIGHT)
 		.build();
 
+	m_textureTable = std::make_unique<BindlessTextureTable>(m_device);
+
 	m_userInterface = std::make_unique<UserInterface>(
 		m_window,
 		m_device,
@@ -73,12 +86,52 @@ void Engine::run()
 		uboBuffers[i]->map();
 	}
 
+	// read back once the frame's fence has been waited on, the frame ending
+	// with a barrier making its shader writes visible to the host
+	std::vector<std::unique_ptr<Buffer>> feedbackBuffers(
+		Swapchain::MAX_FRAMES_IN_FLIGHT);
+	for (int i = 0; i < feedbackBuffers.size(); ++i)
+	{
+		feedbackBuffers[i] = std::make_unique<Buffer>(
+			m_device,
+			sizeof(uint32_t),
+			FEEDBACK_BUFFER_WORDS,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+		feedbackBuffers[i]->map();
+		std::memset(
+			feedbackBuffers[i]->getMappedMemory(),
+			0,
+			feedbackBuffers[i]->getBufferSize());
+		feedbackBuffers[i]->flush();
+	}
+
+	// the light list and light tiles are read by every lit fragment, and the
+	// tiles written by the light cull pass
 	auto globalSetLayout = DescriptorSetLayout::Builder(m_device)
 		.addBinding(
 			0,
 			VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-			VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT)
+			VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT)
+		.addBinding(
+			1,
+			VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			VK_SHADER_STAGE_FRAGMENT_BIT)
+		.addBinding(
+			2,
+			VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT)
+		.addBinding(
+			3,
+			VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT)
 		.build();
+
+	PointLightSystem pointLightSystem{
+		m_device,
+		globalSetLayout->getDescriptorSetLayout(),
+		m_scene
+	};
 	
 	std::vector<VkDescriptorSet> globalDescriptorSets(
 		Swapchain::MAX_FRAMES_IN_FLIGHT);
@@ -86,45 +139,50 @@ void Engine::run()
 	for (int i = 0; i < globalDescriptorSets.size(); ++i)
 	{
 		VkDescriptorBufferInfo bufferInfo = uboBuffers[i]->descriptorInfo();
+		VkDescriptorBufferInfo feedbackInfo = feedbackBuffers[i]->descriptorInfo();
+		VkDescriptorBufferInfo lightInfo = pointLightSystem.getLightBufferInfo(i);
+		VkDescriptorBufferInfo tileInfo = pointLightSystem.getTileBufferInfo(i);
 
 		DescriptorWriter(*globalSetLayout, *m_globalDescriptorPool)
 			.writeBuffer(0, &bufferInfo)
+			.writeBuffer(1, &feedbackInfo)
+			.writeBuffer(2, &lightInfo)
+			.writeBuffer(3, &tileInfo)
 			.build(globalDescriptorSets[i]);
 	}
 
-	auto materialSetLayout = DescriptorSetLayout::Builder(m_device)
-		.addBinding(
-			0,
-			VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-			VK_SHADER_STAGE_FRAGMENT_BIT)
-		.addBinding(
-			1,
-			VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-			VK_SHADER_STAGE_FRAGMENT_BIT)
-		.build();
-
 	auto materialView = m_scene->getAllEntitiesWith<SpriteRenderComponent>();
 	for (auto&& [entity, renderComponent] : materialView.each())
 	{
-		Material& material = renderComponent.material;
-		VkDescriptorImageInfo albedoInfo = material.albedo->descriptorInfo();
-		VkDescriptorImageInfo normalsInfo = material.normalMap->descriptorInfo();
-
-		DescriptorWriter(*materialSetLayout, *m_textureDescriptorPool)
-			.writeImage(0, &albedoInfo)
-			.writeImage(1, &normalsInfo)
-			.build(material.materialDescriptor);
+		assignTextureIndices(renderComponent.material);
 	}
 
 	RenderSystem renderSystem{ 
 		m_device,
 		m_renderer.getSwapchainRenderPass(),
 		globalSetLayout->getDescriptorSetLayout(),
-		materialSetLayout->getDescriptorSetLayout(),
+		m_textureTable->getSetLayout(),
+		m_textureTable->getDescriptorSet(),
+		m_scene,
+		m_frameWorkers,
+		[this]() { requestFrame(); }
+	};
+
+	TilemapSystem tilemapSystem{
+		m_device,
+		m_renderer.getSwapchainRenderPass(),
+		globalSetLayout->getDescriptorSetLayout(),
+		*m_textureTable,
 		m_scene
 	};
 
-	PointLightSystem pointLightSystem{ m_scene };
+	// the render pass is recorded as secondary command buffers, one slot each
+	// for the interface on this thread, and the tilemaps and sprites on workers
+	constexpr uint32_t UI_SLOT = 0;
+	constexpr uint32_t TILEMAP_SLOT = 1;
+	constexpr uint32_t SPRITE_SLOT = 2;
+	CommandRecorder commandRecorder{ m_device, 3 };
+	uint64_t recordedSwapchain = m_renderer.getSwapchainGeneration();
 
 	m_scene->onSceneStart();
 	if (m_postConstructCallback) m_postConstructCallback();
@@ -134,10 +192,62 @@ void Engine::run()
 
 	m_window.show();
 
+	// frames left to render before idling
+	uint32_t settleFrames = IDLE_SETTLE_FRAMES;
+
+	// earliest input the next presented frame responds to
+	bool inputPending = false;
+	std::chrono::steady_clock::time_point inputTime;
+
 	while (!m_window.shouldClose())
 	{
+		// -------------- frame pacing --------------
+		PresentProfile profile = m_renderer.getPresentProfile();
+		if (profile == PresentProfile::PowerSaver)
+		{
+			std::this_thread::sleep_until(
+				currentTime +
+				std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+					std::chrono::duration<float>(1.0f / POWER_SAVER_FRAME_RATE)));
+		}
+		else if (profile == PresentProfile::LowLatency)
+		{
+			// sample input once the previous frame has finished, rather than
+			// before waiting on it
+			m_renderer.waitForFrame();
+		}
+
 		// note glfwPollEvents() may block, e.g. on window resize
-		glfwPollEvents();
+		if (m_idleMode && settleFrames == 0)
+		{
+			// woken early by events, or by requestFrame posting an empty one
+			glfwWaitEventsTimeout(IDLE_WAIT_SECONDS);
+
+			// time spent waiting is not simulated
+			currentTime = std::chrono::high_resolution_clock::now();
+		}
+		else
+		{
+			glfwPollEvents();
+		}
+		if (!inputPending)
+		{
+			inputPending = m_window.takeInputTime(inputTime);
+		}
+
+		// anything that changes the frame restarts the settle frames, and
+		// scripts that animate keep the engine rendering
+		bool animating = m_scene->isAnimating();
+		if (m_frameRequested.exchange(false) || m_window.hadEvents() || animating)
+		{
+			m_window.resetEventsFlag();
+			settleFrames = IDLE_SETTLE_FRAMES;
+		}
+		if (m_idleMode)
+		{
+			if (settleFrames == 0) continue;
+			--settleFrames;
+		}
 
 		// -------------- frame timing --------------
 		std::chrono::steady_clock::time_point newTime =
@@ -151,10 +261,12 @@ void Engine::run()
 		currentTime = newTime;
 
 		clearAsyncList();
+		m_textureTable->collect();
 
 		if (m_normalCoordsDirty)
 		{
 			renderSystem.updateNormalCoords(m_coordinateScales);
+			tilemapSystem.updateNormalCoords(m_coordinateScales);
 			m_normalCoordsDirty = false;
 		}
 
@@ -164,6 +276,8 @@ void Engine::run()
 		if (VkCommandBuffer commandBuffer = m_renderer.beginFrame())
 		{
 			int frameIndex = m_renderer.getFrameIndex();
+			streamVirtualTextures(*feedbackBuffers[frameIndex], commandBuffer);
+
 			FrameInfo frameInfo
 			{
 				frameIndex,
@@ -186,8 +300,8 @@ void Engine::run()
 				 1.0f);
 
 			GlobalUbo ubo{};
-			// set the point light positions/number
-			pointLightSystem.update(ubo);
+			// set the point lights and the light tile grid
+			pointLightSystem.update(ubo, frameIndex, frameExtent);
 			// set the view and projection matrices from the active camera
 			std::shared_ptr<Camera> camera = m_scene->getActiveCamera();
 			ubo.projView = camera->getProjection() * camera->getView();
@@ -195,19 +309,117 @@ void Engine::run()
 			uboBuffers[frameIndex]->writeToBuffer(&ubo);
 			uboBuffers[frameIndex]->flush();
 
+			// cull sprites against the camera, and bin lights into tiles,
+			// recorded before the render pass
+			renderSystem.cullEntities(frameInfo);
+			pointLightSystem.cullLights(frameInfo);
+
 			// FRAME PHASE 2
-			// render the frame
+			// render the frame, elements may change the scene so are run before
+			// the scene is recorded
 			m_userInterface->startFrame();
-			m_renderer.beginSwapchainRenderPass(commandBuffer);
-			renderSystem.renderEntities(frameInfo);
 			m_userInterface->getElementManager()->runElements();
-			m_userInterface->render(commandBuffer);
+
+			commandRecorder.beginFrame(frameIndex);
+			if (m_renderer.getSwapchainGeneration() != recordedSwapchain)
+			{
+				commandRecorder.invalidate();
+				recordedSwapchain = m_renderer.getSwapchainGeneration();
+			}
+			VkCommandBufferInheritanceInfo inheritanceInfo =
+				m_renderer.getInheritanceInfo();
+			auto recordPass = [&](uint32_t slot, auto&& record)
+				{
+					FrameInfo passInfo = frameInfo;
+					passInfo.commandBuffer = commandRecorder.begin(slot, inheritanceInfo);
+					m_renderer.setViewport(passInfo.commandBuffer);
+					record(passInfo);
+					commandRecorder.end(passInfo.commandBuffer);
+					return passInfo.commandBuffer;
+				};
+
+			std::future<VkCommandBuffer> tilemapPass = m_frameWorkers.submit([&]()
+				{
+					return recordPass(TILEMAP_SLOT, [&](const FrameInfo& passInfo)
+						{
+							tilemapSystem.renderTilemaps(passInfo);
+						});
+				});
+
+			// the sprite pass is only recorded again when its commands change
+			uint64_t spriteVersion = renderSystem.getCommandVersion();
+			VkCommandBuffer recordedSprites =
+				commandRecorder.findRecorded(SPRITE_SLOT, spriteVersion);
+			std::future<VkCommandBuffer> spritePass;
+			if (recordedSprites == VK_NULL_HANDLE)
+			{
+				spritePass = m_frameWorkers.submit([&]()
+					{
+						FrameInfo passInfo = frameInfo;
+						passInfo.commandBuffer = commandRecorder.beginReusable(
+							SPRITE_SLOT,
+							spriteVersion,
+							inheritanceInfo);
+						m_renderer.setViewport(passInfo.commandBuffer);
+						renderSystem.renderEntities(passInfo);
+						commandRecorder.end(passInfo.commandBuffer);
+						return passInfo.commandBuffer;
+					});
+			}
+
+			VkCommandBuffer uiPass = recordPass(UI_SLOT, [&](const FrameInfo& passInfo)
+				{
+					m_userInterface->render(passInfo.commandBuffer);
+				});
+
+			// executed in the order they were drawn inline
+			std::array<VkCommandBuffer, 3> passes{
+				tilemapPass.get(),
+				spritePass.valid() ? spritePass.get() : recordedSprites,
+				uiPass
+			};
+			m_renderer.beginSwapchainRenderPass(
+				commandBuffer,
+				VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+			vkCmdExecuteCommands(
+				commandBuffer,
+				static_cast<uint32_t>(passes.size()),
+				passes.data());
 			m_renderer.endSwapchainRenderPass(commandBuffer);
+
+			// the feedback written by fragments is read by the host once the
+			// frame's fence signals
+			VkMemoryBarrier feedbackBarrier{};
+			feedbackBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			feedbackBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+			feedbackBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+			vkCmdPipelineBarrier(
+				commandBuffer,
+				VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+				VK_PIPELINE_STAGE_HOST_BIT,
+				0,
+				1, &feedbackBarrier,
+				0, nullptr,
+				0, nullptr);
+
 			m_renderer.endFrame();
 			m_userInterface->endFrame();
+
+			if (inputPending)
+			{
+				recordLatency(
+					m_renderer.getPresentProfile(),
+					std::chrono::duration<float, std::milli>(
+						std::chrono::steady_clock::now() - inputTime).count());
+				inputPending = false;
+			}
 		}
 	}
-	vkDeviceWaitIdle(m_device.device());
+	m_device.waitIdle();
+
+	// retired resources reference engine objects, so must be freed before
+	// those are destroyed
+	m_device.getDeletionQueue().flush();
 }
 
 /**
@@ -223,13 +435,65 @@ void Engine::updateTextureData(
 	std::vector<uint8_t> data)
 {
 	std::function<void()> f_update =
-		[texData = std::move(data), texture = m_textures[textureName]]
+		[texData = std::move(data), texture = getTextureByName(textureName)]
 			{
 				texture->updateTextureData((void*)texData.data());
 			};
 
-	std::scoped_lock<std::mutex> lock(m_functionMutex);
-	m_functionList.push_back(f_update);
+	{
+		std::scoped_lock<std::mutex> lock(m_functionMutex);
+		m_functionList.push_back(f_update);
+	}
+	requestFrame();
+}
+
+/**
+* Updates the associated texture data held by the texture with the supplied
+* name, where the data may have different dimensions to the texture. Can be
+* called asyncrhonously. On resize the texture image is reallocated from the
+* device ImagePool, the texture moves to a new bindless table slot, and the
+* scale of entities whose albedo is the texture is adjusted to keep their size
+* in pixels.
+* 
+* @param textureName The name of the texture to update.
+* @param data Vector containing the data
+* @param width The width in pixels of the data.
+* @param height The height in pixels of the data.
+*/
+void Engine::updateTextureData(
+	std::string textureName,
+	std::vector<uint8_t> data,
+	int width,
+	int height)
+{
+	std::function<void()> f_update =
+		[this,
+		texData = std::move(data),
+		texture = getTextureByName(textureName),
+		width,
+		height]
+			{
+				int oldWidth = texture->getWidth();
+				int oldHeight = texture->getHeight();
+				VkImageView oldView = texture->descriptorInfo().imageView;
+
+				texture->updateTextureData((void*)texData.data(), width, height);
+
+				if (texture->descriptorInfo().imageView != oldView)
+				{
+					refreshTextureIndex(texture);
+				}
+				if (width != oldWidth || height != oldHeight)
+				{
+					rescaleSprites(texture, oldWidth, oldHeight);
+				}
+			};
+
+	{
+		std::scoped_lock<std::mutex> lock(m_functionMutex);
+		m_functionList.push_back(f_update);
+	}
+	requestFrame();
 }
 
 /**
@@ -291,9 +555,23 @@ std::shared_ptr<Scene> Engine::getActiveScene()
 */
 std::shared_ptr<Texture> Engine::getTextureByName(const std::string& name)
 {
+	std::scoped_lock<std::mutex> lock(m_textureMutex);
 	auto texIt = m_textures.find(name);
 	assert(texIt != m_textures.end() && "failed to find texture!");
-	return m_textures[name];
+	return texIt->second;
+}
+
+/**
+* Removes a texture from the texture map. The GPU resources are retired once
+* the last material referencing the texture releases it, and destroyed when no
+* frame in flight can still sample them, so this never stalls the device.
+* 
+* @param name The name of the texture to release.
+*/
+void Engine::releaseTexture(const std::string& name)
+{
+	std::scoped_lock<std::mutex> lock(m_textureMutex);
+	m_textures.erase(name);
 }
 
 /**
@@ -329,6 +607,411 @@ Material Engine::getMaterialByName(const std::string& name)
 	return m_materials[name];
 }
 
+/**
+* Packs a sprite into the engine texture atlas, replacing any sprite of the same
+* name. Sprites sharing an atlas page share bindless texture slots. If the
+* atlas is full the least recently used page no sprite in the scene is drawn
+* from is evicted, and its sprites must be added again before being applied.
+* Pages in use are never evicted, so applied sprites never point at a page
+* reused by others. Blocks until the upload has finished. Should be called from
+* the thread running the engine. Will throw a runtime error if every page is
+* full and in use.
+*
+* @param name The name of the sprite.
+* @param albedo R8G8B8A8 albedo data.
+* @param normal R8G8B8A8 encoded normals, or empty for flat normals.
+* @param width The sprite width in pixels.
+* @param height The sprite height in pixels.
+*
+* @return The location of the sprite in the atlas.
+*/
+AtlasRegion Engine::addAtlasSprite(
+	const std::string& name,
+	const std::vector<uint8_t>& albedo,
+	const std::vector<uint8_t>& normal,
+	int width,
+	int height)
+{
+	// pages drawn from by the scene, which eviction would leave with stale uvs
+	std::vector<uint32_t> pinnedPages;
+	uint32_t pageCount = m_atlas.getPageCount();
+	auto materialView = getActiveScene()->getAllEntitiesWith<SpriteRenderComponent>();
+	for (uint32_t page = 0; page < pageCount; ++page)
+	{
+		std::shared_ptr<Texture> albedoPage = m_atlas.getAlbedoPage(page);
+		for (auto&& [entity, renderComponent] : materialView.each())
+		{
+			if (renderComponent.material.albedo == albedoPage)
+			{
+				pinnedPages.push_back(page);
+				break;
+			}
+		}
+	}
+
+	return m_atlas.add(
+		name,
+		albedo.data(),
+		normal.empty() ? nullptr : normal.data(),
+		static_cast<uint32_t>(width),
+		static_cast<uint32_t>(height),
+		nullptr,
+		&pinnedPages);
+}
+
+/**
+* Packs a sprite from an image into the engine texture atlas, with flat normals.
+* Colour images cooked into the open texture archive under the sprite name are
+* copied from it without decoding the file.
+*
+* @param name The name of the sprite.
+* @param filePath The file path of the image.
+*
+* @return The location of the sprite in the atlas.
+*/
+AtlasRegion Engine::addAtlasSprite(const std::string& name, const std::string& filePath)
+{
+	const ArchiveEntry* entry =
+		m_textureArchive ? m_textureArchive->find(name) : nullptr;
+	if (entry && entry->format == VK_FORMAT_R8G8B8A8_SRGB)
+	{
+		const uint8_t* texels = m_textureArchive->levelData(*entry, 0);
+		std::vector<uint8_t> albedo(texels, texels + entry->levelSize(0));
+		return addAtlasSprite(name, albedo, {}, entry->width, entry->height);
+	}
+
+	TextureData data = Texture::decodeFile(filePath);
+	return addAtlasSprite(name, data.pixels, {}, data.width, data.height);
+}
+
+/**
+* Points a sprite render component at its sprite in the engine texture atlas,
+* setting its material to the atlas page and its uv rectangle to the sprite.
+* Should be called from the thread running the engine. A component already in
+* the scene must then be marked changed, see Entity::markChanged.
+*
+* @param name The name of the sprite.
+* @param component The sprite render component to set.
+*
+* @return False if the sprite is not in the atlas, or has been evicted.
+*/
+bool Engine::applyAtlasSprite(const std::string& name, SpriteRenderComponent& component)
+{
+	AtlasRegion region;
+	if (!m_atlas.find(name, region)) return false;
+
+	component.material.albedo = m_atlas.getAlbedoPage(region.page);
+	component.material.normalMap = m_atlas.getNormalPage(region.page);
+	component.uvRect = region.uvRect;
+	assignTextureIndices(component.material);
+	return true;
+}
+
+/**
+* Creates a virtual texture from a canvas of any size, replacing any virtual
+* texture of the same name. The canvas is kept in CPU memory, and only the
+* tiles drawn are streamed to the GPU, into a cache of fixed size. Blocks until
+* the coarsest tile has been uploaded. The texture's range of the feedback
+* buffers is released once the texture is destroyed and no frame in flight can
+* write it. Will throw a runtime error if the feedback buffers have no room for
+* the texture.
+*
+* @param name The name of the virtual texture.
+* @param albedo R8G8B8A8 albedo data, moved into the texture.
+* @param normal R8G8B8A8 encoded normals, or empty for flat normals.
+* @param width The canvas width in pixels.
+* @param height The canvas height in pixels.
+* @param configInfo Virtual texture configuration options.
+*
+* @return The virtual texture.
+*/
+std::shared_ptr<VirtualTexture> Engine::addVirtualTexture(
+	const std::string& name,
+	std::vector<uint8_t> albedo,
+	std::vector<uint8_t> normal,
+	int width,
+	int height,
+	VirtualTextureConfigInfo configInfo)
+{
+	uint32_t wordCount = VirtualTexture::feedbackWordCount(width, height);
+	uint32_t feedbackOffset;
+	if (!allocateFeedbackRange(wordCount, feedbackOffset))
+	{
+		throw std::runtime_error("no feedback space for virtual texture: " + name);
+	}
+
+	// frames in flight may still write the range after the texture is gone, so
+	// it is released through the deletion queue
+	Device& device = m_device;
+	std::shared_ptr<FeedbackRanges> ranges = m_feedbackRanges;
+	auto releaseFeedback = [&device, ranges, feedbackOffset, wordCount](
+		VirtualTexture* virtualTexture)
+		{
+			delete virtualTexture;
+			device.retire([ranges, feedbackOffset, wordCount]()
+				{
+					std::scoped_lock<std::mutex> lock(ranges->mutex);
+					auto range = ranges->free.emplace(feedbackOffset, wordCount).first;
+					auto next = std::next(range);
+					if (next != ranges->free.end() &&
+						range->first + range->second == next->first)
+					{
+						range->second += next->second;
+						ranges->free.erase(next);
+					}
+					if (range != ranges->free.begin())
+					{
+						auto previous = std::prev(range);
+						if (previous->first + previous->second == range->first)
+						{
+							previous->second += range->second;
+							ranges->free.erase(range);
+						}
+					}
+				});
+		};
+
+	std::unique_ptr<VirtualTexture> created;
+	try
+	{
+		created = std::make_unique<VirtualTexture>(
+			m_device,
+			std::move(albedo),
+			std::move(normal),
+			static_cast<uint32_t>(width),
+			static_cast<uint32_t>(height),
+			feedbackOffset,
+			configInfo);
+	}
+	catch (...)
+	{
+		releaseFeedback(nullptr);
+		throw;
+	}
+	std::shared_ptr<VirtualTexture> virtualTexture{ created.release(), releaseFeedback };
+
+	std::scoped_lock<std::mutex> lock(m_textureMutex);
+	m_virtualTextures[name] = virtualTexture;
+	return virtualTexture;
+}
+
+/**
+* Takes a range of the feedback buffers, reusing the first released range large
+* enough before growing the used part of the buffers.
+*
+* @param wordCount The words needed.
+* @param offset Set to the first word of the range.
+*
+* @return False if the feedback buffers have no room for the range.
+*/
+bool Engine::allocateFeedbackRange(uint32_t wordCount, uint32_t& offset)
+{
+	std::scoped_lock<std::mutex> lock(m_feedbackRanges->mutex);
+	auto& freeRanges = m_feedbackRanges->free;
+	for (auto range = freeRanges.begin(); range != freeRanges.end(); ++range)
+	{
+		if (range->second < wordCount) continue;
+
+		offset = range->first;
+		if (range->second > wordCount)
+		{
+			freeRanges.emplace(offset + wordCount, range->second - wordCount);
+		}
+		freeRanges.erase(range);
+		return true;
+	}
+
+	if (m_feedbackRanges->end + wordCount > FEEDBACK_BUFFER_WORDS) return false;
+	offset = m_feedbackRanges->end;
+	m_feedbackRanges->end += wordCount;
+	return true;
+}
+
+/**
+* Points a sprite render component at a virtual texture, setting its material
+* to the tile caches and page table. Should be called from the thread running
+* the engine. A component already in the scene must then be marked changed, see
+* Entity::markChanged.
+*
+* @param name The name of the virtual texture.
+* @param component The sprite render component to set.
+*
+* @return False if there is no virtual texture of that name.
+*/
+bool Engine::applyVirtualTexture(
+	const std::string& name,
+	SpriteRenderComponent& component)
+{
+	std::shared_ptr<VirtualTexture> virtualTexture;
+	{
+		std::scoped_lock<std::mutex> lock(m_textureMutex);
+		auto found = m_virtualTextures.find(name);
+		if (found == m_virtualTextures.end()) return false;
+		virtualTexture = found->second;
+	}
+
+	component.material.albedo = virtualTexture->getAlbedoCache();
+	component.material.normalMap = virtualTexture->getNormalCache();
+	component.material.virtualTexture = virtualTexture;
+	component.uvRect = glm::vec4{ 0.0f, 0.0f, 1.0f, 1.0f };
+	assignTextureIndices(component.material);
+	return true;
+}
+
+/**
+* Checks whether an image is too large to be held in a single texture, and so
+* should be drawn as a virtual texture. Texture images are pooled in power of
+* two sizes, so the rounded size is checked against the device limit.
+*
+* @param width The image width in pixels.
+* @param height The image height in pixels.
+*
+* @return True if the image must be a virtual texture.
+*/
+bool Engine::exceedsTextureLimits(int width, int height)
+{
+	uint32_t maxSize =
+		m_device.getPhysicalDeviceProperties().limits.maxImageDimension2D;
+	return
+		ImagePool::bucketSize(static_cast<uint32_t>(width)) > maxSize ||
+		ImagePool::bucketSize(static_cast<uint32_t>(height)) > maxSize;
+}
+
+/**
+* Gets the tilemap of the given name, creating an empty one on first use. Can
+* be called asynchronously.
+*
+* @param name The name of the tilemap.
+*
+* @return The tilemap.
+*/
+std::shared_ptr<Tilemap> Engine::getTilemap(const std::string& name)
+{
+	std::scoped_lock<std::mutex> lock(m_textureMutex);
+	auto& tilemap = m_tilemaps[name];
+	if (!tilemap) tilemap = std::make_shared<Tilemap>(m_device);
+	return tilemap;
+}
+
+/**
+* Sets the tileset of a tilemap. Can be called asynchronously, the textures are
+* written before the next frame. A tileset holding no whole tile is logged and
+* ignored, as it is only checked once the update runs.
+*
+* @param name The name of the tilemap.
+* @param albedo R8G8B8A8 tileset image, tiles laid out row by row.
+* @param normal R8G8B8A8 encoded normals of the same size, or empty for flat
+* normals.
+* @param width The tileset image width in pixels.
+* @param height The tileset image height in pixels.
+* @param tileWidth The width of each tile in pixels.
+* @param tileHeight The height of each tile in pixels.
+*/
+void Engine::updateTileset(
+	const std::string& name,
+	std::vector<uint8_t> albedo,
+	std::vector<uint8_t> normal,
+	uint32_t width,
+	uint32_t height,
+	uint32_t tileWidth,
+	uint32_t tileHeight)
+{
+	std::function<void()> f_update =
+		[this,
+		albedo = std::move(albedo),
+		normal = std::move(normal),
+		tilemap = getTilemap(name),
+		width,
+		height,
+		tileWidth,
+		tileHeight]
+			{
+				try
+				{
+					updateTilemapTextures(tilemap, [&]()
+						{
+							tilemap->setTileset(
+								albedo.data(),
+								normal.empty() ? nullptr : normal.data(),
+								width,
+								height,
+								tileWidth,
+								tileHeight);
+						});
+				}
+				catch (const std::exception& e)
+				{
+					std::cout << "failed to update tileset: " << e.what() << "\n";
+				}
+			};
+
+	{
+		std::scoped_lock<std::mutex> lock(m_functionMutex);
+		m_functionList.push_back(f_update);
+	}
+	requestFrame();
+}
+
+/**
+* Replaces the grid of a tilemap. Can be called asynchronously, the grid is
+* written before the next frame. An empty grid is logged and ignored.
+*
+* @param name The name of the tilemap.
+* @param tiles columns * rows tile values, row by row.
+* @param columns The grid width in tiles.
+* @param rows The grid height in tiles.
+*/
+void Engine::updateTilemap(
+	const std::string& name,
+	std::vector<uint32_t> tiles,
+	uint32_t columns,
+	uint32_t rows)
+{
+	std::function<void()> f_update =
+		[this, tiles = std::move(tiles), tilemap = getTilemap(name), columns, rows]
+			{
+				try
+				{
+					updateTilemapTextures(tilemap, [&]()
+						{
+							tilemap->setTiles(tiles.data(), columns, rows);
+						});
+				}
+				catch (const std::exception& e)
+				{
+					std::cout << "failed to update tilemap: " << e.what() << "\n";
+				}
+			};
+
+	{
+		std::scoped_lock<std::mutex> lock(m_functionMutex);
+		m_functionList.push_back(f_update);
+	}
+	requestFrame();
+}
+
+/**
+* Changes single cells of a tilemap, uploading only the region of the grid
+* that covers them. Can be called asynchronously.
+*
+* @param name The name of the tilemap.
+* @param edits The cells to change.
+*/
+void Engine::editTilemap(const std::string& name, std::vector<TileEdit> edits)
+{
+	std::function<void()> f_update =
+		[edits = std::move(edits), tilemap = getTilemap(name)]
+			{
+				tilemap->editTiles(edits);
+			};
+
+	{
+		std::scoped_lock<std::mutex> lock(m_functionMutex);
+		m_functionList.push_back(f_update);
+	}
+	requestFrame();
+}
+
 /**
 * Sets scale values for the normal map coordinates used by the shaders. Negative
 * values will invert that axis.
@@ -341,6 +1024,70 @@ void Engine::setNormalCoordinateScales(float x, float y, float z)
 {
 	m_coordinateScales = glm::vec3{x, y, z};
 	m_normalCoordsDirty = true;
+	requestFrame();
+}
+
+/**
+* Switches the present profile, rebuilding the swapchain before the next frame.
+* Can be called asynchronously, such as from interface elements while the
+* frame is being recorded.
+*
+* @param profile The profile to present with.
+*/
+void Engine::setPresentProfile(PresentProfile profile)
+{
+	{
+		std::scoped_lock<std::mutex> lock(m_functionMutex);
+		m_functionList.push_back([this, profile]()
+			{
+				m_renderer.setPresentProfile(profile);
+			});
+	}
+	requestFrame();
+}
+
+/**
+* Gets the input to present latency measured while presenting with a profile.
+*
+* @param profile The profile to get measurements of.
+*
+* @return Copy of the latency statistics, empty if the profile was not used.
+*/
+LatencyStats Engine::getLatencyStats(PresentProfile profile) const
+{
+	return m_latencyStats[static_cast<size_t>(profile)];
+}
+
+/**
+* Adds a latency measurement to the statistics of a profile.
+*
+* @param profile The profile the frame was presented with.
+* @param milliseconds The latency of the frame.
+*/
+void Engine::recordLatency(PresentProfile profile, float milliseconds)
+{
+	LatencyStats& stats = m_latencyStats[static_cast<size_t>(profile)];
+	if (stats.sampleCount == 0)
+	{
+		stats.minMs = milliseconds;
+		stats.maxMs = milliseconds;
+	}
+	++stats.sampleCount;
+	stats.averageMs += (milliseconds - stats.averageMs) / stats.sampleCount;
+	stats.minMs = std::min(stats.minMs, milliseconds);
+	stats.maxMs = std::max(stats.maxMs, milliseconds);
+}
+
+/**
+* Asks for a frame to be rendered, waking the engine if it is idle. Thread safe,
+* producers changing what is drawn from other threads call this once the
+* change is queued. Calls from the engine thread, such as from interface
+* elements and scripts, take effect on the next loop.
+*/
+void Engine::requestFrame()
+{
+	m_frameRequested = true;
+	glfwPostEmptyEvent();
 }
 
 /**
@@ -365,6 +1112,17 @@ void Engine::setPostConstructCallback(std::function<void()> callback)
 void Engine::setClearColor(float r, float g, float b)
 {
 	m_renderer.setClearColor(r, g, b);
+	requestFrame();
+}
+
+/**
+* Gets a snapshot of the device memory allocator usage.
+*
+* @return Copy of the current allocator statistics.
+*/
+AllocatorStats Engine::getMemoryStats()
+{
+	return m_device.getAllocator().getStats();
 }
 
 //  Interface end  ----------------------------------
@@ -372,29 +1130,155 @@ void Engine::setClearColor(float r, float g, float b)
 /**
 * Itterates over registered texture dependencies and loads the files into
 * Texture objects. These objects are inserted into a map as values with their
-* registered names as keys.
+* registered names as keys. Textures found by name in the open texture archive
+* are uploaded straight from it. Other files are decoded in parallel on a
+* temporary worker pool, while the calling thread packs and records the uploads
+* of decoded files in registration order into batches that share a submission.
+* Decode and upload times are reported per file.
 */
 void Engine::loadTextures()
 {
-	m_textureCount += static_cast<uint32_t>(m_textureDefinitions.size());
+	using Clock = std::chrono::steady_clock;
+	auto elapsedMs = [](Clock::time_point start)
+		{
+			return std::chrono::duration<double, std::milli>(Clock::now() - start)
+				.count();
+		};
+
+	struct DecodedTexture
+	{
+		TextureData data;
+		double decodeMs = 0.0;
+	};
+
+	auto loadStart = Clock::now();
+
+	// sized to the hardware threads, and joined once the function returns
+	ThreadPool decodePool{};
+	std::vector<std::future<DecodedTexture>> decodes;
+	std::vector<const ArchiveEntry*> archived;
+	decodes.reserve(m_textureDefinitions.size());
+	archived.reserve(m_textureDefinitions.size());
 	for (auto& [handle, filePath] : m_textureDefinitions)
 	{
-		m_textures.emplace(handle, std::make_shared<Texture>(m_device));
-		m_textures[handle]->loadFromFile(filePath);
+		const ArchiveEntry* entry =
+			m_textureArchive ? m_textureArchive->find(handle) : nullptr;
+		archived.push_back(entry);
+		if (entry)
+		{
+			decodes.emplace_back();
+			continue;
+		}
+
+		decodes.push_back(decodePool.submit(
+			[filePath = filePath, elapsedMs]()
+			{
+				auto decodeStart = Clock::now();
+				DecodedTexture decoded{ Texture::decodeFile(filePath) };
+				decoded.decodeMs = elapsedMs(decodeStart);
+				return decoded;
+			}));
 	}
 
-	m_textureDescriptorPool = DescriptorPool::Builder(m_device)
-		.setMaxSets(m_textureCount)
-		.addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_textureCount)
-		.build();
+	UploadBatch batch{ m_device };
+	uint32_t batchTextures = 0;
+	auto submitBatch = [&]()
+		{
+			if (batch.isEmpty()) return;
+
+			auto submitStart = Clock::now();
+			VkDeviceSize stagedBytes = batch.getStagedBytes();
+			batch.submit();
+			std::cout << "submitted " << batchTextures << " texture uploads ("
+				<< stagedBytes / 1024 << " KiB) in " << elapsedMs(submitStart)
+				<< " ms\n";
+			batchTextures = 0;
+		};
+
+	size_t index = 0;
+	for (auto& [handle, filePath] : m_textureDefinitions)
+	{
+		const ArchiveEntry* entry = archived[index];
+		if (entry)
+		{
+			index++;
+			auto uploadStart = Clock::now();
+			std::shared_ptr<Texture> texture = std::make_shared<Texture>(m_device);
+			texture->loadFromArchive(*m_textureArchive, *entry, TextureConfigInfo{}, batch);
+			registerTexture(handle, std::move(texture));
+			batchTextures++;
+
+			std::cout << handle << ": archive upload " << elapsedMs(uploadStart)
+				<< " ms\n";
+			if (batch.getStagedBytes() >= MAX_UPLOAD_BATCH_BYTES)
+			{
+				submitBatch();
+			}
+			continue;
+		}
+
+		DecodedTexture decoded = decodes[index++].get();
+
+		auto uploadStart = Clock::now();
+		std::shared_ptr<Texture> texture = std::make_shared<Texture>(m_device);
+		texture->loadFromData(
+			decoded.data.pixels.data(),
+			decoded.data.width,
+			decoded.data.height,
+			TextureConfigInfo{},
+			batch);
+		registerTexture(handle, std::move(texture));
+		batchTextures++;
+
+		std::cout << filePath << ": decode " << decoded.decodeMs << " ms, upload "
+			<< elapsedMs(uploadStart) << " ms\n";
+
+		// submit once the batch reaches its size threshold
+		if (batch.getStagedBytes() >= MAX_UPLOAD_BATCH_BYTES)
+		{
+			submitBatch();
+		}
+	}
+	submitBatch();
+
+	std::cout << "loaded " << m_textureDefinitions.size() << " textures in "
+		<< elapsedMs(loadStart) << " ms\n";
 
 	m_texturesLoaded = true;
 }
 
+/**
+* Opens a cooked texture archive, written by the cooker, to load texture
+* dependencies from. Dependencies whose names are in the archive are loaded
+* from it without decoding their image files. Should be called before
+* loadTextures. Will throw a runtime error if the archive is invalid, or if an
+* entry fails its content hash check in debug builds.
+*
+* @param filePath The file path of the archive.
+*/
+void Engine::openTextureArchive(const std::string& filePath)
+{
+	auto archive = std::make_unique<AssetArchive>(filePath);
+
+#ifndef NDEBUG
+	for (const ArchiveEntry& entry : *archive)
+	{
+		if (!archive->verify(entry))
+		{
+			throw std::runtime_error(
+				"corrupt texture " + std::string(entry.name) + " in " + filePath);
+		}
+	}
+#endif
+
+	m_textureArchive = std::move(archive);
+}
+
 /**
 * Loads a new texture object from the supplied data ptr. Texture objects are
 * stored in texture map with the supplied handle. Assumes that supplied data is
-* in R8B8G8A8 format.
+* in R8B8G8A8 format. Blocks until the upload has finished, and may be called
+* from any thread.
 * 
 * @param handle String used for accessing the constructed texture object.
 * @param data Ptr to the data to be used.
@@ -408,9 +1292,231 @@ void Engine::loadTexture(
 	int height,
 	TextureConfigInfo configInfo = TextureConfigInfo{})
 {
-	m_textures.emplace(handle, std::make_shared<Texture>(m_device));
-	m_textures[handle]->loadFromData(data, width, height, configInfo);
-	m_textureCount++;
+	std::shared_ptr<Texture> texture = std::make_shared<Texture>(m_device);
+	texture->loadFromData(data, width, height, configInfo);
+	registerTexture(handle, std::move(texture));
+}
+
+/**
+* Queues a texture to be created from the supplied data on a loader thread. May
+* be called from any thread. Each loader thread records its uploads from its
+* own command pool, and submission is serialized by the Device, so loads do not
+* race the render loop. The texture is stored in the texture map with the
+* supplied handle once the upload has finished.
+* 
+* @param handle String used for accessing the constructed texture object.
+* @param data R8G8B8A8 pixel data, moved into the load job.
+* @param width Texture width in pixels.
+* @param height Texture height in pixels.
+* @param configInfo Texture configuration options.
+* 
+* @return Future holding the loaded texture, or the exception thrown by the
+* load.
+*/
+std::future<std::shared_ptr<Texture>> Engine::loadTextureAsync(
+	std::string handle,
+	std::vector<uint8_t> data,
+	int width,
+	int height,
+	TextureConfigInfo configInfo)
+{
+	return m_loaderPool.submit(
+		[this,
+		handle = std::move(handle),
+		data = std::move(data),
+		width,
+		height,
+		configInfo]()
+		{
+			std::shared_ptr<Texture> texture = std::make_shared<Texture>(m_device);
+			texture->loadFromData((void*)data.data(), width, height, configInfo);
+			registerTexture(handle, texture);
+			return texture;
+		});
+}
+
+/**
+* Inserts a loaded texture into the texture map. Thread safe.
+* 
+* @param handle The name of the texture.
+* @param texture The loaded texture object.
+*/
+void Engine::registerTexture(
+	const std::string& handle,
+	std::shared_ptr<Texture> texture)
+{
+	{
+		std::scoped_lock<std::mutex> lock(m_textureMutex);
+		m_textures[handle] = std::move(texture);
+	}
+	requestFrame();
+}
+
+/**
+* Sets the bindless texture table slots of a material from its textures, adding
+* the textures to the table on first use.
+* 
+* @param material The material to set, passed by reference.
+*/
+void Engine::assignTextureIndices(Material& material)
+{
+	material.albedoIndex = m_textureTable->acquire(material.albedo);
+	material.normalMapIndex = m_textureTable->acquire(material.normalMap);
+	if (material.virtualTexture)
+	{
+		material.pageTableIndex =
+			m_textureTable->acquire(material.virtualTexture->getPageTable());
+	}
+}
+
+/**
+* Moves a texture to a new bindless table slot after its image view has changed,
+* and points every material using the texture at the new slot, both those of
+* scene entities and the named materials they are copied from.
+* 
+* @param texture The texture whose image view has changed.
+*/
+void Engine::refreshTextureIndex(const std::shared_ptr<Texture>& texture)
+{
+	uint32_t index = m_textureTable->refresh(texture);
+	auto refresh = [&texture, index](Material& material)
+		{
+			bool uses = material.albedo == texture || material.normalMap == texture;
+			if (material.albedo == texture) material.albedoIndex = index;
+			if (material.normalMap == texture) material.normalMapIndex = index;
+			return uses;
+		};
+
+	auto materialView = m_scene->getAllEntitiesWith<SpriteRenderComponent>();
+	for (auto&& [entity, renderComponent] : materialView.each())
+	{
+		if (refresh(renderComponent.material))
+		{
+			m_scene->markChanged<SpriteRenderComponent>(entity);
+		}
+	}
+	for (auto& [name, material] : m_materials)
+	{
+		refresh(material);
+	}
+}
+
+/**
+* Reads the virtual texture feedback written by the frame that last used the
+* buffer, records uploads of the missing tiles it asks for into the frame's
+* command buffer, then clears the buffer for the next frame. The uploads run
+* before the frame's render pass, so the render loop never waits on them. Must
+* be called after the frame's fence has been waited on, and before the frame's
+* render pass is recorded.
+*
+* @param feedbackBuffer The feedback buffer of the current frame.
+* @param commandBuffer The command buffer of the current frame.
+*/
+void Engine::streamVirtualTextures(Buffer& feedbackBuffer, VkCommandBuffer commandBuffer)
+{
+	std::vector<std::shared_ptr<VirtualTexture>> virtualTextures;
+	{
+		std::scoped_lock<std::mutex> lock(m_textureMutex);
+		for (auto& [name, virtualTexture] : m_virtualTextures)
+		{
+			virtualTextures.push_back(virtualTexture);
+		}
+	}
+	if (virtualTextures.empty()) return;
+
+	uint32_t wordCount;
+	{
+		std::scoped_lock<std::mutex> lock(m_feedbackRanges->mutex);
+		wordCount = m_feedbackRanges->end;
+	}
+
+	feedbackBuffer.invalidate();
+	uint32_t* feedback = static_cast<uint32_t*>(feedbackBuffer.getMappedMemory());
+
+	UploadBatch batch{ m_device, commandBuffer };
+	for (auto& virtualTexture : virtualTextures)
+	{
+		virtualTexture->processFeedback(
+			feedback + virtualTexture->getFeedbackOffset(),
+			batch);
+	}
+
+	// the page table is updated before this frame draws, but the feedback of
+	// the streamed tiles is read by later frames
+	if (!batch.isEmpty()) requestFrame();
+	batch.submit();
+
+	std::memset(feedback, 0, wordCount * sizeof(uint32_t));
+	feedbackBuffer.flush();
+}
+
+/**
+* Runs an update of a tilemap, then moves any of its textures whose image view
+* changed, on resize, to a new bindless table slot.
+*
+* @param tilemap The tilemap to update.
+* @param update Function applying the update.
+*/
+void Engine::updateTilemapTextures(
+	const std::shared_ptr<Tilemap>& tilemap,
+	const std::function<void()>& update)
+{
+	auto viewOf = [](const std::shared_ptr<Texture>& texture)
+		{
+			return texture ? texture->descriptorInfo().imageView : VK_NULL_HANDLE;
+		};
+
+	std::shared_ptr<Texture> textures[] = {
+		tilemap->getTileGrid(),
+		tilemap->getAlbedoTileset(),
+		tilemap->getNormalTileset() };
+	VkImageView oldViews[] = {
+		viewOf(textures[0]),
+		viewOf(textures[1]),
+		viewOf(textures[2]) };
+
+	update();
+
+	for (int i = 0; i < 3; ++i)
+	{
+		if (textures[i] && viewOf(textures[i]) != oldViews[i])
+		{
+			refreshTextureIndex(textures[i]);
+		}
+	}
+}
+
+/**
+* Scales sprites whose albedo is the given texture by the change in texture
+* size, so that their size in pixels follows the texture.
+* 
+* @param texture The resized texture.
+* @param oldWidth The width in pixels before the resize.
+* @param oldHeight The height in pixels before the resize.
+*/
+void Engine::rescaleSprites(
+	const std::shared_ptr<Texture>& texture,
+	int oldWidth,
+	int oldHeight)
+{
+	if (oldWidth <= 0 || oldHeight <= 0) return;
+
+	float scaleX = static_cast<float>(texture->getWidth()) / oldWidth;
+	float scaleY = static_cast<float>(texture->getHeight()) / oldHeight;
+
+	auto spriteView =
+		m_scene->getAllEntitiesWith<TransformComponent, SpriteRenderComponent>();
+	for (auto&& [entity, transform, renderComponent] : spriteView.each())
+	{
+		if (renderComponent.material.albedo != texture) continue;
+
+		transform.scale.x *= scaleX;
+		transform.scale.y *= scaleY;
+
+		// the uv scale of the pooled image follows the texture size too
+		m_scene->markChanged<TransformComponent>(entity);
+		m_scene->markChanged<SpriteRenderComponent>(entity);
+	}
 }
 
 /**
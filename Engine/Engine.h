@@ -8,6 +8,12 @@
 #include "Descriptors.h"
 #include "UserInterface.h"
 #include "Texture.h"
+#include "TextureAtlas.h"
+#include "BindlessTextureTable.h"
+#include "VirtualTexture.h"
+#include "Tilemap.h"
+#include "ThreadPool.h"
+#include "UploadBatch.h"
 #include "Scene/Scene.h"
 #include "Scene/Components.h"
 
@@ -18,6 +24,9 @@
 #include <set>
 #include <map>
 #include <mutex>
+#include <future>
+#include <atomic>
+#include <array>
 
 
 namespace wrengine
@@ -30,6 +39,24 @@ struct EngineConfigInfo
 	uint32_t width = 800;
 	uint32_t height = 600;
 	std::string windowName = "wrengine";
+
+	// only render when something changes, sleeping in between, see
+	// Engine::requestFrame
+	bool idleMode = false;
+
+	PresentProfile presentProfile = PresentProfile::Smooth;
+};
+
+/**
+* Input to present latency measured under a present profile, from the first
+* input event a frame responds to until the frame is queued for presentation.
+*/
+struct LatencyStats
+{
+	uint64_t sampleCount = 0;
+	float averageMs = 0.0f;
+	float minMs = 0.0f;
+	float maxMs = 0.0f;
 };
 
 /**
@@ -52,7 +79,13 @@ public:
 	void addTextureDependency(std::string handle, std::string filePath);
 	void addTextureDependency(std::map<std::string, std::string> filePaths);
 	void updateTextureData(std::string textureName, std::vector<uint8_t> data);
+	void updateTextureData(
+		std::string textureName,
+		std::vector<uint8_t> data,
+		int width,
+		int height);
 	std::shared_ptr<ElementManager> getUIManager();
+	void openTextureArchive(const std::string& filePath);
 	void loadTextures();
 	void loadTexture(
 		std::string handle,
@@ -60,42 +93,147 @@ public:
 		int width,
 		int height,
 		TextureConfigInfo configInfo);
+	std::future<std::shared_ptr<Texture>> loadTextureAsync(
+		std::string handle,
+		std::vector<uint8_t> data,
+		int width,
+		int height,
+		TextureConfigInfo configInfo = TextureConfigInfo{});
 	std::shared_ptr<Scene> getActiveScene();
 	std::shared_ptr<Texture> getTextureByName(const std::string& name);
+	void releaseTexture(const std::string& name);
 	void createMaterial(
 		const std::string& materialName,
 		const std::string& albedoName,
 		const std::string& normalMapName);
 	Material getMaterialByName(const std::string& name);
+	AtlasRegion addAtlasSprite(
+		const std::string& name,
+		const std::vector<uint8_t>& albedo,
+		const std::vector<uint8_t>& normal,
+		int width,
+		int height);
+	AtlasRegion addAtlasSprite(const std::string& name, const std::string& filePath);
+	bool applyAtlasSprite(const std::string& name, SpriteRenderComponent& component);
+	std::shared_ptr<VirtualTexture> addVirtualTexture(
+		const std::string& name,
+		std::vector<uint8_t> albedo,
+		std::vector<uint8_t> normal,
+		int width,
+		int height,
+		VirtualTextureConfigInfo configInfo = VirtualTextureConfigInfo{});
+	bool applyVirtualTexture(const std::string& name, SpriteRenderComponent& component);
+	bool exceedsTextureLimits(int width, int height);
+	std::shared_ptr<Tilemap> getTilemap(const std::string& name);
+	void updateTileset(
+		const std::string& name,
+		std::vector<uint8_t> albedo,
+		std::vector<uint8_t> normal,
+		uint32_t width,
+		uint32_t height,
+		uint32_t tileWidth,
+		uint32_t tileHeight);
+	void updateTilemap(
+		const std::string& name,
+		std::vector<uint32_t> tiles,
+		uint32_t columns,
+		uint32_t rows);
+	void editTilemap(const std::string& name, std::vector<TileEdit> edits);
 	void setNormalCoordinateScales(float x, float y, float z);
 	void setPostConstructCallback(std::function<void()> callback);
 	void setClearColor(float r, float g, float b);
+	void requestFrame();
+	void setPresentProfile(PresentProfile profile);
+	PresentProfile getPresentProfile() const { return m_renderer.getPresentProfile(); }
+	LatencyStats getLatencyStats(PresentProfile profile) const;
+	AllocatorStats getMemoryStats();
 
 private:
+	// frames rendered after anything changes in idle mode, covering the frames
+	// in flight that virtual texture feedback and interface hover states lag by
+	static constexpr uint32_t IDLE_SETTLE_FRAMES = Swapchain::MAX_FRAMES_IN_FLIGHT + 1;
+
+	// longest wait for events in idle mode, in seconds
+	static constexpr double IDLE_WAIT_SECONDS = 0.5;
+
+	// frame rate cap of the power saver profile
+	static constexpr float POWER_SAVER_FRAME_RATE = 30.0f;
+
+	// staged bytes at which loadTextures submits its upload batch. Checked
+	// after each texture is staged, so a batch may exceed it by one texture.
+	// Half the staging pool, so batches of typical textures are placed in it
+	static constexpr VkDeviceSize MAX_UPLOAD_BATCH_BYTES = 16 * 1024 * 1024;
+
+	// size of each frame's virtual texture feedback buffer, shared by every
+	// virtual texture
+	static constexpr uint32_t FEEDBACK_BUFFER_WORDS = 64 * 1024;
+
+	// ranges of the feedback buffers, shared with the deleters of virtual
+	// textures so that ranges released during shutdown never outlive their list
+	struct FeedbackRanges
+	{
+		// released ranges by offset, merged with their neighbours
+		std::map<uint32_t, uint32_t> free;
+
+		// end of the highest range handed out, the words cleared each frame
+		uint32_t end = 0;
+
+		std::mutex mutex;
+	};
+
 	void loadEntities();
+	void recordLatency(PresentProfile profile, float milliseconds);
 
 	// internal functions
 	void clearAsyncList();
+	void registerTexture(
+		const std::string& handle,
+		std::shared_ptr<Texture> texture);
 	void createMaterialDescriptors();
+	void assignTextureIndices(Material& material);
+	void refreshTextureIndex(const std::shared_ptr<Texture>& texture);
+	bool allocateFeedbackRange(uint32_t wordCount, uint32_t& offset);
+	void streamVirtualTextures(Buffer& feedbackBuffer, VkCommandBuffer commandBuffer);
+	void updateTilemapTextures(
+		const std::shared_ptr<Tilemap>& tilemap,
+		const std::function<void()>& update);
+	void rescaleSprites(
+		const std::shared_ptr<Texture>& texture,
+		int oldWidth,
+		int oldHeight);
 
 	// window params
 	uint32_t m_width = 800;
 	uint32_t m_height = 600;
 	std::string m_windowName = "wrengine";
+	PresentProfile m_presentProfile;
 
 	// vulkan/glfw structures
 	Window m_window{ m_width, m_height, m_windowName };
 	Device m_device{ m_window };
-	Renderer m_renderer{ m_window, m_device };
+	Renderer m_renderer{ m_window, m_device, m_presentProfile };
 	VkPipelineLayout m_pipelineLayout;
 
 	// note that the pools depend on the device, and must be cleaned up first
 	std::unique_ptr<DescriptorPool> m_globalDescriptorPool;
-	std::unique_ptr<DescriptorPool> m_textureDescriptorPool;
+	std::unique_ptr<BindlessTextureTable> m_textureTable;
 	std::set<std::pair<std::string, std::string>> m_textureDefinitions;
+	std::unique_ptr<AssetArchive> m_textureArchive;
 	std::map<std::string, std::shared_ptr<Texture>> m_textures;
 	std::map<std::string, Material> m_materials;
-	uint32_t m_textureCount = 0;
+	TextureAtlas m_atlas{ m_device };
+	std::map<std::string, std::shared_ptr<VirtualTexture>> m_virtualTextures;
+	std::shared_ptr<FeedbackRanges> m_feedbackRanges = std::make_shared<FeedbackRanges>();
+	std::map<std::string, std::shared_ptr<Tilemap>> m_tilemaps;
+	std::mutex m_textureMutex;
+
+	// workers for asynchronous resource loading, must be destroyed before the
+	// device as loads in progress depend on it
+	ThreadPool m_loaderPool{ 2 };
+
+	// workers sharing the CPU work of each frame, such as building sprite
+	// instances and recording secondary command buffers
+	ThreadPool m_frameWorkers{};
 	std::unique_ptr<UserInterface> m_userInterface{};
 
 	// pre frame execution list
@@ -114,5 +252,12 @@ private:
 	// normal map coordinate scales
 	glm::vec3 m_coordinateScales = { 1.0f, 1.0f, 1.0f };
 	bool m_normalCoordsDirty = false;
+
+	// render on demand
+	bool m_idleMode = false;
+	std::atomic<bool> m_frameRequested{ true };
+
+	// latency measured under each present profile, indexed by profile
+	std::array<LatencyStats, 3> m_latencyStats{};
 };
 } // namespace wrengine
\ No newline at end of file
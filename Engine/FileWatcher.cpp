@@ -0,0 +1,136 @@
+#include "FileWatcher.h"
+
+// std
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <set>
+#include <stdexcept>
+
+#ifdef __linux__
+	#include <poll.h>
+	#include <sys/inotify.h>
+	#include <unistd.h>
+#endif
+
+namespace wrengine
+{
+/**
+* Starts watching a directory. Will throw a runtime error if the directory
+* cannot be watched.
+*
+* @param directory The directory to watch. Subdirectories are not watched.
+* @param callback Called on the watcher thread with the name of each changed
+* file, relative to the directory.
+*/
+FileWatcher::FileWatcher(const std::string& directory, Callback callback) :
+	m_directory{ directory },
+	m_callback{ std::move(callback) }
+{
+	if (!std::filesystem::is_directory(directory))
+	{
+		throw std::runtime_error("watched path is not a directory: " + directory);
+	}
+
+#ifdef __linux__
+	m_inotifyFile = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (m_inotifyFile < 0)
+	{
+		throw std::runtime_error("failed to initialize inotify");
+	}
+
+	// editors that save through a temporary file rename it into place
+	if (inotify_add_watch(m_inotifyFile, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+	{
+		close(m_inotifyFile);
+		throw std::runtime_error("failed to watch directory: " + directory);
+	}
+#endif
+
+	m_thread = std::thread(&FileWatcher::watchLoop, this);
+}
+
+/**
+* Stops the watcher thread. The callback is not called after this returns.
+*/
+FileWatcher::~FileWatcher()
+{
+	m_stopping = true;
+	m_thread.join();
+
+#ifdef __linux__
+	close(m_inotifyFile);
+#endif
+}
+
+#ifdef __linux__
+/**
+* Watcher thread body. Blocks on the inotify descriptor, waking periodically to
+* check for shutdown. The events read in one go are coalesced so that a file
+* written several times in quick succession is reported once.
+*/
+void FileWatcher::watchLoop()
+{
+	alignas(inotify_event) char buffer[4096];
+	pollfd descriptor{ m_inotifyFile, POLLIN, 0 };
+
+	while (!m_stopping)
+	{
+		if (poll(&descriptor, 1, WAKE_INTERVAL_MS) <= 0) continue;
+
+		std::set<std::string> changedFiles;
+		ssize_t length;
+		while ((length = read(m_inotifyFile, buffer, sizeof(buffer))) > 0)
+		{
+			for (char* event = buffer; event < buffer + length;)
+			{
+				auto* info = reinterpret_cast<inotify_event*>(event);
+				if (info->len > 0 && !(info->mask & IN_ISDIR))
+				{
+					changedFiles.insert(info->name);
+				}
+				event += sizeof(inotify_event) + info->len;
+			}
+		}
+
+		for (const std::string& fileName : changedFiles)
+		{
+			m_callback(fileName);
+		}
+	}
+}
+#else
+/**
+* Watcher thread body. Polls the modification times of the files in the
+* directory, reporting any that are new or changed since the last poll.
+*/
+void FileWatcher::watchLoop()
+{
+	namespace fs = std::filesystem;
+	std::map<std::string, fs::file_time_type> writeTimes;
+
+	bool firstScan = true;
+	while (!m_stopping)
+	{
+		std::error_code error;
+		for (const auto& entry : fs::directory_iterator(m_directory, error))
+		{
+			if (!entry.is_regular_file(error)) continue;
+
+			std::string fileName = entry.path().filename().string();
+			fs::file_time_type writeTime = entry.last_write_time(error);
+			if (error) continue;
+
+			auto found = writeTimes.find(fileName);
+			if (found != writeTimes.end() && found->second == writeTime) continue;
+
+			writeTimes[fileName] = writeTime;
+			if (!firstScan) m_callback(fileName);
+		}
+
+		firstScan = false;
+		std::this_thread::sleep_for(std::chrono::milliseconds(WAKE_INTERVAL_MS));
+	}
+}
+#endif
+} // namespace wrengine
\ No newline at end of file
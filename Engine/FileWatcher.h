@@ -0,0 +1,46 @@
+#pragma once
+
+//std
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+
+namespace wrengine
+{
+/**
+* Watches a directory for files that are written or moved into it, calling back
+* with the file name on a dedicated thread. On Linux the watch is event driven
+* using inotify, and only files that were closed after writing are reported, so
+* partially written files are never seen. Other platforms poll modification
+* times instead.
+*/
+class FileWatcher
+{
+public:
+	using Callback = std::function<void(const std::string& fileName)>;
+
+	FileWatcher(const std::string& directory, Callback callback);
+	~FileWatcher();
+
+	// not copyable or movable
+	FileWatcher(const FileWatcher&) = delete;
+	FileWatcher& operator=(const FileWatcher&) = delete;
+	FileWatcher(FileWatcher&&) = delete;
+	FileWatcher& operator=(FileWatcher&&) = delete;
+
+	const std::string& getDirectory() const { return m_directory; }
+
+private:
+	void watchLoop();
+
+	// how often the stop flag is checked, and the poll period without inotify
+	static constexpr int WAKE_INTERVAL_MS = 100;
+
+	std::string m_directory;
+	Callback m_callback;
+	std::atomic<bool> m_stopping{ false };
+	int m_inotifyFile = -1;
+	std::thread m_thread;
+};
+} // namespace wrengine
\ No newline at end of file
@@ -9,26 +9,31 @@
 
 namespace wrengine
 {
-constexpr size_t MAX_LIGHTS = 10;
+// point lights a frame can hold, further lights are not drawn
+constexpr size_t MAX_LIGHTS = 4096;
 
 /**
-* Struct describing point light data.
+* Struct describing point light data, laid out to match the std430 light
+* buffer.
 */
 struct PointLight
 {
-	glm::vec4 position{}; // ignore w
+	glm::vec4 position{}; // w = radius of influence
 	glm::vec4 color{}; // xyzw = R G B Intensity
 };
 
 /**
-* Struct defining the layout for the globally accessible uniform data.
+* Struct defining the layout for the globally accessible uniform data. Lights
+* are in the light buffer, and binned into square screen tiles of
+* lightTileSize pixels, see PointLightSystem.
 */
 struct GlobalUbo
 {
 	glm::mat4 projView{ 1.0f };
 	glm::vec4 ambientLight{ 1.0f, 1.0f, 1.0f, 0.02f };
-	PointLight pointLights[10];
-	uint64_t numLights;
+	uint32_t numLights = 0;
+	uint32_t lightTileSize = 0;
+	glm::vec2 viewportSize{ 0.0f };
 };
 
 /**
@@ -0,0 +1,144 @@
+#include "ImagePool.h"
+
+#include "Device.h"
+
+// std
+#include <algorithm>
+
+namespace wrengine
+{
+ImagePool::~ImagePool()
+{
+	for (auto& [key, images] : m_freeImages)
+	{
+		for (auto& image : images)
+		{
+			destroyImage(image);
+		}
+	}
+}
+
+/**
+* Gets an image with at least the requested dimensions, reusing a free image
+* from the matching bucket where possible. The contents of a reused image are
+* undefined. Will throw a runtime error if a new image cannot be created.
+*
+* @param width The minimum width in pixels.
+* @param height The minimum height in pixels.
+* @param format The image format.
+* @param usage Bitmask of VkImageUsageFlagBits for the image.
+* @param mipLevels The number of mip levels, which must not exceed the full
+* chain of the bucket extent.
+*
+* @return The pooled image, with its bucket extent.
+*/
+PooledImage ImagePool::acquire(
+	uint32_t width,
+	uint32_t height,
+	VkFormat format,
+	VkImageUsageFlags usage,
+	uint32_t mipLevels)
+{
+	BucketKey key{ bucketSize(width), bucketSize(height), format, usage, mipLevels };
+
+	{
+		std::scoped_lock<std::mutex> lock(m_mutex);
+		auto it = m_freeImages.find(key);
+		if (it != m_freeImages.end() && !it->second.empty())
+		{
+			PooledImage image = it->second.back();
+			it->second.pop_back();
+			return image;
+		}
+	}
+
+	PooledImage image{};
+	image.extent = { std::get<0>(key), std::get<1>(key) };
+	image.format = format;
+	image.usage = usage;
+	image.mipLevels = mipLevels;
+
+	VkImageCreateInfo imageInfo{};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.extent.width = image.extent.width;
+	imageInfo.extent.height = image.extent.height;
+	imageInfo.extent.depth = 1;
+	imageInfo.mipLevels = mipLevels;
+	imageInfo.arrayLayers = 1;
+	imageInfo.format = format;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	imageInfo.usage = usage;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.flags = 0; // optional
+
+	m_device.createImageWithInfo(
+		imageInfo,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		image.image,
+		image.memory);
+
+	return image;
+}
+
+/**
+* Returns an image to its bucket. Buckets hold a bounded number of free images,
+* and any beyond that are destroyed.
+*
+* @param image The image to return, which must not be in use by the device.
+*/
+void ImagePool::release(PooledImage image)
+{
+	if (image.image == VK_NULL_HANDLE) return;
+
+	BucketKey key{
+		image.extent.width,
+		image.extent.height,
+		image.format,
+		image.usage,
+		image.mipLevels };
+
+	std::scoped_lock<std::mutex> lock(m_mutex);
+	std::vector<PooledImage>& images = m_freeImages[key];
+	if (images.size() < MAX_FREE_PER_BUCKET)
+	{
+		images.push_back(image);
+		return;
+	}
+	destroyImage(image);
+}
+
+/**
+* Rounds a dimension up to its bucket size. Each power of two octave is split
+* into BUCKETS_PER_OCTAVE steps of at least MIN_BUCKET_SIZE, so buckets past
+* 512 pixels are less than an eighth larger than the size, and power of two
+* sizes map to themselves.
+*
+* @param size Dimension in pixels.
+*
+* @return The bucket dimension in pixels.
+*/
+uint32_t ImagePool::bucketSize(uint32_t size)
+{
+	// octave < size <= 2 * octave
+	uint32_t octave = MIN_BUCKET_SIZE / 2;
+	while (octave * 2 < size)
+	{
+		octave <<= 1;
+	}
+	uint32_t step = std::max(MIN_BUCKET_SIZE, octave / BUCKETS_PER_OCTAVE);
+	return std::max(MIN_BUCKET_SIZE, (size + step - 1) / step * step);
+}
+
+/**
+* Destroys an image and frees its memory.
+*/
+void ImagePool::destroyImage(PooledImage& image)
+{
+	vkDestroyImage(m_device.device(), image.image, nullptr);
+	m_device.getAllocator().free(image.memory);
+	image = PooledImage{};
+}
+} // namespace wrengine
\ No newline at end of file
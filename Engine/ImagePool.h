@@ -0,0 +1,74 @@
+#pragma once
+
+#include "MemoryAllocator.h"
+
+//std
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+namespace wrengine
+{
+// forward declaration
+class Device;
+
+/**
+* A 2D image handed out by the ImagePool. The extent is the size of the bucket
+* the image was allocated for, which may be larger than the content it holds.
+*/
+struct PooledImage
+{
+	VkImage image = VK_NULL_HANDLE;
+	Allocation memory{};
+	VkExtent2D extent{ 0, 0 };
+	VkFormat format = VK_FORMAT_UNDEFINED;
+	VkImageUsageFlags usage = 0;
+	uint32_t mipLevels = 1;
+};
+
+/**
+* Recycles sampled 2D images between textures. Requested sizes are rounded up
+* to buckets per axis, eight per power of two octave, so a canvas that is
+* resized back and forth, or several sprites of similar size, share a small set
+* of images rather than creating a new image for every change, while large
+* images stay within an eighth of their content along either axis. Released
+* images must no longer be in use by the device, so they should be returned
+* through the Device deletion queue. All methods are thread safe.
+*/
+class ImagePool
+{
+public:
+	static constexpr uint32_t MIN_BUCKET_SIZE = 64;
+	static constexpr uint32_t BUCKETS_PER_OCTAVE = 8;
+	static constexpr size_t MAX_FREE_PER_BUCKET = 4;
+
+	ImagePool(Device& device) : m_device{ device } {}
+	~ImagePool();
+
+	// not copyable
+	ImagePool(const ImagePool&) = delete;
+	ImagePool& operator=(const ImagePool&) = delete;
+
+	PooledImage acquire(
+		uint32_t width,
+		uint32_t height,
+		VkFormat format,
+		VkImageUsageFlags usage,
+		uint32_t mipLevels = 1);
+	void release(PooledImage image);
+
+	static uint32_t bucketSize(uint32_t size);
+
+private:
+	// width, height, format, usage, mip levels
+	using BucketKey =
+		std::tuple<uint32_t, uint32_t, VkFormat, VkImageUsageFlags, uint32_t>;
+
+	void destroyImage(PooledImage& image);
+
+	Device& m_device;
+	std::map<BucketKey, std::vector<PooledImage>> m_freeImages;
+	std::mutex m_mutex;
+};
+} // namespace wrengine
\ No newline at end of file
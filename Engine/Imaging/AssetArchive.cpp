@@ -0,0 +1,387 @@
+#include "AssetArchive.h"
+
+#include "MipChain.h"
+
+// std
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+namespace wrengine
+{
+/**
+* Gets the byte offset of a mip level from the start of the entry data.
+*
+* @param level The mip level.
+*
+* @return Offset in bytes.
+*/
+uint64_t ArchiveEntry::levelOffset(uint32_t level) const
+{
+	uint64_t offset = 0;
+	for (uint32_t i = 0; i < level; ++i)
+	{
+		offset += levelSize(i);
+	}
+	return offset;
+}
+
+/**
+* Gets the size in bytes of a mip level.
+*
+* @param level The mip level.
+*
+* @return Size in bytes.
+*/
+uint64_t ArchiveEntry::levelSize(uint32_t level) const
+{
+	return static_cast<uint64_t>(mipExtent(width, level)) *
+		mipExtent(height, level) *
+		texelSize;
+}
+
+/**
+* 64 bit FNV-1a hash.
+*
+* @param data The bytes to hash.
+* @param size The number of bytes.
+*
+* @return The hash.
+*/
+uint64_t fnv1a64(const uint8_t* data, size_t size)
+{
+	uint64_t hash = 0xcbf29ce484222325ull;
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash ^= data[i];
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
+/**
+* Adds a texture to the archive. Will throw an invalid argument error if the
+* name is too long or the levels do not match the dimensions.
+*
+* @param name The name the texture is loaded by.
+* @param format The VkFormat of the texel data.
+* @param width The width in pixels of level 0.
+* @param height The height in pixels of level 0.
+* @param texelSize The size in bytes of one texel.
+* @param flags Bitmask of ARCHIVE_FLAG values.
+* @param levels Tightly packed texel data of each mip level, level 0 first.
+*/
+void AssetArchiveWriter::addTexture(
+	const std::string& name,
+	uint32_t format,
+	uint32_t width,
+	uint32_t height,
+	uint32_t texelSize,
+	uint32_t flags,
+	const std::vector<std::vector<uint8_t>>& levels)
+{
+	if (name.size() >= ARCHIVE_NAME_SIZE)
+	{
+		throw std::invalid_argument("archive texture name too long: " + name);
+	}
+
+	ArchiveEntry entry{};
+	std::memcpy(entry.name, name.c_str(), name.size());
+	entry.format = format;
+	entry.width = width;
+	entry.height = height;
+	entry.mipLevels = static_cast<uint32_t>(levels.size());
+	entry.texelSize = texelSize;
+	entry.flags = flags;
+
+	std::vector<uint8_t> data;
+	for (uint32_t level = 0; level < entry.mipLevels; ++level)
+	{
+		if (levels[level].size() != entry.levelSize(level))
+		{
+			throw std::invalid_argument("archive texture level size mismatch: " + name);
+		}
+		data.insert(data.end(), levels[level].begin(), levels[level].end());
+	}
+	entry.dataSize = data.size();
+	entry.hash = fnv1a64(data.data(), data.size());
+
+	m_entries.push_back(entry);
+	m_data.push_back(std::move(data));
+}
+
+/**
+* Writes the archive to file. Will throw a runtime error on failure.
+*
+* @param filePath The file path to write to.
+*/
+void AssetArchiveWriter::write(const std::string& filePath) const
+{
+	std::vector<ArchiveEntry> entries = m_entries;
+	std::vector<uint8_t> padding(ARCHIVE_ALIGNMENT, 0);
+
+	std::ofstream file{ filePath, std::ios::binary | std::ios::trunc };
+	if (!file)
+	{
+		throw std::runtime_error("failed to open archive for writing: " + filePath);
+	}
+
+	ArchiveHeader header{};
+	std::memcpy(header.magic, ARCHIVE_MAGIC, sizeof(header.magic));
+	header.version = ARCHIVE_VERSION;
+	header.entryCount = static_cast<uint32_t>(entries.size());
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+	// texel data, aligned for direct use from the mapping, shared where equal
+	uint64_t offset = sizeof(header);
+	for (size_t i = 0; i < entries.size(); ++i)
+	{
+		auto shared = std::find_if(entries.begin(), entries.begin() + i,
+			[&](const ArchiveEntry& other)
+			{
+				return other.hash == entries[i].hash &&
+					other.dataSize == entries[i].dataSize &&
+					m_data[&other - entries.data()] == m_data[i];
+			});
+		if (shared != entries.begin() + i)
+		{
+			entries[i].dataOffset = shared->dataOffset;
+			continue;
+		}
+
+		uint64_t aligned = (offset + ARCHIVE_ALIGNMENT - 1) & ~(ARCHIVE_ALIGNMENT - 1);
+		file.write(reinterpret_cast<const char*>(padding.data()), aligned - offset);
+		file.write(reinterpret_cast<const char*>(m_data[i].data()), m_data[i].size());
+		entries[i].dataOffset = aligned;
+		offset = aligned + m_data[i].size();
+	}
+
+	std::sort(entries.begin(), entries.end(),
+		[](const ArchiveEntry& a, const ArchiveEntry& b)
+		{
+			return std::strncmp(a.name, b.name, ARCHIVE_NAME_SIZE) < 0;
+		});
+
+	uint64_t aligned = (offset + alignof(ArchiveEntry) - 1) & ~(alignof(ArchiveEntry) - 1);
+	file.write(reinterpret_cast<const char*>(padding.data()), aligned - offset);
+	file.write(
+		reinterpret_cast<const char*>(entries.data()),
+		entries.size() * sizeof(ArchiveEntry));
+
+	header.entriesOffset = aligned;
+	file.seekp(0);
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+	if (!file)
+	{
+		throw std::runtime_error("failed to write archive: " + filePath);
+	}
+}
+
+/**
+* Maps an archive file and validates its table. Will throw a runtime error if
+* the file cannot be mapped or is not a valid archive.
+*
+* @param filePath The file path of the archive.
+*/
+AssetArchive::AssetArchive(const std::string& filePath) : m_filePath{ filePath }
+{
+	map();
+	try
+	{
+		validate();
+	}
+	catch (...)
+	{
+		unmap();
+		throw;
+	}
+}
+
+AssetArchive::~AssetArchive()
+{
+	unmap();
+}
+
+/**
+* Finds a texture by name.
+*
+* @param name The texture name.
+*
+* @return The entry, or nullptr if the archive has no such texture.
+*/
+const ArchiveEntry* AssetArchive::find(const std::string& name) const
+{
+	if (name.size() >= ARCHIVE_NAME_SIZE) return nullptr;
+
+	const ArchiveEntry* entry = std::lower_bound(begin(), end(), name,
+		[](const ArchiveEntry& a, const std::string& key)
+		{
+			return std::strncmp(a.name, key.c_str(), ARCHIVE_NAME_SIZE) < 0;
+		});
+
+	if (entry == end() || name != entry->name) return nullptr;
+	return entry;
+}
+
+/**
+* Gets the texel data of a mip level, in place in the mapping.
+*
+* @param entry An entry of this archive.
+* @param level The mip level, less than the entry mip level count.
+*
+* @return Pointer to the tightly packed level data.
+*/
+const uint8_t* AssetArchive::levelData(const ArchiveEntry& entry, uint32_t level) const
+{
+	return m_data + entry.dataOffset + entry.levelOffset(level);
+}
+
+/**
+* Checks the texel data of an entry against its content hash.
+*
+* @param entry An entry of this archive.
+*
+* @return True if the data is intact.
+*/
+bool AssetArchive::verify(const ArchiveEntry& entry) const
+{
+	return fnv1a64(m_data + entry.dataOffset, entry.dataSize) == entry.hash;
+}
+
+/**
+* Maps the whole archive file read only.
+*/
+void AssetArchive::map()
+{
+#ifdef _WIN32
+	HANDLE file = CreateFileA(
+		m_filePath.c_str(),
+		GENERIC_READ,
+		FILE_SHARE_READ,
+		nullptr,
+		OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+		nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		throw std::runtime_error("failed to open archive: " + m_filePath);
+	}
+	m_fileHandle = file;
+
+	LARGE_INTEGER size;
+	GetFileSizeEx(file, &size);
+	m_size = static_cast<size_t>(size.QuadPart);
+
+	HANDLE mapping = m_size ?
+		CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr) :
+		nullptr;
+	if (!mapping)
+	{
+		unmap();
+		throw std::runtime_error("failed to map archive: " + m_filePath);
+	}
+	m_mappingHandle = mapping;
+
+	m_data = static_cast<const uint8_t*>(
+		MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+	int file = open(m_filePath.c_str(), O_RDONLY);
+	if (file < 0)
+	{
+		throw std::runtime_error("failed to open archive: " + m_filePath);
+	}
+
+	struct stat fileStat;
+	if (fstat(file, &fileStat) != 0 || fileStat.st_size == 0)
+	{
+		close(file);
+		throw std::runtime_error("failed to map archive: " + m_filePath);
+	}
+	m_size = static_cast<size_t>(fileStat.st_size);
+
+	// the mapping keeps its own reference to the file
+	void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, file, 0);
+	close(file);
+	m_data = data == MAP_FAILED ? nullptr : static_cast<const uint8_t*>(data);
+#endif
+
+	if (!m_data)
+	{
+		unmap();
+		throw std::runtime_error("failed to map archive: " + m_filePath);
+	}
+}
+
+/**
+* Releases the mapping.
+*/
+void AssetArchive::unmap()
+{
+#ifdef _WIN32
+	if (m_data) UnmapViewOfFile(m_data);
+	if (m_mappingHandle) CloseHandle(static_cast<HANDLE>(m_mappingHandle));
+	if (m_fileHandle) CloseHandle(static_cast<HANDLE>(m_fileHandle));
+#else
+	if (m_data) munmap(const_cast<uint8_t*>(m_data), m_size);
+#endif
+	m_data = nullptr;
+	m_mappingHandle = nullptr;
+	m_fileHandle = nullptr;
+	m_size = 0;
+}
+
+/**
+* Checks the header and that every entry lies within the file.
+*/
+void AssetArchive::validate()
+{
+	if (m_size < sizeof(ArchiveHeader))
+	{
+		throw std::runtime_error("archive too small: " + m_filePath);
+	}
+
+	const ArchiveHeader* header = reinterpret_cast<const ArchiveHeader*>(m_data);
+	if (std::memcmp(header->magic, ARCHIVE_MAGIC, sizeof(header->magic)) != 0 ||
+		header->version != ARCHIVE_VERSION)
+	{
+		throw std::runtime_error("not a supported archive: " + m_filePath);
+	}
+
+	uint64_t tableSize = static_cast<uint64_t>(header->entryCount) * sizeof(ArchiveEntry);
+	if (header->entriesOffset % alignof(ArchiveEntry) != 0 ||
+		header->entriesOffset > m_size ||
+		tableSize > m_size - header->entriesOffset)
+	{
+		throw std::runtime_error("archive table out of bounds: " + m_filePath);
+	}
+
+	m_entries = reinterpret_cast<const ArchiveEntry*>(m_data + header->entriesOffset);
+	m_entryCount = header->entryCount;
+
+	for (const ArchiveEntry& entry : *this)
+	{
+		if (entry.name[ARCHIVE_NAME_SIZE - 1] != '\0' ||
+			entry.mipLevels == 0 ||
+			entry.mipLevels > 32 ||
+			entry.dataOffset > m_size ||
+			entry.dataSize > m_size - entry.dataOffset ||
+			entry.levelOffset(entry.mipLevels) != entry.dataSize)
+		{
+			throw std::runtime_error("archive entry out of bounds: " + m_filePath);
+		}
+	}
+}
+} // namespace wrengine
\ No newline at end of file
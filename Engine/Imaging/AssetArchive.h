@@ -0,0 +1,117 @@
+#pragma once
+
+//std
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace wrengine
+{
+constexpr char ARCHIVE_MAGIC[4] = { 'W', 'R', 'A', 'R' };
+constexpr uint32_t ARCHIVE_VERSION = 1;
+constexpr uint64_t ARCHIVE_ALIGNMENT = 256;
+constexpr size_t ARCHIVE_NAME_SIZE = 64;
+
+// entry flags
+constexpr uint32_t ARCHIVE_FLAG_NORMAL_MAP = 1 << 0;
+
+/**
+* Archive file header, at offset zero.
+*/
+struct ArchiveHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t entryCount;
+	uint32_t reserved;
+	uint64_t entriesOffset;
+};
+
+/**
+* Archive table entry describing one texture. Texel data of every mip level is
+* stored tightly packed and consecutively from dataOffset, which is aligned to
+* ARCHIVE_ALIGNMENT, with level dimensions given by mipExtent. Entries are
+* sorted by name.
+*/
+struct ArchiveEntry
+{
+	char name[ARCHIVE_NAME_SIZE];
+	uint32_t format; // VkFormat of the texel data
+	uint32_t width;
+	uint32_t height;
+	uint32_t mipLevels;
+	uint32_t texelSize;
+	uint32_t flags;
+	uint64_t dataOffset;
+	uint64_t dataSize;
+	uint64_t hash; // FNV-1a of the texel data
+
+	uint64_t levelOffset(uint32_t level) const;
+	uint64_t levelSize(uint32_t level) const;
+};
+
+uint64_t fnv1a64(const uint8_t* data, size_t size);
+
+/**
+* Builds an archive of cooked textures in memory and writes it to file.
+* Textures with identical texel data share their data in the file.
+*/
+class AssetArchiveWriter
+{
+public:
+	void addTexture(
+		const std::string& name,
+		uint32_t format,
+		uint32_t width,
+		uint32_t height,
+		uint32_t texelSize,
+		uint32_t flags,
+		const std::vector<std::vector<uint8_t>>& levels);
+	void write(const std::string& filePath) const;
+
+private:
+	std::vector<ArchiveEntry> m_entries;
+	std::vector<std::vector<uint8_t>> m_data;
+};
+
+/**
+* Read only view of an archive file, mapped into memory. Texel data is used in
+* place, straight from the mapping, so loading a texture needs no decoding and
+* no intermediate copies. The archive must outlive any pointers into it.
+*/
+class AssetArchive
+{
+public:
+	AssetArchive(const std::string& filePath);
+	~AssetArchive();
+
+	// not copyable
+	AssetArchive(const AssetArchive&) = delete;
+	AssetArchive& operator=(const AssetArchive&) = delete;
+
+	const ArchiveEntry* find(const std::string& name) const;
+	const uint8_t* levelData(const ArchiveEntry& entry, uint32_t level) const;
+	bool verify(const ArchiveEntry& entry) const;
+
+	// getters
+	const ArchiveEntry* begin() const { return m_entries; }
+	const ArchiveEntry* end() const { return m_entries + m_entryCount; }
+	const std::string& getFilePath() const { return m_filePath; }
+
+private:
+	void map();
+	void unmap();
+	void validate();
+
+	std::string m_filePath;
+	const uint8_t* m_data = nullptr;
+	size_t m_size = 0;
+	const ArchiveEntry* m_entries = nullptr;
+	uint32_t m_entryCount = 0;
+
+	// platform mapping handles
+	void* m_fileHandle = nullptr;
+	void* m_mappingHandle = nullptr;
+};
+} // namespace wrengine
\ No newline at end of file
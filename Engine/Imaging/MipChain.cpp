@@ -0,0 +1,228 @@
+#include "MipChain.h"
+
+// std
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace wrengine
+{
+/**
+* Gets the number of levels in a full mip chain, down to a single texel.
+*
+* @param width The width in pixels of the base level.
+* @param height The height in pixels of the base level.
+*
+* @return The mip level count.
+*/
+uint32_t mipLevelCount(uint32_t width, uint32_t height)
+{
+	uint32_t size = std::max(width, height);
+	uint32_t levels = 1;
+	while (size > 1)
+	{
+		size >>= 1;
+		++levels;
+	}
+	return levels;
+}
+
+/**
+* Gets the size of a mip level along one axis, rounding up so that a level
+* covers every texel of the level above it.
+*
+* @param size The size in pixels of the base level.
+* @param level The mip level.
+*
+* @return The size in pixels of the level, at least one.
+*/
+uint32_t mipExtent(uint32_t size, uint32_t level)
+{
+	uint32_t extent = (size + (1u << level) - 1) >> level;
+	return std::max(extent, 1u);
+}
+
+/**
+* Gets the rectangle of a mip level that depends on a rectangle of the base
+* level, such as the texels to regenerate after a partial update.
+*
+* @param rect The rectangle of the base level.
+* @param level The mip level.
+*
+* @return The covering rectangle of the level.
+*/
+PixelRect mipRect(const PixelRect& rect, uint32_t level)
+{
+	if (rect.isEmpty()) return PixelRect{};
+
+	uint32_t x0 = rect.x >> level;
+	uint32_t y0 = rect.y >> level;
+	uint32_t x1 = mipExtent(rect.x + rect.width, level);
+	uint32_t y1 = mipExtent(rect.y + rect.height, level);
+	return PixelRect{ x0, y0, x1 - x0, y1 - y0 };
+}
+
+/**
+* Converts an sRGB encoded channel to linear light.
+*/
+static float srgbToLinear(uint8_t value)
+{
+	static const auto table = []()
+		{
+			std::array<float, 256> values{};
+			for (size_t i = 0; i < values.size(); ++i)
+			{
+				float c = static_cast<float>(i) / 255.0f;
+				values[i] = c <= 0.04045f ?
+					c / 12.92f :
+					std::pow((c + 0.055f) / 1.055f, 2.4f);
+			}
+			return values;
+		}();
+	return table[value];
+}
+
+/**
+* Converts a linear light channel to sRGB encoding.
+*/
+static float linearToSrgb(float value)
+{
+	float c = value <= 0.0031308f ?
+		value * 12.92f :
+		1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+	return c * 255.0f;
+}
+
+/**
+* Generates a rectangle of the next mip level of an RGBA8 image with a 2x2 box
+* filter. Colour channels of sRGB images are averaged in linear light, matching
+* a blit of an sRGB format, while alpha is always linear. Source texels beyond
+* the edge are clamped.
+*
+* @param src The source level, tightly packed RGBA8.
+* @param srcWidth The width in pixels of the source level.
+* @param srcHeight The height in pixels of the source level.
+* @param dst The destination level, tightly packed RGBA8.
+* @param dstWidth The width in pixels of the destination level.
+* @param dstRect The rectangle of the destination level to generate.
+* @param srgb Whether the colour channels are sRGB encoded.
+*/
+void downsampleRGBA8(
+	const uint8_t* src,
+	uint32_t srcWidth,
+	uint32_t srcHeight,
+	uint8_t* dst,
+	uint32_t dstWidth,
+	const PixelRect& dstRect,
+	bool srgb)
+{
+	for (uint32_t y = dstRect.y; y < dstRect.y + dstRect.height; ++y)
+	{
+		uint32_t sy0 = std::min(y * 2, srcHeight - 1);
+		uint32_t sy1 = std::min(y * 2 + 1, srcHeight - 1);
+
+		for (uint32_t x = dstRect.x; x < dstRect.x + dstRect.width; ++x)
+		{
+			uint32_t sx0 = std::min(x * 2, srcWidth - 1);
+			uint32_t sx1 = std::min(x * 2 + 1, srcWidth - 1);
+			const uint32_t samples[4][2] = {
+				{ sx0, sy0 }, { sx1, sy0 }, { sx0, sy1 }, { sx1, sy1 } };
+
+			float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+			for (const auto& sample : samples)
+			{
+				const uint8_t* texel =
+					src + (static_cast<size_t>(sample[1]) * srcWidth + sample[0]) * 4;
+				for (int c = 0; c < 3; ++c)
+				{
+					sum[c] += srgb ? srgbToLinear(texel[c]) : texel[c] / 255.0f;
+				}
+				sum[3] += texel[3] / 255.0f;
+			}
+
+			uint8_t* texel = dst + (static_cast<size_t>(y) * dstWidth + x) * 4;
+			for (int c = 0; c < 4; ++c)
+			{
+				float average = sum[c] * 0.25f;
+				float encoded = srgb && c < 3 ?
+					linearToSrgb(average) :
+					average * 255.0f;
+				texel[c] = static_cast<uint8_t>(
+					std::clamp(std::nearbyint(encoded), 0.0f, 255.0f));
+			}
+		}
+	}
+}
+
+/**
+* Decodes a two channel normal, reconstructing z on the hemisphere as the
+* fragment shader does.
+*/
+static void decodeNormalRG(const uint8_t* texel, float& x, float& y, float& z)
+{
+	x = static_cast<float>(texel[0]) * (2.0f / 255.0f) - 1.0f;
+	y = static_cast<float>(texel[1]) * (2.0f / 255.0f) - 1.0f;
+	z = std::sqrt(std::max(1.0f - x * x - y * y, 0.0f));
+}
+
+/**
+* Generates a rectangle of the next mip level of a two channel normal map. Each
+* texel is the renormalized sum of the 2x2 normals above it, as a plain average
+* of the stored channels would shorten the normals and flatten the lighting of
+* zoomed out sprites. Source texels beyond the edge are clamped.
+*
+* @param src The source level, tightly packed RG8.
+* @param srcWidth The width in pixels of the source level.
+* @param srcHeight The height in pixels of the source level.
+* @param dst The destination level, tightly packed RG8.
+* @param dstWidth The width in pixels of the destination level.
+* @param dstRect The rectangle of the destination level to generate.
+*/
+void downsampleNormalsRG(
+	const uint8_t* src,
+	uint32_t srcWidth,
+	uint32_t srcHeight,
+	uint8_t* dst,
+	uint32_t dstWidth,
+	const PixelRect& dstRect)
+{
+	for (uint32_t y = dstRect.y; y < dstRect.y + dstRect.height; ++y)
+	{
+		uint32_t sy0 = std::min(y * 2, srcHeight - 1);
+		uint32_t sy1 = std::min(y * 2 + 1, srcHeight - 1);
+
+		for (uint32_t x = dstRect.x; x < dstRect.x + dstRect.width; ++x)
+		{
+			uint32_t sx0 = std::min(x * 2, srcWidth - 1);
+			uint32_t sx1 = std::min(x * 2 + 1, srcWidth - 1);
+			const uint32_t samples[4][2] = {
+				{ sx0, sy0 }, { sx1, sy0 }, { sx0, sy1 }, { sx1, sy1 } };
+
+			float sumX = 0.0f;
+			float sumY = 0.0f;
+			float sumZ = 0.0f;
+			for (const auto& sample : samples)
+			{
+				float nx, ny, nz;
+				decodeNormalRG(
+					src + (static_cast<size_t>(sample[1]) * srcWidth + sample[0]) * 2,
+					nx, ny, nz);
+				sumX += nx;
+				sumY += ny;
+				sumZ += nz;
+			}
+
+			// opposing normals cancel out, and renormalizing what is left would
+			// amplify quantization noise, so fall back to facing the viewer
+			float length = std::sqrt(sumX * sumX + sumY * sumY + sumZ * sumZ);
+			float inverseLength = length > 0.05f ? 1.0f / length : 0.0f;
+
+			uint8_t* texel = dst + (static_cast<size_t>(y) * dstWidth + x) * 2;
+			texel[0] = static_cast<uint8_t>(std::clamp(
+				std::nearbyint((sumX * inverseLength) * 127.5f + 127.5f), 0.0f, 255.0f));
+			texel[1] = static_cast<uint8_t>(std::clamp(
+				std::nearbyint((sumY * inverseLength) * 127.5f + 127.5f), 0.0f, 255.0f));
+		}
+	}
+}
+} // namespace wrengine
\ No newline at end of file
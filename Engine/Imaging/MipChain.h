@@ -0,0 +1,25 @@
+#pragma once
+
+#include "PixelKernels.h"
+
+namespace wrengine
+{
+uint32_t mipLevelCount(uint32_t width, uint32_t height);
+uint32_t mipExtent(uint32_t size, uint32_t level);
+PixelRect mipRect(const PixelRect& rect, uint32_t level);
+void downsampleRGBA8(
+	const uint8_t* src,
+	uint32_t srcWidth,
+	uint32_t srcHeight,
+	uint8_t* dst,
+	uint32_t dstWidth,
+	const PixelRect& dstRect,
+	bool srgb);
+void downsampleNormalsRG(
+	const uint8_t* src,
+	uint32_t srcWidth,
+	uint32_t srcHeight,
+	uint8_t* dst,
+	uint32_t dstWidth,
+	const PixelRect& dstRect);
+} // namespace wrengine
\ No newline at end of file
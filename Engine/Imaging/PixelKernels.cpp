@@ -0,0 +1,262 @@
+#include "PixelKernelsImpl.h"
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#ifdef WR_PIXEL_KERNELS_X86
+	#ifdef _MSC_VER
+		#include <intrin.h>
+	#else
+		#include <cpuid.h>
+	#endif
+#endif
+
+namespace wrengine
+{
+namespace detail
+{
+/**
+* Keeps the R and G channels of RGBA texels.
+*/
+void packRGScalar(const uint8_t* src, uint8_t* dst, size_t count)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		dst[i * 2 + 0] = src[i * 4 + 0];
+		dst[i * 2 + 1] = src[i * 4 + 1];
+	}
+}
+
+/**
+* Renormalizes RGB encoded normals and keeps their x and y. The operation order
+* matches the vector kernels so that every variant is bit exact.
+*/
+void packNormalsRGScalar(const uint8_t* src, uint8_t* dst, size_t count)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		float x = static_cast<float>(src[i * 4 + 0]) * NORMAL_DECODE_SCALE - 1.0f;
+		float y = static_cast<float>(src[i * 4 + 1]) * NORMAL_DECODE_SCALE - 1.0f;
+		float z = static_cast<float>(src[i * 4 + 2]) * NORMAL_DECODE_SCALE - 1.0f;
+
+		float lengthSquared = (x * x + y * y) + z * z;
+		float inverseLength = 1.0f / std::sqrt(lengthSquared);
+
+		float outX = (x * inverseLength) * NORMAL_ENCODE_SCALE + NORMAL_ENCODE_SCALE;
+		float outY = (y * inverseLength) * NORMAL_ENCODE_SCALE + NORMAL_ENCODE_SCALE;
+
+		dst[i * 2 + 0] = static_cast<uint8_t>(
+			std::clamp(std::nearbyint(outX), 0.0f, 255.0f));
+		dst[i * 2 + 1] = static_cast<uint8_t>(
+			std::clamp(std::nearbyint(outY), 0.0f, 255.0f));
+	}
+}
+
+/**
+* Compares a single texel of two rows.
+*/
+static bool texelEqual(const uint8_t* a, const uint8_t* b, uint32_t x)
+{
+	return std::memcmp(a + x * 4, b + x * 4, 4) == 0;
+}
+
+/**
+* Finds the first and last differing texels of two rows.
+*
+* @return False if the rows are equal.
+*/
+bool rowDiffScalar(
+	const uint8_t* a,
+	const uint8_t* b,
+	uint32_t width,
+	uint32_t& first,
+	uint32_t& last)
+{
+	uint32_t x = 0;
+	while (x < width && texelEqual(a, b, x)) ++x;
+	if (x == width) return false;
+	first = x;
+
+	// terminates at first at the latest
+	uint32_t end = width - 1;
+	while (texelEqual(a, b, end)) --end;
+	last = end;
+	return true;
+}
+
+/**
+* Accumulates the bounding rectangle of differing rows using a row comparison
+* function.
+*/
+PixelRect diffRectRows(
+	const uint8_t* a,
+	const uint8_t* b,
+	uint32_t width,
+	uint32_t height,
+	RowDiffFunction rowDiff)
+{
+	uint32_t minX = width;
+	uint32_t maxX = 0;
+	uint32_t minY = height;
+	uint32_t maxY = 0;
+	size_t stride = static_cast<size_t>(width) * 4;
+
+	for (uint32_t y = 0; y < height; ++y)
+	{
+		uint32_t first;
+		uint32_t last;
+		if (!rowDiff(a + y * stride, b + y * stride, width, first, last)) continue;
+
+		minX = std::min(minX, first);
+		maxX = std::max(maxX, last);
+		if (minY == height) minY = y;
+		maxY = y;
+	}
+
+	if (minY == height) return PixelRect{};
+	return PixelRect{ minX, minY, maxX - minX + 1, maxY - minY + 1 };
+}
+
+PixelRect diffRectScalar(
+	const uint8_t* a,
+	const uint8_t* b,
+	uint32_t width,
+	uint32_t height)
+{
+	return diffRectRows(a, b, width, height, rowDiffScalar);
+}
+
+#ifdef WR_PIXEL_KERNELS_X86
+/**
+* Queries a cpuid leaf and subleaf.
+*/
+static void cpuid(int info[4], int leaf, int subleaf)
+{
+#ifdef _MSC_VER
+	__cpuidex(info, leaf, subleaf);
+#else
+	unsigned int a, b, c, d;
+	__cpuid_count(leaf, subleaf, a, b, c, d);
+	info[0] = static_cast<int>(a);
+	info[1] = static_cast<int>(b);
+	info[2] = static_cast<int>(c);
+	info[3] = static_cast<int>(d);
+#endif
+}
+
+/**
+* Reads the XCR0 register, describing the register state saved by the OS.
+*/
+static uint64_t readXCR0()
+{
+#ifdef _MSC_VER
+	return _xgetbv(0);
+#else
+	uint32_t low, high;
+	__asm__ volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+	return (static_cast<uint64_t>(high) << 32) | low;
+#endif
+}
+#endif
+} // namespace detail
+
+/**
+* Detects the highest supported instruction set level with kernels. AVX2 also
+* requires the OS to save the upper halves of the vector registers. The level
+* can be capped by setting WRENGINE_SIMD to scalar, sse4.2 or avx2.
+*
+* @return The instruction set level.
+*/
+SimdLevel detectSimdLevel()
+{
+	SimdLevel level = SimdLevel::Scalar;
+
+#ifdef WR_PIXEL_KERNELS_X86
+	int info[4];
+	detail::cpuid(info, 0, 0);
+	int maxLeaf = info[0];
+
+	detail::cpuid(info, 1, 0);
+	bool hasSSE42 = (info[2] & (1 << 20)) != 0;
+	bool hasOSXSave = (info[2] & (1 << 27)) != 0;
+	bool hasAVX = (info[2] & (1 << 28)) != 0;
+
+	if (hasSSE42)
+	{
+		level = SimdLevel::SSE42;
+
+		if (maxLeaf >= 7 && hasOSXSave && hasAVX &&
+			(detail::readXCR0() & 0x6) == 0x6)
+		{
+			detail::cpuid(info, 7, 0);
+			if (info[1] & (1 << 5))
+			{
+				level = SimdLevel::AVX2;
+			}
+		}
+	}
+#endif
+
+	if (const char* cap = std::getenv("WRENGINE_SIMD"))
+	{
+		std::string capName{ cap };
+		SimdLevel capLevel = SimdLevel::AVX2;
+		if (capName == "scalar") capLevel = SimdLevel::Scalar;
+		else if (capName == "sse4.2") capLevel = SimdLevel::SSE42;
+		level = std::min(level, capLevel);
+	}
+
+	return level;
+}
+
+/**
+* Gets the kernels for the best instruction set supported by this CPU. The
+* selection is made once, on first use.
+*
+* @return The selected kernel table.
+*/
+const PixelKernels& getPixelKernels()
+{
+	static const PixelKernels& kernels = getPixelKernels(detectSimdLevel());
+	return kernels;
+}
+
+/**
+* Gets the kernels for an instruction set level. The caller is responsible for
+* checking the level is supported, see detectSimdLevel. Builds without x86
+* kernels return the scalar kernels for every level.
+*
+* @param level The instruction set level.
+*
+* @return The kernel table for the level.
+*/
+const PixelKernels& getPixelKernels(SimdLevel level)
+{
+	static const PixelKernels scalarKernels{
+		"scalar",
+		detail::packRGScalar,
+		detail::packNormalsRGScalar,
+		detail::diffRectScalar
+	};
+
+#ifdef WR_PIXEL_KERNELS_X86
+	switch (level)
+	{
+	case SimdLevel::AVX2:
+		return detail::pixelKernelsAVX2();
+	case SimdLevel::SSE42:
+		return detail::pixelKernelsSSE42();
+	default:
+		break;
+	}
+#else
+	(void)level;
+#endif
+
+	return scalarKernels;
+}
+} // namespace wrengine
\ No newline at end of file
@@ -0,0 +1,58 @@
+#pragma once
+
+//std
+#include <cstddef>
+#include <cstdint>
+
+namespace wrengine
+{
+/**
+* Rectangle in pixels. A rectangle with zero width or height is empty.
+*/
+struct PixelRect
+{
+	uint32_t x = 0;
+	uint32_t y = 0;
+	uint32_t width = 0;
+	uint32_t height = 0;
+
+	bool isEmpty() const { return width == 0 || height == 0; }
+};
+
+/**
+* Instruction set levels with a kernel implementation, in ascending order.
+*/
+enum class SimdLevel
+{
+	Scalar = 0,
+	SSE42,
+	AVX2,
+};
+
+/**
+* Table of pixel conversion kernels for one instruction set, those the texture
+* ingest path uses. Source data is tightly packed 8 bit RGBA.
+*/
+struct PixelKernels
+{
+	const char* name;
+
+	// keep the R and G channels, writing 2 bytes per texel
+	void (*packRG)(const uint8_t* src, uint8_t* dst, size_t count);
+
+	// decode an RGB normal, renormalize it, and write its x and y as 2 bytes
+	// per texel, for z to be reconstructed in the shader
+	void (*packNormalsRG)(const uint8_t* src, uint8_t* dst, size_t count);
+
+	// bounding rectangle of the texels that differ between two images
+	PixelRect (*diffRect)(
+		const uint8_t* a,
+		const uint8_t* b,
+		uint32_t width,
+		uint32_t height);
+};
+
+SimdLevel detectSimdLevel();
+const PixelKernels& getPixelKernels();
+const PixelKernels& getPixelKernels(SimdLevel level);
+} // namespace wrengine
\ No newline at end of file
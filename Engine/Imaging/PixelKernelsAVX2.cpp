@@ -0,0 +1,193 @@
+#include "PixelKernelsImpl.h"
+
+// compiled with AVX2 enabled, and only called after runtime detection
+
+#ifdef WR_PIXEL_KERNELS_X86
+
+#include <immintrin.h>
+
+namespace wrengine
+{
+namespace detail
+{
+static inline __m256i load256(const uint8_t* src)
+{
+	return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));
+}
+
+static inline void store256(uint8_t* dst, __m256i value)
+{
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), value);
+}
+
+/**
+* Index of the lowest set bit of a non zero mask.
+*/
+static inline uint32_t lowestBit(uint32_t mask)
+{
+	uint32_t bit = 0;
+	while (!(mask & (1u << bit))) ++bit;
+	return bit;
+}
+
+/**
+* Index of the highest set bit of a non zero mask.
+*/
+static inline uint32_t highestBit(uint32_t mask)
+{
+	uint32_t bit = 31;
+	while (!(mask & (1u << bit))) --bit;
+	return bit;
+}
+
+static void packRGAVX2(const uint8_t* src, uint8_t* dst, size_t count)
+{
+	const __m256i shuffle = _mm256_setr_epi8(
+		0, 1, 4, 5, 8, 9, 12, 13, -1, -1, -1, -1, -1, -1, -1, -1,
+		0, 1, 4, 5, 8, 9, 12, 13, -1, -1, -1, -1, -1, -1, -1, -1);
+
+	// sixteen texels per iteration, so every store is a full 256 bits
+	size_t i = 0;
+	for (; i + 16 <= count; i += 16)
+	{
+		// gather the low 64 bits of each lane into the low 128 bits
+		__m256i a = _mm256_shuffle_epi8(load256(src + i * 4), shuffle);
+		__m256i b = _mm256_shuffle_epi8(load256(src + i * 4 + 32), shuffle);
+		a = _mm256_permute4x64_epi64(a, _MM_SHUFFLE(3, 1, 2, 0));
+		b = _mm256_permute4x64_epi64(b, _MM_SHUFFLE(3, 1, 2, 0));
+		store256(dst + i * 2, _mm256_permute2x128_si256(a, b, 0x20));
+	}
+	packRGScalar(src + i * 4, dst + i * 2, count - i);
+}
+
+static void packNormalsRGAVX2(const uint8_t* src, uint8_t* dst, size_t count)
+{
+	const __m256i byteMask = _mm256_set1_epi32(0xFF);
+	const __m256 decodeScale = _mm256_set1_ps(NORMAL_DECODE_SCALE);
+	const __m256 encodeScale = _mm256_set1_ps(NORMAL_ENCODE_SCALE);
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256i maxValue = _mm256_set1_epi32(255);
+	const __m256i zero = _mm256_setzero_si256();
+
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256i texels = load256(src + i * 4);
+		__m256 x = _mm256_cvtepi32_ps(_mm256_and_si256(texels, byteMask));
+		__m256 y = _mm256_cvtepi32_ps(
+			_mm256_and_si256(_mm256_srli_epi32(texels, 8), byteMask));
+		__m256 z = _mm256_cvtepi32_ps(
+			_mm256_and_si256(_mm256_srli_epi32(texels, 16), byteMask));
+
+		x = _mm256_sub_ps(_mm256_mul_ps(x, decodeScale), one);
+		y = _mm256_sub_ps(_mm256_mul_ps(y, decodeScale), one);
+		z = _mm256_sub_ps(_mm256_mul_ps(z, decodeScale), one);
+
+		__m256 lengthSquared = _mm256_add_ps(
+			_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)),
+			_mm256_mul_ps(z, z));
+		__m256 inverseLength = _mm256_div_ps(one, _mm256_sqrt_ps(lengthSquared));
+
+		__m256 outX = _mm256_add_ps(
+			_mm256_mul_ps(_mm256_mul_ps(x, inverseLength), encodeScale),
+			encodeScale);
+		__m256 outY = _mm256_add_ps(
+			_mm256_mul_ps(_mm256_mul_ps(y, inverseLength), encodeScale),
+			encodeScale);
+
+		__m256i intX = _mm256_min_epi32(
+			_mm256_max_epi32(_mm256_cvtps_epi32(outX), zero), maxValue);
+		__m256i intY = _mm256_min_epi32(
+			_mm256_max_epi32(_mm256_cvtps_epi32(outY), zero), maxValue);
+
+		// narrow x | y << 8 to 16 bits per texel, then gather both lanes
+		__m256i packed = _mm256_or_si256(intX, _mm256_slli_epi32(intY, 8));
+		packed = _mm256_packus_epi32(packed, packed);
+		packed = _mm256_permute4x64_epi64(packed, _MM_SHUFFLE(3, 1, 2, 0));
+		_mm_storeu_si128(
+			reinterpret_cast<__m128i*>(dst + i * 2),
+			_mm256_castsi256_si128(packed));
+	}
+	packNormalsRGScalar(src + i * 4, dst + i * 2, count - i);
+}
+
+/**
+* Compares eight texels, returning a bit per texel set where they differ.
+*/
+static inline uint32_t differingTexels(const uint8_t* a, const uint8_t* b)
+{
+	__m256i equal = _mm256_cmpeq_epi32(load256(a), load256(b));
+	return ~static_cast<uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(equal))) & 0xFF;
+}
+
+static bool rowDiffAVX2(
+	const uint8_t* a,
+	const uint8_t* b,
+	uint32_t width,
+	uint32_t& first,
+	uint32_t& last)
+{
+	uint32_t x = 0;
+	uint32_t mask = 0;
+	for (; x + 8 <= width; x += 8)
+	{
+		mask = differingTexels(a + x * 4, b + x * 4);
+		if (mask) break;
+	}
+
+	if (!mask)
+	{
+		uint32_t tailFirst;
+		uint32_t tailLast;
+		if (!rowDiffScalar(a + x * 4, b + x * 4, width - x, tailFirst, tailLast))
+		{
+			return false;
+		}
+		first = x + tailFirst;
+		last = x + tailLast;
+		return true;
+	}
+	first = x + lowestBit(mask);
+
+	// search back from the end, in blocks that stay clear of the first texel
+	uint32_t end = width;
+	for (; end >= first + 8; end -= 8)
+	{
+		uint32_t endMask = differingTexels(a + (end - 8) * 4, b + (end - 8) * 4);
+		if (endMask)
+		{
+			last = end - 8 + highestBit(endMask);
+			return true;
+		}
+	}
+
+	uint32_t tailFirst;
+	uint32_t tailLast;
+	rowDiffScalar(a + first * 4, b + first * 4, end - first, tailFirst, tailLast);
+	last = first + tailLast;
+	return true;
+}
+
+static PixelRect diffRectAVX2(
+	const uint8_t* a,
+	const uint8_t* b,
+	uint32_t width,
+	uint32_t height)
+{
+	return diffRectRows(a, b, width, height, rowDiffAVX2);
+}
+
+const PixelKernels& pixelKernelsAVX2()
+{
+	static const PixelKernels kernels{
+		"avx2",
+		packRGAVX2,
+		packNormalsRGAVX2,
+		diffRectAVX2
+	};
+	return kernels;
+}
+} // namespace detail
+} // namespace wrengine
+
+#endif // WR_PIXEL_KERNELS_X86
\ No newline at end of file
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "PixelKernels.h"
+
+// kernel tables and shared helpers for the per instruction set translation
+// units, not part of the public interface
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+	#define WR_PIXEL_KERNELS_X86
+#endif
+
+namespace wrengine
+{
+namespace detail
+{
+constexpr float NORMAL_DECODE_SCALE = 2.0f / 255.0f;
+constexpr float NORMAL_ENCODE_SCALE = 127.5f;
+
+// scalar kernels, also used for the tails of the vector kernels
+void packRGScalar(const uint8_t* src, uint8_t* dst, size_t count);
+void packNormalsRGScalar(const uint8_t* src, uint8_t* dst, size_t count);
+PixelRect diffRectScalar(
+	const uint8_t* a,
+	const uint8_t* b,
+	uint32_t width,
+	uint32_t height);
+
+// returns the first and last differing texel of a row, or false if the rows
+// are equal, shared by every diffRect implementation
+using RowDiffFunction = bool (*)(
+	const uint8_t* a,
+	const uint8_t* b,
+	uint32_t width,
+	uint32_t& first,
+	uint32_t& last);
+PixelRect diffRectRows(
+	const uint8_t* a,
+	const uint8_t* b,
+	uint32_t width,
+	uint32_t height,
+	RowDiffFunction rowDiff);
+bool rowDiffScalar(
+	const uint8_t* a,
+	const uint8_t* b,
+	uint32_t width,
+	uint32_t& first,
+	uint32_t& last);
+
+#ifdef WR_PIXEL_KERNELS_X86
+const PixelKernels& pixelKernelsSSE42();
+const PixelKernels& pixelKernelsAVX2();
+#endif
+} // namespace detail
+} // namespace wrengine
\ No newline at end of file
@@ -0,0 +1,185 @@
+#include "PixelKernelsImpl.h"
+
+// compiled with SSE4.2 enabled, and only called after runtime detection
+
+#ifdef WR_PIXEL_KERNELS_X86
+
+#include <immintrin.h>
+
+namespace wrengine
+{
+namespace detail
+{
+static inline __m128i load128(const uint8_t* src)
+{
+	return _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+}
+
+static inline void store128(uint8_t* dst, __m128i value)
+{
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(dst), value);
+}
+
+/**
+* Index of the lowest set bit of a non zero mask.
+*/
+static inline uint32_t lowestBit(uint32_t mask)
+{
+	uint32_t bit = 0;
+	while (!(mask & (1u << bit))) ++bit;
+	return bit;
+}
+
+/**
+* Index of the highest set bit of a non zero mask.
+*/
+static inline uint32_t highestBit(uint32_t mask)
+{
+	uint32_t bit = 31;
+	while (!(mask & (1u << bit))) --bit;
+	return bit;
+}
+
+static void packRGSSE42(const uint8_t* src, uint8_t* dst, size_t count)
+{
+	const __m128i shuffle = _mm_setr_epi8(
+		0, 1, 4, 5, 8, 9, 12, 13, -1, -1, -1, -1, -1, -1, -1, -1);
+
+	// sixteen texels per iteration, so every store is a full 128 bits
+	size_t i = 0;
+	for (; i + 16 <= count; i += 16)
+	{
+		__m128i a = _mm_shuffle_epi8(load128(src + i * 4), shuffle);
+		__m128i b = _mm_shuffle_epi8(load128(src + i * 4 + 16), shuffle);
+		__m128i c = _mm_shuffle_epi8(load128(src + i * 4 + 32), shuffle);
+		__m128i d = _mm_shuffle_epi8(load128(src + i * 4 + 48), shuffle);
+		store128(dst + i * 2, _mm_unpacklo_epi64(a, b));
+		store128(dst + i * 2 + 16, _mm_unpacklo_epi64(c, d));
+	}
+	packRGScalar(src + i * 4, dst + i * 2, count - i);
+}
+
+static void packNormalsRGSSE42(const uint8_t* src, uint8_t* dst, size_t count)
+{
+	const __m128i byteMask = _mm_set1_epi32(0xFF);
+	const __m128 decodeScale = _mm_set1_ps(NORMAL_DECODE_SCALE);
+	const __m128 encodeScale = _mm_set1_ps(NORMAL_ENCODE_SCALE);
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128i maxValue = _mm_set1_epi32(255);
+	const __m128i zero = _mm_setzero_si128();
+
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128i texels = load128(src + i * 4);
+		__m128 x = _mm_cvtepi32_ps(_mm_and_si128(texels, byteMask));
+		__m128 y = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(texels, 8), byteMask));
+		__m128 z = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(texels, 16), byteMask));
+
+		x = _mm_sub_ps(_mm_mul_ps(x, decodeScale), one);
+		y = _mm_sub_ps(_mm_mul_ps(y, decodeScale), one);
+		z = _mm_sub_ps(_mm_mul_ps(z, decodeScale), one);
+
+		__m128 lengthSquared = _mm_add_ps(
+			_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)),
+			_mm_mul_ps(z, z));
+		__m128 inverseLength = _mm_div_ps(one, _mm_sqrt_ps(lengthSquared));
+
+		__m128 outX = _mm_add_ps(
+			_mm_mul_ps(_mm_mul_ps(x, inverseLength), encodeScale),
+			encodeScale);
+		__m128 outY = _mm_add_ps(
+			_mm_mul_ps(_mm_mul_ps(y, inverseLength), encodeScale),
+			encodeScale);
+
+		__m128i intX = _mm_min_epi32(_mm_max_epi32(_mm_cvtps_epi32(outX), zero), maxValue);
+		__m128i intY = _mm_min_epi32(_mm_max_epi32(_mm_cvtps_epi32(outY), zero), maxValue);
+
+		// each 32 bit lane now holds x | y << 8, narrow to 16 bits per texel
+		__m128i packed = _mm_or_si128(intX, _mm_slli_epi32(intY, 8));
+		packed = _mm_packus_epi32(packed, packed);
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(dst + i * 2), packed);
+	}
+	packNormalsRGScalar(src + i * 4, dst + i * 2, count - i);
+}
+
+/**
+* Compares four texels, returning a bit per texel set where they differ.
+*/
+static inline uint32_t differingTexels(const uint8_t* a, const uint8_t* b)
+{
+	__m128i equal = _mm_cmpeq_epi32(load128(a), load128(b));
+	return ~static_cast<uint32_t>(_mm_movemask_ps(_mm_castsi128_ps(equal))) & 0xF;
+}
+
+static bool rowDiffSSE42(
+	const uint8_t* a,
+	const uint8_t* b,
+	uint32_t width,
+	uint32_t& first,
+	uint32_t& last)
+{
+	uint32_t x = 0;
+	uint32_t mask = 0;
+	for (; x + 4 <= width; x += 4)
+	{
+		mask = differingTexels(a + x * 4, b + x * 4);
+		if (mask) break;
+	}
+
+	if (!mask)
+	{
+		uint32_t tailFirst;
+		uint32_t tailLast;
+		if (!rowDiffScalar(a + x * 4, b + x * 4, width - x, tailFirst, tailLast))
+		{
+			return false;
+		}
+		first = x + tailFirst;
+		last = x + tailLast;
+		return true;
+	}
+	first = x + lowestBit(mask);
+
+	// search back from the end, in blocks that stay clear of the first texel
+	uint32_t end = width;
+	for (; end >= first + 4; end -= 4)
+	{
+		uint32_t endMask = differingTexels(a + (end - 4) * 4, b + (end - 4) * 4);
+		if (endMask)
+		{
+			last = end - 4 + highestBit(endMask);
+			return true;
+		}
+	}
+
+	uint32_t tailFirst;
+	uint32_t tailLast;
+	rowDiffScalar(a + first * 4, b + first * 4, end - first, tailFirst, tailLast);
+	last = first + tailLast;
+	return true;
+}
+
+static PixelRect diffRectSSE42(
+	const uint8_t* a,
+	const uint8_t* b,
+	uint32_t width,
+	uint32_t height)
+{
+	return diffRectRows(a, b, width, height, rowDiffSSE42);
+}
+
+const PixelKernels& pixelKernelsSSE42()
+{
+	static const PixelKernels kernels{
+		"sse4.2",
+		packRGSSE42,
+		packNormalsRGSSE42,
+		diffRectSSE42
+	};
+	return kernels;
+}
+} // namespace detail
+} // namespace wrengine
+
+#endif // WR_PIXEL_KERNELS_X86
\ No newline at end of file
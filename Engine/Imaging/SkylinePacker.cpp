@@ -0,0 +1,152 @@
+#include "SkylinePacker.h"
+
+// std
+#include <algorithm>
+#include <limits>
+
+namespace wrengine
+{
+/**
+* Creates an empty page.
+*
+* @param width The page width in pixels.
+* @param height The page height in pixels.
+*/
+SkylinePacker::SkylinePacker(uint32_t width, uint32_t height) :
+	m_width{ width },
+	m_height{ height }
+{
+	reset();
+}
+
+/**
+* Finds a place for a rectangle, choosing the position with the lowest top edge
+* and then the least width of skyline left to its right.
+*
+* @param width The rectangle width in pixels.
+* @param height The rectangle height in pixels.
+* @param rect Set to the placed rectangle on success.
+*
+* @return False if the rectangle does not fit in the page.
+*/
+bool SkylinePacker::insert(uint32_t width, uint32_t height, PixelRect& rect)
+{
+	if (width == 0 || height == 0) return false;
+
+	size_t bestIndex = m_skyline.size();
+	uint32_t bestTop = std::numeric_limits<uint32_t>::max();
+	uint32_t bestWidth = std::numeric_limits<uint32_t>::max();
+	uint32_t bestY = 0;
+
+	for (size_t i = 0; i < m_skyline.size(); ++i)
+	{
+		uint32_t y;
+		if (!fit(i, width, height, y)) continue;
+
+		uint32_t top = y + height;
+		if (top < bestTop || (top == bestTop && m_skyline[i].width < bestWidth))
+		{
+			bestIndex = i;
+			bestTop = top;
+			bestWidth = m_skyline[i].width;
+			bestY = y;
+		}
+	}
+
+	if (bestIndex == m_skyline.size()) return false;
+
+	rect = PixelRect{ m_skyline[bestIndex].x, bestY, width, height };
+	addLevel(bestIndex, rect);
+	m_usedArea += static_cast<uint64_t>(width) * height;
+	return true;
+}
+
+/**
+* Empties the page.
+*/
+void SkylinePacker::reset()
+{
+	m_skyline.assign(1, Segment{ 0, 0, m_width });
+	m_usedArea = 0;
+}
+
+/**
+* Gets the fraction of the page area covered by packed rectangles.
+*
+* @return Occupancy between zero and one.
+*/
+float SkylinePacker::getOccupancy() const
+{
+	return static_cast<float>(m_usedArea) /
+		(static_cast<float>(m_width) * static_cast<float>(m_height));
+}
+
+/**
+* Tests whether a rectangle fits with its left edge at the start of a segment.
+* It rests on the highest segment beneath it.
+*
+* @param index The skyline segment index.
+* @param width The rectangle width in pixels.
+* @param height The rectangle height in pixels.
+* @param y Set to the bottom of the rectangle when it fits.
+*
+* @return True if the rectangle fits.
+*/
+bool SkylinePacker::fit(size_t index, uint32_t width, uint32_t height, uint32_t& y) const
+{
+	uint32_t x = m_skyline[index].x;
+	if (width > m_width - x) return false;
+
+	y = 0;
+	uint32_t remaining = width;
+	for (size_t i = index; remaining > 0; ++i)
+	{
+		y = std::max(y, m_skyline[i].y);
+		if (height > m_height - y) return false;
+		remaining -= std::min(remaining, m_skyline[i].width);
+	}
+	return true;
+}
+
+/**
+* Raises the skyline over a placed rectangle, trimming the segments it covers
+* and merging neighbouring segments of equal height.
+*
+* @param index The segment the rectangle starts at.
+* @param rect The placed rectangle.
+*/
+void SkylinePacker::addLevel(size_t index, const PixelRect& rect)
+{
+	m_skyline.insert(
+		m_skyline.begin() + index,
+		Segment{ rect.x, rect.y + rect.height, rect.width });
+
+	uint32_t right = rect.x + rect.width;
+	for (size_t i = index + 1; i < m_skyline.size();)
+	{
+		Segment& segment = m_skyline[i];
+		if (segment.x >= right) break;
+
+		uint32_t segmentRight = segment.x + segment.width;
+		if (segmentRight <= right)
+		{
+			m_skyline.erase(m_skyline.begin() + i);
+			continue;
+		}
+		segment.width = segmentRight - right;
+		segment.x = right;
+		break;
+	}
+
+	for (size_t i = 0; i + 1 < m_skyline.size();)
+	{
+		if (m_skyline[i].y == m_skyline[i + 1].y)
+		{
+			m_skyline[i].width += m_skyline[i + 1].width;
+			m_skyline.erase(m_skyline.begin() + i + 1);
+			continue;
+		}
+		++i;
+	}
+}
+} // namespace wrengine
\ No newline at end of file
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "PixelKernels.h"
+
+//std
+#include <cstdint>
+#include <vector>
+
+namespace wrengine
+{
+/**
+* Packs rectangles into a fixed size page with the skyline bottom left
+* heuristic. The top edge of the packed area is kept as a list of horizontal
+* segments, and each rectangle is placed where its top edge is lowest. The
+* skyline does not record the space below it, so single rectangles cannot be
+* freed, only the whole page reset.
+*/
+class SkylinePacker
+{
+public:
+	SkylinePacker(uint32_t width, uint32_t height);
+
+	bool insert(uint32_t width, uint32_t height, PixelRect& rect);
+	void reset();
+
+	// getters
+	uint32_t getWidth() const { return m_width; }
+	uint32_t getHeight() const { return m_height; }
+	float getOccupancy() const;
+
+private:
+	struct Segment
+	{
+		uint32_t x;
+		uint32_t y;
+		uint32_t width;
+	};
+
+	bool fit(size_t index, uint32_t width, uint32_t height, uint32_t& y) const;
+	void addLevel(size_t index, const PixelRect& rect);
+
+	uint32_t m_width;
+	uint32_t m_height;
+	uint64_t m_usedArea = 0;
+	std::vector<Segment> m_skyline;
+};
+} // namespace wrengine
\ No newline at end of file
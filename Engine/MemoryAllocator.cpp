@@ -0,0 +1,479 @@
+#include "MemoryAllocator.h"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace wrengine
+{
+/**
+* Rounds a value up to the next multiple of alignment.
+*/
+static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+	return alignment > 1 ? ((value + alignment - 1) / alignment) * alignment : value;
+}
+
+MemoryAllocator::MemoryAllocator(
+	VkDevice device,
+	VkPhysicalDevice physicalDevice) :
+	m_device{ device }
+{
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &m_memoryProperties);
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+	m_nonCoherentAtomSize =
+		std::max<VkDeviceSize>(properties.limits.nonCoherentAtomSize, 1);
+}
+
+MemoryAllocator::~MemoryAllocator()
+{
+	for (auto& kinds : m_slabs)
+	{
+		for (auto& sizeClasses : kinds)
+		{
+			for (auto& slabs : sizeClasses)
+			{
+				for (auto& slab : slabs)
+				{
+					vkFreeMemory(m_device, slab->memory, nullptr);
+				}
+				slabs.clear();
+			}
+		}
+	}
+
+	for (auto& pool : m_stagingPools)
+	{
+		if (pool.memory != VK_NULL_HANDLE)
+		{
+			vkFreeMemory(m_device, pool.memory, nullptr);
+		}
+	}
+}
+
+/**
+* Allocates a region of device memory satisfying the supplied requirements.
+* Will throw a runtime error if no suitable memory type exists or the device is
+* out of memory.
+*
+* @param requirements Memory requirements of the resource to be bound.
+* @param properties Bitmask of VkMemoryPropertyFlagBits the memory must have.
+* @param type The intended usage of the memory.
+*
+* @return The allocated region.
+*/
+Allocation MemoryAllocator::allocate(
+	const VkMemoryRequirements& requirements,
+	VkMemoryPropertyFlags properties,
+	AllocationType type)
+{
+	Allocation allocation{};
+	allocation.memoryType = findMemoryType(
+		requirements.memoryTypeBits,
+		properties);
+	allocation.size = requirements.size;
+
+	std::scoped_lock<std::mutex> lock(m_mutex);
+
+	bool placed = false;
+	if (type == AllocationType::Staging)
+	{
+		placed = allocateFromLinearPool(
+			requirements,
+			allocation.memoryType,
+			allocation);
+	}
+
+	bool wantsDedicated =
+		requirements.size > MAX_SLOT_SIZE ||
+		(type == AllocationType::Image &&
+			requirements.size >= DEDICATED_IMAGE_THRESHOLD);
+
+	if (!placed && !wantsDedicated)
+	{
+		uint32_t resourceKind = type == AllocationType::Image ? 1 : 0;
+		placed = allocateFromSlab(
+			requirements,
+			allocation.memoryType,
+			resourceKind,
+			allocation);
+	}
+
+	if (!placed)
+	{
+		allocateDedicated(requirements, allocation.memoryType, allocation);
+	}
+
+	m_stats.allocationCount++;
+	m_stats.usedBytes += allocation.size;
+	return allocation;
+}
+
+/**
+* Returns an allocation to the allocator. The allocation is reset, and freeing
+* an empty allocation is a no-op.
+*
+* @param allocation The allocation to free, passed by reference.
+*/
+void MemoryAllocator::free(Allocation& allocation)
+{
+	if (allocation.memory == VK_NULL_HANDLE) return;
+
+	std::scoped_lock<std::mutex> lock(m_mutex);
+
+	switch (allocation.strategy)
+	{
+	case StrategySlab:
+	{
+		Slab* slab = static_cast<Slab*>(allocation.owner);
+		slab->freeSlots.push_back(allocation.slot);
+
+		// release slabs that have emptied, keeping one per size class around so
+		// that alternating allocate/free does not thrash vkAllocateMemory
+		SizeClassSlabs& slabs =
+			m_slabs[allocation.memoryType][slab->resourceKind][slab->sizeClass];
+		if (slab->freeSlots.size() == slab->slotCount && slabs.size() > 1)
+		{
+			freeDeviceMemory(slab->memory, slab->slotSize * slab->slotCount);
+			slabs.erase(std::find_if(
+				slabs.begin(),
+				slabs.end(),
+				[slab](const std::unique_ptr<Slab>& s) { return s.get() == slab; }));
+			m_stats.slabCount--;
+		}
+		break;
+	}
+	case StrategyLinear:
+	{
+		LinearPool& pool = m_stagingPools[allocation.memoryType];
+		auto region = std::find_if(
+			pool.regions.begin(),
+			pool.regions.end(),
+			[&allocation](const LinearRegion& r) { return r.offset == allocation.offset; });
+		assert(region != pool.regions.end() && "staging pool free without allocation");
+		region->freed = true;
+
+		while (!pool.regions.empty() && pool.regions.front().freed)
+		{
+			pool.regions.pop_front();
+		}
+		if (pool.regions.empty())
+		{
+			pool.head = 0;
+		}
+		m_stats.stagingBytes -= allocation.reserved;
+		break;
+	}
+	case StrategyDedicated:
+		freeDeviceMemory(allocation.memory, allocation.reserved);
+		m_stats.dedicatedCount--;
+		break;
+	}
+
+	m_stats.allocationCount--;
+	m_stats.usedBytes -= allocation.size;
+	allocation = Allocation{};
+}
+
+/**
+* Flushes a host write range of an allocation to make it visible to the device.
+* The range is widened to the non-coherent atom size, and clamped to the
+* allocation's reserved region.
+*
+* @param allocation The mapped allocation.
+* @param size (Optional) Size of the range, VK_WHOLE_SIZE for the whole region.
+* @param offset (Optional) Byte offset from the start of the allocation.
+*
+* @return VkResult of the flush call.
+*/
+VkResult MemoryAllocator::flush(
+	const Allocation& allocation,
+	VkDeviceSize size,
+	VkDeviceSize offset)
+{
+	VkMappedMemoryRange range = mappedRange(allocation, size, offset);
+	return vkFlushMappedMemoryRanges(m_device, 1, &range);
+}
+
+/**
+* Invalidates a range of an allocation to make device writes visible to the
+* host. The range is widened to the non-coherent atom size, and clamped to the
+* allocation's reserved region.
+*
+* @param allocation The mapped allocation.
+* @param size (Optional) Size of the range, VK_WHOLE_SIZE for the whole region.
+* @param offset (Optional) Byte offset from the start of the allocation.
+*
+* @return VkResult of the invalidate call.
+*/
+VkResult MemoryAllocator::invalidate(
+	const Allocation& allocation,
+	VkDeviceSize size,
+	VkDeviceSize offset)
+{
+	VkMappedMemoryRange range = mappedRange(allocation, size, offset);
+	return vkInvalidateMappedMemoryRanges(m_device, 1, &range);
+}
+
+/**
+* Gets a snapshot of the allocator statistics.
+*
+* @return Copy of the current statistics.
+*/
+AllocatorStats MemoryAllocator::getStats()
+{
+	std::scoped_lock<std::mutex> lock(m_mutex);
+	return m_stats;
+}
+
+/**
+* Finds the index of a memory type matching the filter and properties. Will
+* throw a runtime error if none is found.
+*/
+uint32_t MemoryAllocator::findMemoryType(
+	uint32_t typeFilter,
+	VkMemoryPropertyFlags properties)
+{
+	for (uint32_t i = 0; i < m_memoryProperties.memoryTypeCount; i++)
+	{
+		if ((typeFilter & (1 << i)) &&
+			(m_memoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+		{
+			return i;
+		}
+	}
+
+	throw std::runtime_error("failed to find suitable memory type!");
+}
+
+/**
+* Allocates a block of device memory, persistently mapping it if the memory
+* type is host visible. Will throw a runtime error on failure.
+*
+* @param size Size in bytes of the block.
+* @param memoryType Index of the memory type to allocate from.
+* @param mapped Set to the host pointer of the block, or nullptr.
+*
+* @return The allocated device memory.
+*/
+VkDeviceMemory MemoryAllocator::allocateDeviceMemory(
+	VkDeviceSize size,
+	uint32_t memoryType,
+	void** mapped)
+{
+	VkMemoryAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = size;
+	allocInfo.memoryTypeIndex = memoryType;
+
+	VkDeviceMemory memory;
+	if (vkAllocateMemory(m_device, &allocInfo, nullptr, &memory) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to allocate device memory!");
+	}
+
+	*mapped = nullptr;
+	if (m_memoryProperties.memoryTypes[memoryType].propertyFlags &
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+	{
+		if (vkMapMemory(m_device, memory, 0, VK_WHOLE_SIZE, 0, mapped) != VK_SUCCESS)
+		{
+			vkFreeMemory(m_device, memory, nullptr);
+			throw std::runtime_error("failed to map device memory!");
+		}
+	}
+
+	m_stats.deviceMemoryCount++;
+	m_stats.reservedBytes += size;
+	return memory;
+}
+
+/**
+* Frees a block of device memory. Mapped memory is implicitly unmapped.
+*/
+void MemoryAllocator::freeDeviceMemory(VkDeviceMemory memory, VkDeviceSize size)
+{
+	vkFreeMemory(m_device, memory, nullptr);
+	m_stats.deviceMemoryCount--;
+	m_stats.reservedBytes -= size;
+}
+
+/**
+* Places an allocation in the smallest power of two size class that satisfies
+* both its size and alignment. Slots are aligned to their own size, so any
+* alignment up to the slot size is satisfied by construction.
+*
+* @return False if the request is too large for any size class.
+*/
+bool MemoryAllocator::allocateFromSlab(
+	const VkMemoryRequirements& requirements,
+	uint32_t memoryType,
+	uint32_t resourceKind,
+	Allocation& allocation)
+{
+	VkDeviceSize required = std::max(requirements.size, requirements.alignment);
+	VkDeviceSize slotSize = MIN_SLOT_SIZE;
+	uint32_t sizeClass = 0;
+	while (slotSize < required)
+	{
+		slotSize <<= 1;
+		sizeClass++;
+	}
+	if (sizeClass >= SIZE_CLASS_COUNT) return false;
+
+	SizeClassSlabs& slabs = m_slabs[memoryType][resourceKind][sizeClass];
+
+	// newest slabs are the most likely to have free slots
+	Slab* slab = nullptr;
+	for (auto it = slabs.rbegin(); it != slabs.rend(); ++it)
+	{
+		if (!(*it)->freeSlots.empty())
+		{
+			slab = it->get();
+			break;
+		}
+	}
+
+	if (!slab)
+	{
+		VkDeviceSize slabSize =
+			std::clamp(slotSize * 16, MIN_SLAB_SIZE, MAX_SLAB_SIZE);
+
+		std::unique_ptr<Slab> newSlab = std::make_unique<Slab>();
+		newSlab->resourceKind = resourceKind;
+		newSlab->sizeClass = sizeClass;
+		newSlab->slotSize = slotSize;
+		newSlab->slotCount = static_cast<uint32_t>(slabSize / slotSize);
+		newSlab->memory =
+			allocateDeviceMemory(slabSize, memoryType, &newSlab->mapped);
+
+		// push in reverse so low offsets are handed out first
+		newSlab->freeSlots.resize(newSlab->slotCount);
+		for (uint32_t i = 0; i < newSlab->slotCount; ++i)
+		{
+			newSlab->freeSlots[i] = newSlab->slotCount - 1 - i;
+		}
+
+		slab = newSlab.get();
+		slabs.push_back(std::move(newSlab));
+		m_stats.slabCount++;
+	}
+
+	uint32_t slot = slab->freeSlots.back();
+	slab->freeSlots.pop_back();
+
+	allocation.memory = slab->memory;
+	allocation.offset = slot * slotSize;
+	allocation.reserved = slotSize;
+	allocation.mapped =
+		slab->mapped ? static_cast<char*>(slab->mapped) + allocation.offset : nullptr;
+	allocation.owner = slab;
+	allocation.slot = slot;
+	allocation.strategy = StrategySlab;
+	return true;
+}
+
+/**
+* Places a staging allocation by bumping the head of the memory type's staging
+* ring. The head wraps to the start when the end of the pool is reached, and
+* may advance up to the oldest allocation still live, so space is reused as
+* soon as the allocations before it are freed rather than once all are.
+*
+* @return False if the pool cannot currently fit the request.
+*/
+bool MemoryAllocator::allocateFromLinearPool(
+	const VkMemoryRequirements& requirements,
+	uint32_t memoryType,
+	Allocation& allocation)
+{
+	VkDeviceSize reserved = alignUp(requirements.size, m_nonCoherentAtomSize);
+	if (reserved > STAGING_POOL_SIZE) return false;
+
+	LinearPool& pool = m_stagingPools[memoryType];
+	if (pool.memory == VK_NULL_HANDLE)
+	{
+		pool.memory =
+			allocateDeviceMemory(STAGING_POOL_SIZE, memoryType, &pool.mapped);
+	}
+
+	VkDeviceSize alignment =
+		std::max(requirements.alignment, m_nonCoherentAtomSize);
+	VkDeviceSize offset = alignUp(pool.head, alignment);
+	if (pool.regions.empty())
+	{
+		offset = 0;
+	}
+	else
+	{
+		// the live regions span from the oldest to head, wrapping if the
+		// newest was placed before the oldest
+		VkDeviceSize oldest = pool.regions.front().offset;
+		bool wrapped = pool.regions.back().offset < oldest;
+		if (!wrapped && offset + reserved > STAGING_POOL_SIZE)
+		{
+			offset = 0;
+			wrapped = true;
+		}
+		if (wrapped && offset + reserved > oldest) return false;
+	}
+
+	pool.head = offset + reserved;
+	pool.regions.push_back({ offset, false });
+	m_stats.stagingBytes += reserved;
+
+	allocation.memory = pool.memory;
+	allocation.offset = offset;
+	allocation.reserved = reserved;
+	allocation.mapped =
+		pool.mapped ? static_cast<char*>(pool.mapped) + offset : nullptr;
+	allocation.owner = &pool;
+	allocation.strategy = StrategyLinear;
+	return true;
+}
+
+/**
+* Gives an allocation its own block of device memory.
+*/
+void MemoryAllocator::allocateDedicated(
+	const VkMemoryRequirements& requirements,
+	uint32_t memoryType,
+	Allocation& allocation)
+{
+	allocation.memory = allocateDeviceMemory(
+		requirements.size,
+		memoryType,
+		&allocation.mapped);
+	allocation.offset = 0;
+	allocation.reserved = requirements.size;
+	allocation.owner = nullptr;
+	allocation.strategy = StrategyDedicated;
+	m_stats.dedicatedCount++;
+}
+
+/**
+* Builds a mapped memory range for an allocation, widened to the non-coherent
+* atom size and clamped to the reserved region.
+*/
+VkMappedMemoryRange MemoryAllocator::mappedRange(
+	const Allocation& allocation,
+	VkDeviceSize size,
+	VkDeviceSize offset)
+{
+	VkDeviceSize regionEnd = allocation.offset + allocation.reserved;
+	VkDeviceSize begin = allocation.offset + offset;
+	VkDeviceSize end = size == VK_WHOLE_SIZE ? regionEnd : begin + size;
+
+	begin = (begin / m_nonCoherentAtomSize) * m_nonCoherentAtomSize;
+	end = std::min(alignUp(end, m_nonCoherentAtomSize), regionEnd);
+
+	VkMappedMemoryRange range{};
+	range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+	range.memory = allocation.memory;
+	range.offset = begin;
+	range.size = end - begin;
+	return range;
+}
+} // namespace wrengine
\ No newline at end of file
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+//std
+#include <array>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace wrengine
+{
+/**
+* Describes how a resource will use its memory, which selects the strategy the
+* allocator uses to place it.
+*/
+enum class AllocationType
+{
+	Buffer,  // linear resource, sub-allocated from size class slabs
+	Image,   // optimal tiling resource, sub-allocated or dedicated when large
+	Staging, // short lived host visible upload memory, from a linear pool
+};
+
+/**
+* A region of device memory handed out by the MemoryAllocator. Host visible
+* memory is persistently mapped, and mapped points at the start of the region.
+*/
+struct Allocation
+{
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	VkDeviceSize offset = 0;
+	VkDeviceSize size = 0;
+	void* mapped = nullptr;
+
+	// allocator bookkeeping
+	VkDeviceSize reserved = 0;
+	uint32_t memoryType = 0;
+	void* owner = nullptr;
+	uint32_t slot = 0;
+	uint8_t strategy = 0;
+};
+
+/**
+* Snapshot of allocator usage.
+*/
+struct AllocatorStats
+{
+	uint32_t deviceMemoryCount = 0;
+	uint32_t allocationCount = 0;
+	uint32_t dedicatedCount = 0;
+	uint32_t slabCount = 0;
+	VkDeviceSize reservedBytes = 0;
+	VkDeviceSize usedBytes = 0;
+	VkDeviceSize stagingBytes = 0;
+};
+
+/**
+* Sub-allocator for device memory. Small and medium resources are placed in
+* power of two size classes carved from shared slabs, one set of slabs per
+* memory type and per linear/optimal resource kind so buffer image granularity
+* never needs to be considered. Staging memory comes from a per memory type
+* ring, which reclaims space from its oldest allocations as they are released,
+* so frames whose staging buffers are retired with their fence keep reusing
+* the same memory. Large
+* images and anything bigger than the largest size class get a dedicated
+* vkAllocateMemory. All methods are thread safe.
+*/
+class MemoryAllocator
+{
+public:
+	static constexpr VkDeviceSize MIN_SLOT_SIZE = 256;
+	static constexpr VkDeviceSize MAX_SLOT_SIZE = 8 * 1024 * 1024;
+	static constexpr VkDeviceSize MIN_SLAB_SIZE = 1024 * 1024;
+	static constexpr VkDeviceSize MAX_SLAB_SIZE = 32 * 1024 * 1024;
+	static constexpr VkDeviceSize STAGING_POOL_SIZE = 32 * 1024 * 1024;
+	static constexpr VkDeviceSize DEDICATED_IMAGE_THRESHOLD = 4 * 1024 * 1024;
+
+	MemoryAllocator(VkDevice device, VkPhysicalDevice physicalDevice);
+	~MemoryAllocator();
+
+	// not copyable
+	MemoryAllocator(const MemoryAllocator&) = delete;
+	MemoryAllocator& operator=(const MemoryAllocator&) = delete;
+
+	Allocation allocate(
+		const VkMemoryRequirements& requirements,
+		VkMemoryPropertyFlags properties,
+		AllocationType type);
+	void free(Allocation& allocation);
+
+	VkResult flush(
+		const Allocation& allocation,
+		VkDeviceSize size = VK_WHOLE_SIZE,
+		VkDeviceSize offset = 0);
+	VkResult invalidate(
+		const Allocation& allocation,
+		VkDeviceSize size = VK_WHOLE_SIZE,
+		VkDeviceSize offset = 0);
+
+	AllocatorStats getStats();
+
+private:
+	static constexpr uint32_t SIZE_CLASS_COUNT = 16; // 256B to 8MB
+	static constexpr uint32_t RESOURCE_KIND_COUNT = 2; // linear, optimal
+
+	enum Strategy : uint8_t
+	{
+		StrategySlab = 0,
+		StrategyLinear,
+		StrategyDedicated,
+	};
+
+	struct Slab
+	{
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		void* mapped = nullptr;
+		uint32_t resourceKind = 0;
+		uint32_t sizeClass = 0;
+		VkDeviceSize slotSize = 0;
+		uint32_t slotCount = 0;
+		std::vector<uint32_t> freeSlots;
+	};
+
+	struct LinearRegion
+	{
+		VkDeviceSize offset = 0;
+		bool freed = false;
+	};
+
+	// regions are kept in allocation order, and reclaimed from the front once
+	// freed, so the oldest live region bounds the space ahead of head
+	struct LinearPool
+	{
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		void* mapped = nullptr;
+		VkDeviceSize head = 0;
+		std::deque<LinearRegion> regions;
+	};
+
+	using SizeClassSlabs = std::vector<std::unique_ptr<Slab>>;
+
+	uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
+	VkDeviceMemory allocateDeviceMemory(
+		VkDeviceSize size,
+		uint32_t memoryType,
+		void** mapped);
+	void freeDeviceMemory(VkDeviceMemory memory, VkDeviceSize size);
+	bool allocateFromSlab(
+		const VkMemoryRequirements& requirements,
+		uint32_t memoryType,
+		uint32_t resourceKind,
+		Allocation& allocation);
+	bool allocateFromLinearPool(
+		const VkMemoryRequirements& requirements,
+		uint32_t memoryType,
+		Allocation& allocation);
+	void allocateDedicated(
+		const VkMemoryRequirements& requirements,
+		uint32_t memoryType,
+		Allocation& allocation);
+	VkMappedMemoryRange mappedRange(
+		const Allocation& allocation,
+		VkDeviceSize size,
+		VkDeviceSize offset);
+
+	VkDevice m_device;
+	VkPhysicalDeviceMemoryProperties m_memoryProperties;
+	VkDeviceSize m_nonCoherentAtomSize;
+
+	// [memory type][resource kind][size class]
+	std::array<
+		std::array<
+			std::array<SizeClassSlabs, SIZE_CLASS_COUNT>,
+			RESOURCE_KIND_COUNT>,
+		VK_MAX_MEMORY_TYPES> m_slabs;
+	std::array<LinearPool, VK_MAX_MEMORY_TYPES> m_stagingPools;
+
+	AllocatorStats m_stats{};
+	std::mutex m_mutex;
+};
+} // namespace wrengine
\ No newline at end of file
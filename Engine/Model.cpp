@@ -58,6 +58,29 @@ Model::Model(
 
 Model::~Model() {}
 
+/**
+* Creates a unit quad centred on the origin, with texture coordinates covering
+* the whole texture.
+*
+* @param device The device to create the buffers on.
+*
+* @return The quad model.
+*/
+std::unique_ptr<Model> Model::createQuad(Device& device)
+{
+	Model::VertexData vertexData{};
+	vertexData.vertices =
+	{
+		{{-0.5f, -0.5f, 0.0f}, {1.0f, 0.0f, 0.0f}, {0.0f, 0.0f}},
+		{{ 0.5f, -0.5f, 0.0f}, {0.0f, 1.0f, 0.0f}, {1.0f, 0.0f}},
+		{{ 0.5f,  0.5f, 0.0f}, {0.0f, 0.0f, 1.0f}, {1.0f, 1.0f}},
+		{{-0.5f,  0.5f, 0.0f}, {1.0f, 1.0f, 1.0f}, {0.0f, 1.0f}}
+	};
+
+	vertexData.indices = { 0, 1, 2, 2, 3, 0 };
+	return std::make_unique<Model>(device, vertexData);
+}
+
 /**
 * Binds the vertex buffer ready for drawing. Will bind index buffer if in use.
 * 
@@ -19,9 +19,14 @@ Pipeline::Pipeline(
 
 Pipeline::~Pipeline()
 {
-	vkDestroyShaderModule(m_device.device(), m_vertShaderModule, nullptr);
-	vkDestroyShaderModule(m_device.device(), m_fragShaderModule, nullptr);
-	vkDestroyPipeline(m_device.device(), m_grahpicsPipeline, nullptr);
+	// command buffers in flight may still be bound to this pipeline, shader
+	// modules are owned by the device's pipeline cache
+	VkDevice device = m_device.device();
+	m_device.retire(
+		[device, pipeline = m_grahpicsPipeline]()
+		{
+			vkDestroyPipeline(device, pipeline, nullptr);
+		});
 }
 
 /**
@@ -51,9 +56,10 @@ std::vector<char> Pipeline::readFile(const std::string& filepath)
 }
 
 /**
-* Creates and constructs the graphics pipeline object. Reads SPIR-V shader files
-* and compiles into shader program. Will throw a runtime error on failure to
-* create graphics pipeline.
+* Creates and constructs the graphics pipeline object. Shader modules come from
+* the device's pipeline cache, which also holds the compiled pipelines of
+* earlier launches. Will throw a runtime error on failure to create graphics
+* pipeline.
 * 
 * @param vertFilepath Path to the SPIR-V vertex shader code.
 * @param fragFilepath Path to the SPIR-V fragment shader code.
@@ -67,11 +73,18 @@ void Pipeline::createGraphicsPipeline(
 {
 	assert(pipelineInfo.pipelineLayout != VK_NULL_HANDLE &&
 		"Cannot create graphics pipeline - no pipeline layout!");
-	std::vector<char> vertCode = readFile(vertFilepath);
-	std::vector<char> fragCode = readFile(fragFilepath);
+	PipelineCache& pipelineCache = m_device.getPipelineCache();
+	m_vertShaderModule = pipelineCache.getShaderModule(vertFilepath);
+	m_fragShaderModule = pipelineCache.getShaderModule(fragFilepath);
 
-	createShaderModule(vertCode, &m_vertShaderModule);
-	createShaderModule(fragCode, &m_fragShaderModule);
+	VkSpecializationInfo specializationInfo{};
+	specializationInfo.mapEntryCount =
+		static_cast<uint32_t>(pipelineInfo.specializationEntries.size());
+	specializationInfo.pMapEntries = pipelineInfo.specializationEntries.data();
+	specializationInfo.dataSize = pipelineInfo.specializationData.size();
+	specializationInfo.pData = pipelineInfo.specializationData.data();
+	const VkSpecializationInfo* stageSpecialization =
+		pipelineInfo.specializationEntries.empty() ? nullptr : &specializationInfo;
 
 	VkPipelineShaderStageCreateInfo shaderStages[2]{};
 	shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -80,7 +93,7 @@ void Pipeline::createGraphicsPipeline(
 	shaderStages[0].pName = "main";
 	shaderStages[0].flags = 0;
 	shaderStages[0].pNext = nullptr;
-	shaderStages[0].pSpecializationInfo = nullptr;
+	shaderStages[0].pSpecializationInfo = stageSpecialization;
 
 	shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 	shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
@@ -88,13 +101,11 @@ void Pipeline::createGraphicsPipeline(
 	shaderStages[1].pName = "main";
 	shaderStages[1].flags = 0;
 	shaderStages[1].pNext = nullptr;
-	shaderStages[1].pSpecializationInfo = nullptr;
+	shaderStages[1].pSpecializationInfo = stageSpecialization;
 
 	
-	std::vector<VkVertexInputBindingDescription> bindingDescriptions =
-		Model::Vertex::getBindingDescriptions();
-	std::vector<VkVertexInputAttributeDescription> attributeDescriptions =
-		Model::Vertex::getAttributeDescriptions();
+	const auto& bindingDescriptions = pipelineInfo.bindingDescriptions;
+	const auto& attributeDescriptions = pipelineInfo.attributeDescriptions;
 
 	VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
 	vertexInputInfo.sType =
@@ -102,7 +113,7 @@ void Pipeline::createGraphicsPipeline(
 	vertexInputInfo.vertexAttributeDescriptionCount =
 		static_cast<uint32_t>(attributeDescriptions.size());
 	vertexInputInfo.vertexBindingDescriptionCount =
-		static_cast<uint32_t>(bindingDescriptions.size());;
+		static_cast<uint32_t>(bindingDescriptions.size());
 	vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
 	vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
 
@@ -128,7 +139,7 @@ void Pipeline::createGraphicsPipeline(
 	
 	if (vkCreateGraphicsPipelines(
 		m_device.device(),
-		VK_NULL_HANDLE,
+		pipelineCache.getCache(),
 		1,
 		&pipelineCreateInfo,
 		nullptr,
@@ -138,32 +149,6 @@ void Pipeline::createGraphicsPipeline(
 	}
 }
 
-/**
-* Creates shader module from supplied SPIR-V shader code. Will throw a runtime
-* error if shader module cannot be created.
-* 
-* @param code The code to compile into the shader module.
-* @param shaderModule Pointer to the created shader module.
-*/
-void Pipeline::createShaderModule(
-	const std::vector<char>& code,
-	VkShaderModule* shaderModule)
-{
-	VkShaderModuleCreateInfo createInfo{};
-	createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-	createInfo.codeSize = code.size();
-	createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
-
-	if (vkCreateShaderModule(
-		m_device.device(),
-		&createInfo,
-		nullptr,
-		shaderModule) != VK_SUCCESS)
-	{
-		throw std::runtime_error("failed to create shader module!");
-	}
-}
-
 /**
 * Submits a call to bind the pipeline ready for draw.
 * 
@@ -185,6 +170,9 @@ void Pipeline::bind(VkCommandBuffer commandBuffer)
 */
 void Pipeline::defaultPipelineConfigInfo(PipelineConfigInfo& configInfo)
 {
+	configInfo.bindingDescriptions = Model::Vertex::getBindingDescriptions();
+	configInfo.attributeDescriptions = Model::Vertex::getAttributeDescriptions();
+
 	configInfo.inputAssemblyInfo.sType =
 		VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
 	configInfo.inputAssemblyInfo.topology =
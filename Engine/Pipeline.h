@@ -19,6 +19,16 @@ struct PipelineConfigInfo
 	PipelineConfigInfo(const PipelineConfigInfo&) = delete;
 	PipelineConfigInfo& operator=(const PipelineConfigInfo&) = delete;
 
+	// vertex buffer layout, Model::Vertex by default. Left empty by pipelines
+	// that pull their vertices from buffers in the shader
+	std::vector<VkVertexInputBindingDescription> bindingDescriptions{};
+	std::vector<VkVertexInputAttributeDescription> attributeDescriptions{};
+
+	// specialization constants given to both shader stages, none by default.
+	// Entries index into the packed constant data
+	std::vector<VkSpecializationMapEntry> specializationEntries{};
+	std::vector<uint8_t> specializationData{};
+
 	VkPipelineInputAssemblyStateCreateInfo inputAssemblyInfo;
 	VkPipelineRasterizationStateCreateInfo rasterizationInfo;
 	VkPipelineViewportStateCreateInfo viewportInfo;
@@ -51,10 +61,10 @@ public:
 	Pipeline& operator=(const Pipeline&) = delete;
 
 	static void defaultPipelineConfigInfo(PipelineConfigInfo& configInfo);
+	static std::vector<char> readFile(const std::string& filepath);
 	void bind(VkCommandBuffer commandBuffer);
 
 private:
-	static std::vector<char> readFile(const std::string& filepath);
 
 	void createGraphicsPipeline(
 		const std::string& vertFilepath,
@@ -62,10 +72,6 @@ private:
 		const PipelineConfigInfo& pipelineInfo
 	);
 
-	void createShaderModule(
-		const std::vector<char>& code,
-		VkShaderModule* shaderModule);
-
 	Device& m_device;
 	VkPipeline m_grahpicsPipeline;
 	VkShaderModule m_vertShaderModule;
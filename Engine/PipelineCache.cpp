@@ -0,0 +1,194 @@
+#include "PipelineCache.h"
+#include "Pipeline.h"
+#include "Imaging/AssetArchive.h"
+
+// std
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <cstring>
+#include <cstdio>
+
+namespace wrengine
+{
+/**
+* Creates the pipeline cache, seeded from the cache file if it exists and was
+* written for this device and driver. Will throw a runtime error if the cache
+* cannot be created.
+*
+* @param device The logical device pipelines are created on.
+* @param properties The properties of the physical device.
+* @param filePath Path of the cache file.
+*/
+PipelineCache::PipelineCache(
+	VkDevice device,
+	const VkPhysicalDeviceProperties& properties,
+	const std::string& filePath) :
+	m_device{ device },
+	m_properties{ properties },
+	m_filePath{ filePath }
+{
+	std::vector<char> data = loadCacheData();
+
+	VkPipelineCacheCreateInfo createInfo{};
+	createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	createInfo.initialDataSize = data.size();
+	createInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+	if (vkCreatePipelineCache(
+		m_device,
+		&createInfo,
+		nullptr,
+		&m_cache) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create pipeline cache!");
+	}
+}
+
+PipelineCache::~PipelineCache()
+{
+	for (auto& [hash, shaderModule] : m_shaderModules)
+	{
+		vkDestroyShaderModule(m_device, shaderModule, nullptr);
+	}
+	vkDestroyPipelineCache(m_device, m_cache, nullptr);
+}
+
+/**
+* Writes the pipeline cache to its file. The data is written to a temporary
+* file first, so an interrupted write does not leave a truncated cache behind.
+* Failure to write is reported but not fatal, the next launch compiles the
+* pipelines again.
+*/
+void PipelineCache::save()
+{
+	size_t size = 0;
+	if (vkGetPipelineCacheData(m_device, m_cache, &size, nullptr) != VK_SUCCESS ||
+		size == 0)
+	{
+		return;
+	}
+
+	std::vector<char> data(size);
+	if (vkGetPipelineCacheData(m_device, m_cache, &size, data.data()) != VK_SUCCESS)
+	{
+		std::cerr << "failed to read pipeline cache data\n";
+		return;
+	}
+
+	std::string tempPath = m_filePath + ".tmp";
+	{
+		std::ofstream file{ tempPath, std::ios::binary | std::ios::trunc };
+		if (!file.write(data.data(), static_cast<std::streamsize>(size)))
+		{
+			std::cerr << "failed to write pipeline cache: " << tempPath << "\n";
+			return;
+		}
+	}
+
+	std::remove(m_filePath.c_str());
+	if (std::rename(tempPath.c_str(), m_filePath.c_str()) != 0)
+	{
+		std::cerr << "failed to replace pipeline cache: " << m_filePath << "\n";
+	}
+}
+
+/**
+* Gets the shader module of a SPIR-V file, creating it only if no module with
+* the same code exists. Modules are owned by the cache, and live until it is
+* destroyed. Will throw a runtime error if the file cannot be read or the
+* module cannot be created.
+*
+* @param filePath Path of the SPIR-V code.
+*
+* @return The shader module.
+*/
+VkShaderModule PipelineCache::getShaderModule(const std::string& filePath)
+{
+	std::scoped_lock<std::mutex> lock(m_shaderMutex);
+
+	auto fileHash = m_fileHashes.find(filePath);
+	if (fileHash != m_fileHashes.end())
+	{
+		return m_shaderModules.at(fileHash->second);
+	}
+
+	std::vector<char> code = Pipeline::readFile(filePath);
+	uint64_t hash = fnv1a64(reinterpret_cast<const uint8_t*>(code.data()), code.size());
+	m_fileHashes[filePath] = hash;
+
+	auto shaderModule = m_shaderModules.find(hash);
+	if (shaderModule != m_shaderModules.end())
+	{
+		return shaderModule->second;
+	}
+
+	VkShaderModuleCreateInfo createInfo{};
+	createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	createInfo.codeSize = code.size();
+	createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+
+	VkShaderModule module;
+	if (vkCreateShaderModule(
+		m_device,
+		&createInfo,
+		nullptr,
+		&module) != VK_SUCCESS)
+	{
+		m_fileHashes.erase(filePath);
+		throw std::runtime_error("failed to create shader module!");
+	}
+	m_shaderModules[hash] = module;
+	return module;
+}
+
+/**
+* Reads the cache file, if it exists and is compatible with the device.
+*
+* @return The cache data, or empty to start an empty cache.
+*/
+std::vector<char> PipelineCache::loadCacheData() const
+{
+	std::ifstream file{ m_filePath, std::ios::ate | std::ios::binary };
+	if (!file.is_open()) return {};
+
+	std::vector<char> data(static_cast<size_t>(file.tellg()));
+	file.seekg(0);
+	if (!file.read(data.data(), static_cast<std::streamsize>(data.size())))
+	{
+		return {};
+	}
+
+	if (!isCompatible(data))
+	{
+		std::cout << "pipeline cache was written for a different device or driver, ignoring\n";
+		return {};
+	}
+	return data;
+}
+
+/**
+* Checks that cache data starts with a version one header written by this
+* vendor, device and driver.
+*
+* @param data The cache data.
+*
+* @return Whether the data can be given to the driver.
+*/
+bool PipelineCache::isCompatible(const std::vector<char>& data) const
+{
+	VkPipelineCacheHeaderVersionOne header{};
+	if (data.size() < sizeof(header)) return false;
+	std::memcpy(&header, data.data(), sizeof(header));
+
+	return
+		header.headerSize >= sizeof(header) &&
+		header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+		header.vendorID == m_properties.vendorID &&
+		header.deviceID == m_properties.deviceID &&
+		std::memcmp(
+			header.pipelineCacheUUID,
+			m_properties.pipelineCacheUUID,
+			VK_UUID_SIZE) == 0;
+}
+} // namespace wrengine
\ No newline at end of file
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+//std
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+
+namespace wrengine
+{
+/**
+* Engine wide pipeline and shader module cache. The VkPipelineCache is loaded
+* from a file on construction, and written back by save, so pipelines compiled
+* by one launch are reused by the next. Cache data is only loaded if its header
+* matches the vendor, device and pipeline cache UUID of the physical device, as
+* a driver update invalidates it. Shader modules are created once per distinct
+* SPIR-V, keyed by a hash of the code, and shared by every pipeline using them.
+* Both caches are safe to use from any thread.
+*/
+class PipelineCache
+{
+public:
+	PipelineCache(
+		VkDevice device,
+		const VkPhysicalDeviceProperties& properties,
+		const std::string& filePath);
+	~PipelineCache();
+
+	// not copyable
+	PipelineCache(const PipelineCache&) = delete;
+	PipelineCache& operator=(const PipelineCache&) = delete;
+
+	void save();
+	VkShaderModule getShaderModule(const std::string& filePath);
+
+	// getters
+	VkPipelineCache getCache() const { return m_cache; }
+
+private:
+	std::vector<char> loadCacheData() const;
+	bool isCompatible(const std::vector<char>& data) const;
+
+	VkDevice m_device;
+	VkPhysicalDeviceProperties m_properties;
+	std::string m_filePath;
+	VkPipelineCache m_cache = VK_NULL_HANDLE;
+
+	// shader modules by hash of their code, and the hash of each file read
+	std::unordered_map<uint64_t, VkShaderModule> m_shaderModules;
+	std::unordered_map<std::string, uint64_t> m_fileHashes;
+	std::mutex m_shaderMutex;
+};
+} // namespace wrengine
\ No newline at end of file
@@ -0,0 +1,134 @@
+#include "PipelineVariants.h"
+
+// std
+#include <stdexcept>
+#include <chrono>
+
+namespace wrengine
+{
+/**
+* @param factory Creates the pipeline of a key. Called on the compile thread,
+* so must only use state that is safe to read from it.
+* @param maxVariants The most variants the set holds, ids are below this.
+* @param onReady Called on the compile thread when a variant is ready, such as
+* to wake an idle engine.
+*/
+PipelineVariants::PipelineVariants(
+	Factory factory,
+	uint32_t maxVariants,
+	std::function<void()> onReady) :
+	m_factory{ std::move(factory) },
+	m_maxVariants{ maxVariants },
+	m_onReady{ std::move(onReady) }
+{
+}
+
+/**
+* Compiles a variant on the calling thread, for variants needed before the first
+* frame.
+*
+* @param key The variant key.
+* @param group The fallback group of the key.
+*/
+void PipelineVariants::build(uint32_t key, uint32_t group)
+{
+	if (m_ids.count(key)) return;
+
+	uint32_t id = addVariant(key, group);
+	m_variants[id].pipeline = m_factory(key);
+	markReady(id);
+}
+
+/**
+* Takes the variants whose compiles have finished. Called once per frame,
+* before resolving keys. Rethrows compile errors.
+*/
+void PipelineVariants::update()
+{
+	if (m_pendingCount == 0) return;
+
+	for (uint32_t id = 0; id < m_variants.size(); ++id)
+	{
+		Variant& variant = m_variants[id];
+		if (!variant.pending.valid() ||
+			variant.pending.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		{
+			continue;
+		}
+
+		variant.pipeline = variant.pending.get();
+		--m_pendingCount;
+		markReady(id);
+	}
+}
+
+/**
+* Gets the variant to draw a key with this frame.
+*
+* @param key The variant key.
+* @param group The fallback group of the key.
+* @param request Whether to start compiling the variant if it was never
+* requested, otherwise only existing variants are resolved.
+*
+* @return The id of the key's variant if ready, otherwise of the last ready
+* variant of its group, or NO_VARIANT if the group has none.
+*/
+uint32_t PipelineVariants::resolve(uint32_t key, uint32_t group, bool request)
+{
+	auto id = m_ids.find(key);
+	if (id != m_ids.end())
+	{
+		if (m_variants[id->second].pipeline) return id->second;
+	}
+	else if (request)
+	{
+		uint32_t newId = addVariant(key, group);
+		auto promise = std::make_shared<std::promise<std::unique_ptr<Pipeline>>>();
+		m_variants[newId].pending = promise->get_future();
+		++m_pendingCount;
+
+		// the future is ready before the owner is told
+		m_compilePool.submit([this, key, promise]()
+			{
+				try
+				{
+					promise->set_value(m_factory(key));
+				}
+				catch (...)
+				{
+					promise->set_exception(std::current_exception());
+				}
+				if (m_onReady) m_onReady();
+			});
+	}
+
+	auto fallback = m_groupFallbacks.find(group);
+	return fallback != m_groupFallbacks.end() ? fallback->second : NO_VARIANT;
+}
+
+/**
+* Assigns the next id to a key. Will throw a runtime error if the set is full.
+*
+* @return The id.
+*/
+uint32_t PipelineVariants::addVariant(uint32_t key, uint32_t group)
+{
+	if (m_variants.size() >= m_maxVariants)
+	{
+		throw std::runtime_error("too many pipeline variants!");
+	}
+
+	uint32_t id = static_cast<uint32_t>(m_variants.size());
+	m_variants.push_back({ key, group, nullptr, {} });
+	m_ids[key] = id;
+	return id;
+}
+
+/**
+* Makes a ready variant the fallback of its group.
+*/
+void PipelineVariants::markReady(uint32_t id)
+{
+	m_groupFallbacks[m_variants[id].group] = id;
+}
+} // namespace wrengine
\ No newline at end of file
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "Pipeline.h"
+#include "ThreadPool.h"
+
+//std
+#include <memory>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <future>
+
+namespace wrengine
+{
+/**
+* Set of pipelines specialized from the same shaders, identified by a key the
+* owner packs its state into. Variants are compiled on a worker thread the
+* first time they are requested, so a new variant never stalls a frame. Keys
+* belong to a fallback group, such as the variants of one material, and until
+* a requested variant is ready the last ready variant of its group is used in
+* its place. Each variant gets a small id, stable for the lifetime of the set,
+* that sort keys can hold. Apart from construction, methods are called from the
+* thread rendering the frame.
+*/
+class PipelineVariants
+{
+public:
+	static constexpr uint32_t NO_VARIANT = ~0u;
+
+	using Factory = std::function<std::unique_ptr<Pipeline>(uint32_t key)>;
+
+	PipelineVariants(
+		Factory factory,
+		uint32_t maxVariants,
+		std::function<void()> onReady = {});
+
+	// not copyable
+	PipelineVariants(const PipelineVariants&) = delete;
+	PipelineVariants& operator=(const PipelineVariants&) = delete;
+
+	void build(uint32_t key, uint32_t group);
+	void update();
+	uint32_t resolve(uint32_t key, uint32_t group, bool request);
+	Pipeline& get(uint32_t id) { return *m_variants[id].pipeline; }
+
+private:
+	/**
+	* A requested pipeline, compiled or pending.
+	*/
+	struct Variant
+	{
+		uint32_t key;
+		uint32_t group;
+		std::unique_ptr<Pipeline> pipeline;
+		std::future<std::unique_ptr<Pipeline>> pending;
+	};
+
+	uint32_t addVariant(uint32_t key, uint32_t group);
+	void markReady(uint32_t id);
+
+	Factory m_factory;
+	uint32_t m_maxVariants;
+	std::function<void()> m_onReady;
+
+	// indexed by id
+	std::vector<Variant> m_variants;
+	std::unordered_map<uint32_t, uint32_t> m_ids;
+	std::unordered_map<uint32_t, uint32_t> m_groupFallbacks;
+	uint32_t m_pendingCount = 0;
+
+	// a single compile thread, so variants never compete with frame workers.
+	// Declared last, so queued compiles finish before the variants are freed
+	ThreadPool m_compilePool{ 1 };
+};
+} // namespace wrengine
\ No newline at end of file
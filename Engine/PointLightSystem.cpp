@@ -1,14 +1,102 @@
 #include "PointLightSystem.h"
 
+// std
+#include <stdexcept>
+#include <algorithm>
+#include <cmath>
+
+// light contribution below which a light is treated as not reaching a fragment,
+// see lightRadius
+constexpr float LIGHT_CUTOFF = 1.0f / 256.0f;
+
+// light_cull.comp bins a tile per workgroup
+constexpr uint32_t TILE_STRIDE = wrengine::PointLightSystem::MAX_LIGHTS_PER_TILE + 1;
+
 namespace wrengine
 {
-PointLightSystem::PointLightSystem(std::shared_ptr<Scene> scene) :
+PointLightSystem::PointLightSystem(
+	Device& device,
+	VkDescriptorSetLayout globalSetLayout,
+	std::shared_ptr<Scene> scene) :
+	m_device{ device },
 	m_activeScene{ scene }
 {
+	createBuffers();
+	createCullPipeline(globalSetLayout);
+}
+
+PointLightSystem::~PointLightSystem()
+{
+	vkDestroyPipelineLayout(m_device.device(), m_cullPipelineLayout, nullptr);
+}
+
+/**
+* Creates the light and tile buffers of each frame in flight, sized for the
+* most lights and tiles a frame can have, so the global sets are never
+* rewritten. Tiles are only written and read by the device.
+*/
+void PointLightSystem::createBuffers()
+{
+	m_lightBuffers.resize(Swapchain::MAX_FRAMES_IN_FLIGHT);
+	m_tileBuffers.resize(Swapchain::MAX_FRAMES_IN_FLIGHT);
+	for (int i = 0; i < Swapchain::MAX_FRAMES_IN_FLIGHT; ++i)
+	{
+		m_lightBuffers[i] = std::make_unique<Buffer>(
+			m_device,
+			sizeof(PointLight),
+			static_cast<uint32_t>(MAX_LIGHTS),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+		m_lightBuffers[i]->map();
+
+		m_tileBuffers[i] = std::make_unique<Buffer>(
+			m_device,
+			sizeof(uint32_t),
+			MAX_TILES * TILE_STRIDE,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	}
+}
+
+/**
+* Creates the light cull compute pipeline and its layout, which uses the global
+* set alone.
+*
+* @param globalSetLayout The global descriptor set layout.
+*/
+void PointLightSystem::createCullPipeline(VkDescriptorSetLayout globalSetLayout)
+{
+	VkPipelineLayoutCreateInfo createInfo{};
+	createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	createInfo.setLayoutCount = 1;
+	createInfo.pSetLayouts = &globalSetLayout;
+	createInfo.pushConstantRangeCount = 0;
+	createInfo.pPushConstantRanges = nullptr;
 
+	if (vkCreatePipelineLayout(
+		m_device.device(),
+		&createInfo,
+		nullptr,
+		&m_cullPipelineLayout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create light cull pipeline layout!");
+	}
+
+	m_cullPipeline = std::make_unique<ComputePipeline>(
+		m_device,
+		"shaders/light_cull.comp.spv",
+		m_cullPipelineLayout);
 }
 
-void PointLightSystem::update(GlobalUbo& ubo)
+/**
+* Writes the scene's point lights to the frame's light buffer, and the light
+* count and tile grid to the global ubo. Lights past MAX_LIGHTS are dropped.
+*
+* @param ubo The frame's global ubo.
+* @param frameIndex The frame in flight, whose light buffer to write.
+* @param extent The extent of the frame, which the tiles cover.
+*/
+void PointLightSystem::update(GlobalUbo& ubo, int frameIndex, VkExtent2D extent)
 {
 	auto activeSceneLock = m_activeScene.lock();
 	if (!activeSceneLock)
@@ -19,17 +107,106 @@ void PointLightSystem::update(GlobalUbo& ubo)
 	auto pointLightView = activeSceneLock->getAllEntitiesWith<
 		TransformComponent,
 		PointLightComponent>();
-	std::shared_ptr<Camera> camera = activeSceneLock->getActiveCamera();
+
+	Buffer& lightBuffer = *m_lightBuffers[frameIndex];
+	auto* lights = static_cast<PointLight*>(lightBuffer.getMappedMemory());
 
 	size_t lightIndex = 0;
 	for (auto&& [entity, transform, light] : pointLightView.each())
 	{
-		glm::vec4 lightPos = glm::vec4{ transform.translation, 0.0f };
-		//lightPos = camera->getProjection() * lightPos;
-		ubo.pointLights[lightIndex].position = lightPos;
-		ubo.pointLights[lightIndex].color = light.lightColor;
+		if (lightIndex == MAX_LIGHTS) break;
+
+		lights[lightIndex].position = glm::vec4{
+			transform.translation,
+			lightRadius(light.lightColor) };
+		lights[lightIndex].color = light.lightColor;
 		lightIndex++;
 	}
-	ubo.numLights = lightIndex;
+	lightBuffer.flush();
+
+	// tiles grow until the viewport fits in MAX_TILES of them
+	uint32_t tileSize = TILE_SIZE;
+	auto tileCount = [](uint32_t size, uint32_t pixels)
+		{
+			return (pixels + size - 1) / size;
+		};
+	while (tileCount(tileSize, extent.width) * tileCount(tileSize, extent.height) > MAX_TILES)
+	{
+		tileSize *= 2;
+	}
+	m_tileCountX = tileCount(tileSize, extent.width);
+	m_tileCountY = tileCount(tileSize, extent.height);
+
+	ubo.numLights = static_cast<uint32_t>(lightIndex);
+	ubo.lightTileSize = tileSize;
+	ubo.viewportSize = glm::vec2{ extent.width, extent.height };
+}
+
+/**
+* Records the compute pass binning the frame's lights into tiles, a workgroup
+* per tile. Must be recorded after update, and outside of a render pass.
+*
+* @param frameInfo Structure describing relevent current frame information.
+*/
+void PointLightSystem::cullLights(const FrameInfo& frameInfo)
+{
+	if (m_tileCountX == 0 || m_tileCountY == 0) return;
+
+	m_cullPipeline->bind(frameInfo.commandBuffer);
+	vkCmdBindDescriptorSets(
+		frameInfo.commandBuffer,
+		VK_PIPELINE_BIND_POINT_COMPUTE,
+		m_cullPipelineLayout,
+		0, 1,
+		&frameInfo.globalDescriptorSet,
+		0, nullptr);
+
+	vkCmdDispatch(frameInfo.commandBuffer, m_tileCountX, m_tileCountY, 1);
+
+	// the tiles are read by the fragment shaders of the render pass
+	VkMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	vkCmdPipelineBarrier(
+		frameInfo.commandBuffer,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+		0,
+		1, &barrier,
+		0, nullptr,
+		0, nullptr);
+}
+
+VkDescriptorBufferInfo PointLightSystem::getLightBufferInfo(int frameIndex)
+{
+	return m_lightBuffers[frameIndex]->descriptorInfo();
+}
+
+VkDescriptorBufferInfo PointLightSystem::getTileBufferInfo(int frameIndex)
+{
+	return m_tileBuffers[frameIndex]->descriptorInfo();
+}
+
+/**
+* Finds the distance at which a light's contribution falls below LIGHT_CUTOFF,
+* solving the attenuation of the sprite shaders for its brightest channel. The
+* shaders fade lights out towards this radius, so culling them past it leaves
+* no seams.
+*
+* @param color The light's color and intensity.
+*
+* @return The radius of influence, 0 for lights that light nothing.
+*/
+float PointLightSystem::lightRadius(const glm::vec4& color)
+{
+	// the diffuse term peaks at pi, see diffuseColor in simple_shader.frag
+	float peak = std::max({ color.r, color.g, color.b }) * color.a *
+		glm::pi<float>() * 50000.0f;
+	if (peak <= 0.0f) return 0.0f;
+
+	// 20 D^2 + 3 D + 0.4 = peak / cutoff
+	float c = 0.4f - peak / LIGHT_CUTOFF;
+	return (-3.0f + std::sqrt(9.0f - 80.0f * c)) / 40.0f;
 }
 } // namespace wrengine
\ No newline at end of file
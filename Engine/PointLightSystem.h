@@ -1,22 +1,74 @@
 #pragma once
 
+#include "Device.h"
+#include "Buffer.h"
+#include "ComputePipeline.h"
 #include "FrameInfo.h"
+#include "Swapchain.h"
 
 #include "Scene/Scene.h"
 
 //std
 #include <memory>
+#include <vector>
 
 namespace wrengine
 {
+/**
+* Gathers the point lights of the scene into a per frame light buffer, and
+* records a compute pass binning them into square screen tiles. The tile buffer
+* holds, for each tile, the number of lights reaching it followed by their
+* indices, so fragments only loop over the lights of their tile. Both buffers
+* are bound in the global descriptor set, at bindings 2 and 3.
+*/
 class PointLightSystem
 {
 public:
-	PointLightSystem(std::shared_ptr<Scene> scene);
+	// smallest tile, in pixels. Tiles double in size when the viewport would
+	// need more than MAX_TILES
+	static constexpr uint32_t TILE_SIZE = 32;
+	static constexpr uint32_t MAX_TILES = 8192;
 
-	void update(GlobalUbo& ubo);
+	// lights a tile can hold, further lights reaching it are not drawn there
+	static constexpr uint32_t MAX_LIGHTS_PER_TILE = 127;
+
+	PointLightSystem(
+		Device& device,
+		VkDescriptorSetLayout globalSetLayout,
+		std::shared_ptr<Scene> scene);
+
+	~PointLightSystem();
+
+	// should not copy
+	PointLightSystem(const PointLightSystem&) = delete;
+	PointLightSystem& operator=(const PointLightSystem&) = delete;
+
+	void update(GlobalUbo& ubo, int frameIndex, VkExtent2D extent);
+	void cullLights(const FrameInfo& frameInfo);
+
+	// getters
+	VkDescriptorBufferInfo getLightBufferInfo(int frameIndex);
+	VkDescriptorBufferInfo getTileBufferInfo(int frameIndex);
 
 private:
+	void createBuffers();
+	void createCullPipeline(VkDescriptorSetLayout globalSetLayout);
+	static float lightRadius(const glm::vec4& color);
+
+	Device& m_device;
+
+	// light and tile buffers, one of each per frame in flight
+	std::vector<std::unique_ptr<Buffer>> m_lightBuffers;
+	std::vector<std::unique_ptr<Buffer>> m_tileBuffers;
+
+	// compute pipeline binning lights into tiles
+	VkPipelineLayout m_cullPipelineLayout;
+	std::unique_ptr<ComputePipeline> m_cullPipeline;
+
+	// tile grid of the current frame
+	uint32_t m_tileCountX = 0;
+	uint32_t m_tileCountY = 0;
+
 	std::weak_ptr<Scene> m_activeScene;
 };
 } // namespace wrengine
\ No newline at end of file
@@ -0,0 +1,133 @@
+#include "RenderQueue.h"
+
+// std
+#include <array>
+#include <cstring>
+
+namespace wrengine
+{
+// key layout below the two pass bits
+constexpr uint32_t PASS_SHIFT = 62;
+constexpr uint32_t DEPTH_BITS = 32;
+constexpr uint64_t PIPELINE_MASK = (1ull << RenderQueue::PIPELINE_BITS) - 1;
+constexpr uint64_t MATERIAL_MASK = (1ull << RenderQueue::MATERIAL_BITS) - 1;
+
+// opaque: pass | pipeline | material | depth
+constexpr uint32_t OPAQUE_PIPELINE_SHIFT =
+	PASS_SHIFT - RenderQueue::PIPELINE_BITS;
+constexpr uint32_t OPAQUE_MATERIAL_SHIFT =
+	OPAQUE_PIPELINE_SHIFT - RenderQueue::MATERIAL_BITS;
+
+// transparent: pass | inverted depth | pipeline | material
+constexpr uint32_t TRANSPARENT_DEPTH_SHIFT = PASS_SHIFT - DEPTH_BITS;
+constexpr uint32_t TRANSPARENT_PIPELINE_SHIFT =
+	TRANSPARENT_DEPTH_SHIFT - RenderQueue::PIPELINE_BITS;
+
+static_assert(OPAQUE_MATERIAL_SHIFT >= DEPTH_BITS, "opaque key fields overlap");
+static_assert(
+	TRANSPARENT_PIPELINE_SHIFT >= RenderQueue::MATERIAL_BITS,
+	"transparent key fields overlap");
+
+/**
+* Builds the sort key of a draw. Pipeline and material are truncated to their
+* key fields, so should be small indices, such as bindless table slots.
+*
+* @param pass The pass the draw belongs to.
+* @param pipeline Index of the pipeline the draw uses.
+* @param material Index of the draw's material.
+* @param depth Distance of the draw from the camera.
+*
+* @return The sort key.
+*/
+uint64_t RenderQueue::makeKey(
+	RenderPass pass,
+	uint32_t pipeline,
+	uint32_t material,
+	float depth)
+{
+	uint64_t key = static_cast<uint64_t>(pass) << PASS_SHIFT;
+	if (pass == RenderPass::Opaque)
+	{
+		key |= (pipeline & PIPELINE_MASK) << OPAQUE_PIPELINE_SHIFT;
+		key |= (material & MATERIAL_MASK) << OPAQUE_MATERIAL_SHIFT;
+		key |= orderedDepth(depth);
+	}
+	else
+	{
+		// far draws first
+		key |= static_cast<uint64_t>(~orderedDepth(depth)) << TRANSPARENT_DEPTH_SHIFT;
+		key |= (pipeline & PIPELINE_MASK) << TRANSPARENT_PIPELINE_SHIFT;
+		key |= material & MATERIAL_MASK;
+	}
+	return key;
+}
+
+RenderPass RenderQueue::passOf(uint64_t key)
+{
+	return static_cast<RenderPass>(key >> PASS_SHIFT);
+}
+
+uint32_t RenderQueue::pipelineOf(uint64_t key)
+{
+	uint32_t shift = passOf(key) == RenderPass::Opaque ?
+		OPAQUE_PIPELINE_SHIFT :
+		TRANSPARENT_PIPELINE_SHIFT;
+	return static_cast<uint32_t>((key >> shift) & PIPELINE_MASK);
+}
+
+/**
+* Sorts the queued draws by key, one byte at a time from the lowest. Bytes that
+* are the same in every key are skipped, so a frame whose keys differ in few
+* fields costs few passes.
+*/
+void RenderQueue::sort()
+{
+	constexpr size_t RADIX = 256;
+	constexpr size_t BYTES = sizeof(uint64_t);
+
+	if (m_items.size() < 2) return;
+	m_scratch.resize(m_items.size());
+
+	// histograms of every byte in one read of the keys
+	std::array<std::array<uint32_t, RADIX>, BYTES> counts{};
+	for (const Item& item : m_items)
+	{
+		for (size_t byte = 0; byte < BYTES; ++byte)
+		{
+			++counts[byte][(item.key >> (byte * 8)) & 0xFF];
+		}
+	}
+
+	for (size_t byte = 0; byte < BYTES; ++byte)
+	{
+		auto& count = counts[byte];
+		uint64_t first = (m_items.front().key >> (byte * 8)) & 0xFF;
+		if (count[first] == m_items.size()) continue;
+
+		uint32_t offset = 0;
+		for (uint32_t& bucket : count)
+		{
+			uint32_t size = bucket;
+			bucket = offset;
+			offset += size;
+		}
+
+		for (const Item& item : m_items)
+		{
+			m_scratch[count[(item.key >> (byte * 8)) & 0xFF]++] = item;
+		}
+		m_items.swap(m_scratch);
+	}
+}
+
+/**
+* Maps a float to an unsigned integer of the same order, flipping every bit of
+* negative values and the sign bit of positive ones.
+*/
+uint32_t RenderQueue::orderedDepth(float depth)
+{
+	uint32_t bits;
+	std::memcpy(&bits, &depth, sizeof(bits));
+	return (bits & 0x80000000u) ? ~bits : bits | 0x80000000u;
+}
+} // namespace wrengine
\ No newline at end of file
@@ -0,0 +1,72 @@
+#pragma once
+
+//std
+#include <cstdint>
+#include <vector>
+
+namespace wrengine
+{
+/**
+* Passes a draw can belong to, in the order they are drawn.
+*/
+enum class RenderPass : uint32_t
+{
+	Opaque = 0,
+	Transparent,
+};
+
+/**
+* Orders the draws of a frame by a 64 bit sort key. The pass is in the top
+* bits, so opaque draws come first. Opaque keys follow with pipeline, material
+* and then depth front to back, so state changes are grouped and near draws
+* fill the depth buffer first. Transparent keys follow with depth back to front,
+* which blending requires, and only then pipeline and material. Keys are sorted
+* with an LSD radix sort, which is stable, so draws with equal keys keep the
+* order they were pushed in.
+*/
+class RenderQueue
+{
+public:
+	/**
+	* A queued draw, the key and the index of the caller's draw data.
+	*/
+	struct Item
+	{
+		uint64_t key;
+		uint32_t index;
+	};
+
+	// key fields
+	static constexpr uint32_t PIPELINE_BITS = 8;
+	static constexpr uint32_t MATERIAL_BITS = 22;
+
+	static uint64_t makeKey(
+		RenderPass pass,
+		uint32_t pipeline,
+		uint32_t material,
+		float depth);
+	static RenderPass passOf(uint64_t key);
+	static uint32_t pipelineOf(uint64_t key);
+
+	void clear() { m_items.clear(); }
+	void push(uint64_t key, uint32_t index) { m_items.push_back({ key, index }); }
+
+	// filling presized slots, which threads may do concurrently for distinct slots
+	void resize(size_t count) { m_items.resize(count); }
+	void set(size_t slot, uint64_t key, uint32_t index) { m_items[slot] = { key, index }; }
+
+	void sort();
+
+	// getters
+	const std::vector<Item>& getItems() const { return m_items; }
+	bool isEmpty() const { return m_items.empty(); }
+
+private:
+	static uint32_t orderedDepth(float depth);
+
+	std::vector<Item> m_items;
+
+	// radix sort scratch space, kept between frames
+	std::vector<Item> m_scratch;
+};
+} // namespace wrengine
\ No newline at end of file
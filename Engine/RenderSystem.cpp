@@ -1,4 +1,6 @@
 #include "RenderSystem.h"
+#include "UploadBatch.h"
+#include "VirtualTexture.h"
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -11,84 +13,193 @@
 #include <array>
 #include <iostream>
 #include <cmath>
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
 
 /**
-* Simple struct for push constants. Contains transform, offset and color data.
-* w element of normalsTransform is padding.
+* Specialization constants of the sprite shaders, in constant id order.
 */
-struct PushConstantData
+struct SpecializationData
 {
-	glm::mat4 model{ 1.0f };
 	uint32_t shaderConfig = 0;
-	alignas(16) glm::vec4 normalsTransform = { 1.0f, -1.0f, 1.0f, 0.0f };
+	VkBool32 virtualTexture = VK_FALSE;
+	float normalScales[3]{ 1.0f, -1.0f, 1.0f };
 };
 
+/**
+* Push constants of the cull pass, the camera projection and view, the number
+* of cull groups, and which of the two dispatches is running.
+*/
+struct CullPushConstantData
+{
+	glm::mat4 projectionView{ 1.0f };
+	uint32_t groupCount = 0;
+	uint32_t phase = 0;
+};
+
+/**
+* A workgroup of the cull pass, up to CULL_GROUP_SIZE consecutive instances of
+* one draw, laid out to match the std430 group buffer. The CPU writes the draw,
+* range and first group of the draw. The first dispatch writes the mask and
+* count of survivors, which the second uses to place them.
+*/
+struct CullGroup
+{
+	uint32_t draw = 0;
+	uint32_t first = 0;
+	uint32_t count = 0;
+	uint32_t firstGroup = 0;
+	uint32_t mask[4]{};
+	uint32_t survivors = 0;
+	uint32_t padding[3]{};
+};
+
+// variant key bits set by a sprite's material, which form its material group
+constexpr uint32_t NORMAL_MAPPED_BIT = 0x1;
+constexpr uint32_t VIRTUAL_TEXTURE_BIT = 0x2;
+constexpr uint32_t TRANSPARENT_BIT = 0x4;
+
+// variant key bits set by the frame, an inverted bit per normal axis
+constexpr uint32_t NORMAL_INVERT_SHIFT = 3;
+
+// every key has an id to spare
+constexpr uint32_t MAX_VARIANTS = 1u << 6;
+
+// vertices of the quad generated by the vertex shader
+constexpr uint32_t QUAD_VERTEX_COUNT = 6;
+
+// instances per workgroup of cull.comp, and the most workgroups dispatched in
+// x, the least every device supports
+constexpr uint32_t CULL_GROUP_SIZE = 128;
+constexpr uint32_t MAX_CULL_GROUPS_X = 65535;
+
+// the instance buffers start with room for this many sprites
+constexpr size_t MIN_INSTANCE_CAPACITY = 256;
+
+// fewest sprites worth handing to a worker thread
+constexpr size_t MIN_SPRITES_PER_CHUNK = 1024;
+
+static_assert(sizeof(wrengine::SpriteInstance) % 16 == 0,
+	"sprite instances must match the std430 array stride");
+static_assert(sizeof(CullGroup) == 48,
+	"cull groups must match the std430 array stride");
+
 namespace wrengine
 {
 RenderSystem::RenderSystem(
 	Device& device,
 	VkRenderPass renderPass,
 	VkDescriptorSetLayout globalSetLayout,
-	VkDescriptorSetLayout materialSetLayout,
-	std::shared_ptr<Scene> activeScene) :
+	VkDescriptorSetLayout textureSetLayout,
+	VkDescriptorSet textureDescriptorSet,
+	std::shared_ptr<Scene> activeScene,
+	ThreadPool& threadPool,
+	std::function<void()> onVariantReady) :
 	m_device{ device },
-	m_activeScene{ activeScene }
+	m_renderPass{ renderPass },
+	m_textureDescriptorSet{ textureDescriptorSet },
+	m_activeScene{ activeScene },
+	m_threadPool{ threadPool }
 {
-	createPipelineLayout(globalSetLayout, materialSetLayout);
-	createPipeline(renderPass);
+	createInstanceDescriptors();
+	createPipelineLayout(globalSetLayout, textureSetLayout);
+	createPipelineVariants(std::move(onVariantReady));
+	createCullPipeline();
 
-	// initialise quad model data 
-	// TODO do this somewhere else, maybe constants header?
-	Model::VertexData vertexData{};
-	vertexData.vertices =
-	{
-		{{-0.5f, -0.5f, 0.0f}, {1.0f, 0.0f, 0.0f}, {0.0f, 0.0f}},
-		{{ 0.5f, -0.5f, 0.0f}, {0.0f, 1.0f, 0.0f}, {1.0f, 0.0f}},
-		{{ 0.5f,  0.5f, 0.0f}, {0.0f, 0.0f, 1.0f}, {1.0f, 1.0f}},
-		{{-0.5f,  0.5f, 0.0f}, {1.0f, 1.0f, 1.0f}, {0.0f, 1.0f}}
-	};
-
-	vertexData.indices = { 0, 1, 2, 2, 3, 0 };
-	m_quadModel = std::make_unique<Model>(m_device, vertexData);
+	// instances follow the sprites added, removed and patched in the scene
+	activeScene->onComponentAdded<TransformComponent>()
+		.connect<&RenderSystem::onSpriteAddedOrRemoved>(*this);
+	activeScene->onComponentAdded<SpriteRenderComponent>()
+		.connect<&RenderSystem::onSpriteAddedOrRemoved>(*this);
+	activeScene->onComponentRemoved<TransformComponent>()
+		.connect<&RenderSystem::onSpriteAddedOrRemoved>(*this);
+	activeScene->onComponentRemoved<SpriteRenderComponent>()
+		.connect<&RenderSystem::onSpriteAddedOrRemoved>(*this);
+	activeScene->onComponentChanged<TransformComponent>()
+		.connect<&RenderSystem::onSpriteChanged>(*this);
+	activeScene->onComponentChanged<SpriteRenderComponent>()
+		.connect<&RenderSystem::onSpriteChanged>(*this);
 }
 
 RenderSystem::~RenderSystem()
 {
+	if (auto activeScene = m_activeScene.lock())
+	{
+		activeScene->onComponentAdded<TransformComponent>()
+			.disconnect<&RenderSystem::onSpriteAddedOrRemoved>(*this);
+		activeScene->onComponentAdded<SpriteRenderComponent>()
+			.disconnect<&RenderSystem::onSpriteAddedOrRemoved>(*this);
+		activeScene->onComponentRemoved<TransformComponent>()
+			.disconnect<&RenderSystem::onSpriteAddedOrRemoved>(*this);
+		activeScene->onComponentRemoved<SpriteRenderComponent>()
+			.disconnect<&RenderSystem::onSpriteAddedOrRemoved>(*this);
+		activeScene->onComponentChanged<TransformComponent>()
+			.disconnect<&RenderSystem::onSpriteChanged>(*this);
+		activeScene->onComponentChanged<SpriteRenderComponent>()
+			.disconnect<&RenderSystem::onSpriteChanged>(*this);
+	}
+
+	// compiles in progress use the pipeline layout
+	m_variants.reset();
 	vkDestroyPipelineLayout(m_device.device(), m_pipelineLayout, nullptr);
+	vkDestroyPipelineLayout(m_device.device(), m_cullPipelineLayout, nullptr);
 }
 
+/**
+* Sets the scale of each normal map axis, +1 or -1 to invert it. Sprites switch
+* to variants specialized for the new scales once they are compiled.
+*
+* @param scales The axis scales.
+*/
 void RenderSystem::updateNormalCoords(glm::vec3 scales)
 {
 	m_normalCoordScales = scales;
 }
 
+/**
+* Gets the version of the commands renderEntities records for the current frame.
+* It changes whenever they would, when the runs and pipelines of the draws
+* differ from those of the last version, or instance sets are rewritten.
+* Instances, draw ranges and culling results are read from buffers, so sprites
+* moving or being culled leave it unchanged. Must be called after cullEntities.
+*
+* @return The command version, recorded commands of an equal version can be
+* executed again.
+*/
+uint64_t RenderSystem::getCommandVersion()
+{
+	if (m_draws != m_versionedDraws)
+	{
+		m_versionedDraws = m_draws;
+		++m_commandVersion;
+	}
+	return m_commandVersion;
+}
+
 /**
 * Creates a pipeline layout owned by the render system acording to supplied
 * descriptor set layouts.
 * 
 * @param globalSetLayout The current global descriptor set layout.
+* @param textureSetLayout The bindless texture table set layout.
 */
 void RenderSystem::createPipelineLayout(
 	VkDescriptorSetLayout globalSetLayout,
-	VkDescriptorSetLayout materialSetLayout)
+	VkDescriptorSetLayout textureSetLayout)
 {
-	VkPushConstantRange pushConstantRange{};
-	pushConstantRange.stageFlags =
-		VK_SHADER_STAGE_VERTEX_BIT |
-		VK_SHADER_STAGE_FRAGMENT_BIT;
-	pushConstantRange.size = sizeof(PushConstantData);
-
 	std::vector<VkDescriptorSetLayout> descriptorSetLayout{
 		globalSetLayout,
-		materialSetLayout
+		textureSetLayout,
+		m_instanceSetLayout->getDescriptorSetLayout()
 	};
 
 	VkPipelineLayoutCreateInfo createInfo{};
 	createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
 	createInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayout.size());
 	createInfo.pSetLayouts = descriptorSetLayout.data();
-	createInfo.pushConstantRangeCount = 1;
-	createInfo.pPushConstantRanges = &pushConstantRange;
+	createInfo.pushConstantRangeCount = 0;
+	createInfo.pPushConstantRanges = nullptr;
 
 	if (vkCreatePipelineLayout(
 		m_device.device(),
@@ -101,24 +212,91 @@ void RenderSystem::createPipelineLayout(
 }
 
 /**
-* Creates a pipeline object owned by the render system, using hardcoded shader
-* file paths.
-* 
-* @param renderPass The render pass object to use in pipeline configuration.
+* Creates the set of sprite pipeline variants, and compiles the variants of
+* the plain opaque and transparent materials for the initial frame state, so
+* the first frames need not wait for them.
+*
+* @param onVariantReady Called from the compile thread when a variant is ready.
 */
-void RenderSystem::createPipeline(VkRenderPass renderPass)
+void RenderSystem::createPipelineVariants(std::function<void()> onVariantReady)
 {
 	assert(m_pipelineLayout != nullptr &&
 		"cannot create pipeline before pipeline layout!");
 
+	m_variants = std::make_unique<PipelineVariants>(
+		[this](uint32_t key) { return createVariant(key); },
+		MAX_VARIANTS,
+		std::move(onVariantReady));
+
+	uint32_t features = variantFeatures();
+	for (uint32_t group : {
+		0u,
+		NORMAL_MAPPED_BIT,
+		TRANSPARENT_BIT,
+		TRANSPARENT_BIT | NORMAL_MAPPED_BIT })
+	{
+		m_variants->build(group | features, group);
+	}
+	m_groupVariants.fill(PipelineVariants::NO_VARIANT);
+	m_drawsVariants.fill(PipelineVariants::NO_VARIANT);
+}
+
+/**
+* Creates the sprite pipeline of a variant key, using hardcoded shader file
+* paths. Opaque sprites write depth without blending. Transparent sprites blend,
+* and test depth without writing it, so that sprites behind them drawn later in
+* the pass are not hidden. Sprites at equal depth pass the test, and are drawn
+* in queue order. The remaining key bits are given to the shaders as
+* specialization constants. Called on the compile thread, so only reads state
+* fixed at construction.
+*
+* @param key The variant key.
+*
+* @return The pipeline.
+*/
+std::unique_ptr<Pipeline> RenderSystem::createVariant(uint32_t key)
+{
 	PipelineConfigInfo pipelineConfig{};
 	Pipeline::defaultPipelineConfigInfo(pipelineConfig);
-	pipelineConfig.colorBlendAttachment.blendEnable = VK_TRUE;
-	pipelineConfig.colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
-	pipelineConfig.colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_DST_ALPHA;
-	pipelineConfig.renderPass = renderPass;
+	pipelineConfig.depthStencilInfo.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+	pipelineConfig.renderPass = m_renderPass;
 	pipelineConfig.pipelineLayout = m_pipelineLayout;
-	m_pipeline = std::make_unique<Pipeline>(
+
+	// the quad is generated from the vertex index
+	pipelineConfig.bindingDescriptions.clear();
+	pipelineConfig.attributeDescriptions.clear();
+
+	if (key & TRANSPARENT_BIT)
+	{
+		pipelineConfig.colorBlendAttachment.blendEnable = VK_TRUE;
+		pipelineConfig.colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+		pipelineConfig.colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+		pipelineConfig.colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+		pipelineConfig.colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_DST_ALPHA;
+		pipelineConfig.depthStencilInfo.depthWriteEnable = VK_FALSE;
+	}
+
+	SpecializationData constants{};
+	constants.shaderConfig = static_cast<uint32_t>(
+		(key & NORMAL_MAPPED_BIT) ? ShaderConfig::NormalMapped : ShaderConfig::Emissive);
+	constants.virtualTexture = (key & VIRTUAL_TEXTURE_BIT) ? VK_TRUE : VK_FALSE;
+	for (uint32_t axis = 0; axis < 3; ++axis)
+	{
+		bool inverted = key & (1u << (NORMAL_INVERT_SHIFT + axis));
+		constants.normalScales[axis] = inverted ? -1.0f : 1.0f;
+	}
+
+	pipelineConfig.specializationEntries = {
+		{ 0, offsetof(SpecializationData, shaderConfig), sizeof(uint32_t) },
+		{ 1, offsetof(SpecializationData, virtualTexture), sizeof(VkBool32) },
+		{ 2, offsetof(SpecializationData, normalScales), sizeof(float) },
+		{ 3, offsetof(SpecializationData, normalScales) + sizeof(float), sizeof(float) },
+		{ 4, offsetof(SpecializationData, normalScales) + 2 * sizeof(float), sizeof(float) }
+	};
+	const auto* data = reinterpret_cast<const uint8_t*>(&constants);
+	pipelineConfig.specializationData.assign(data, data + sizeof(constants));
+
+	return std::make_unique<Pipeline>(
 		m_device,
 		"shaders/simple_shader.vert.spv",
 		"shaders/simple_shader.frag.spv",
@@ -126,12 +304,230 @@ void RenderSystem::createPipeline(VkRenderPass renderPass)
 }
 
 /**
-* Submits command to render the provided Entity objects.
+* Gets the variant key bits set by the frame state, the normal axes to invert.
+*/
+uint32_t RenderSystem::variantFeatures()
+{
+	uint32_t features = 0;
+	for (uint32_t axis = 0; axis < 3; ++axis)
+	{
+		if (m_normalCoordScales[axis] < 0.0f)
+		{
+			features |= 1u << (NORMAL_INVERT_SHIFT + axis);
+		}
+	}
+	return features;
+}
+
+/**
+* Fills the frame's variant table, mapping each material group to the variant
+* its sprites are drawn with. Variants are requested for the groups the frame
+* uses, and groups without a ready variant are not drawn until one is.
+*
+* @param usedGroups Bit mask of the material groups the frame's sprites use.
+*/
+void RenderSystem::resolveVariants(uint32_t usedGroups)
+{
+	m_variants->update();
+
+	uint32_t features = variantFeatures();
+	for (uint32_t group = 0; group < MATERIAL_GROUP_COUNT; ++group)
+	{
+		bool used = usedGroups & (1u << group);
+		m_groupVariants[group] = used ?
+			m_variants->resolve(group | features, group, true) :
+			PipelineVariants::NO_VARIANT;
+	}
+}
+
+/**
+* Creates the cull compute pipeline and its layout, which uses the instance set
+* alone.
+*/
+void RenderSystem::createCullPipeline()
+{
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.size = sizeof(CullPushConstantData);
+
+	VkDescriptorSetLayout instanceSetLayout =
+		m_instanceSetLayout->getDescriptorSetLayout();
+
+	VkPipelineLayoutCreateInfo createInfo{};
+	createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	createInfo.setLayoutCount = 1;
+	createInfo.pSetLayouts = &instanceSetLayout;
+	createInfo.pushConstantRangeCount = 1;
+	createInfo.pPushConstantRanges = &pushConstantRange;
+
+	if (vkCreatePipelineLayout(
+		m_device.device(),
+		&createInfo,
+		nullptr,
+		&m_cullPipelineLayout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create cull pipeline layout!");
+	}
+
+	m_cullPipeline = std::make_unique<ComputePipeline>(
+		m_device,
+		"shaders/cull.comp.spv",
+		m_cullPipelineLayout);
+}
+
+/**
+* Creates the instance buffer set layout, and a set and buffers for each frame
+* in flight. Binding 0 holds the sprite instances, binding 1 the indices of the
+* instances that survive culling, binding 2 the indirect draw commands, and
+* binding 3 the workgroups of the cull pass.
+*/
+void RenderSystem::createInstanceDescriptors()
+{
+	m_instanceSetLayout = DescriptorSetLayout::Builder(m_device)
+		.addBinding(
+			0,
+			VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT)
+		.addBinding(
+			1,
+			VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_COMPUTE_BIT)
+		.addBinding(
+			2,
+			VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			VK_SHADER_STAGE_COMPUTE_BIT)
+		.addBinding(
+			3,
+			VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			VK_SHADER_STAGE_COMPUTE_BIT)
+		.build();
+
+	m_instancePool = DescriptorPool::Builder(m_device)
+		.setMaxSets(Swapchain::MAX_FRAMES_IN_FLIGHT)
+		.addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4 * Swapchain::MAX_FRAMES_IN_FLIGHT)
+		.build();
+
+	m_visibleBuffers.resize(Swapchain::MAX_FRAMES_IN_FLIGHT);
+	m_drawBuffers.resize(Swapchain::MAX_FRAMES_IN_FLIGHT);
+	m_groupBuffers.resize(Swapchain::MAX_FRAMES_IN_FLIGHT);
+	m_instanceDescriptorSets.resize(Swapchain::MAX_FRAMES_IN_FLIGHT);
+	m_staleDescriptorSets.assign(Swapchain::MAX_FRAMES_IN_FLIGHT, true);
+	m_frameLayouts.assign(Swapchain::MAX_FRAMES_IN_FLIGHT, 0);
+	for (int i = 0; i < Swapchain::MAX_FRAMES_IN_FLIGHT; ++i)
+	{
+		if (!m_instancePool->allocateDescriptor(
+			m_instanceSetLayout->getDescriptorSetLayout(),
+			m_instanceDescriptorSets[i]))
+		{
+			throw std::runtime_error("failed to allocate sprite instance set!");
+		}
+		reserveFrameBuffers(i, MIN_INSTANCE_CAPACITY);
+	}
+	reserveInstances(MIN_INSTANCE_CAPACITY);
+}
+
+/**
+* Makes sure the instance buffer can hold a number of sprites, replacing it with
+* one of double the size if not. The old buffer is retired, as frames in flight
+* may still read it, and the set of every frame is rewritten before the frame
+* next culls. A new buffer holds no instances until they are uploaded.
+*
+* @param count The number of sprites to hold.
+*/
+void RenderSystem::reserveInstances(size_t count)
+{
+	size_t capacity = m_instanceBuffer ? m_instanceBuffer->getInstanceCount() : 0;
+	if (count <= capacity) return;
+
+	capacity = std::max(capacity, MIN_INSTANCE_CAPACITY);
+	while (capacity < count) capacity *= 2;
+
+	if (m_instanceBuffer)
+	{
+		m_device.retire(
+			[instances = std::shared_ptr<Buffer>(std::move(m_instanceBuffer))]() {});
+	}
+
+	// only written by copies recorded into the frames
+	m_instanceBuffer = std::make_unique<Buffer>(
+		m_device,
+		sizeof(SpriteInstance),
+		static_cast<uint32_t>(capacity),
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	m_staleDescriptorSets.assign(Swapchain::MAX_FRAMES_IN_FLIGHT, true);
+}
+
+/**
+* Makes sure the buffers the cull pass of a frame writes can hold a number of
+* sprites, replacing them with ones of double the size if not. The frame's
+* fence has been waited on, but the old buffers are retired as its set may
+* still be referenced by a command buffer pending reset. Each sprite can at
+* most need a draw and a cull group of its own, so the draw and group buffers
+* have the same capacity.
+*
+* @param frameIndex The frame in flight whose buffers to check.
+* @param count The number of sprites to hold.
+*/
+void RenderSystem::reserveFrameBuffers(int frameIndex, size_t count)
+{
+	auto& visibleBuffer = m_visibleBuffers[frameIndex];
+	auto& drawBuffer = m_drawBuffers[frameIndex];
+	auto& groupBuffer = m_groupBuffers[frameIndex];
+
+	size_t capacity = visibleBuffer ? visibleBuffer->getInstanceCount() : 0;
+	if (count <= capacity) return;
+
+	capacity = std::max(capacity, MIN_INSTANCE_CAPACITY);
+	while (capacity < count) capacity *= 2;
+
+	if (visibleBuffer)
+	{
+		m_device.retire(
+			[visible = std::shared_ptr<Buffer>(std::move(visibleBuffer)),
+			draws = std::shared_ptr<Buffer>(std::move(drawBuffer)),
+			groups = std::shared_ptr<Buffer>(std::move(groupBuffer))]() {});
+	}
+
+	// only written and read by the device
+	visibleBuffer = std::make_unique<Buffer>(
+		m_device,
+		sizeof(uint32_t),
+		static_cast<uint32_t>(capacity),
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+	drawBuffer = std::make_unique<Buffer>(
+		m_device,
+		sizeof(VkDrawIndirectCommand),
+		static_cast<uint32_t>(capacity),
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+	drawBuffer->map();
+
+	groupBuffer = std::make_unique<Buffer>(
+		m_device,
+		sizeof(CullGroup),
+		static_cast<uint32_t>(capacity),
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+	groupBuffer->map();
+
+	// the new buffers hold no draws or groups yet
+	m_frameLayouts[frameIndex] = 0;
+	m_staleDescriptorSets[frameIndex] = true;
+}
+
+/**
+* Brings the instances up to date with the scene, then records the compute
+* pass culling them against the active camera. In a steady scene only the
+* sprites patched since the last frame are uploaded again, and a draw is kept
+* for each run of instances sharing a pipeline variant, skipping runs whose
+* variant is not ready. Must be recorded outside of a render pass.
 * 
 * @param frameInfo Structure describing relevent current frame information.
-* @param entities Vector of Entity objects to render.
 */
-void RenderSystem::renderEntities(const FrameInfo& frameInfo)
+void RenderSystem::cullEntities(const FrameInfo& frameInfo)
 {
 	// TODO handle this more precisely than just throwing an exception.
 	// log and return?
@@ -141,77 +537,564 @@ void RenderSystem::renderEntities(const FrameInfo& frameInfo)
 		throw std::runtime_error("can't render entities without active scene!");
 	}
 
-	m_pipeline->bind(frameInfo.commandBuffer);
+	// depth is the distance in front of the camera, so the sort keys of every
+	// sprite follow the view
+	std::shared_ptr<Camera> camera = activeSceneLock->getActiveCamera();
+	glm::mat4 view = camera->getView();
+	if (view != m_sortedView)
+	{
+		m_rebuildInstances = true;
+	}
+
+	// an update finding a sprite that moved in the queue asks for a rebuild
+	if (!m_rebuildInstances)
+	{
+		updateInstances(*activeSceneLock, view, frameInfo.commandBuffer);
+	}
+	if (m_rebuildInstances)
+	{
+		rebuildInstances(*activeSceneLock, view, frameInfo.commandBuffer);
+	}
+	m_changedSprites.clear();
+
+	if (m_runs.empty())
+	{
+		m_draws.clear();
+		return;
+	}
+
+	// groups map to distinct variants, so the instances of a run share a
+	// pipeline. Runs are culled whether or not they are drawn
+	resolveVariants(m_usedGroups);
+	if (m_drawsLayout != m_layoutVersion || m_drawsVariants != m_groupVariants)
+	{
+		m_draws.clear();
+		for (uint32_t run = 0; run < m_runs.size(); ++run)
+		{
+			uint32_t variant = m_groupVariants[m_runs[run].group];
+			if (variant != PipelineVariants::NO_VARIANT)
+			{
+				m_draws.emplace_back(run, variant);
+			}
+		}
+		m_drawsLayout = m_layoutVersion;
+		m_drawsVariants = m_groupVariants;
+	}
 
+	prepareFrame(frameInfo.frameIndex);
+
+	m_cullPipeline->bind(frameInfo.commandBuffer);
 	vkCmdBindDescriptorSets(
 		frameInfo.commandBuffer,
-		VK_PIPELINE_BIND_POINT_GRAPHICS,
-		m_pipelineLayout,
+		VK_PIPELINE_BIND_POINT_COMPUTE,
+		m_cullPipelineLayout,
 		0, 1,
-		&frameInfo.globalDescriptorSet,
+		&m_instanceDescriptorSets[frameInfo.frameIndex],
 		0, nullptr);
-	
-	auto renderView = activeSceneLock->getAllEntitiesWith<
+
+	// the first dispatch tests the instances of each group and counts their
+	// survivors, the second places them after those of earlier groups
+	uint32_t groupsX = std::min(m_cullGroupCount, MAX_CULL_GROUPS_X);
+	uint32_t groupsY = (m_cullGroupCount + groupsX - 1) / groupsX;
+	CullPushConstantData push{};
+	push.projectionView = camera->getProjection() * view;
+	push.groupCount = m_cullGroupCount;
+	for (push.phase = 0; push.phase < 2; ++push.phase)
+	{
+		if (push.phase > 0)
+		{
+			VkMemoryBarrier countBarrier{};
+			countBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			countBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+			countBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			vkCmdPipelineBarrier(
+				frameInfo.commandBuffer,
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				0,
+				1, &countBarrier,
+				0, nullptr,
+				0, nullptr);
+		}
+
+		vkCmdPushConstants(
+			frameInfo.commandBuffer,
+			m_cullPipelineLayout,
+			VK_SHADER_STAGE_COMPUTE_BIT,
+			0,
+			sizeof(CullPushConstantData),
+			&push);
+		vkCmdDispatch(frameInfo.commandBuffer, groupsX, groupsY, 1);
+	}
+
+	// the draws and visible indices are read by the render pass
+	VkMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+	vkCmdPipelineBarrier(
+		frameInfo.commandBuffer,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+		0,
+		1, &barrier,
+		0, nullptr,
+		0, nullptr);
+}
+
+/**
+* Gathers every sprite entity, builds their instances and sort keys on the
+* thread pool and sorts them, then records an upload of the instances in draw
+* order, and splits them into runs sharing a material group. Each run is drawn
+* by one indirect draw, and culled in groups of up to CULL_GROUP_SIZE
+* instances.
+*
+* @param scene The scene holding the sprites.
+* @param view The camera view, giving the depth of each sprite.
+* @param commandBuffer The frame's command buffer to record the upload into.
+*/
+void RenderSystem::rebuildInstances(
+	Scene& scene,
+	const glm::mat4& view,
+	VkCommandBuffer commandBuffer)
+{
+	m_rebuildInstances = false;
+	m_sortedView = view;
+	++m_layoutVersion;
+	m_runs.clear();
+	m_usedGroups = 0;
+	m_cullGroupCount = 0;
+	m_instanceSlots.clear();
+
+	// components are gathered up front, so workers do not iterate the registry
+	auto renderView = scene.getAllEntitiesWith<
 		TransformComponent,
 		SpriteRenderComponent>();
+	m_sprites.clear();
+	for (auto&& [entity, transform, render] : renderView.each())
+	{
+		m_sprites.push_back({ entity, &transform, &render });
+	}
+	m_instanceKeys.resize(m_sprites.size());
+	if (m_sprites.empty()) return;
 
-	std::shared_ptr<Camera> camera = activeSceneLock->getActiveCamera();
-	glm::mat4 projectionView = camera->getProjection() * camera->getView();
+	m_instances.resize(m_sprites.size());
+	m_renderQueue.resize(m_sprites.size());
+	std::atomic<uint32_t> usedGroups{ 0 };
+	parallelFor(m_sprites.size(), [this, &view, &usedGroups](size_t begin, size_t end)
+		{
+			uint32_t chunkGroups = 0;
+			for (size_t i = begin; i < end; ++i)
+			{
+				uint64_t key = buildInstance(
+					*m_sprites[i].transform,
+					*m_sprites[i].render,
+					view,
+					m_instances[i]);
+				m_renderQueue.set(i, key, static_cast<uint32_t>(i));
+				chunkGroups |= 1u << RenderQueue::pipelineOf(key);
+			}
+			usedGroups.fetch_or(chunkGroups, std::memory_order_relaxed);
+		});
 
-	for (auto&& [entity, transform, render] : renderView.each())
+	m_renderQueue.sort();
+	m_usedGroups = usedGroups.load();
+
+	// instances are written in draw order, as instanced draws rasterize in
+	// instance order
+	const auto& items = m_renderQueue.getItems();
+	reserveInstances(items.size());
+	VkDeviceSize size = items.size() * sizeof(SpriteInstance);
+	auto stagingBuffer = std::make_unique<Buffer>(
+		m_device,
+		size,
+		1,
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	stagingBuffer->map();
+	auto* sortedInstances = static_cast<SpriteInstance*>(stagingBuffer->getMappedMemory());
+	parallelFor(items.size(), [this, sortedInstances, &items](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; ++i)
+			{
+				sortedInstances[i] = m_instances[items[i].index];
+				m_instanceKeys[i] = items[i].key;
+			}
+		});
+	copyInstances(commandBuffer, std::move(stagingBuffer), { { 0, 0, size } });
+
+	// a run ends where the material group of the next instance differs
+	m_instanceSlots.reserve(items.size());
+	uint32_t runStart = 0;
+	for (uint32_t i = 0; i < items.size(); ++i)
 	{
-		PushConstantData push{};
+		m_instanceSlots[m_sprites[items[i].index].entity] = i;
 
-		glm::mat4 model = glm::translate(glm::mat4{ 1.0f }, transform.translation);
-		model = glm::scale(model, transform.scale);
-		model = glm::rotate(model, transform.rotation.y, glm::vec3{ 0.0f, 1.0f, 0.0f });
-		model = glm::rotate(model, transform.rotation.x, glm::vec3{ 1.0f, 0.0f, 0.0f });
-		model = glm::rotate(model, transform.rotation.z, glm::vec3{ 0.0f, 0.0f, 1.0f });
+		uint32_t group = RenderQueue::pipelineOf(items[i].key);
+		if (i + 1 < items.size() && RenderQueue::pipelineOf(items[i + 1].key) == group)
+		{
+			continue;
+		}
 
-		push.model = model;
-		push.shaderConfig = static_cast<uint32_t>(render.material.shaderConfig);
-		push.normalsTransform = glm::vec4{ m_normalCoordScales, 0.0f };
+		uint32_t count = i + 1 - runStart;
+		m_runs.push_back({ group, runStart, count });
+		m_cullGroupCount += (count + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE;
+		runStart = i + 1;
+	}
+}
 
-		vkCmdPushConstants(
-			frameInfo.commandBuffer,
-			m_pipelineLayout,
-			VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-			0,
-			sizeof(PushConstantData),
-			&push);
+/**
+* Builds the instances of the sprites patched since the last frame, and
+* records uploads of them to their slots in the instance buffer. Asks for a
+* rebuild instead if a sprite is missing from the last rebuild, or its sort key
+* changed, as the order of the instances would change.
+*
+* @param scene The scene holding the sprites.
+* @param view The camera view the instances were sorted for.
+* @param commandBuffer The frame's command buffer to record the uploads into.
+*/
+void RenderSystem::updateInstances(
+	Scene& scene,
+	const glm::mat4& view,
+	VkCommandBuffer commandBuffer)
+{
+	if (m_changedSprites.empty()) return;
 
-		vkCmdBindDescriptorSets(
-			frameInfo.commandBuffer,
-			VK_PIPELINE_BIND_POINT_GRAPHICS,
-			m_pipelineLayout,
-			1, 1,
-			&render.material.materialDescriptor,
-			0, nullptr);
+	auto renderView = scene.getAllEntitiesWith<
+		TransformComponent,
+		SpriteRenderComponent>();
+
+	// patches of entities that are not sprites, such as the camera, are ignored
+	std::vector<std::pair<uint32_t, SpriteInstance>> updates;
+	updates.reserve(m_changedSprites.size());
+	for (entt::entity entity : m_changedSprites)
+	{
+		if (!renderView.contains(entity)) continue;
+
+		auto slot = m_instanceSlots.find(entity);
+		if (slot == m_instanceSlots.end())
+		{
+			m_rebuildInstances = true;
+			return;
+		}
+
+		SpriteInstance instance{};
+		uint64_t key = buildInstance(
+			renderView.get<TransformComponent>(entity),
+			renderView.get<SpriteRenderComponent>(entity),
+			view,
+			instance);
+		if (key != m_instanceKeys[slot->second])
+		{
+			m_rebuildInstances = true;
+			return;
+		}
+		updates.emplace_back(slot->second, instance);
+	}
+	if (updates.empty()) return;
+
+	// sprites patched more than once are uploaded once, and neighbouring
+	// instances share a copy
+	auto bySlot = [](const auto& a, const auto& b) { return a.first < b.first; };
+	auto sameSlot = [](const auto& a, const auto& b) { return a.first == b.first; };
+	std::sort(updates.begin(), updates.end(), bySlot);
+	updates.erase(std::unique(updates.begin(), updates.end(), sameSlot), updates.end());
+
+	auto stagingBuffer = std::make_unique<Buffer>(
+		m_device,
+		sizeof(SpriteInstance),
+		static_cast<uint32_t>(updates.size()),
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	stagingBuffer->map();
+	auto* staged = static_cast<SpriteInstance*>(stagingBuffer->getMappedMemory());
+
+	std::vector<VkBufferCopy> regions;
+	for (size_t i = 0; i < updates.size(); ++i)
+	{
+		staged[i] = updates[i].second;
+
+		VkDeviceSize srcOffset = i * sizeof(SpriteInstance);
+		VkDeviceSize dstOffset = updates[i].first * sizeof(SpriteInstance);
+		if (!regions.empty() &&
+			regions.back().srcOffset + regions.back().size == srcOffset &&
+			regions.back().dstOffset + regions.back().size == dstOffset)
+		{
+			regions.back().size += sizeof(SpriteInstance);
+		}
+		else
+		{
+			regions.push_back({ srcOffset, dstOffset, sizeof(SpriteInstance) });
+		}
+	}
+	copyInstances(commandBuffer, std::move(stagingBuffer), regions);
+}
 
-		bindQuad(frameInfo.commandBuffer);
-		drawQuad(frameInfo.commandBuffer);
+/**
+* Records copies from a staging buffer into the instance buffer, ordered after
+* the reads of earlier frames and before those of the frame's cull pass and
+* draws. The staging buffer is released once the frame completes.
+*
+* @param commandBuffer The frame's command buffer.
+* @param stagingBuffer The buffer holding the instances to copy.
+* @param regions The regions to copy.
+*/
+void RenderSystem::copyInstances(
+	VkCommandBuffer commandBuffer,
+	std::unique_ptr<Buffer> stagingBuffer,
+	const std::vector<VkBufferCopy>& regions)
+{
+	UploadBatch batch{ m_device, commandBuffer };
+	VkCommandBuffer uploadCommands = batch.getCommandBuffer();
+
+	// the instance buffer is shared, so the last frame may still be reading it
+	VkPipelineStageFlags readStages =
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT |
+		VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+		VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+	vkCmdPipelineBarrier(
+		uploadCommands,
+		readStages,
+		VK_PIPELINE_STAGE_TRANSFER_BIT,
+		0,
+		0, nullptr,
+		0, nullptr,
+		0, nullptr);
+
+	vkCmdCopyBuffer(
+		uploadCommands,
+		stagingBuffer->getBuffer(),
+		m_instanceBuffer->getBuffer(),
+		static_cast<uint32_t>(regions.size()),
+		regions.data());
+
+	VkMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	vkCmdPipelineBarrier(
+		uploadCommands,
+		VK_PIPELINE_STAGE_TRANSFER_BIT,
+		readStages,
+		0,
+		1, &barrier,
+		0, nullptr,
+		0, nullptr);
+
+	batch.addStagingBuffer(std::move(stagingBuffer));
+	batch.submit();
+}
+
+/**
+* Readies the buffers of a frame for its cull pass. They are grown to hold the
+* instances, the draws and cull groups of the current runs are written if the
+* frame last culled an older rebuild, and the frame's set is rewritten if any
+* buffer it references was replaced. The frame's fence has been waited on, so
+* neither is in use by the device.
+*
+* @param frameIndex The frame in flight to ready.
+*/
+void RenderSystem::prepareFrame(int frameIndex)
+{
+	reserveFrameBuffers(frameIndex, m_instanceKeys.size());
+
+	if (m_frameLayouts[frameIndex] != m_layoutVersion)
+	{
+		// a draw for each run, starting at the run, whose instance count is
+		// written by culling. Each run is split into cull groups, whose
+		// survivors are compacted in order to the start of the run
+		auto* draws = static_cast<VkDrawIndirectCommand*>(
+			m_drawBuffers[frameIndex]->getMappedMemory());
+		auto* groups = static_cast<CullGroup*>(
+			m_groupBuffers[frameIndex]->getMappedMemory());
+		uint32_t groupCount = 0;
+		for (uint32_t run = 0; run < m_runs.size(); ++run)
+		{
+			const InstanceRun& instances = m_runs[run];
+			draws[run] = { QUAD_VERTEX_COUNT, 0, 0, instances.first };
+
+			uint32_t firstGroup = groupCount;
+			uint32_t end = instances.first + instances.count;
+			for (uint32_t first = instances.first; first < end; first += CULL_GROUP_SIZE)
+			{
+				CullGroup& group = groups[groupCount++];
+				group.draw = run;
+				group.first = first;
+				group.count = std::min(CULL_GROUP_SIZE, end - first);
+				group.firstGroup = firstGroup;
+			}
+		}
+		m_drawBuffers[frameIndex]->flush();
+		m_groupBuffers[frameIndex]->flush();
+		m_frameLayouts[frameIndex] = m_layoutVersion;
+	}
+
+	if (m_staleDescriptorSets[frameIndex])
+	{
+		// commands recorded with the old set contents are invalid
+		++m_commandVersion;
+
+		VkDescriptorBufferInfo instanceInfo = m_instanceBuffer->descriptorInfo();
+		VkDescriptorBufferInfo visibleInfo = m_visibleBuffers[frameIndex]->descriptorInfo();
+		VkDescriptorBufferInfo drawInfo = m_drawBuffers[frameIndex]->descriptorInfo();
+		VkDescriptorBufferInfo groupInfo = m_groupBuffers[frameIndex]->descriptorInfo();
+		DescriptorWriter(*m_instanceSetLayout, *m_instancePool)
+			.writeBuffer(0, &instanceInfo)
+			.writeBuffer(1, &visibleInfo)
+			.writeBuffer(2, &drawInfo)
+			.writeBuffer(3, &groupInfo)
+			.overwrite(m_instanceDescriptorSets[frameIndex]);
+		m_staleDescriptorSets[frameIndex] = false;
 	}
 }
 
 /**
-* Binds the pipeline ready to draw standard quad model.
+* Asks for the instances to be rebuilt when a sprite component is added to or
+* removed from an entity.
+*/
+void RenderSystem::onSpriteAddedOrRemoved(entt::registry& registry, entt::entity entity)
+{
+	m_rebuildInstances = true;
+}
+
+/**
+* Queues the instance of an entity to be built again when one of its sprite
+* components is patched.
+*/
+void RenderSystem::onSpriteChanged(entt::registry& registry, entt::entity entity)
+{
+	m_changedSprites.push_back(entity);
+}
+
+/**
+* Builds the instance and sort key of a sprite. Only the sprite is read and the
+* instance written, so sprites can be built concurrently.
 *
-* @param commandBuffer The command buffer into which bind commands will be
-* recorded. 
+* @param transform The sprite's transform.
+* @param render The sprite's render component.
+* @param view The camera view, giving the sprite's depth.
+* @param instance The instance to build.
+*
+* @return The sort key of the sprite, whose pipeline field is its material
+* group.
 */
-void RenderSystem::bindQuad(const VkCommandBuffer& commandBuffer)
+uint64_t RenderSystem::buildInstance(
+	const TransformComponent& transform,
+	const SpriteRenderComponent& render,
+	const glm::mat4& view,
+	SpriteInstance& instance)
 {
-	m_quadModel->bind(commandBuffer);
+	instance = SpriteInstance{};
+
+	glm::mat4 model = glm::translate(glm::mat4{ 1.0f }, transform.translation);
+	model = glm::scale(model, transform.scale);
+	model = glm::rotate(model, transform.rotation.y, glm::vec3{ 0.0f, 1.0f, 0.0f });
+	model = glm::rotate(model, transform.rotation.x, glm::vec3{ 1.0f, 0.0f, 0.0f });
+	model = glm::rotate(model, transform.rotation.z, glm::vec3{ 0.0f, 0.0f, 1.0f });
+
+	instance.model = model;
+	instance.shaderConfig = static_cast<uint32_t>(render.material.shaderConfig);
+	bool transparent = render.material.transparent;
+	uint32_t group = transparent ? TRANSPARENT_BIT : 0;
+	if (render.material.shaderConfig == ShaderConfig::NormalMapped)
+	{
+		group |= NORMAL_MAPPED_BIT;
+	}
+
+	glm::vec2 uvScale = render.material.albedo->getUVScale();
+	if (const auto& virtualTexture = render.material.virtualTexture)
+	{
+		group |= VIRTUAL_TEXTURE_BIT;
+		instance.virtualTexture =
+			virtualTexture->getShaderInfo(render.material.pageTableIndex);
+		instance.feedbackOffset = virtualTexture->getFeedbackOffset();
+		uvScale = virtualTexture->getUVScale();
+	}
+	instance.uvTransform = glm::vec4{
+		uvScale * glm::vec2{ render.uvRect.z, render.uvRect.w },
+		uvScale * glm::vec2{ render.uvRect.x, render.uvRect.y } };
+	instance.albedoIndex = render.material.albedoIndex;
+	instance.normalMapIndex = render.material.normalMapIndex;
+
+	float depth = -(view * glm::vec4{ transform.translation, 1.0f }).z;
+	return RenderQueue::makeKey(
+		transparent ? RenderPass::Transparent : RenderPass::Opaque,
+		group,
+		render.material.albedoIndex,
+		depth);
+}
+
+/**
+* Splits a range of sprites into contiguous chunks, running the first on the
+* calling thread and the rest on the thread pool, and waits for all of them.
+* Small ranges are run on the calling thread alone.
+*
+* @param count The number of sprites.
+* @param job Callable processing the sprites in [begin, end).
+*/
+void RenderSystem::parallelFor(
+	size_t count,
+	const std::function<void(size_t, size_t)>& job)
+{
+	size_t chunkCount = std::min(
+		static_cast<size_t>(m_threadPool.size()) + 1,
+		(count + MIN_SPRITES_PER_CHUNK - 1) / MIN_SPRITES_PER_CHUNK);
+	if (chunkCount <= 1)
+	{
+		job(0, count);
+		return;
+	}
+
+	size_t chunkSize = (count + chunkCount - 1) / chunkCount;
+	std::vector<std::future<void>> chunks;
+	chunks.reserve(chunkCount - 1);
+	for (size_t begin = chunkSize; begin < count; begin += chunkSize)
+	{
+		size_t end = std::min(begin + chunkSize, count);
+		chunks.push_back(m_threadPool.submit([&job, begin, end]() { job(begin, end); }));
+	}
+	job(0, std::min(chunkSize, count));
+
+	// get rethrows exceptions from the workers
+	for (auto& chunk : chunks)
+	{
+		chunk.get();
+	}
 }
 
 /**
-* Draws current pipeline state using standard quad model.
+* Records the indirect draws written by the cull pass of the frame.
 * 
-* @param commandBuffer The command buffer into which draw commands will be
-* recorded.
+* @param frameInfo Structure describing relevent current frame information.
 */
-void RenderSystem::drawQuad(const VkCommandBuffer& commandBuffer)
+void RenderSystem::renderEntities(const FrameInfo& frameInfo)
 {
-	m_quadModel->draw(commandBuffer);
+	if (m_draws.empty()) return;
+
+	// textures are bindless, so every sprite shares the sets
+	VkDescriptorSet descriptorSets[] = {
+		frameInfo.globalDescriptorSet,
+		m_textureDescriptorSet,
+		m_instanceDescriptorSets[frameInfo.frameIndex]
+	};
+	vkCmdBindDescriptorSets(
+		frameInfo.commandBuffer,
+		VK_PIPELINE_BIND_POINT_GRAPHICS,
+		m_pipelineLayout,
+		0, 3,
+		descriptorSets,
+		0, nullptr);
+
+	// each run has a draw at its index, drawn if its variant is ready
+	for (const auto& [run, variant] : m_draws)
+	{
+		m_variants->get(variant).bind(frameInfo.commandBuffer);
+		vkCmdDrawIndirect(
+			frameInfo.commandBuffer,
+			m_drawBuffers[frameInfo.frameIndex]->getBuffer(),
+			run * sizeof(VkDrawIndirectCommand),
+			1,
+			sizeof(VkDrawIndirectCommand));
+	}
 }
 } // namespace wrengine
\ No newline at end of file
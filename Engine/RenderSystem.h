@@ -8,20 +8,71 @@
 
 #include "Device.h"
 #include "Pipeline.h"
-#include "Model.h"
+#include "PipelineVariants.h"
+#include "ComputePipeline.h"
+#include "Buffer.h"
+#include "Descriptors.h"
 #include "FrameInfo.h"
+#include "RenderQueue.h"
+#include "Swapchain.h"
+#include "ThreadPool.h"
 #include "Scene/Scene.h"
 
 //std
+#include <array>
 #include <string>
 #include <memory>
 #include <vector>
+#include <functional>
+#include <unordered_map>
+#include <utility>
 
 namespace wrengine
 {
+/**
+* Per sprite data read by the sprite shaders, laid out to match the std430
+* instance buffer. uvTransform holds the texture coordinate scale in xy and
+* offset in zw, mapping the quad to the sprite's region of its albedo texture.
+* The texture indices are slots of the bindless texture table. virtualTexture
+* and feedbackOffset describe the page table and feedback range of a virtual
+* texture, see VirtualTexture::getShaderInfo.
+*/
+struct SpriteInstance
+{
+	glm::mat4 model{ 1.0f };
+	glm::vec4 uvTransform{ 1.0f, 1.0f, 0.0f, 0.0f };
+	uint32_t shaderConfig = 0;
+	uint32_t albedoIndex = 0;
+	uint32_t normalMapIndex = 0;
+	uint32_t virtualTexture = 0;
+	uint32_t feedbackOffset = 0;
+	uint32_t padding[3]{};
+};
+
 /**
 * Simple system to specify a rendering structure, and configure a corresponding
-* pipeline object.
+* pipeline object. Sprites are drawn instanced, with the data of each sprite
+* held in a device local storage buffer and the quad generated in the vertex
+* shader, so a frame costs the same few commands however many sprites it has.
+* Instances are ordered by a render queue, opaque sprites first and then
+* transparent sprites back to front, and a draw is issued for each run of
+* instances sharing a pipeline. Pipelines are variants of the sprite shaders,
+* specialized for the material's shader config, virtual texturing and blending,
+* and for the frame's normal transform, so the shaders hold no branches on
+* them. Variants are compiled on first use off the frame's thread, drawing with
+* the last ready variant of the material until then. Sprites outside the
+* camera view are culled by a compute pass, which compacts the survivors of
+* each draw and writes the indirect draw commands the render pass consumes.
+*
+* The instances persist between frames. Sprites whose components are patched
+* through Entity::markChanged have their instances uploaded again in place.
+* The instances are only built again and sorted, on the workers of a thread
+* pool, when sprites are added or removed, a change moves a sprite in the
+* render queue, or the camera view changes, so in a steady scene the cull pass
+* is the only per sprite work of a frame. As the draws read everything that
+* moves from buffers, the recorded commands only change with the pipelines
+* drawn and the descriptor sets, which getCommandVersion tracks so that
+* recorded commands can be reused.
 */
 class RenderSystem
 {
@@ -30,8 +81,11 @@ public:
 		Device& device,
 		VkRenderPass renderPass,
 		VkDescriptorSetLayout globalSetLayout,
-		VkDescriptorSetLayout materialSetLayout,
-		std::shared_ptr<Scene> activeScene);
+		VkDescriptorSetLayout textureSetLayout,
+		VkDescriptorSet textureDescriptorSet,
+		std::shared_ptr<Scene> activeScene,
+		ThreadPool& threadPool,
+		std::function<void()> onVariantReady = {});
 
 	~RenderSystem();
 
@@ -40,28 +94,144 @@ public:
 	RenderSystem& operator=(const RenderSystem&) = delete;
 
 	// interface
+	void cullEntities(const FrameInfo& frameInfo);
 	void renderEntities(const FrameInfo& frameInfo);
+	uint64_t getCommandVersion();
 	void updateNormalCoords(glm::vec3 scales);
 
 private:
+	/**
+	* The components of a sprite gathered for a rebuild.
+	*/
+	struct SpriteRef
+	{
+		entt::entity entity;
+		const TransformComponent* transform;
+		const SpriteRenderComponent* render;
+	};
+
+	/**
+	* Consecutive instances sharing a material group, drawn by one indirect
+	* draw at the index of the run.
+	*/
+	struct InstanceRun
+	{
+		uint32_t group;
+		uint32_t first;
+		uint32_t count;
+	};
+
 	// helper functions
 	void createPipelineLayout(
 		VkDescriptorSetLayout globalSetLayout,
-		VkDescriptorSetLayout materialSetLayout);
-	void createPipeline(VkRenderPass renderPass);
-	void bindQuad(const VkCommandBuffer& frameInfo);
-	void drawQuad(const VkCommandBuffer& frameInfo);
+		VkDescriptorSetLayout textureSetLayout);
+	void createPipelineVariants(std::function<void()> onVariantReady);
+	std::unique_ptr<Pipeline> createVariant(uint32_t key);
+	uint32_t variantFeatures();
+	void resolveVariants(uint32_t usedGroups);
+	void createCullPipeline();
+	void createInstanceDescriptors();
+	void reserveInstances(size_t count);
+	void reserveFrameBuffers(int frameIndex, size_t count);
+	void prepareFrame(int frameIndex);
+	void rebuildInstances(
+		Scene& scene,
+		const glm::mat4& view,
+		VkCommandBuffer commandBuffer);
+	void updateInstances(
+		Scene& scene,
+		const glm::mat4& view,
+		VkCommandBuffer commandBuffer);
+	void copyInstances(
+		VkCommandBuffer commandBuffer,
+		std::unique_ptr<Buffer> stagingBuffer,
+		const std::vector<VkBufferCopy>& regions);
+	uint64_t buildInstance(
+		const TransformComponent& transform,
+		const SpriteRenderComponent& render,
+		const glm::mat4& view,
+		SpriteInstance& instance);
+	void parallelFor(
+		size_t count,
+		const std::function<void(size_t, size_t)>& job);
+
+	// scene signal handlers
+	void onSpriteAddedOrRemoved(entt::registry& registry, entt::entity entity);
+	void onSpriteChanged(entt::registry& registry, entt::entity entity);
 
 	// vulkan/glfw structures
 	Device& m_device;
-	std::unique_ptr<Pipeline> m_pipeline;
 	VkPipelineLayout m_pipelineLayout;
 
+	VkRenderPass m_renderPass;
+
+	// sprite pipeline variants. The pipeline field of the sort keys holds the
+	// material group of a sprite, the variant key bits depending on its
+	// material, which the frame's variant table maps to a variant id
+	static constexpr uint32_t MATERIAL_GROUP_COUNT = 8;
+	std::unique_ptr<PipelineVariants> m_variants;
+	std::array<uint32_t, MATERIAL_GROUP_COUNT> m_groupVariants;
+
+	// compute pipeline culling instances against the camera view
+	VkPipelineLayout m_cullPipelineLayout;
+	std::unique_ptr<ComputePipeline> m_cullPipeline;
+
+	// bindless texture array, bound once per frame
+	VkDescriptorSet m_textureDescriptorSet;
+
+	// sprite instances in draw order, shared by every frame in flight. The
+	// visible index, indirect draw and cull group buffers are written by the
+	// cull pass, so there is one of each per frame in flight. All are grown as
+	// needed, after which a frame's set is rewritten before it is next used
+	std::unique_ptr<DescriptorSetLayout> m_instanceSetLayout;
+	std::unique_ptr<DescriptorPool> m_instancePool;
+	std::unique_ptr<Buffer> m_instanceBuffer;
+	std::vector<std::unique_ptr<Buffer>> m_visibleBuffers;
+	std::vector<std::unique_ptr<Buffer>> m_drawBuffers;
+	std::vector<std::unique_ptr<Buffer>> m_groupBuffers;
+	std::vector<VkDescriptorSet> m_instanceDescriptorSets;
+	std::vector<bool> m_staleDescriptorSets;
+
+	// sprites of the last rebuild, with their instances in queue slot order
+	std::vector<SpriteRef> m_sprites;
+	std::vector<SpriteInstance> m_instances;
+	RenderQueue m_renderQueue;
+
+	// sort key of each instance in draw order, and the instance of each sprite
+	std::vector<uint64_t> m_instanceKeys;
+	std::unordered_map<entt::entity, uint32_t> m_instanceSlots;
+
+	// sprites patched since the last frame, and whether the instances must be
+	// rebuilt, along with the camera view they were sorted for
+	std::vector<entt::entity> m_changedSprites;
+	bool m_rebuildInstances = true;
+	glm::mat4 m_sortedView{ 1.0f };
+
+	// runs of the last rebuild, with their material groups and cull groups.
+	// Each rebuild is a new layout, which a frame's draw and group buffers are
+	// written with before the frame culls
+	std::vector<InstanceRun> m_runs;
+	uint32_t m_usedGroups = 0;
+	uint32_t m_cullGroupCount = 0;
+	uint64_t m_layoutVersion = 0;
+	std::vector<uint64_t> m_frameLayouts;
+
+	// run and pipeline of each indirect draw of the current frame, and the
+	// layout and variant table they were found for
+	std::vector<std::pair<uint32_t, uint32_t>> m_draws;
+	uint64_t m_drawsLayout = 0;
+	std::array<uint32_t, MATERIAL_GROUP_COUNT> m_drawsVariants;
+
+	// version of the commands renderEntities records, and the draws it last
+	// changed for
+	uint64_t m_commandVersion = 0;
+	std::vector<std::pair<uint32_t, uint32_t>> m_versionedDraws;
+
 	// scene to render
 	std::weak_ptr<Scene> m_activeScene;
 
-	// TODO figure out a better system for drawing quads
-	std::unique_ptr<Model> m_quadModel;
+	// workers building instances, shared with the rest of the frame
+	ThreadPool& m_threadPool;
 
 	// normal coordinates
 	glm::vec3 m_normalCoordScales{ 1.0f, -1.0f, 1.0f };
@@ -7,7 +7,8 @@
 
 namespace wrengine
 {
-Renderer::Renderer(Window& window, Device& device) :
+Renderer::Renderer(Window& window, Device& device, PresentProfile profile) :
+	m_presentProfile{ profile },
 	m_window{ window },
 	m_device{ device }
 {
@@ -27,7 +28,7 @@ Renderer::~Renderer()
 */
 void Renderer::waitIdle()
 {
-	vkDeviceWaitIdle(m_device.device());
+	m_device.waitIdle();
 }
 
 /**
@@ -79,6 +80,23 @@ void Renderer::setClearColor(float r, float g, float b)
 	m_clearG = g;
 	m_clearB = b;
 }
+
+/**
+* Rebuilds the swapchain with the present mode and frames in flight of a
+* profile. Must not be called while a frame is in progress.
+* 
+* @param profile The profile to present with.
+*/
+void Renderer::setPresentProfile(PresentProfile profile)
+{
+	assert(
+		!m_isFrameStarted &&
+		"can't change present profile with frame in progress");
+	if (profile == m_presentProfile) return;
+
+	m_presentProfile = profile;
+	recreateSwapchain();
+}
 //  Interface end  ----------------------------------
 
 /**
@@ -95,15 +113,19 @@ void Renderer::recreateSwapchain()
 		glfwWaitEvents();
 	}
 
-	vkDeviceWaitIdle(m_device.device());
+	m_device.waitIdle();
 	if (!m_swapchain)
 	{
-		m_swapchain = std::make_unique<Swapchain>(m_device, extent);
+		m_swapchain = std::make_unique<Swapchain>(m_device, extent, m_presentProfile);
 	}
 	else
 	{
 		std::shared_ptr<Swapchain> oldSwapchain = std::move(m_swapchain);
-		m_swapchain = std::make_unique<Swapchain>(m_device, extent, oldSwapchain);
+		m_swapchain = std::make_unique<Swapchain>(
+			m_device,
+			extent,
+			m_presentProfile,
+			oldSwapchain);
 
 		if (!oldSwapchain->compareSwapFormats(*m_swapchain.get()))
 		{
@@ -111,6 +133,7 @@ void Renderer::recreateSwapchain()
 			throw std::runtime_error("swap chain format has changed!");
 		}
 	}
+	++m_swapchainGeneration;
 }
 
 /**
@@ -178,6 +201,14 @@ VkCommandBuffer Renderer::beginFrame()
 		throw std::runtime_error("unable to aquire next image!");
 	}
 
+	// the fence for this frame slot has signaled, so every frame up to
+	// MAX_FRAMES_IN_FLIGHT behind this one has finished on the device
+	if (m_frameNumber >= Swapchain::MAX_FRAMES_IN_FLIGHT)
+	{
+		m_device.getDeletionQueue().collect(
+			m_frameNumber - Swapchain::MAX_FRAMES_IN_FLIGHT);
+	}
+
 	m_isFrameStarted = true;
 
 	VkCommandBuffer commandBuffer = getCurrentCommandBuffer();
@@ -227,14 +258,19 @@ void Renderer::endFrame()
 	m_currentFrameIndex =
 		(m_currentFrameIndex + 1) %
 		Swapchain::MAX_FRAMES_IN_FLIGHT;
+	m_device.getDeletionQueue().setFrame(++m_frameNumber);
 }
 
 /**
 * Records commands to begin the render pass, using the current Swapchain object.
 * 
 * @param commandBuffer Command buffer into which commands are recorded.
+* @param contents Whether the pass is recorded inline, or executed from
+* secondary command buffers.
 */
-void Renderer::beginSwapchainRenderPass(VkCommandBuffer commandBuffer)
+void Renderer::beginSwapchainRenderPass(
+	VkCommandBuffer commandBuffer,
+	VkSubpassContents contents)
 {
 	assert(
 		m_isFrameStarted &&
@@ -259,8 +295,23 @@ void Renderer::beginSwapchainRenderPass(VkCommandBuffer commandBuffer)
 	vkCmdBeginRenderPass(
 		commandBuffer,
 		&renderPassInfo,
-		VK_SUBPASS_CONTENTS_INLINE);
+		contents);
 
+	// secondary command buffers do not inherit dynamic state, and set their own
+	if (contents == VK_SUBPASS_CONTENTS_INLINE)
+	{
+		setViewport(commandBuffer);
+	}
+}
+
+/**
+* Records commands setting the viewport and scissor to cover the swapchain
+* extent.
+*
+* @param commandBuffer The command buffer to record to.
+*/
+void Renderer::setViewport(VkCommandBuffer commandBuffer) const
+{
 	VkViewport viewport{};
 	viewport.x = 0.0f;
 	viewport.y = 0.0f;
@@ -289,4 +340,24 @@ void Renderer::endSwapchainRenderPass(VkCommandBuffer commandBuffer)
 
 	vkCmdEndRenderPass(commandBuffer);
 }
+
+/**
+* Describes the render pass and framebuffer of the current frame, for secondary
+* command buffers recording its contents.
+*
+* @return The inheritance info, of subpass 0 of the swapchain render pass.
+*/
+VkCommandBufferInheritanceInfo Renderer::getInheritanceInfo() const
+{
+	assert(
+		m_isFrameStarted &&
+		"cannot get inheritance info when frame not in progress");
+
+	VkCommandBufferInheritanceInfo inheritanceInfo{};
+	inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+	inheritanceInfo.renderPass = m_swapchain->getRenderPass();
+	inheritanceInfo.subpass = 0;
+	inheritanceInfo.framebuffer = m_swapchain->getFrameBuffer(m_currentImageIndex);
+	return inheritanceInfo;
+}
 } // namespace wrengine
\ No newline at end of file
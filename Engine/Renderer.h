@@ -20,7 +20,7 @@ namespace wrengine
 class Renderer
 {
 public:
-	Renderer(Window& window, Device& device);
+	Renderer(Window& window, Device& device, PresentProfile profile);
 
 	~Renderer();
 
@@ -31,8 +31,12 @@ public:
 	// interface
 	VkCommandBuffer beginFrame();
 	void endFrame();
-	void beginSwapchainRenderPass(VkCommandBuffer commandBuffer);
+	void beginSwapchainRenderPass(
+		VkCommandBuffer commandBuffer,
+		VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
 	void endSwapchainRenderPass(VkCommandBuffer commandBuffer);
+	void setViewport(VkCommandBuffer commandBuffer) const;
+	VkCommandBufferInheritanceInfo getInheritanceInfo() const;
 	bool isFrameInProgress() const { return m_isFrameStarted; }
 	VkCommandBuffer getCurrentCommandBuffer() const;
 	VkRenderPass getSwapchainRenderPass() const;
@@ -40,8 +44,13 @@ public:
 	VkExtent2D getExtent() const { return m_swapchain->getSwapChainExtent(); }
 	void waitIdle();
 	int getFrameIndex() const;
+	uint64_t getFrameNumber() const { return m_frameNumber; }
+	uint64_t getSwapchainGeneration() const { return m_swapchainGeneration; }
 	size_t getImageCount() { return m_swapchain->imageCount(); }
 	void setClearColor(float r, float g, float b);
+	void setPresentProfile(PresentProfile profile);
+	PresentProfile getPresentProfile() const { return m_presentProfile; }
+	void waitForFrame() { m_swapchain->waitForFrame(); }
 
 private:
 	// helper functions
@@ -51,12 +60,18 @@ private:
 
 	uint32_t m_currentImageIndex;
 	int m_currentFrameIndex = 0;
+	uint64_t m_frameNumber = 0;
+
+	// incremented each time the swapchain, and with it the render pass and
+	// extent, is recreated
+	uint64_t m_swapchainGeneration = 0;
 	bool m_isFrameStarted = false;
 
 	// window params
 	uint32_t m_width = 800;
 	uint32_t m_height = 600;
 	std::string m_windowName = "wrengine";
+	PresentProfile m_presentProfile;
 
 	// vulkan/glfw structures
 	Window& m_window;
@@ -12,6 +12,9 @@
 
 namespace wrengine
 {
+// forward declarations
+class VirtualTexture;
+class Tilemap;
 
 /**
 * Shader configuration enum
@@ -29,8 +32,21 @@ struct Material
 {
 	std::shared_ptr<Texture> albedo;
 	std::shared_ptr<Texture> normalMap;
-	VkDescriptorSet materialDescriptor = nullptr;
+
+	// slots of the textures in the engine bindless texture table
+	uint32_t albedoIndex = 0;
+	uint32_t normalMapIndex = 0;
+
+	// set when the albedo and normal map are the tile caches of a virtual
+	// texture, sampled through its page table
+	std::shared_ptr<VirtualTexture> virtualTexture;
+	uint32_t pageTableIndex = 0;
 	ShaderConfig shaderConfig = ShaderConfig::Emissive;
+
+	// transparent materials are blended, drawn back to front after opaque ones.
+	// Materials whose alpha is only ever 0 or 1 can clear this, to be drawn
+	// front to back with depth writes instead
+	bool transparent = true;
 };
 
 /**
@@ -68,10 +84,28 @@ struct SpriteRenderComponent
 	glm::vec4 color{ 1.0f };
 	Material material;
 
+	// region of the albedo texture to draw, as offset in xy and size in zw, in
+	// texture coordinates of its content. Sprites packed into an atlas page
+	// draw their own region of the shared page.
+	glm::vec4 uvRect{ 0.0f, 0.0f, 1.0f, 1.0f };
+
 	SpriteRenderComponent() = default;
 	SpriteRenderComponent(const glm::vec4& color) : color{ color } {}
 };
 
+/**
+* Component for rendering a tilemap layer. The layer is drawn as a single quad
+* the size of the map in pixels, multiplied by the transform scale.
+*/
+struct TilemapComponent
+{
+	std::shared_ptr<Tilemap> tilemap;
+	ShaderConfig shaderConfig = ShaderConfig::NormalMapped;
+
+	TilemapComponent() = default;
+	TilemapComponent(std::shared_ptr<Tilemap> tilemap) : tilemap{ tilemap } {}
+};
+
 // forward declaration
 class ScriptableEntity;
 
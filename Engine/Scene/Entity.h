@@ -42,6 +42,15 @@ public:
 		return sceneLock->m_registry.get<T>(m_entityHandle);
 	}
 
+	// components modified in place must be marked, see Scene::markChanged
+	template<typename T>
+	void markChanged()
+	{
+		auto sceneLock = m_scene.lock();
+		assert(sceneLock && "cannot mark entity components outside scene lifetime!");
+		sceneLock->markChanged<T>(m_entityHandle);
+	}
+
 	template<typename T>
 	void removeComponent()
 	{
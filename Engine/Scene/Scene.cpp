@@ -63,4 +63,14 @@ void Scene::onUpdate(float deltaTime)
 		camera.camera->setViewDirection(transform.translation, transform.rotation);
 	}
 }
+
+bool Scene::isAnimating()
+{
+	// only scripts that opt in animate, others change the scene through events
+	for (auto& [entity, script] : m_registry.view<ScriptComponent>().each())
+	{
+		if (script.instance && script.instance->isAnimating()) return true;
+	}
+	return false;
+}
 } // namespace wrengine
\ No newline at end of file
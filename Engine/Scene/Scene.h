@@ -27,10 +27,32 @@ public:
 		return m_registry.view<Components...>();
 	}
 
+	/**
+	* Notifies listeners to onComponentChanged that a component was modified in
+	* place. Systems keeping data derived from components, such as the sprite
+	* instances of the RenderSystem, only see changes made known this way.
+	*/
+	template<typename Component>
+	void markChanged(entt::entity entity)
+	{
+		m_registry.patch<Component>(entity);
+	}
+
+	// signals raised when a component is added, marked changed or removed
+	template<typename Component>
+	auto onComponentAdded() { return m_registry.on_construct<Component>(); }
+
+	template<typename Component>
+	auto onComponentChanged() { return m_registry.on_update<Component>(); }
+
+	template<typename Component>
+	auto onComponentRemoved() { return m_registry.on_destroy<Component>(); }
+
 	std::shared_ptr<Camera> getActiveCamera() { return m_activeCamera; }
 
 	void onSceneStart();
 	void onUpdate(float deltaTime);
+	bool isAnimating();
 
 private:
 	entt::registry m_registry;
@@ -16,13 +16,25 @@ public:
 		return m_entity.getComponent<T>();
 	}
 
+	template<typename T>
+	void markChanged()
+	{
+		m_entity.markChanged<T>();
+	}
+
+	bool isAnimating() const { return m_animating; }
+
 protected:
 	virtual void onCreate() {}
 	virtual void onDestroy() {}
 	virtual void onUpdate(float deltaTime) {}
 
+	// scripts that change the scene every update keep an idle engine rendering
+	void setAnimating(bool animating) { m_animating = animating; }
+
 private:
 	Entity m_entity;
+	bool m_animating = false;
 	friend class Scene;
 };
 
@@ -7,9 +7,13 @@
 
 namespace wrengine
 {
-Swapchain::Swapchain(Device& deviceRef, VkExtent2D extent) :
+Swapchain::Swapchain(
+	Device& deviceRef,
+	VkExtent2D extent,
+	PresentProfile profile) :
 	m_device{ deviceRef },
-	m_extent{ extent }
+	m_extent{ extent },
+	m_profile{ profile }
 {
 	init();
 }
@@ -17,9 +21,11 @@ Swapchain::Swapchain(Device& deviceRef, VkExtent2D extent) :
 Swapchain::Swapchain(
 	Device& deviceRef,
 	VkExtent2D extent,
+	PresentProfile profile,
 	std::shared_ptr<Swapchain> previous) :
 	m_device{ deviceRef },
 	m_extent{ extent },
+	m_profile{ profile },
 	m_oldSwapchain{ previous }
 {
 	init();
@@ -57,7 +63,7 @@ Swapchain::~Swapchain()
 	{
 		vkDestroyImageView(m_device.device(), m_depthImageViews[i], nullptr);
 		vkDestroyImage(m_device.device(), m_depthImages[i], nullptr);
-		vkFreeMemory(m_device.device(), m_depthImageMemorys[i], nullptr);
+		m_device.getAllocator().free(m_depthImageMemorys[i]);
 	}
 
 	for (auto framebuffer : m_swapchainFramebuffers)
@@ -101,7 +107,9 @@ VkSurfaceFormatKHR Swapchain::chooseSwapSurfaceFormat(
 }
 
 /**
-* Chooses the present mode. Will opt for Mailbox if available, otherwise FIFO.
+* Chooses the present mode of the profile. Low latency opts for immediate if
+* available, then mailbox. Otherwise, and for the other profiles, FIFO, which is
+* always supported.
 * 
 * @param availablePresentModes Vector of present modes from which to choose.
 * @return The chosen present mode.
@@ -109,18 +117,53 @@ VkSurfaceFormatKHR Swapchain::chooseSwapSurfaceFormat(
 VkPresentModeKHR Swapchain::chooseSwapPresentMode(
 	const std::vector<VkPresentModeKHR>& availablePresentModes)
 {
-	for (const auto& presentMode : availablePresentModes)
+	if (m_profile == PresentProfile::LowLatency)
 	{
-		if (presentMode == VK_PRESENT_MODE_MAILBOX_KHR)
+		for (VkPresentModeKHR preferred : {
+			VK_PRESENT_MODE_IMMEDIATE_KHR,
+			VK_PRESENT_MODE_MAILBOX_KHR })
 		{
-			std::cout << "present mode: mailbox\n";
-			return presentMode;
+			if (std::find(
+				availablePresentModes.begin(),
+				availablePresentModes.end(),
+				preferred) != availablePresentModes.end())
+			{
+				std::cout << (preferred == VK_PRESENT_MODE_IMMEDIATE_KHR ?
+					"present mode: immediate\n" :
+					"present mode: mailbox\n");
+				return preferred;
+			}
 		}
 	}
 	std::cout << "present mode: v-sync\n";
 	return VK_PRESENT_MODE_FIFO_KHR;
 }
 
+/**
+* Gets the number of frames the profile lets the CPU record ahead of the device.
+* 
+* @return One for low latency, otherwise MAX_FRAMES_IN_FLIGHT.
+*/
+int Swapchain::getFramesInFlight() const
+{
+	return m_profile == PresentProfile::LowLatency ? 1 : MAX_FRAMES_IN_FLIGHT;
+}
+
+/**
+* Waits for the frame that last used the current frame slot to finish on the
+* device. With one frame in flight, this is the previous frame, so work after
+* the wait, such as polling input, is as late as it can be.
+*/
+void Swapchain::waitForFrame()
+{
+	vkWaitForFences(
+		m_device.device(),
+		1,
+		&m_inFlightFences[m_currentFrame],
+		VK_TRUE,
+		std::numeric_limits<uint64_t>::max());
+}
+
 /**
 * Chooses the suitable swapchain extent, given a list of surface capabilities.
 * 
@@ -254,8 +297,7 @@ VkResult Swapchain::submitCommandBuffers(
 	submitInfo.pSignalSemaphores = signalSemaphores;
 
 	vkResetFences(m_device.device(), 1, &m_inFlightFences[m_currentFrame]);
-	if (vkQueueSubmit(
-		m_device.graphicsQueue(),
+	if (m_device.submitGraphics(
 		1,
 		&submitInfo,
 		m_inFlightFences[m_currentFrame]) != VK_SUCCESS)
@@ -275,9 +317,9 @@ VkResult Swapchain::submitCommandBuffers(
 
 	presentInfo.pImageIndices = imageIndex;
 
-	VkResult result = vkQueuePresentKHR(m_device.presentQueue(), &presentInfo);
+	VkResult result = m_device.present(&presentInfo);
 
-	m_currentFrame = (m_currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+	m_currentFrame = (m_currentFrame + 1) % getFramesInFlight();
 
 	return result;
 }
@@ -306,8 +348,7 @@ void Swapchain::createSwapChain()
 
 	VkSurfaceFormatKHR surfaceFormat =
 		chooseSwapSurfaceFormat(swapChainSupport.formats);
-	VkPresentModeKHR presentMode =
-		chooseSwapPresentMode(swapChainSupport.presentModes);
+	m_presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
 	VkExtent2D extent = chooseSwapExtent(swapChainSupport.capabilities);
 
 	uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
@@ -348,7 +389,7 @@ void Swapchain::createSwapChain()
 
 	createInfo.preTransform = swapChainSupport.capabilities.currentTransform;
 	createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
-	createInfo.presentMode = presentMode;
+	createInfo.presentMode = m_presentMode;
 	createInfo.clipped = VK_TRUE;
 	createInfo.oldSwapchain =
 		m_oldSwapchain == nullptr ?
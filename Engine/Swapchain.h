@@ -10,6 +10,20 @@
 
 namespace wrengine
 {
+/**
+* Presentation trade offs between latency, smoothness and power use.
+* LowLatency keeps one frame in flight and presents immediately, or in mailbox
+* mode, so input is shown as soon as a frame is drawn. Smooth presents in FIFO
+* order with every frame in flight, so frames are evenly paced to the display.
+* PowerSaver presents like Smooth, with the engine capping the frame rate.
+*/
+enum class PresentProfile : uint32_t
+{
+	LowLatency = 0,
+	Smooth,
+	PowerSaver,
+};
+
 /**
 * Abstraction over vulkan Swapchain object. Owns and operates the images, image
 * views, their memory buffers, and the GPU only and Host/Client synchronization
@@ -18,12 +32,15 @@ namespace wrengine
 class Swapchain
 {
 public:
+	// per frame resources are allocated for this many frames, profiles may keep
+	// fewer in flight
 	static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
 
-	Swapchain(Device &deviceRef, VkExtent2D extent);
+	Swapchain(Device &deviceRef, VkExtent2D extent, PresentProfile profile);
 	Swapchain(
 		Device &deviceRef,
 		VkExtent2D extent,
+		PresentProfile profile,
 		std::shared_ptr<Swapchain> previous);
 	~Swapchain();
 
@@ -41,10 +58,14 @@ public:
 	VkExtent2D getSwapChainExtent() { return m_swapchainExtent; }
 	uint32_t width() { return m_swapchainExtent.width; }
 	uint32_t height() { return m_swapchainExtent.height; }
+	PresentProfile getPresentProfile() const { return m_profile; }
+	VkPresentModeKHR getPresentMode() const { return m_presentMode; }
+	int getFramesInFlight() const;
 
 	// interface functions
 	VkFormat findDepthFormat();
 	float extentAspectRatio();
+	void waitForFrame();
 	VkResult acquireNextImage(uint32_t* imageIndex);
 	VkResult submitCommandBuffers(
 		const VkCommandBuffer* buffers,
@@ -70,6 +91,8 @@ private:
 	// member vars
 	Device& m_device;
 	VkExtent2D m_extent;
+	PresentProfile m_profile;
+	VkPresentModeKHR m_presentMode;
 	VkSwapchainKHR m_swapchain;
 	VkFormat m_swapchainImageFormat;
 	VkFormat m_swapchainDepthFormat;
@@ -80,7 +103,7 @@ private:
 	std::vector<VkImage> m_swapchainImages;
 	std::vector<VkImageView> m_imageViews;
 	std::vector<VkImage> m_depthImages;
-	std::vector<VkDeviceMemory> m_depthImageMemorys;
+	std::vector<Allocation> m_depthImageMemorys;
 	std::vector<VkImageView> m_depthImageViews;
 	std::vector<VkFramebuffer> m_swapchainFramebuffers;
 
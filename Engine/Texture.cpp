@@ -1,6 +1,11 @@
 #include "Texture.h"
 
+#include "UploadBatch.h"
+#include "Imaging/MipChain.h"
+
+#include <algorithm>
 #include <stdexcept>
+#include <cstring>
 
 #ifdef NDEBUG
 	#define STBI_NO_FALIURE_STRINGS
@@ -15,6 +20,76 @@
 
 namespace wrengine
 {
+/**
+* Gets the size in bytes of a single texel of a supported texture format. Will
+* throw an invalid argument error for unsupported formats.
+* 
+* @param format The texture format.
+* 
+* @return Bytes per texel.
+*/
+uint32_t Texture::texelSize(VkFormat format)
+{
+	switch (format)
+	{
+	case VK_FORMAT_R8G8B8A8_SRGB:
+	case VK_FORMAT_R8G8B8A8_UNORM:
+		return 4;
+	case VK_FORMAT_R8G8_UNORM:
+		return 2;
+	case VK_FORMAT_R8_UNORM:
+		return 1;
+	default:
+		throw std::invalid_argument("unsupported texture format!");
+	}
+}
+
+/**
+* Packs RGBA8 texels into a supported texture format by keeping the leading
+* channels, using the pixel kernels selected for this CPU. Normal maps packed to
+* two channels are renormalized first. Will throw an invalid argument error for
+* unsupported formats.
+* 
+* @param src Source RGBA8 texels.
+* @param dst Destination, with room for count texels of the target format.
+* @param count Number of texels to pack.
+* @param format The target texture format.
+* @param isNormalMap Whether the texels are RGB encoded normals.
+*/
+void Texture::packTexels(
+	const uint8_t* src,
+	uint8_t* dst,
+	size_t count,
+	VkFormat format,
+	bool isNormalMap)
+{
+	uint32_t channels = texelSize(format);
+	if (channels == 4)
+	{
+		std::memcpy(dst, src, count * 4);
+		return;
+	}
+
+	if (channels == 2)
+	{
+		const PixelKernels& kernels = getPixelKernels();
+		if (isNormalMap)
+		{
+			kernels.packNormalsRG(src, dst, count);
+		}
+		else
+		{
+			kernels.packRG(src, dst, count);
+		}
+		return;
+	}
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		dst[i] = src[i * 4];
+	}
+}
+
 Texture::~Texture()
 {
 	if (m_stbiData)
@@ -23,10 +98,14 @@ Texture::~Texture()
 		m_stbiData = nullptr;
 	}
 
-	vkDestroySampler(m_device.device(), m_textureSampler, nullptr);
-	vkDestroyImageView(m_device.device(), m_textureImageView, nullptr);
-	vkDestroyImage(m_device.device(), m_textureImage, nullptr);
-	vkFreeMemory(m_device.device(), m_textureImageMemory, nullptr);
+	// frames in flight may still sample this texture, so defer its destruction
+	retireImage();
+	VkDevice device = m_device.device();
+	m_device.retire(
+		[device, sampler = m_textureSampler]()
+		{
+			vkDestroySampler(device, sampler, nullptr);
+		});
 }
 
 /**
@@ -116,6 +195,108 @@ void Texture::loadFromData(
 	this->loadFromData(data, width, height);
 }
 
+/**
+* Loads the data from given data ptr in to Vulkan texture structures, recording
+* the upload into a batch. The texture must not be used until the batch has
+* been submitted. Assumes the use of 4 channel R8B8G8A8 data.
+*
+* @param data Void ptr of the data to write the texture with, which may be
+* released once this returns.
+* @param width The width in pixels of the image data.
+* @param height The height in pixels of the image data.
+* @param configInfo The struct with specified configuration options.
+* @param batch The batch to record the upload into.
+*/
+void Texture::loadFromData(
+	void* data,
+	int width,
+	int height,
+	TextureConfigInfo configInfo,
+	UploadBatch& batch)
+{
+	m_configInfo = configInfo;
+	m_numChannels = 4;
+	createTextureBuffer(data, width, height, &batch);
+}
+
+/**
+* Loads a cooked texture from an archive, recording the upload into a batch.
+* Texel data is already in its GPU format and copied straight from the archive
+* mapping to staging memory, along with any cooked mip levels. The format and
+* normal map flag of the entry override those of the config. The texture must
+* not be used until the batch has been submitted.
+*
+* @param archive The archive holding the texture.
+* @param entry The archive entry of the texture.
+* @param configInfo The struct with specified configuration options.
+* @param batch The batch to record the upload into.
+*/
+void Texture::loadFromArchive(
+	const AssetArchive& archive,
+	const ArchiveEntry& entry,
+	TextureConfigInfo configInfo,
+	UploadBatch& batch)
+{
+	m_configInfo = configInfo;
+	m_configInfo.format = static_cast<VkFormat>(entry.format);
+	m_configInfo.isNormalMap = (entry.flags & ARCHIVE_FLAG_NORMAL_MAP) != 0;
+	m_numChannels = static_cast<int>(entry.texelSize);
+	m_width = static_cast<int>(entry.width);
+	m_height = static_cast<int>(entry.height);
+
+	// normal map levels can only be generated on the host from RGBA data
+	if (entry.mipLevels < mipLevelCount(entry.width, entry.height) &&
+		generatesNormalMips())
+	{
+		m_configInfo.generateMipmaps = false;
+	}
+
+	createImage();
+	uploadArchiveLevels(archive, entry, batch);
+	createTextureSampler();
+	createImageView();
+}
+
+/**
+* Decodes an image file to RGBA8 texels without touching the device, so may be
+* called from any thread. Will throw a runtime error on failure to read the
+* image.
+*
+* @param filePath The file path of the image.
+*
+* @return The decoded texels and their dimensions.
+*/
+TextureData Texture::decodeFile(const std::string& filePath)
+{
+	int width;
+	int height;
+	int numChannels;
+	stbi_uc* pixels = stbi_load(
+		filePath.c_str(),
+		&width,
+		&height,
+		&numChannels,
+		STBI_rgb_alpha);
+
+	if (!pixels)
+	{
+		throw std::runtime_error(
+			"failed to load texture at " +
+			filePath +
+			" - " +
+			std::string(stbi_failure_reason()));
+	}
+
+	TextureData textureData{};
+	textureData.width = width;
+	textureData.height = height;
+	textureData.pixels.assign(
+		pixels,
+		pixels + static_cast<size_t>(width) * height * 4);
+	stbi_image_free(pixels);
+	return textureData;
+}
+
 /**
 * Gets the VkDescriptorImageInfo for use with this Texture.
 */
@@ -129,55 +310,135 @@ VkDescriptorImageInfo Texture::descriptorInfo()
 }
 
 /**
-* Updates the texture object on device memory to use new data. Supports 256x256
-* RGBA8888 data only.
-* 
+* Updates the texture object on device memory to use new data, which must match
+* the texture dimensions. Only the region that differs from the previous update
+* is uploaded, and an update without changes records no commands. No device
+* wait is needed, as frames sampling the image were submitted earlier to the
+* same queue, and the transition to the transfer layout waits on their fragment
+* shader reads.
+*
 * @param data Pointer to new texture data.
 */
 void Texture::updateTextureData(void* data)
 {
-	// sync by waiting for device
-	// TODO this is likely excessive, prefer to syncronise on a GPU fence.
-	vkDeviceWaitIdle(m_device.device());
-
-	//TODO fix this to write to the image buffer properly, rather than staging
-	uint32_t imageSize = m_width * m_height;
-	VkDeviceSize pixelSize = 4 * sizeof(unsigned char);
-	VkDeviceSize bufferSize = pixelSize * imageSize;
-
-	Buffer stagingBuffer{
-	m_device,
-	pixelSize,
-	imageSize,
-	VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-	VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
-	};
+	const uint8_t* texels = static_cast<const uint8_t*>(data);
+
+	PixelRect dirty = contentRect();
+	if (!m_shadowData.empty())
+	{
+		dirty = getPixelKernels().diffRect(
+			m_shadowData.data(),
+			texels,
+			static_cast<uint32_t>(m_width),
+			static_cast<uint32_t>(m_height));
+		if (dirty.isEmpty()) return;
+	}
 
-	stagingBuffer.map();
-	stagingBuffer.writeToBuffer(data);
+	uploadData(data, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false, dirty);
+	storeShadowData(texels, dirty);
+}
 
-	m_device.copyBuffer(
-		stagingBuffer.getBuffer(),
-		m_textureBuffer->getBuffer(),
-		bufferSize);
+/**
+* Updates the texture object with data of possibly different dimensions. If the
+* new size fits the current image bucket the image is reused in place,
+* otherwise an image of a suitable bucket is taken from the device ImagePool
+* and the old image is retired. In the latter case the image view changes, and
+* descriptors referencing this texture must be rewritten.
+*
+* @param data Pointer to new texture data.
+* @param width The width in pixels of the new data.
+* @param height The height in pixels of the new data.
+*/
+void Texture::updateTextureData(void* data, int width, int height)
+{
+	if (width == m_width && height == m_height)
+	{
+		updateTextureData(data);
+		return;
+	}
 
-	transitionImageLayout(
-		VK_FORMAT_R8G8B8A8_SRGB,
-		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+	m_width = width;
+	m_height = height;
+	m_shadowData.clear();
 
-	m_device.copyBufferToImage(
-		stagingBuffer.getBuffer(),
-		m_textureImage,
-		static_cast<uint32_t>(m_width),
-		static_cast<uint32_t>(m_height),
-		1);
+	// clear the whole image so no stale texels border the new content, the
+	// mip chain follows the content so it may change within a small bucket
+	if (ImagePool::bucketSize(width) == m_image.extent.width &&
+		ImagePool::bucketSize(height) == m_image.extent.height &&
+		(m_image.mipLevels == 1 ||
+			m_image.mipLevels == mipLevelCount(
+				static_cast<uint32_t>(width),
+				static_cast<uint32_t>(height))))
+	{
+		uploadData(data, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, true, contentRect());
+	}
+	else
+	{
+		retireImage();
+		createImage();
+		uploadData(data, VK_IMAGE_LAYOUT_UNDEFINED, true, contentRect());
+		createImageView();
+	}
 
-	// transition back to read only optimal so we can sample from shaders
-	transitionImageLayout(
-		VK_FORMAT_R8G8B8A8_SRGB,
-		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	storeShadowData(static_cast<const uint8_t*>(data), contentRect());
+}
+
+/**
+* Writes a rectangle of texels, leaving the rest of the texture unchanged. Used
+* to place sprites into atlas pages.
+*
+* @param data Pointer to rect.width * rect.height RGBA texels.
+* @param rect The rectangle to write, within the texture.
+* @param batch Optional batch to record into, rather than submitting now.
+*/
+void Texture::updateRegion(
+	const void* data,
+	const PixelRect& rect,
+	UploadBatch* batch)
+{
+	if (rect.isEmpty()) return;
+	if (rect.x + rect.width > static_cast<uint32_t>(m_width) ||
+		rect.y + rect.height > static_cast<uint32_t>(m_height))
+	{
+		throw std::runtime_error("texture region is out of bounds!");
+	}
+
+	// the shadow copy holds the whole texture, so uploads read from it
+	size_t stride = static_cast<size_t>(m_width) * 4;
+	if (m_shadowData.empty())
+	{
+		m_shadowData.assign(stride * m_height, 0);
+	}
+
+	const uint8_t* src = static_cast<const uint8_t*>(data);
+	for (uint32_t row = 0; row < rect.height; ++row)
+	{
+		std::memcpy(
+			m_shadowData.data() + (rect.y + row) * stride + rect.x * 4,
+			src + static_cast<size_t>(row) * rect.width * 4,
+			static_cast<size_t>(rect.width) * 4);
+	}
+
+	uploadData(
+		m_shadowData.data(),
+		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		false,
+		rect,
+		batch);
+}
+
+/**
+* Gets the scale from quad texture coordinates to the region of the image
+* holding content, as pooled images may be larger than the texture.
+*
+* @return UV scale of the content region.
+*/
+glm::vec2 Texture::getUVScale() const
+{
+	return glm::vec2{
+		static_cast<float>(m_width) / static_cast<float>(m_image.extent.width),
+		static_cast<float>(m_height) / static_cast<float>(m_image.extent.height)
+	};
 }
 
 /**
@@ -187,132 +448,599 @@ void Texture::updateTextureData(void* data)
 void Texture::createTextureBuffer()
 {
 	createTextureBuffer(m_stbiData, m_width, m_height);
+
+	stbi_image_free(m_stbiData);
+	m_stbiData = nullptr;
 }
 
 /**
-* Creates the buffer structures to hold the texture data.
-* 
-* @param data Void ptr of the data to write to buffer.
+* Creates the image structures to hold the texture data, and uploads the data.
+*
+* @param data Void ptr of the data to write to the image.
 * @param width The width in pixels of the image data.
 * @param height The height in pixels of the image data.
+* @param batch Optional batch to record the upload into.
 */
-void Texture::createTextureBuffer(void* data, int width, int height)
+void Texture::createTextureBuffer(
+	void* data,
+	int width,
+	int height,
+	UploadBatch* batch)
 {
 	m_width = width;
 	m_height = height;
-	uint32_t imageSize = width * height;
-	VkDeviceSize pixelSize = 4 * sizeof(unsigned char);
-	VkDeviceSize bufferSize = pixelSize * imageSize;
 
-	Buffer stagingBuffer{
-		m_device,
-		pixelSize,
-		imageSize,
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
-	};
+	createImage();
+	uploadData(data, VK_IMAGE_LAYOUT_UNDEFINED, true, contentRect(), batch);
+	createTextureSampler();
+	createImageView();
+}
+
+/**
+* Takes an image large enough for the texture from the device ImagePool. When
+* mipmaps are enabled the image has a full mip chain for the content extent,
+* rather than the larger bucket extent, unless the format cannot be blitted
+* with linear filtering, in which case the texture falls back to a single level.
+*/
+void Texture::createImage()
+{
+	uint32_t mipLevels = 1;
+	VkImageUsageFlags usage =
+		VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+
+	if (m_configInfo.generateMipmaps)
+	{
+		if (generatesNormalMips())
+		{
+			mipLevels = mipLevelCount(
+				static_cast<uint32_t>(m_width),
+				static_cast<uint32_t>(m_height));
+		}
+		else if (supportsBlitMipmaps())
+		{
+			mipLevels = mipLevelCount(
+				static_cast<uint32_t>(m_width),
+				static_cast<uint32_t>(m_height));
+			usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+		}
+	}
+
+	m_image = m_device.getImagePool().acquire(
+		static_cast<uint32_t>(m_width),
+		static_cast<uint32_t>(m_height),
+		m_configInfo.format,
+		usage,
+		mipLevels);
+}
+
+/**
+* Checks whether mip levels of this texture are generated on the host. Blits
+* average the stored channels, which shortens two channel normals, so normal
+* maps are instead downsampled and renormalized as they are uploaded.
+*
+* @return True if the mip chain is generated on the host.
+*/
+bool Texture::generatesNormalMips() const
+{
+	return m_configInfo.isNormalMap && m_configInfo.format == VK_FORMAT_R8G8_UNORM;
+}
+
+/**
+* Checks whether the texture format supports generating mip levels by blitting
+* with linear filtering.
+*
+* @return True if the format supports mipmap blits.
+*/
+bool Texture::supportsBlitMipmaps() const
+{
+	VkFormatProperties properties;
+	vkGetPhysicalDeviceFormatProperties(
+		m_device.getPhysicalDevice(),
+		m_configInfo.format,
+		&properties);
+
+	VkFormatFeatureFlags required =
+		VK_FORMAT_FEATURE_BLIT_SRC_BIT |
+		VK_FORMAT_FEATURE_BLIT_DST_BIT |
+		VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+	return (properties.optimalTilingFeatures & required) == required;
+}
+
+/**
+* Hands the current image and view to the deletion queue. The image returns to
+* the ImagePool once no frame in flight can still sample it.
+*/
+void Texture::retireImage()
+{
+	if (m_image.image == VK_NULL_HANDLE) return;
+
+	VkDevice device = m_device.device();
+	ImagePool& imagePool = m_device.getImagePool();
+	m_device.retire(
+		[device, &imagePool, imageView = m_textureImageView, image = m_image]()
+		{
+			vkDestroyImageView(device, imageView, nullptr);
+			imagePool.release(image);
+		});
 
-	stagingBuffer.map();
-	stagingBuffer.writeToBuffer(data);
+	m_image = PooledImage{};
+	m_textureImageView = nullptr;
+}
+
+/**
+* Copies a rectangle of texture data into the image, and regenerates the texels
+* of lower mip levels that depend on it, in a single submission or recorded
+* into an upload batch. Optionally clears the whole image first, which is
+* required when the image is fresh from the pool or the content region has
+* changed.
+*
+* @param data Pointer to m_width * m_height RGBA texels, which are packed to the
+* texture format.
+* @param oldLayout The current layout of the image.
+* @param clearImage Whether to clear the image to transparent before copying.
+* @param rect The rectangle of texels to copy, within the content region.
+* @param batch Optional batch to record into, rather than submitting now.
+*/
+void Texture::uploadData(
+	void* data,
+	VkImageLayout oldLayout,
+	bool clearImage,
+	const PixelRect& rect,
+	UploadBatch* batch)
+{
+	VkDeviceSize pixelSize = texelSize(m_configInfo.format);
+	bool normalMips = m_image.mipLevels > 1 && generatesNormalMips();
+
+	// host generated levels are copied from the staging buffer after level 0
+	uint32_t copyLevels = normalMips ? m_image.mipLevels : 1;
+	std::vector<PixelRect> levelRects(copyLevels);
+	std::vector<VkDeviceSize> levelOffsets(copyLevels);
+	uint32_t stagingTexels = 0;
+	for (uint32_t level = 0; level < copyLevels; ++level)
+	{
+		levelRects[level] = mipRect(rect, level);
+		levelOffsets[level] = stagingTexels * pixelSize;
+		stagingTexels += levelRects[level].width * levelRects[level].height;
+	}
 
-	m_textureBuffer = std::make_unique<Buffer>(
+	auto stagingBuffer = std::make_unique<Buffer>(
 		m_device,
 		pixelSize,
-		imageSize,
-		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		stagingTexels,
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
 
-	m_device.copyBuffer(
-		stagingBuffer.getBuffer(),
-		m_textureBuffer->getBuffer(),
-		bufferSize);
+	// pack straight into the staging memory, so narrower formats also reduce
+	// the bytes written by the host and copied by the device
+	stagingBuffer->map();
+	const uint8_t* src = static_cast<const uint8_t*>(data);
+	uint8_t* dst = static_cast<uint8_t*>(stagingBuffer->getMappedMemory());
+	size_t srcStride = static_cast<size_t>(m_width) * 4;
 
-	if (m_stbiData)
+	if (rect.width == static_cast<uint32_t>(m_width))
 	{
-		stbi_image_free(m_stbiData);
-		m_stbiData = nullptr;
+		packTexels(
+			src + rect.y * srcStride,
+			dst,
+			rect.width * rect.height,
+			m_configInfo.format,
+			m_configInfo.isNormalMap);
+	}
+	else
+	{
+		for (uint32_t row = 0; row < rect.height; ++row)
+		{
+			packTexels(
+				src + (rect.y + row) * srcStride + rect.x * 4,
+				dst + row * rect.width * pixelSize,
+				rect.width,
+				m_configInfo.format,
+				m_configInfo.isNormalMap);
+		}
 	}
 
-	createImage();
+	if (normalMips)
+	{
+		generateNormalMips(dst, levelRects, levelOffsets);
+	}
+
+	VkCommandBuffer commandBuffer = batch ?
+		batch->getCommandBuffer() :
+		m_device.beginSingleTimeCommands();
 
 	// transition the image for copying
 	transitionImageLayout(
-		VK_FORMAT_R8G8B8A8_SRGB,
+		commandBuffer,
+		oldLayout,
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+
+	if (clearImage)
+	{
+		VkClearColorValue clearColor{};
+		VkImageSubresourceRange range{};
+		range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		range.baseMipLevel = 0;
+		range.levelCount = VK_REMAINING_MIP_LEVELS;
+		range.baseArrayLayer = 0;
+		range.layerCount = 1;
+
+		vkCmdClearColorImage(
+			commandBuffer,
+			m_image.image,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			&clearColor,
+			1, &range);
+
+		// order the clear before the copy over the content region
+		VkMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		vkCmdPipelineBarrier(
+			commandBuffer,
+			VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT,
+			0,
+			1, &barrier,
+			0, nullptr,
+			0, nullptr);
+	}
+
+	std::vector<VkBufferImageCopy> regions(copyLevels);
+	for (uint32_t level = 0; level < copyLevels; ++level)
+	{
+		VkBufferImageCopy& region = regions[level];
+		region.bufferOffset = levelOffsets[level];
+		region.bufferRowLength = 0;
+		region.bufferImageHeight = 0;
+		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		region.imageSubresource.mipLevel = level;
+		region.imageSubresource.baseArrayLayer = 0;
+		region.imageSubresource.layerCount = 1;
+		region.imageOffset = {
+			static_cast<int32_t>(levelRects[level].x),
+			static_cast<int32_t>(levelRects[level].y),
+			0 };
+		region.imageExtent = {
+			levelRects[level].width,
+			levelRects[level].height,
+			1 };
+	}
+
+	vkCmdCopyBufferToImage(
+		commandBuffer,
+		stagingBuffer->getBuffer(),
+		m_image.image,
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		static_cast<uint32_t>(regions.size()),
+		regions.data());
+
+	if (m_image.mipLevels > 1 && !normalMips)
+	{
+		// leaves every level read only optimal
+		blitMipmaps(commandBuffer, rect);
+	}
+	else
+	{
+		// transition back to read only optimal so we can sample from shaders
+		transitionImageLayout(
+			commandBuffer,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	}
+
+	if (batch)
+	{
+		batch->addStagingBuffer(std::move(stagingBuffer));
+	}
+	else
+	{
+		m_device.endSingleTimeCommands(commandBuffer);
+	}
+}
+
+/**
+* Copies the cooked levels of an archive texture into a freshly created image.
+* Levels beyond the cooked chain, present when the pooled image is larger than
+* the texture, hold only the single texel of the last cooked level. If the
+* archive has no mip chain the levels are blitted from level 0 instead.
+*
+* @param archive The archive holding the texture.
+* @param entry The archive entry of the texture.
+* @param batch The batch to record the upload into.
+*/
+void Texture::uploadArchiveLevels(
+	const AssetArchive& archive,
+	const ArchiveEntry& entry,
+	UploadBatch& batch)
+{
+	bool fullChain = entry.mipLevels >= mipLevelCount(entry.width, entry.height);
+	uint32_t copyLevels = fullChain ? m_image.mipLevels : 1;
+	uint32_t stagingLevels = std::min(entry.mipLevels, copyLevels);
+	VkDeviceSize stagingSize = entry.levelOffset(stagingLevels);
+
+	auto stagingBuffer = std::make_unique<Buffer>(
+		m_device,
+		stagingSize,
+		1,
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+	// the levels are consecutive in the archive, so a single copy suffices
+	stagingBuffer->map();
+	std::memcpy(
+		stagingBuffer->getMappedMemory(),
+		archive.levelData(entry, 0),
+		static_cast<size_t>(stagingSize));
+
+	VkCommandBuffer commandBuffer = batch.getCommandBuffer();
+
+	transitionImageLayout(
+		commandBuffer,
 		VK_IMAGE_LAYOUT_UNDEFINED,
 		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
 
-	m_device.copyBufferToImage(
-		stagingBuffer.getBuffer(),
-		m_textureImage,
-		static_cast<uint32_t>(m_width),
-		static_cast<uint32_t>(m_height),
-		1);
+	// the pooled image may be larger than the texture, so clear the border
+	VkClearColorValue clearColor{};
+	VkImageSubresourceRange range{};
+	range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	range.baseMipLevel = 0;
+	range.levelCount = VK_REMAINING_MIP_LEVELS;
+	range.baseArrayLayer = 0;
+	range.layerCount = 1;
+	vkCmdClearColorImage(
+		commandBuffer,
+		m_image.image,
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		&clearColor,
+		1, &range);
+
+	VkMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	vkCmdPipelineBarrier(
+		commandBuffer,
+		VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_PIPELINE_STAGE_TRANSFER_BIT,
+		0,
+		1, &barrier,
+		0, nullptr,
+		0, nullptr);
+
+	std::vector<VkBufferImageCopy> regions(copyLevels);
+	for (uint32_t level = 0; level < copyLevels; ++level)
+	{
+		uint32_t sourceLevel = std::min(level, stagingLevels - 1);
+
+		VkBufferImageCopy& region = regions[level];
+		region.bufferOffset = entry.levelOffset(sourceLevel);
+		region.bufferRowLength = 0;
+		region.bufferImageHeight = 0;
+		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		region.imageSubresource.mipLevel = level;
+		region.imageSubresource.baseArrayLayer = 0;
+		region.imageSubresource.layerCount = 1;
+		region.imageOffset = { 0, 0, 0 };
+		region.imageExtent = {
+			mipExtent(entry.width, sourceLevel),
+			mipExtent(entry.height, sourceLevel),
+			1 };
+	}
+
+	vkCmdCopyBufferToImage(
+		commandBuffer,
+		stagingBuffer->getBuffer(),
+		m_image.image,
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		static_cast<uint32_t>(regions.size()),
+		regions.data());
+
+	if (copyLevels < m_image.mipLevels)
+	{
+		blitMipmaps(commandBuffer, contentRect());
+	}
+	else
+	{
+		transitionImageLayout(
+			commandBuffer,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	}
+
+	batch.addStagingBuffer(std::move(stagingBuffer));
+}
+
+/**
+* Records blits regenerating the texels of each mip level that depend on a
+* rectangle of level 0, each level downsampled from the one above it. All
+* levels must be in the transfer destination layout, and are left read only
+* optimal.
+*
+* @param commandBuffer The command buffer to record the blits into.
+* @param rect The rectangle of level 0 that changed.
+*/
+void Texture::blitMipmaps(VkCommandBuffer commandBuffer, const PixelRect& rect)
+{
+	for (uint32_t level = 1; level < m_image.mipLevels; ++level)
+	{
+		transitionImageLayout(
+			commandBuffer,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			level - 1, 1);
+
+		// source texels past the edge of a narrow level are clamped to it
+		PixelRect dstRect = mipRect(rect, level);
+		int32_t srcWidth = static_cast<int32_t>(
+			std::max(m_image.extent.width >> (level - 1), 1u));
+		int32_t srcHeight = static_cast<int32_t>(
+			std::max(m_image.extent.height >> (level - 1), 1u));
+		int32_t x0 = static_cast<int32_t>(dstRect.x);
+		int32_t y0 = static_cast<int32_t>(dstRect.y);
+		int32_t x1 = static_cast<int32_t>(dstRect.x + dstRect.width);
+		int32_t y1 = static_cast<int32_t>(dstRect.y + dstRect.height);
+
+		VkImageBlit blit{};
+		blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		blit.srcSubresource.mipLevel = level - 1;
+		blit.srcSubresource.baseArrayLayer = 0;
+		blit.srcSubresource.layerCount = 1;
+		blit.srcOffsets[0] = { x0 * 2, y0 * 2, 0 };
+		blit.srcOffsets[1] = {
+			std::min(x1 * 2, srcWidth),
+			std::min(y1 * 2, srcHeight),
+			1 };
+		blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		blit.dstSubresource.mipLevel = level;
+		blit.dstSubresource.baseArrayLayer = 0;
+		blit.dstSubresource.layerCount = 1;
+		blit.dstOffsets[0] = { x0, y0, 0 };
+		blit.dstOffsets[1] = { x1, y1, 1 };
+
+		vkCmdBlitImage(
+			commandBuffer,
+			m_image.image,
+			VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			m_image.image,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			1, &blit,
+			VK_FILTER_LINEAR);
+	}
 
-	// transition back to read only optimal so we can sample from shaders
 	transitionImageLayout(
-		VK_FORMAT_R8G8B8A8_SRGB,
+		commandBuffer,
+		VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		0, m_image.mipLevels - 1);
+	transitionImageLayout(
+		commandBuffer,
 		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		m_image.mipLevels - 1, 1);
+}
 
-	createTextureSampler();
-	createImageView();
+/**
+* Regenerates the host copy of a normal map mip chain within the rectangles
+* that changed, and writes the lower levels to the staging memory after the
+* packed level 0 texels.
+*
+* @param staging The mapped staging memory, holding the packed level 0 rect.
+* @param levelRects The rectangle of each level to regenerate.
+* @param levelOffsets The byte offset of each level in the staging memory.
+*/
+void Texture::generateNormalMips(
+	uint8_t* staging,
+	const std::vector<PixelRect>& levelRects,
+	const std::vector<VkDeviceSize>& levelOffsets)
+{
+	const size_t pixelSize = 2;
+	m_normalMipData.resize(levelRects.size());
+
+	for (size_t level = 0; level < levelRects.size(); ++level)
+	{
+		uint32_t width = mipExtent(m_width, static_cast<uint32_t>(level));
+		uint32_t height = mipExtent(m_height, static_cast<uint32_t>(level));
+		std::vector<uint8_t>& levelData = m_normalMipData[level];
+		levelData.resize(static_cast<size_t>(width) * height * pixelSize);
+
+		const PixelRect& rect = levelRects[level];
+		uint8_t* levelStaging = staging + levelOffsets[level];
+		size_t rowBytes = rect.width * pixelSize;
+
+		if (level > 0)
+		{
+			uint32_t srcLevel = static_cast<uint32_t>(level - 1);
+			downsampleNormalsRG(
+				m_normalMipData[srcLevel].data(),
+				mipExtent(m_width, srcLevel),
+				mipExtent(m_height, srcLevel),
+				levelData.data(),
+				width,
+				rect);
+		}
+
+		// level 0 is copied in from staging, the others out to it
+		for (uint32_t row = 0; row < rect.height; ++row)
+		{
+			uint8_t* texels = levelData.data() +
+				((rect.y + row) * static_cast<size_t>(width) + rect.x) * pixelSize;
+			if (level == 0)
+			{
+				std::memcpy(texels, levelStaging + row * rowBytes, rowBytes);
+			}
+			else
+			{
+				std::memcpy(levelStaging + row * rowBytes, texels, rowBytes);
+			}
+		}
+	}
 }
 
 /**
-* Creates the texture image.
+* Copies a rectangle of RGBA texture data into the shadow copy, creating the
+* copy from the whole content region if it does not exist yet.
+*
+* @param data Pointer to m_width * m_height RGBA texels.
+* @param rect The rectangle of texels that changed.
 */
-void Texture::createImage()
+void Texture::storeShadowData(const uint8_t* data, const PixelRect& rect)
+{
+	size_t stride = static_cast<size_t>(m_width) * 4;
+	if (m_shadowData.empty())
+	{
+		m_shadowData.assign(data, data + stride * m_height);
+		return;
+	}
+
+	for (uint32_t row = rect.y; row < rect.y + rect.height; ++row)
+	{
+		size_t offset = row * stride + rect.x * 4;
+		std::memcpy(m_shadowData.data() + offset, data + offset, rect.width * 4);
+	}
+}
+
+/**
+* Gets the rectangle covering the whole texture content.
+*
+* @return The content rectangle.
+*/
+PixelRect Texture::contentRect() const
 {
-	VkImageCreateInfo imageInfo{};
-	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-	imageInfo.imageType = VK_IMAGE_TYPE_2D;
-	imageInfo.extent.width = static_cast<uint32_t>(m_width);
-	imageInfo.extent.height = static_cast<uint32_t>(m_height);
-	imageInfo.extent.depth = 1;
-	imageInfo.mipLevels = 1;
-	imageInfo.arrayLayers = 1;
-	imageInfo.format = VK_FORMAT_R8G8B8A8_SRGB;
-	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
-	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	imageInfo.usage = 
-		VK_IMAGE_USAGE_TRANSFER_DST_BIT |
-		VK_IMAGE_USAGE_SAMPLED_BIT;
-	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-	imageInfo.flags = 0; // optional
-
-	m_device.createImageWithInfo(
-		imageInfo,
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-		m_textureImage,
-		m_textureImageMemory);
+	return PixelRect{
+		0,
+		0,
+		static_cast<uint32_t>(m_width),
+		static_cast<uint32_t>(m_height) };
 }
 
 /**
-* Transitions the texture image between memory layouts. Will throw a runtime
-* error if the layout transition is unsupported.
-* 
-* @param format Image format.
+* Records a transition of the texture image between memory layouts. Will throw
+* a runtime error if the layout transition is unsupported.
+*
+* @param commandBuffer The command buffer to record the barrier into.
 * @param oldLayout The layout that the image is transitioning from.
 * @param newLayout The target image layout that the image is transitioning to.
+* @param baseMipLevel The first mip level to transition.
+* @param levelCount The number of mip levels to transition.
 */
 void Texture::transitionImageLayout(
-	VkFormat format,
+	VkCommandBuffer commandBuffer,
 	VkImageLayout oldLayout,
-	VkImageLayout newLayout)
+	VkImageLayout newLayout,
+	uint32_t baseMipLevel,
+	uint32_t levelCount)
 {
-	VkCommandBuffer commandBuffer = m_device.beginSingleTimeCommands();
-
 	VkImageMemoryBarrier barrier{};
 	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
 	barrier.oldLayout = oldLayout;
 	barrier.newLayout = newLayout;
 	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
 	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-	barrier.image = m_textureImage;
+	barrier.image = m_image.image;
 	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	barrier.subresourceRange.baseMipLevel = 0;
-	barrier.subresourceRange.levelCount = 1;
+	barrier.subresourceRange.baseMipLevel = baseMipLevel;
+	barrier.subresourceRange.levelCount = levelCount;
 	barrier.subresourceRange.baseArrayLayer = 0;
 	barrier.subresourceRange.layerCount = 1;
 
@@ -349,6 +1077,26 @@ void Texture::transitionImageLayout(
 		srcStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
 		dstStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
 	}
+	else if (
+		oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL &&
+		newLayout == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL)
+	{
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+		srcStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		dstStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+	}
+	else if (
+		oldLayout == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL &&
+		newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+	{
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+		srcStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		dstStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+	}
 	else
 	{
 		throw std::invalid_argument("unsupported layout transition!");
@@ -362,8 +1110,6 @@ void Texture::transitionImageLayout(
 		0, nullptr,									// buf barrier count, pBufferBarriers
 		1, &barrier									// img barrier count, pImageBarriers
 	);
-
-	m_device.endSingleTimeCommands(commandBuffer);
 }
 
 /**
@@ -374,12 +1120,12 @@ void Texture::createImageView()
 {
 	VkImageViewCreateInfo viewInfo{};
 	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-	viewInfo.image = m_textureImage;
+	viewInfo.image = m_image.image;
 	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-	viewInfo.format = VK_FORMAT_R8G8B8A8_SRGB;
+	viewInfo.format = m_configInfo.format;
 	viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 	viewInfo.subresourceRange.baseMipLevel = 0;
-	viewInfo.subresourceRange.levelCount = 1;
+	viewInfo.subresourceRange.levelCount = m_image.mipLevels;
 	viewInfo.subresourceRange.baseArrayLayer = 0;
 	viewInfo.subresourceRange.layerCount = 1;
 
@@ -419,7 +1165,7 @@ void Texture::createTextureSampler()
 	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
 	samplerInfo.mipLodBias = 0.0f;
 	samplerInfo.minLod = 0.0f;
-	samplerInfo.maxLod = 0.0f;
+	samplerInfo.maxLod = VK_LOD_CLAMP_NONE; // limited by the image view
 
 	if (vkCreateSampler(
 		m_device.device(),
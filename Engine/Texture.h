@@ -5,25 +5,60 @@
 #include "Device.h"
 #include "Buffer.h"
 #include "Constants.h"
+#include "Imaging/PixelKernels.h"
+#include "Imaging/AssetArchive.h"
+
+#include <glm/glm.hpp>
 
 // std
 #include <string>
 #include <memory>
+#include <vector>
 
 namespace wrengine
 {
+// forward declaration
+class UploadBatch;
+
 /**
 * Struct for texture configuration options.
 */
 struct TextureConfigInfo
 {
 	VkFilter filterType = VK_FILTER_LINEAR;
+
+	// GPU format of the texture. Source data is always RGBA8, and is packed to
+	// this format on upload. Use a UNORM format for non-colour data such as
+	// normal maps, which are best stored as two channel RG.
+	VkFormat format = VK_FORMAT_R8G8B8A8_SRGB;
+
+	// source data holds RGB encoded normals, which are renormalized when packed
+	// to a two channel format
+	bool isNormalMap = false;
+
+	// build a mip chain, regenerated within the changed region on each update,
+	// so that scaled down sprites do not alias
+	bool generateMipmaps = true;
+};
+
+/**
+* Decoded RGBA8 image data.
+*/
+struct TextureData
+{
+	std::vector<uint8_t> pixels;
+	int width = 0;
+	int height = 0;
 };
 
 /**
 * Encapsulation of texture resources. Can read images from file and load into
 * the Vulkan image and image memory structures. Provides image views and texture
 * samplers for use of the texture within a shader.
+*
+* Images are taken from the device ImagePool, so may be larger than the texture
+* itself. Content occupies the top left of the image, and getUVScale gives the
+* texture coordinate scale to that region.
 */
 class Texture
 {
@@ -46,24 +81,78 @@ public:
 		int width,
 		int height,
 		TextureConfigInfo configInfo);
+	void loadFromData(
+		void* data,
+		int width,
+		int height,
+		TextureConfigInfo configInfo,
+		UploadBatch& batch);
+	void loadFromArchive(
+		const AssetArchive& archive,
+		const ArchiveEntry& entry,
+		TextureConfigInfo configInfo,
+		UploadBatch& batch);
 	VkDescriptorImageInfo descriptorInfo();
 	void updateTextureData(void* data);
+	void updateTextureData(void* data, int width, int height);
+	void updateRegion(
+		const void* data,
+		const PixelRect& rect,
+		UploadBatch* batch = nullptr);
+
+	// getters
+	int getWidth() const { return m_width; }
+	int getHeight() const { return m_height; }
+	glm::vec2 getUVScale() const;
+
+	static TextureData decodeFile(const std::string& filePath);
+	static uint32_t texelSize(VkFormat format);
+	static void packTexels(
+		const uint8_t* src,
+		uint8_t* dst,
+		size_t count,
+		VkFormat format,
+		bool isNormalMap = false);
 
 private:
 	void createTextureBuffer();
-	void createTextureBuffer(void* data, int width, int height);
+	void createTextureBuffer(
+		void* data,
+		int width,
+		int height,
+		UploadBatch* batch = nullptr);
 	void createImage();
+	void retireImage();
+	void uploadData(
+		void* data,
+		VkImageLayout oldLayout,
+		bool clearImage,
+		const PixelRect& rect,
+		UploadBatch* batch = nullptr);
+	void uploadArchiveLevels(
+		const AssetArchive& archive,
+		const ArchiveEntry& entry,
+		UploadBatch& batch);
+	void blitMipmaps(VkCommandBuffer commandBuffer, const PixelRect& rect);
+	void generateNormalMips(
+		uint8_t* staging,
+		const std::vector<PixelRect>& levelRects,
+		const std::vector<VkDeviceSize>& levelOffsets);
+	bool generatesNormalMips() const;
+	bool supportsBlitMipmaps() const;
+	void storeShadowData(const uint8_t* data, const PixelRect& rect);
+	PixelRect contentRect() const;
 	void transitionImageLayout(
-		VkFormat format,
+		VkCommandBuffer commandBuffer,
 		VkImageLayout oldLayout,
-		VkImageLayout newLayout);
+		VkImageLayout newLayout,
+		uint32_t baseMipLevel = 0,
+		uint32_t levelCount = VK_REMAINING_MIP_LEVELS);
 	void createImageView();
 	void createTextureSampler();
 
 	Device& m_device;
-	std::unique_ptr<Buffer> m_textureBuffer;
-	VkImage m_textureImage = nullptr;
-	VkDeviceMemory m_textureImageMemory = nullptr;
+	PooledImage m_image{};
 	VkImageView m_textureImageView = nullptr;
 	VkSampler m_textureSampler = nullptr;
 	
@@ -73,6 +162,13 @@ private:
   int m_height{};
 	int m_numChannels{};
 
+	// copy of the last RGBA data uploaded by updateTextureData, used to find
+	// the region changed by the next update
+	std::vector<uint8_t> m_shadowData;
+
+	// host copy of the mip chain of two channel normal maps, level 0 included
+	std::vector<std::vector<uint8_t>> m_normalMipData;
+
 	// config options
 	TextureConfigInfo m_configInfo{};
 };
@@ -0,0 +1,320 @@
+#include "TextureAtlas.h"
+
+// std
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+namespace wrengine
+{
+TextureAtlas::TextureAtlas(Device& device, AtlasConfigInfo configInfo) :
+	m_device{ device },
+	m_configInfo{ configInfo }
+{
+	m_configInfo.maxPages = std::max(m_configInfo.maxPages, 1u);
+}
+
+/**
+* Adds a sprite to the atlas, or replaces the texels of a sprite already in it.
+* A replaced sprite of the same size keeps its place. Uploads are submitted
+* before this returns. Will throw a runtime error if the sprite and its padding
+* are larger than a page, or if every page is full and pinned.
+*
+* @param name The name of the sprite.
+* @param albedo Pointer to width * height RGBA texels.
+* @param normal Pointer to width * height RGB encoded normals, or nullptr for
+* flat normals.
+* @param width The sprite width in pixels.
+* @param height The sprite height in pixels.
+* @param evicted Optional list to append the names of evicted sprites to.
+* @param pinnedPages Optional list of pages that must not be evicted, such as
+* pages still being drawn from.
+*
+* @return The location of the sprite.
+*/
+AtlasRegion TextureAtlas::add(
+	const std::string& name,
+	const uint8_t* albedo,
+	const uint8_t* normal,
+	uint32_t width,
+	uint32_t height,
+	std::vector<std::string>* evicted,
+	const std::vector<uint32_t>* pinnedPages)
+{
+	uint32_t paddedWidth = width + 2 * m_configInfo.padding;
+	uint32_t paddedHeight = height + 2 * m_configInfo.padding;
+	if (width == 0 || height == 0 ||
+		paddedWidth > m_configInfo.pageSize ||
+		paddedHeight > m_configInfo.pageSize)
+	{
+		throw std::runtime_error("sprite does not fit in an atlas page: " + name);
+	}
+
+	std::scoped_lock<std::mutex> lock(m_mutex);
+
+	AtlasRegion region{};
+	auto existing = m_entries.find(name);
+	if (existing != m_entries.end() &&
+		existing->second.region.rect.width == width &&
+		existing->second.region.rect.height == height)
+	{
+		region = existing->second.region;
+	}
+	else
+	{
+		if (existing != m_entries.end()) eraseEntry(existing);
+
+		while (!place(paddedWidth, paddedHeight, region))
+		{
+			if (m_pages.size() < m_configInfo.maxPages)
+			{
+				createPage();
+			}
+			else
+			{
+				evictPage(evicted, pinnedPages);
+			}
+		}
+		m_pages[region.page].spriteCount++;
+	}
+
+	std::vector<uint8_t> flatNormals;
+	if (!normal)
+	{
+		const uint8_t flat[4] = { 128, 128, 255, 255 };
+		flatNormals.resize(static_cast<size_t>(width) * height * 4);
+		for (size_t i = 0; i < flatNormals.size(); i += 4)
+		{
+			std::memcpy(&flatNormals[i], flat, 4);
+		}
+		normal = flatNormals.data();
+	}
+
+	PixelRect padded{
+		region.rect.x - m_configInfo.padding,
+		region.rect.y - m_configInfo.padding,
+		paddedWidth,
+		paddedHeight };
+	Page& page = m_pages[region.page];
+	page.albedo->updateRegion(padTexels(albedo, width, height).data(), padded);
+	page.normal->updateRegion(padTexels(normal, width, height).data(), padded);
+
+	m_entries[name] = Entry{ region, ++m_useCounter };
+	return region;
+}
+
+/**
+* Finds a sprite in the atlas, marking it as used.
+*
+* @param name The name of the sprite.
+* @param region Set to the location of the sprite if found.
+*
+* @return False if the sprite is not in the atlas, or has been evicted.
+*/
+bool TextureAtlas::find(const std::string& name, AtlasRegion& region)
+{
+	std::scoped_lock<std::mutex> lock(m_mutex);
+	auto entry = m_entries.find(name);
+	if (entry == m_entries.end()) return false;
+
+	entry->second.lastUse = ++m_useCounter;
+	region = entry->second.region;
+	return true;
+}
+
+/**
+* Removes a sprite from the atlas. Its space is reclaimed once every sprite of
+* its page has been removed.
+*
+* @param name The name of the sprite.
+*/
+void TextureAtlas::remove(const std::string& name)
+{
+	std::scoped_lock<std::mutex> lock(m_mutex);
+	auto entry = m_entries.find(name);
+	if (entry != m_entries.end()) eraseEntry(entry);
+}
+
+uint32_t TextureAtlas::getPageCount()
+{
+	std::scoped_lock<std::mutex> lock(m_mutex);
+	return static_cast<uint32_t>(m_pages.size());
+}
+
+std::shared_ptr<Texture> TextureAtlas::getAlbedoPage(uint32_t page)
+{
+	std::scoped_lock<std::mutex> lock(m_mutex);
+	return m_pages.at(page).albedo;
+}
+
+std::shared_ptr<Texture> TextureAtlas::getNormalPage(uint32_t page)
+{
+	std::scoped_lock<std::mutex> lock(m_mutex);
+	return m_pages.at(page).normal;
+}
+
+/**
+* Finds space for a padded sprite on an existing page, trying pages in order.
+*
+* @param width The padded sprite width.
+* @param height The padded sprite height.
+* @param region Set to the location of the sprite, excluding padding.
+*
+* @return False if no page has space.
+*/
+bool TextureAtlas::place(uint32_t width, uint32_t height, AtlasRegion& region)
+{
+	float pageSize = static_cast<float>(m_configInfo.pageSize);
+	for (uint32_t i = 0; i < m_pages.size(); ++i)
+	{
+		PixelRect rect;
+		if (!m_pages[i].packer.insert(width, height, rect)) continue;
+
+		region.page = i;
+		region.rect = PixelRect{
+			rect.x + m_configInfo.padding,
+			rect.y + m_configInfo.padding,
+			width - 2 * m_configInfo.padding,
+			height - 2 * m_configInfo.padding };
+		region.uvRect = glm::vec4{
+			region.rect.x / pageSize,
+			region.rect.y / pageSize,
+			region.rect.width / pageSize,
+			region.rect.height / pageSize };
+		return true;
+	}
+	return false;
+}
+
+/**
+* Creates an empty page. Mip maps are not generated, as lower levels would blend
+* neighbouring sprites.
+*/
+void TextureAtlas::createPage()
+{
+	uint32_t size = m_configInfo.pageSize;
+	std::vector<uint8_t> empty(static_cast<size_t>(size) * size * 4, 0);
+
+	TextureConfigInfo albedoConfig{};
+	albedoConfig.filterType = m_configInfo.filterType;
+	albedoConfig.generateMipmaps = false;
+
+	TextureConfigInfo normalConfig = albedoConfig;
+	normalConfig.format = VK_FORMAT_R8G8_UNORM;
+	normalConfig.isNormalMap = true;
+
+	Page page{ SkylinePacker{ size, size } };
+	page.albedo = std::make_shared<Texture>(m_device);
+	page.albedo->loadFromData(empty.data(), size, size, albedoConfig);
+	page.normal = std::make_shared<Texture>(m_device);
+	page.normal->loadFromData(empty.data(), size, size, normalConfig);
+	m_pages.push_back(std::move(page));
+}
+
+/**
+* Empties the unpinned page whose most recent use is the oldest. The page
+* textures are not cleared, as the old texels are overwritten by the sprites
+* placed next. Will throw a runtime error if every page is pinned.
+*
+* @param evicted Optional list to append the names of evicted sprites to.
+* @param pinnedPages Optional list of pages that must not be evicted.
+*
+* @return The index of the evicted page.
+*/
+uint32_t TextureAtlas::evictPage(
+	std::vector<std::string>* evicted,
+	const std::vector<uint32_t>* pinnedPages)
+{
+	std::vector<uint64_t> pageLastUse(m_pages.size(), 0);
+	for (const auto& [name, entry] : m_entries)
+	{
+		uint64_t& lastUse = pageLastUse[entry.region.page];
+		lastUse = std::max(lastUse, entry.lastUse);
+	}
+
+	std::vector<bool> pinned(m_pages.size(), false);
+	if (pinnedPages)
+	{
+		for (uint32_t pinnedPage : *pinnedPages)
+		{
+			if (pinnedPage < pinned.size()) pinned[pinnedPage] = true;
+		}
+	}
+
+	uint32_t page = UINT32_MAX;
+	for (uint32_t i = 0; i < m_pages.size(); ++i)
+	{
+		if (pinned[i]) continue;
+		if (page == UINT32_MAX || pageLastUse[i] < pageLastUse[page]) page = i;
+	}
+	if (page == UINT32_MAX)
+	{
+		throw std::runtime_error("texture atlas is full, and every page is in use");
+	}
+
+	for (auto entry = m_entries.begin(); entry != m_entries.end();)
+	{
+		if (entry->second.region.page != page)
+		{
+			++entry;
+			continue;
+		}
+		if (evicted) evicted->push_back(entry->first);
+		entry = m_entries.erase(entry);
+	}
+
+	m_pages[page].packer.reset();
+	m_pages[page].spriteCount = 0;
+	return page;
+}
+
+/**
+* Erases a sprite, resetting its page if it was the last sprite on it.
+*
+* @param entry The sprite to erase.
+*/
+void TextureAtlas::eraseEntry(std::map<std::string, Entry>::iterator entry)
+{
+	Page& page = m_pages[entry->second.region.page];
+	m_entries.erase(entry);
+	if (--page.spriteCount == 0)
+	{
+		page.packer.reset();
+	}
+}
+
+/**
+* Surrounds sprite texels with copies of their edge texels.
+*
+* @param texels Pointer to width * height RGBA texels.
+* @param width The sprite width in pixels.
+* @param height The sprite height in pixels.
+*
+* @return The padded texels.
+*/
+std::vector<uint8_t> TextureAtlas::padTexels(
+	const uint8_t* texels,
+	uint32_t width,
+	uint32_t height) const
+{
+	uint32_t padding = m_configInfo.padding;
+	uint32_t paddedWidth = width + 2 * padding;
+	uint32_t paddedHeight = height + 2 * padding;
+	std::vector<uint8_t> padded(static_cast<size_t>(paddedWidth) * paddedHeight * 4);
+
+	for (uint32_t y = 0; y < paddedHeight; ++y)
+	{
+		uint32_t srcY = std::min(std::max(y, padding) - padding, height - 1);
+		for (uint32_t x = 0; x < paddedWidth; ++x)
+		{
+			uint32_t srcX = std::min(std::max(x, padding) - padding, width - 1);
+			std::memcpy(
+				&padded[(static_cast<size_t>(y) * paddedWidth + x) * 4],
+				&texels[(static_cast<size_t>(srcY) * width + srcX) * 4],
+				4);
+		}
+	}
+	return padded;
+}
+} // namespace wrengine
\ No newline at end of file
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "Device.h"
+#include "Texture.h"
+#include "Imaging/SkylinePacker.h"
+
+#include <glm/glm.hpp>
+
+//std
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace wrengine
+{
+/**
+* Struct for texture atlas configuration options.
+*/
+struct AtlasConfigInfo
+{
+	// width and height of each page in pixels, a power of two so the pooled
+	// page images hold no unused border
+	uint32_t pageSize = 1024;
+
+	// pages are created as needed up to this count, after which the least
+	// recently used page is evicted to make room
+	uint32_t maxPages = 4;
+
+	// texels of each sprite's edge repeated around it, so filtering never
+	// samples a neighbouring sprite
+	uint32_t padding = 1;
+
+	VkFilter filterType = VK_FILTER_NEAREST;
+};
+
+/**
+* Location of a sprite in the atlas.
+*/
+struct AtlasRegion
+{
+	uint32_t page = 0;
+
+	// the sprite texels within the page, excluding padding
+	PixelRect rect{};
+
+	// the sprite as offset in xy and size in zw, in page texture coordinates
+	glm::vec4 uvRect{ 0.0f, 0.0f, 1.0f, 1.0f };
+};
+
+/**
+* Packs sprites into shared texture pages, so that sprites on one page share
+* texture slots and can be drawn together. Each page is a pair of textures, an sRGB albedo and
+* a two channel normal map, with sprites at the same place in both. Space is
+* allocated with a skyline packer. The skyline cannot free single sprites, so
+* space is reclaimed a page at a time: a page is reset once its last sprite is
+* removed, and when every page is full the least recently used page that is
+* not pinned is evicted whole. Evicted sprites must be added again before they
+* are next drawn. All methods are thread safe.
+*/
+class TextureAtlas
+{
+public:
+	TextureAtlas(Device& device, AtlasConfigInfo configInfo = AtlasConfigInfo{});
+
+	// not copyable
+	TextureAtlas(const TextureAtlas&) = delete;
+	TextureAtlas& operator=(const TextureAtlas&) = delete;
+
+	AtlasRegion add(
+		const std::string& name,
+		const uint8_t* albedo,
+		const uint8_t* normal,
+		uint32_t width,
+		uint32_t height,
+		std::vector<std::string>* evicted = nullptr,
+		const std::vector<uint32_t>* pinnedPages = nullptr);
+	bool find(const std::string& name, AtlasRegion& region);
+	void remove(const std::string& name);
+
+	// getters
+	uint32_t getMaxPages() const { return m_configInfo.maxPages; }
+	uint32_t getPageCount();
+	std::shared_ptr<Texture> getAlbedoPage(uint32_t page);
+	std::shared_ptr<Texture> getNormalPage(uint32_t page);
+
+private:
+	struct Page
+	{
+		SkylinePacker packer;
+		std::shared_ptr<Texture> albedo;
+		std::shared_ptr<Texture> normal;
+		uint32_t spriteCount = 0;
+	};
+
+	struct Entry
+	{
+		AtlasRegion region;
+		uint64_t lastUse = 0;
+	};
+
+	bool place(uint32_t width, uint32_t height, AtlasRegion& region);
+	void createPage();
+	uint32_t evictPage(
+		std::vector<std::string>* evicted,
+		const std::vector<uint32_t>* pinnedPages);
+	void eraseEntry(std::map<std::string, Entry>::iterator entry);
+	std::vector<uint8_t> padTexels(
+		const uint8_t* texels,
+		uint32_t width,
+		uint32_t height) const;
+
+	Device& m_device;
+	AtlasConfigInfo m_configInfo;
+	std::vector<Page> m_pages;
+	std::map<std::string, Entry> m_entries;
+	uint64_t m_useCounter = 0;
+	std::mutex m_mutex;
+};
+} // namespace wrengine
\ No newline at end of file
@@ -0,0 +1,65 @@
+#include "ThreadPool.h"
+
+// std
+#include <algorithm>
+
+namespace wrengine
+{
+/**
+* Starts the worker threads.
+*
+* @param threadCount Number of workers to start. A value of zero uses the
+* number of hardware threads, with a minimum of one.
+*/
+ThreadPool::ThreadPool(uint32_t threadCount)
+{
+	if (threadCount == 0)
+	{
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	m_workers.reserve(threadCount);
+	for (uint32_t i = 0; i < threadCount; ++i)
+	{
+		m_workers.emplace_back(&ThreadPool::workerLoop, this);
+	}
+}
+
+/**
+* Finishes all queued jobs and joins the worker threads.
+*/
+ThreadPool::~ThreadPool()
+{
+	{
+		std::scoped_lock<std::mutex> lock(m_queueMutex);
+		m_stopping = true;
+	}
+	m_condition.notify_all();
+
+	for (auto& worker : m_workers)
+	{
+		worker.join();
+	}
+}
+
+/**
+* Worker thread body. Blocks until a job is available, or until the pool is
+* stopping and the queue has drained.
+*/
+void ThreadPool::workerLoop()
+{
+	while (true)
+	{
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(m_queueMutex);
+			m_condition.wait(lock, [this] { return m_stopping || !m_jobs.empty(); });
+			if (m_stopping && m_jobs.empty()) return;
+
+			job = std::move(m_jobs.front());
+			m_jobs.pop();
+		}
+		job();
+	}
+}
+} // namespace wrengine
\ No newline at end of file
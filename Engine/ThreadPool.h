@@ -0,0 +1,69 @@
+#pragma once
+
+//std
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <type_traits>
+
+namespace wrengine
+{
+/**
+* Fixed size pool of worker threads. Jobs are run in submission order by the
+* first idle worker, and submission returns a future for the job result, so
+* jobs can be queued and waited on from any thread. Worker threads live for the
+* lifetime of the pool, which keeps any per-thread state (such as command pools)
+* bounded by the pool size.
+*/
+class ThreadPool
+{
+public:
+	ThreadPool(uint32_t threadCount = 0);
+	~ThreadPool();
+
+	// not copyable or movable
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+	ThreadPool(ThreadPool&&) = delete;
+	ThreadPool& operator=(ThreadPool&&) = delete;
+
+	/**
+	* Queues a callable to be run on a worker thread. Exceptions thrown by the
+	* job are stored in the returned future.
+	*
+	* @param job Callable taking no arguments.
+	*
+	* @return Future holding the result of the job.
+	*/
+	template<typename F>
+	auto submit(F&& job) -> std::future<std::invoke_result_t<std::decay_t<F>>>
+	{
+		using ResultType = std::invoke_result_t<std::decay_t<F>>;
+		auto task = std::make_shared<std::packaged_task<ResultType()>>(
+			std::forward<F>(job));
+		std::future<ResultType> result = task->get_future();
+		{
+			std::scoped_lock<std::mutex> lock(m_queueMutex);
+			m_jobs.emplace([task]() { (*task)(); });
+		}
+		m_condition.notify_one();
+		return result;
+	}
+
+	uint32_t size() const { return static_cast<uint32_t>(m_workers.size()); }
+
+private:
+	void workerLoop();
+
+	std::vector<std::thread> m_workers;
+	std::queue<std::function<void()>> m_jobs;
+	std::mutex m_queueMutex;
+	std::condition_variable m_condition;
+	bool m_stopping = false;
+};
+} // namespace wrengine
\ No newline at end of file
@@ -0,0 +1,163 @@
+#include "Tilemap.h"
+
+// std
+#include <cstring>
+#include <stdexcept>
+
+namespace wrengine
+{
+/**
+* Sets the tileset textures. Tiles are read from the images row by row, so the
+* first tile is at the top left. Will throw a runtime error if the image holds
+* no whole tile.
+*
+* @param albedo Pointer to width * height R8G8B8A8 texels.
+* @param normal Pointer to width * height R8G8B8A8 encoded normals, or nullptr for
+* flat normals.
+* @param width The tileset image width in pixels.
+* @param height The tileset image height in pixels.
+* @param tileWidth The width of each tile in pixels.
+* @param tileHeight The height of each tile in pixels.
+*/
+void Tilemap::setTileset(
+	const uint8_t* albedo,
+	const uint8_t* normal,
+	uint32_t width,
+	uint32_t height,
+	uint32_t tileWidth,
+	uint32_t tileHeight)
+{
+	if (tileWidth == 0 || tileHeight == 0 || tileWidth > 0xFFFF || tileHeight > 0xFFFF ||
+		width < tileWidth || height < tileHeight)
+	{
+		throw std::runtime_error("tileset holds no whole tile!");
+	}
+
+	std::vector<uint8_t> flatNormals;
+	if (!normal)
+	{
+		const uint8_t flat[4] = { 128, 128, 255, 255 };
+		flatNormals.resize(static_cast<size_t>(width) * height * 4);
+		for (size_t i = 0; i < flatNormals.size(); i += 4)
+		{
+			std::memcpy(&flatNormals[i], flat, 4);
+		}
+		normal = flatNormals.data();
+	}
+
+	// tiles are fetched texel by texel, so neither filtering nor mips are used
+	TextureConfigInfo albedoConfig{};
+	albedoConfig.filterType = VK_FILTER_NEAREST;
+	albedoConfig.generateMipmaps = false;
+
+	TextureConfigInfo normalConfig = albedoConfig;
+	normalConfig.format = VK_FORMAT_R8G8_UNORM;
+	normalConfig.isNormalMap = true;
+
+	writeTexture(m_albedoTileset, albedo, width, height, albedoConfig);
+	writeTexture(m_normalTileset, normal, width, height, normalConfig);
+
+	m_tileWidth = tileWidth;
+	m_tileHeight = tileHeight;
+	m_tilesetColumns = width / tileWidth;
+}
+
+/**
+* Replaces the whole grid, which may change size. Only the region that differs
+* from the current grid is uploaded when the size is unchanged.
+*
+* @param tiles Pointer to columns * rows tile values, row by row.
+* @param columns The grid width in tiles.
+* @param rows The grid height in tiles.
+*/
+void Tilemap::setTiles(const uint32_t* tiles, uint32_t columns, uint32_t rows)
+{
+	if (columns == 0 || rows == 0)
+	{
+		throw std::runtime_error("tilemap grid is empty!");
+	}
+
+	m_gridData.resize(static_cast<size_t>(columns) * rows * 4);
+	for (size_t i = 0; i < static_cast<size_t>(columns) * rows; ++i)
+	{
+		encodeTile(tiles[i], &m_gridData[i * 4]);
+	}
+
+	TextureConfigInfo gridConfig{};
+	gridConfig.filterType = VK_FILTER_NEAREST;
+	gridConfig.format = VK_FORMAT_R8G8B8A8_UNORM;
+	gridConfig.generateMipmaps = false;
+	writeTexture(m_tileGrid, m_gridData.data(), columns, rows, gridConfig);
+
+	m_columns = columns;
+	m_rows = rows;
+}
+
+/**
+* Changes single cells of the grid, uploading the region covering them. Edits
+* outside the grid are ignored.
+*
+* @param edits The cells to change.
+*/
+void Tilemap::editTiles(const std::vector<TileEdit>& edits)
+{
+	if (!m_tileGrid) return;
+
+	for (const TileEdit& edit : edits)
+	{
+		if (edit.x >= m_columns || edit.y >= m_rows) continue;
+		encodeTile(
+			edit.tile,
+			&m_gridData[(static_cast<size_t>(edit.y) * m_columns + edit.x) * 4]);
+	}
+
+	// the texture diffs against its last upload, so only edited cells are sent
+	m_tileGrid->updateTextureData(m_gridData.data());
+}
+
+/**
+* Encodes a tile value as a grid texel, the index in red and green and the flip
+* flags in the low bits of blue. Indices past MAX_TILES are drawn as empty.
+*/
+void Tilemap::encodeTile(uint32_t tile, uint8_t* texel)
+{
+	uint32_t index = tile & TILE_INDEX_MASK;
+	if (index >= MAX_TILES) index = 0;
+
+	texel[0] = static_cast<uint8_t>(index & 0xFF);
+	texel[1] = static_cast<uint8_t>(index >> 8);
+	texel[2] = static_cast<uint8_t>(
+		((tile & TILE_FLIP_X) ? 1 : 0) |
+		((tile & TILE_FLIP_Y) ? 2 : 0) |
+		((tile & TILE_FLIP_DIAGONAL) ? 4 : 0));
+	texel[3] = 255;
+}
+
+/**
+* Creates a texture on first use, or updates it with data that may have a
+* different size.
+*/
+void Tilemap::writeTexture(
+	std::shared_ptr<Texture>& texture,
+	const uint8_t* data,
+	uint32_t width,
+	uint32_t height,
+	TextureConfigInfo configInfo)
+{
+	if (!texture)
+	{
+		texture = std::make_shared<Texture>(m_device);
+		texture->loadFromData(
+			const_cast<uint8_t*>(data),
+			static_cast<int>(width),
+			static_cast<int>(height),
+			configInfo);
+		return;
+	}
+
+	texture->updateTextureData(
+		const_cast<uint8_t*>(data),
+		static_cast<int>(width),
+		static_cast<int>(height));
+}
+} // namespace wrengine
\ No newline at end of file
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "Device.h"
+#include "Texture.h"
+
+//std
+#include <memory>
+#include <vector>
+
+namespace wrengine
+{
+/**
+* A change to a single cell of a tilemap.
+*/
+struct TileEdit
+{
+	uint32_t x = 0;
+	uint32_t y = 0;
+
+	// tile index and flip flags, as stored by aseprite
+	uint32_t tile = 0;
+};
+
+/**
+* A grid of tile indices drawn from a tileset, so that the map is uploaded as a
+* few bytes per cell rather than as a full canvas. The tileset is a texture
+* pair, albedo and a parallel normal map, with tiles laid out row by row. The
+* grid is an RGBA8 texture holding a 16 bit tile index in red and green, and
+* the flip flags in blue, looked up per fragment when the map is drawn. Tile 0
+* is empty, as in aseprite. Editing cells only uploads the region of the grid
+* that changed. Should be used from the thread running the engine.
+*/
+class Tilemap
+{
+public:
+	// tile value layout, matching aseprite tilemap images
+	static constexpr uint32_t TILE_INDEX_MASK = 0x1FFFFFFF;
+	static constexpr uint32_t TILE_FLIP_X = 0x80000000;
+	static constexpr uint32_t TILE_FLIP_Y = 0x40000000;
+	static constexpr uint32_t TILE_FLIP_DIAGONAL = 0x20000000;
+
+	// tile indices are stored in 16 bits of the grid texture
+	static constexpr uint32_t MAX_TILES = 65536;
+
+	Tilemap(Device& device) : m_device{ device } {}
+
+	// not copyable
+	Tilemap(const Tilemap&) = delete;
+	Tilemap& operator=(const Tilemap&) = delete;
+
+	void setTileset(
+		const uint8_t* albedo,
+		const uint8_t* normal,
+		uint32_t width,
+		uint32_t height,
+		uint32_t tileWidth,
+		uint32_t tileHeight);
+	void setTiles(const uint32_t* tiles, uint32_t columns, uint32_t rows);
+	void editTiles(const std::vector<TileEdit>& edits);
+	bool isReady() const { return m_albedoTileset && m_tileGrid; }
+
+	// getters
+	uint32_t getColumns() const { return m_columns; }
+	uint32_t getRows() const { return m_rows; }
+	uint32_t getTileWidth() const { return m_tileWidth; }
+	uint32_t getTileHeight() const { return m_tileHeight; }
+	uint32_t getTilesetColumns() const { return m_tilesetColumns; }
+	std::shared_ptr<Texture> getTileGrid() const { return m_tileGrid; }
+	std::shared_ptr<Texture> getAlbedoTileset() const { return m_albedoTileset; }
+	std::shared_ptr<Texture> getNormalTileset() const { return m_normalTileset; }
+
+private:
+	static void encodeTile(uint32_t tile, uint8_t* texel);
+	void writeTexture(
+		std::shared_ptr<Texture>& texture,
+		const uint8_t* data,
+		uint32_t width,
+		uint32_t height,
+		TextureConfigInfo configInfo);
+
+	Device& m_device;
+
+	uint32_t m_columns = 0;
+	uint32_t m_rows = 0;
+	uint32_t m_tileWidth = 0;
+	uint32_t m_tileHeight = 0;
+	uint32_t m_tilesetColumns = 0;
+
+	// encoded grid, kept to apply edits to
+	std::vector<uint8_t> m_gridData;
+
+	std::shared_ptr<Texture> m_tileGrid;
+	std::shared_ptr<Texture> m_albedoTileset;
+	std::shared_ptr<Texture> m_normalTileset;
+};
+} // namespace wrengine
\ No newline at end of file
@@ -0,0 +1,200 @@
+#include "TilemapSystem.h"
+#include "Tilemap.h"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+// std
+#include <stdexcept>
+#include <vector>
+
+/**
+* Push constants for a tilemap layer. textures holds the bindless table slots
+* of the grid, albedo tileset and normal tileset, and the shader config in w.
+* tiling holds the grid columns and rows, the tile width and height packed as
+* 16 bits each, and the number of tiles across the tileset.
+*/
+struct TilemapPushConstantData
+{
+	glm::mat4 model{ 1.0f };
+	glm::vec4 normalsTransform = { 1.0f, -1.0f, 1.0f, 0.0f };
+	glm::uvec4 textures{ 0 };
+	glm::uvec4 tiling{ 0 };
+};
+
+// the minimum push constant size every device supports
+static_assert(sizeof(TilemapPushConstantData) <= 128, "push constants are too large");
+
+namespace wrengine
+{
+TilemapSystem::TilemapSystem(
+	Device& device,
+	VkRenderPass renderPass,
+	VkDescriptorSetLayout globalSetLayout,
+	BindlessTextureTable& textureTable,
+	std::shared_ptr<Scene> activeScene) :
+	m_device{ device },
+	m_textureTable{ textureTable },
+	m_activeScene{ activeScene }
+{
+	createPipelineLayout(globalSetLayout);
+	createPipeline(renderPass);
+	m_quadModel = Model::createQuad(m_device);
+}
+
+TilemapSystem::~TilemapSystem()
+{
+	vkDestroyPipelineLayout(m_device.device(), m_pipelineLayout, nullptr);
+}
+
+void TilemapSystem::updateNormalCoords(glm::vec3 scales)
+{
+	m_normalCoordScales = scales;
+}
+
+/**
+* Creates a pipeline layout using the global set and the bindless texture
+* table set.
+* 
+* @param globalSetLayout The current global descriptor set layout.
+*/
+void TilemapSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayout)
+{
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags =
+		VK_SHADER_STAGE_VERTEX_BIT |
+		VK_SHADER_STAGE_FRAGMENT_BIT;
+	pushConstantRange.size = sizeof(TilemapPushConstantData);
+
+	std::vector<VkDescriptorSetLayout> descriptorSetLayout{
+		globalSetLayout,
+		m_textureTable.getSetLayout()
+	};
+
+	VkPipelineLayoutCreateInfo createInfo{};
+	createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	createInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayout.size());
+	createInfo.pSetLayouts = descriptorSetLayout.data();
+	createInfo.pushConstantRangeCount = 1;
+	createInfo.pPushConstantRanges = &pushConstantRange;
+
+	if (vkCreatePipelineLayout(
+		m_device.device(),
+		&createInfo,
+		nullptr,
+		&m_pipelineLayout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create tilemap pipeline layout!");
+	}
+}
+
+/**
+* Creates the tilemap pipeline, blending as sprites do.
+* 
+* @param renderPass The render pass object to use in pipeline configuration.
+*/
+void TilemapSystem::createPipeline(VkRenderPass renderPass)
+{
+	assert(m_pipelineLayout != nullptr &&
+		"cannot create pipeline before pipeline layout!");
+
+	PipelineConfigInfo pipelineConfig{};
+	Pipeline::defaultPipelineConfigInfo(pipelineConfig);
+	pipelineConfig.colorBlendAttachment.blendEnable = VK_TRUE;
+	pipelineConfig.colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+	pipelineConfig.colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_DST_ALPHA;
+	pipelineConfig.renderPass = renderPass;
+	pipelineConfig.pipelineLayout = m_pipelineLayout;
+	m_pipeline = std::make_unique<Pipeline>(
+		m_device,
+		"shaders/tilemap.vert.spv",
+		"shaders/tilemap.frag.spv",
+		pipelineConfig);
+}
+
+/**
+* Records a draw for each tilemap layer in the scene that has both a tileset
+* and a grid.
+* 
+* @param frameInfo Structure describing relevent current frame information.
+*/
+void TilemapSystem::renderTilemaps(const FrameInfo& frameInfo)
+{
+	auto activeSceneLock = m_activeScene.lock();
+	if (!activeSceneLock)
+	{
+		throw std::runtime_error("can't render tilemaps without active scene!");
+	}
+
+	auto tilemapView = activeSceneLock->getAllEntitiesWith<
+		TransformComponent,
+		TilemapComponent>();
+
+	// the pipeline is only bound once there is a layer to draw
+	bool bound = false;
+	for (auto&& [entity, transform, render] : tilemapView.each())
+	{
+		const auto& tilemap = render.tilemap;
+		if (!tilemap || !tilemap->isReady()) continue;
+
+		if (!bound)
+		{
+			m_pipeline->bind(frameInfo.commandBuffer);
+
+			VkDescriptorSet descriptorSets[] = {
+				frameInfo.globalDescriptorSet,
+				m_textureTable.getDescriptorSet()
+			};
+			vkCmdBindDescriptorSets(
+				frameInfo.commandBuffer,
+				VK_PIPELINE_BIND_POINT_GRAPHICS,
+				m_pipelineLayout,
+				0, 2,
+				descriptorSets,
+				0, nullptr);
+
+			m_quadModel->bind(frameInfo.commandBuffer);
+			bound = true;
+		}
+
+		uint32_t tileWidth = tilemap->getTileWidth();
+		uint32_t tileHeight = tilemap->getTileHeight();
+		glm::vec3 size{
+			static_cast<float>(tilemap->getColumns() * tileWidth),
+			static_cast<float>(tilemap->getRows() * tileHeight),
+			1.0f };
+
+		glm::mat4 model = glm::translate(glm::mat4{ 1.0f }, transform.translation);
+		model = glm::scale(model, transform.scale * size);
+		model = glm::rotate(model, transform.rotation.y, glm::vec3{ 0.0f, 1.0f, 0.0f });
+		model = glm::rotate(model, transform.rotation.x, glm::vec3{ 1.0f, 0.0f, 0.0f });
+		model = glm::rotate(model, transform.rotation.z, glm::vec3{ 0.0f, 0.0f, 1.0f });
+
+		TilemapPushConstantData push{};
+		push.model = model;
+		push.normalsTransform = glm::vec4{ m_normalCoordScales, 0.0f };
+		push.textures = glm::uvec4{
+			m_textureTable.acquire(tilemap->getTileGrid()),
+			m_textureTable.acquire(tilemap->getAlbedoTileset()),
+			m_textureTable.acquire(tilemap->getNormalTileset()),
+			static_cast<uint32_t>(render.shaderConfig) };
+		push.tiling = glm::uvec4{
+			tilemap->getColumns(),
+			tilemap->getRows(),
+			tileWidth | (tileHeight << 16),
+			tilemap->getTilesetColumns() };
+
+		vkCmdPushConstants(
+			frameInfo.commandBuffer,
+			m_pipelineLayout,
+			VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+			0,
+			sizeof(TilemapPushConstantData),
+			&push);
+
+		m_quadModel->draw(frameInfo.commandBuffer);
+	}
+}
+} // namespace wrengine
\ No newline at end of file
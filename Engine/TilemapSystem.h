@@ -0,0 +1,63 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include "Device.h"
+#include "Pipeline.h"
+#include "Model.h"
+#include "FrameInfo.h"
+#include "BindlessTextureTable.h"
+#include "Scene/Scene.h"
+
+//std
+#include <memory>
+
+namespace wrengine
+{
+/**
+* Draws tilemap layers. Each layer is a single quad, and the tile under each
+* fragment is looked up from the tilemap grid texture in the shader, so a
+* layer costs one draw however many tiles it has.
+*/
+class TilemapSystem
+{
+public:
+	TilemapSystem(
+		Device& device,
+		VkRenderPass renderPass,
+		VkDescriptorSetLayout globalSetLayout,
+		BindlessTextureTable& textureTable,
+		std::shared_ptr<Scene> activeScene);
+
+	~TilemapSystem();
+
+	// should not copy
+	TilemapSystem(const TilemapSystem&) = delete;
+	TilemapSystem& operator=(const TilemapSystem&) = delete;
+
+	// interface
+	void renderTilemaps(const FrameInfo& frameInfo);
+	void updateNormalCoords(glm::vec3 scales);
+
+private:
+	// helper functions
+	void createPipelineLayout(VkDescriptorSetLayout globalSetLayout);
+	void createPipeline(VkRenderPass renderPass);
+
+	// vulkan/glfw structures
+	Device& m_device;
+	std::unique_ptr<Pipeline> m_pipeline;
+	VkPipelineLayout m_pipelineLayout;
+
+	// tilemap textures take their slots from the bindless table when drawn
+	BindlessTextureTable& m_textureTable;
+
+	// scene to render
+	std::weak_ptr<Scene> m_activeScene;
+
+	std::unique_ptr<Model> m_quadModel;
+
+	// normal coordinates
+	glm::vec3 m_normalCoordScales{ 1.0f, -1.0f, 1.0f };
+};
+} // namespace wrengine
\ No newline at end of file
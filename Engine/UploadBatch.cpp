@@ -0,0 +1,66 @@
+#include "UploadBatch.h"
+
+namespace wrengine
+{
+/**
+* Submits any uploads that are still recorded.
+*/
+UploadBatch::~UploadBatch()
+{
+	submit();
+}
+
+/**
+* Gets the command buffer to record uploads into. This is the frame's command
+* buffer if the batch was given one, otherwise a new command buffer is begun
+* from the thread command pool if the batch is empty.
+*
+* @return The recording command buffer.
+*/
+VkCommandBuffer UploadBatch::getCommandBuffer()
+{
+	if (m_commandBuffer == VK_NULL_HANDLE)
+	{
+		m_commandBuffer = m_frameCommandBuffer != VK_NULL_HANDLE ?
+			m_frameCommandBuffer :
+			m_device.beginSingleTimeCommands();
+	}
+	return m_commandBuffer;
+}
+
+/**
+* Hands a staging buffer referenced by recorded commands to the batch, which
+* keeps it alive until the batch has been submitted and completed.
+*
+* @param stagingBuffer The staging buffer.
+*/
+void UploadBatch::addStagingBuffer(std::unique_ptr<Buffer> stagingBuffer)
+{
+	m_stagedBytes += stagingBuffer->getBufferSize();
+	m_stagingBuffers.push_back(std::move(stagingBuffer));
+}
+
+/**
+* Submits the recorded uploads and waits for them to complete, then releases
+* the staging buffers. Uploads recorded into a frame's command buffer are left
+* for the frame to submit, and their staging buffers are released through the
+* deletion queue once the frame completes. The batch can be reused afterwards.
+*/
+void UploadBatch::submit()
+{
+	if (m_commandBuffer == VK_NULL_HANDLE) return;
+
+	VkCommandBuffer commandBuffer = m_commandBuffer;
+	m_commandBuffer = VK_NULL_HANDLE;
+	if (commandBuffer != m_frameCommandBuffer)
+	{
+		m_device.endSingleTimeCommands(commandBuffer);
+	}
+
+	// buffers retire themselves on destruction, so are kept until every frame
+	// that may read them has finished
+
+	m_stagingBuffers.clear();
+	m_stagedBytes = 0;
+}
+} // namespace wrengine
\ No newline at end of file
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "Device.h"
+#include "Buffer.h"
+
+//std
+#include <memory>
+#include <vector>
+
+namespace wrengine
+{
+/**
+* Records uploads from several resources into one command buffer, so that they
+* share a single submission and fence wait rather than one each. Staging
+* buffers are held by the batch until the submission completes. A batch may
+* instead record into a frame's command buffer, in which case submitting only
+* hands the staging buffers to the device deletion queue, and the uploads run
+* with the frame. A batch is recorded and submitted on a single thread.
+*/
+class UploadBatch
+{
+public:
+	UploadBatch(Device& device) : m_device{ device } {}
+	UploadBatch(Device& device, VkCommandBuffer frameCommandBuffer) :
+		m_device{ device },
+		m_frameCommandBuffer{ frameCommandBuffer } {}
+	~UploadBatch();
+
+	// not copyable
+	UploadBatch(const UploadBatch&) = delete;
+	UploadBatch& operator=(const UploadBatch&) = delete;
+
+	VkCommandBuffer getCommandBuffer();
+	void addStagingBuffer(std::unique_ptr<Buffer> stagingBuffer);
+	void submit();
+
+	// getters
+	VkDeviceSize getStagedBytes() const { return m_stagedBytes; }
+	bool isEmpty() const { return m_commandBuffer == VK_NULL_HANDLE; }
+
+private:
+	Device& m_device;
+	VkCommandBuffer m_commandBuffer = VK_NULL_HANDLE;
+
+	// recorded into instead of a single time command buffer if set
+	VkCommandBuffer m_frameCommandBuffer = VK_NULL_HANDLE;
+	std::vector<std::unique_ptr<Buffer>> m_stagingBuffers;
+	VkDeviceSize m_stagedBytes = 0;
+};
+} // namespace wrengine
\ No newline at end of file
@@ -63,7 +63,7 @@ UserInterface::UserInterface(
    initInfo.Device = m_device.device();
    initInfo.QueueFamily = m_device.getGraphicsQueueFamily();
    initInfo.Queue = m_device.graphicsQueue();
-   initInfo.PipelineCache = VK_NULL_HANDLE; //  pipeline cache is a potential optimisation, ignore for now
+   initInfo.PipelineCache = m_device.getPipelineCache().getCache();
    initInfo.DescriptorPool = m_descriptorPool;
    initInfo.Allocator = VK_NULL_HANDLE; // not using an allocator yet
    initInfo.MinImageCount = 2;
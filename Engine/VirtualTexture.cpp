@@ -0,0 +1,519 @@
+#include "VirtualTexture.h"
+
+#include "Imaging/MipChain.h"
+
+// std
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+
+namespace wrengine
+{
+/**
+* Splits a canvas into tiles and builds its mip chain, then uploads the
+* coarsest tile. Will throw a runtime error if the data does not match the
+* size, or the cache cannot hold a tile.
+*
+* @param device The device to create the cache and page table on.
+* @param albedo width * height RGBA texels, moved into the texture.
+* @param normal width * height RGB encoded normals, or empty for flat normals.
+* @param width The canvas width in pixels.
+* @param height The canvas height in pixels.
+* @param feedbackOffset The first word of the texture's range of the feedback
+* buffer, see feedbackWordCount.
+* @param configInfo Virtual texture configuration options.
+*/
+VirtualTexture::VirtualTexture(
+	Device& device,
+	std::vector<uint8_t> albedo,
+	std::vector<uint8_t> normal,
+	uint32_t width,
+	uint32_t height,
+	uint32_t feedbackOffset,
+	VirtualTextureConfigInfo configInfo) :
+	m_device{ device },
+	m_configInfo{ configInfo },
+	m_width{ width },
+	m_height{ height },
+	m_feedbackOffset{ feedbackOffset }
+{
+	size_t size = static_cast<size_t>(width) * height * 4;
+	if (width == 0 || height == 0 ||
+		albedo.size() != size ||
+		(!normal.empty() && normal.size() != size))
+	{
+		throw std::runtime_error("virtual texture data does not match its size!");
+	}
+
+	// slot coordinates are stored as bytes in the page table
+	m_slotsPerRow = std::min(m_configInfo.cacheSize / SLOT_SIZE, 256u);
+	if (m_slotsPerRow == 0)
+	{
+		throw std::runtime_error("virtual texture cache is smaller than a tile!");
+	}
+	m_configInfo.maxUploadsPerFrame = std::max(m_configInfo.maxUploadsPerFrame, 1u);
+
+	createLevels(std::move(albedo), std::move(normal));
+	createTextures();
+
+	// the coarsest level is a single tile, the fallback for every other tile
+	UploadBatch batch{ m_device };
+	uploadTile(static_cast<uint32_t>(m_tiles.size()) - 1, allocateSlot(), batch);
+	updatePageTable(batch);
+	batch.submit();
+}
+
+/**
+* Streams the tiles drawn by a finished frame that are not yet resident. Tiles
+* are uploaded coarsest level first, up to maxUploadsPerFrame, each replacing
+* the least recently used tile that the frame did not draw. The page table is
+* updated in the same batch, so later frames see the new tiles.
+*
+* @param feedback The texture's range of the feedback buffer of the frame.
+* @param batch The batch to record the uploads into.
+*/
+void VirtualTexture::processFeedback(const uint32_t* feedback, UploadBatch& batch)
+{
+	++m_frame;
+
+	std::vector<uint32_t> missing;
+	uint32_t tileCount = static_cast<uint32_t>(m_tiles.size());
+	for (uint32_t word = 0; word < getFeedbackWordCount(); ++word)
+	{
+		for (uint32_t bits = feedback[word]; bits != 0; bits &= bits - 1)
+		{
+			uint32_t bit = 0;
+			while (!(bits & (1u << bit))) ++bit;
+
+			uint32_t tile = word * 32 + bit;
+			if (tile >= tileCount) break;
+
+			// the tile, or the ancestor drawn in its place, is in use
+			uint32_t drawn = tile;
+			while (m_tiles[drawn].slot == NO_SLOT) drawn = parentTile(drawn);
+			m_tiles[drawn].lastUse = m_frame;
+			if (drawn != tile) missing.push_back(tile);
+		}
+	}
+	if (missing.empty()) return;
+
+	// tiles are numbered from the finest level, so the coarsest come last
+	std::sort(missing.begin(), missing.end(), std::greater<uint32_t>());
+
+	uint32_t uploads = 0;
+	for (uint32_t tile : missing)
+	{
+		if (uploads == m_configInfo.maxUploadsPerFrame) break;
+
+		uint32_t slot = allocateSlot();
+		if (slot == NO_SLOT) break;
+
+		uploadTile(tile, slot, batch);
+		m_tiles[tile].lastUse = m_frame;
+		uploads++;
+	}
+
+	if (uploads > 0) updatePageTable(batch);
+}
+
+/**
+* Gets the size of the range of the feedback buffer used by a virtual texture
+* of the given size, one bit per tile of every level.
+*
+* @param width The canvas width in pixels.
+* @param height The canvas height in pixels.
+*
+* @return The number of 32 bit feedback words.
+*/
+uint32_t VirtualTexture::feedbackWordCount(uint32_t width, uint32_t height)
+{
+	uint32_t gridWidth;
+	uint32_t gridHeight;
+	uint32_t levelCount;
+	tileGrid(width, height, gridWidth, gridHeight, levelCount);
+
+	uint32_t tileCount = 0;
+	for (uint32_t level = 0; level < levelCount; ++level)
+	{
+		tileCount += std::max(gridWidth >> level, 1u) * std::max(gridHeight >> level, 1u);
+	}
+	return (tileCount + 31) / 32;
+}
+
+/**
+* Gets the scale from quad texture coordinates to the canvas, as the tile grid
+* may extend past it.
+*
+* @return UV scale of the canvas.
+*/
+glm::vec2 VirtualTexture::getUVScale() const
+{
+	return glm::vec2{
+		static_cast<float>(m_width) / (m_levels[0].gridWidth * TILE_SIZE),
+		static_cast<float>(m_height) / (m_levels[0].gridHeight * TILE_SIZE)
+	};
+}
+
+/**
+* Packs the page table slot and the tile grid size for the fragment shader.
+*
+* @param pageTableIndex The bindless table slot of the page table.
+*
+* @return The slot in the low 16 bits, then the log2 of the grid width and
+* height in 4 bits each.
+*/
+uint32_t VirtualTexture::getShaderInfo(uint32_t pageTableIndex) const
+{
+	uint32_t log2Width = 0;
+	uint32_t log2Height = 0;
+	while ((1u << log2Width) < m_levels[0].gridWidth) ++log2Width;
+	while ((1u << log2Height) < m_levels[0].gridHeight) ++log2Height;
+
+	return (pageTableIndex & 0xFFFF) | (log2Width << 16) | (log2Height << 20);
+}
+
+uint32_t VirtualTexture::getFeedbackWordCount() const
+{
+	return static_cast<uint32_t>((m_tiles.size() + 31) / 32);
+}
+
+uint32_t VirtualTexture::getResidentTileCount() const
+{
+	return static_cast<uint32_t>(m_slotTiles.size() - m_freeSlots.size());
+}
+
+/**
+* Finds the power of two tile grid covering a canvas, and the number of levels
+* down to a single tile. Will throw a runtime error if the grid is too large
+* for the shader info.
+*/
+void VirtualTexture::tileGrid(
+	uint32_t width,
+	uint32_t height,
+	uint32_t& gridWidth,
+	uint32_t& gridHeight,
+	uint32_t& levelCount)
+{
+	uint32_t tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+	uint32_t tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+
+	gridWidth = 1;
+	gridHeight = 1;
+	levelCount = 1;
+	while (gridWidth < tilesX) gridWidth <<= 1;
+	while (gridHeight < tilesY) gridHeight <<= 1;
+	while ((1u << (levelCount - 1)) < std::max(gridWidth, gridHeight)) ++levelCount;
+
+	if (levelCount > 16)
+	{
+		throw std::runtime_error("virtual texture is too large!");
+	}
+}
+
+/**
+* Builds the mip chain and lays out the tiles and page table of each level.
+* Levels past the first are packed in a column to the right of the first in
+* the page table.
+*
+* @param albedo The level 0 albedo texels.
+* @param normal The level 0 normals, or empty.
+*/
+void VirtualTexture::createLevels(
+	std::vector<uint8_t> albedo,
+	std::vector<uint8_t> normal)
+{
+	uint32_t gridWidth;
+	uint32_t gridHeight;
+	uint32_t levelCount;
+	tileGrid(m_width, m_height, gridWidth, gridHeight, levelCount);
+
+	m_levels.resize(levelCount);
+	uint32_t firstTile = 0;
+	uint32_t pageTableY = 0;
+	for (uint32_t i = 0; i < levelCount; ++i)
+	{
+		Level& level = m_levels[i];
+		level.width = mipExtent(m_width, i);
+		level.height = mipExtent(m_height, i);
+		level.gridWidth = std::max(gridWidth >> i, 1u);
+		level.gridHeight = std::max(gridHeight >> i, 1u);
+		level.firstTile = firstTile;
+		firstTile += level.gridWidth * level.gridHeight;
+
+		if (i > 0)
+		{
+			level.pageTableX = gridWidth;
+			level.pageTableY = pageTableY;
+			pageTableY += level.gridHeight;
+		}
+	}
+	m_tiles.resize(firstTile);
+
+	m_pageTableWidth = gridWidth + (levelCount > 1 ? m_levels[1].gridWidth : 0);
+	m_pageTableHeight = std::max(gridHeight, pageTableY);
+	m_pageTableData.assign(
+		static_cast<size_t>(m_pageTableWidth) * m_pageTableHeight * 4, 0);
+
+	m_levels[0].albedo = std::move(albedo);
+	m_levels[0].normal = std::move(normal);
+	for (uint32_t i = 1; i < levelCount; ++i)
+	{
+		const Level& source = m_levels[i - 1];
+		Level& level = m_levels[i];
+		PixelRect rect{ 0, 0, level.width, level.height };
+		size_t size = static_cast<size_t>(level.width) * level.height * 4;
+
+		level.albedo.resize(size);
+		downsampleRGBA8(
+			source.albedo.data(), source.width, source.height,
+			level.albedo.data(), level.width, rect, true);
+
+		// averaged normals are renormalized when packed into the cache
+		if (source.normal.empty()) continue;
+		level.normal.resize(size);
+		downsampleRGBA8(
+			source.normal.data(), source.width, source.height,
+			level.normal.data(), level.width, rect, false);
+	}
+}
+
+/**
+* Creates the empty cache textures and page table. None have mip maps, as the
+* levels are held as tiles.
+*/
+void VirtualTexture::createTextures()
+{
+	uint32_t size = m_configInfo.cacheSize;
+	std::vector<uint8_t> empty(static_cast<size_t>(size) * size * 4, 0);
+
+	TextureConfigInfo albedoConfig{};
+	albedoConfig.filterType = m_configInfo.filterType;
+	albedoConfig.generateMipmaps = false;
+
+	TextureConfigInfo normalConfig = albedoConfig;
+	normalConfig.format = VK_FORMAT_R8G8_UNORM;
+	normalConfig.isNormalMap = true;
+
+	m_albedoCache = std::make_shared<Texture>(m_device);
+	m_albedoCache->loadFromData(empty.data(), size, size, albedoConfig);
+	m_normalCache = std::make_shared<Texture>(m_device);
+	m_normalCache->loadFromData(empty.data(), size, size, normalConfig);
+
+	// entries are read with texelFetch, so are never filtered
+	TextureConfigInfo pageTableConfig{};
+	pageTableConfig.filterType = VK_FILTER_NEAREST;
+	pageTableConfig.format = VK_FORMAT_R8G8B8A8_UNORM;
+	pageTableConfig.generateMipmaps = false;
+
+	m_pageTable = std::make_shared<Texture>(m_device);
+	m_pageTable->loadFromData(
+		m_pageTableData.data(),
+		m_pageTableWidth,
+		m_pageTableHeight,
+		pageTableConfig);
+
+	uint32_t slotCount = m_slotsPerRow * m_slotsPerRow;
+	m_slotTiles.assign(slotCount, NO_TILE);
+	m_freeSlots.clear();
+	for (uint32_t slot = slotCount; slot-- > 0;)
+	{
+		m_freeSlots.push_back(slot);
+	}
+}
+
+uint32_t VirtualTexture::tileLevel(uint32_t tile) const
+{
+	uint32_t level = 0;
+	while (level + 1 < m_levels.size() && m_levels[level + 1].firstTile <= tile)
+	{
+		++level;
+	}
+	return level;
+}
+
+/**
+* Gets the tile of the next level covering a tile.
+*
+* @param tile The tile.
+*
+* @return The parent tile, or NO_TILE for the coarsest tile.
+*/
+uint32_t VirtualTexture::parentTile(uint32_t tile) const
+{
+	uint32_t level = tileLevel(tile);
+	if (level + 1 == m_levels.size()) return NO_TILE;
+
+	const Level& current = m_levels[level];
+	const Level& parent = m_levels[level + 1];
+	uint32_t local = tile - current.firstTile;
+	uint32_t x = std::min((local % current.gridWidth) >> 1, parent.gridWidth - 1);
+	uint32_t y = std::min((local / current.gridWidth) >> 1, parent.gridHeight - 1);
+	return parent.firstTile + y * parent.gridWidth + x;
+}
+
+/**
+* Takes a free cache slot, or evicts the least recently used tile that was not
+* drawn by the current frame. The coarsest tile is never evicted.
+*
+* @return The slot, or NO_SLOT if every slot is in use.
+*/
+uint32_t VirtualTexture::allocateSlot()
+{
+	if (!m_freeSlots.empty())
+	{
+		uint32_t slot = m_freeSlots.back();
+		m_freeSlots.pop_back();
+		return slot;
+	}
+
+	uint32_t coarsest = static_cast<uint32_t>(m_tiles.size()) - 1;
+	uint32_t oldestSlot = NO_SLOT;
+	uint64_t oldestUse = m_frame;
+	for (uint32_t slot = 0; slot < m_slotTiles.size(); ++slot)
+	{
+		uint32_t tile = m_slotTiles[slot];
+		if (tile == coarsest || m_tiles[tile].lastUse >= oldestUse) continue;
+
+		oldestSlot = slot;
+		oldestUse = m_tiles[tile].lastUse;
+	}
+	if (oldestSlot == NO_SLOT) return NO_SLOT;
+
+	m_tiles[m_slotTiles[oldestSlot]].slot = NO_SLOT;
+	m_slotTiles[oldestSlot] = NO_TILE;
+	return oldestSlot;
+}
+
+/**
+* Copies a tile and its border into a cache slot.
+*
+* @param tile The tile.
+* @param slot The cache slot to write.
+* @param batch The batch to record the uploads into.
+*/
+void VirtualTexture::uploadTile(uint32_t tile, uint32_t slot, UploadBatch& batch)
+{
+	const Level& level = m_levels[tileLevel(tile)];
+	uint32_t local = tile - level.firstTile;
+	uint32_t tileX = local % level.gridWidth;
+	uint32_t tileY = local / level.gridWidth;
+
+	PixelRect rect{
+		(slot % m_slotsPerRow) * SLOT_SIZE,
+		(slot / m_slotsPerRow) * SLOT_SIZE,
+		SLOT_SIZE,
+		SLOT_SIZE };
+	std::vector<uint8_t> texels(static_cast<size_t>(SLOT_SIZE) * SLOT_SIZE * 4);
+
+	copyTileTexels(level, level.albedo, tileX, tileY, texels);
+	m_albedoCache->updateRegion(texels.data(), rect, &batch);
+
+	if (level.normal.empty())
+	{
+		const uint8_t flat[4] = { 128, 128, 255, 255 };
+		for (size_t i = 0; i < texels.size(); i += 4)
+		{
+			std::memcpy(&texels[i], flat, 4);
+		}
+	}
+	else
+	{
+		copyTileTexels(level, level.normal, tileX, tileY, texels);
+	}
+	m_normalCache->updateRegion(texels.data(), rect, &batch);
+
+	m_tiles[tile].slot = slot;
+	m_slotTiles[slot] = tile;
+}
+
+/**
+* Copies the texels of a tile and its border from a level. The border before
+* the first texel of the level repeats it, and texels past the content of the
+* level are empty.
+*
+* @param level The level holding the tile.
+* @param texels The level's albedo or normal texels.
+* @param tileX The tile column.
+* @param tileY The tile row.
+* @param slotTexels Set to SLOT_SIZE * SLOT_SIZE RGBA texels.
+*/
+void VirtualTexture::copyTileTexels(
+	const Level& level,
+	const std::vector<uint8_t>& texels,
+	uint32_t tileX,
+	uint32_t tileY,
+	std::vector<uint8_t>& slotTexels) const
+{
+	std::fill(slotTexels.begin(), slotTexels.end(), static_cast<uint8_t>(0));
+
+	for (uint32_t y = 0; y < SLOT_SIZE; ++y)
+	{
+		uint32_t sourceY = tileY * TILE_SIZE + y;
+		sourceY = sourceY < TILE_BORDER ? 0 : sourceY - TILE_BORDER;
+		if (sourceY >= level.height) break;
+
+		const uint8_t* sourceRow =
+			texels.data() + static_cast<size_t>(sourceY) * level.width * 4;
+		uint8_t* row = slotTexels.data() + static_cast<size_t>(y) * SLOT_SIZE * 4;
+		for (uint32_t x = 0; x < SLOT_SIZE; ++x)
+		{
+			uint32_t sourceX = tileX * TILE_SIZE + x;
+			sourceX = sourceX < TILE_BORDER ? 0 : sourceX - TILE_BORDER;
+			if (sourceX >= level.width) break;
+
+			std::memcpy(row + x * 4, sourceRow + sourceX * 4, 4);
+		}
+	}
+}
+
+/**
+* Rewrites the page table from the resident tiles, coarsest level first so that
+* tiles which are not resident copy the entry of their parent.
+*
+* @param batch The batch to record the upload into.
+*/
+void VirtualTexture::updatePageTable(UploadBatch& batch)
+{
+	auto entry = [this](uint32_t x, uint32_t y)
+		{
+			return m_pageTableData.data() +
+				(static_cast<size_t>(y) * m_pageTableWidth + x) * 4;
+		};
+
+	for (uint32_t i = static_cast<uint32_t>(m_levels.size()); i-- > 0;)
+	{
+		const Level& level = m_levels[i];
+		for (uint32_t y = 0; y < level.gridHeight; ++y)
+		{
+			for (uint32_t x = 0; x < level.gridWidth; ++x)
+			{
+				uint8_t* texel = entry(level.pageTableX + x, level.pageTableY + y);
+				uint32_t slot = m_tiles[level.firstTile + y * level.gridWidth + x].slot;
+				if (slot != NO_SLOT)
+				{
+					texel[0] = static_cast<uint8_t>(slot % m_slotsPerRow);
+					texel[1] = static_cast<uint8_t>(slot / m_slotsPerRow);
+					texel[2] = static_cast<uint8_t>(i);
+					texel[3] = 255;
+					continue;
+				}
+
+				// the coarsest tile is always resident, so has no parent here
+				const Level& parent = m_levels[i + 1];
+				std::memcpy(
+					texel,
+					entry(
+						parent.pageTableX + std::min(x >> 1, parent.gridWidth - 1),
+						parent.pageTableY + std::min(y >> 1, parent.gridHeight - 1)),
+					4);
+			}
+		}
+	}
+
+	m_pageTable->updateRegion(
+		m_pageTableData.data(),
+		PixelRect{ 0, 0, m_pageTableWidth, m_pageTableHeight },
+		&batch);
+}
+} // namespace wrengine
\ No newline at end of file
@@ -0,0 +1,156 @@
+#pragma once
+
+#include "Device.h"
+#include "Texture.h"
+#include "UploadBatch.h"
+
+#include <glm/glm.hpp>
+
+//std
+#include <memory>
+#include <vector>
+
+namespace wrengine
+{
+/**
+* Struct for virtual texture configuration options.
+*/
+struct VirtualTextureConfigInfo
+{
+	// width and height of the tile cache in texels, a power of two so the
+	// pooled cache images hold no unused border. Bounds the resident GPU memory
+	uint32_t cacheSize = 2048;
+
+	// tiles streamed into the cache per frame, coarsest levels first
+	uint32_t maxUploadsPerFrame = 16;
+
+	VkFilter filterType = VK_FILTER_NEAREST;
+};
+
+/**
+* A canvas too large for a single Texture, held in CPU memory and streamed to
+* the GPU in fixed size tiles. The canvas and its mip chain are split into
+* tiles over a power of two grid. A fixed size cache texture pair, albedo and
+* normal map, holds the resident tiles, and a page table texture maps every
+* tile of every level to a cache slot, or to its nearest resident ancestor. The
+* coarsest level is a single tile which is always resident.
+*
+* Fragments drawing the texture set a bit per visible tile, at the level they
+* sample, in a feedback buffer. processFeedback reads those bits back once the
+* frame has finished, streams missing tiles into the cache, evicting the least
+* recently used, and updates the page table. Apart from construction, methods
+* should be called from the thread running the engine.
+*/
+class VirtualTexture
+{
+public:
+	// texels per tile side, and texels of neighbouring tiles copied around each
+	// tile in the cache so filtering never reads another tile. Must match the
+	// fragment shader
+	static constexpr uint32_t TILE_SIZE = 128;
+	static constexpr uint32_t TILE_BORDER = 1;
+	static constexpr uint32_t SLOT_SIZE = TILE_SIZE + 2 * TILE_BORDER;
+
+	VirtualTexture(
+		Device& device,
+		std::vector<uint8_t> albedo,
+		std::vector<uint8_t> normal,
+		uint32_t width,
+		uint32_t height,
+		uint32_t feedbackOffset,
+		VirtualTextureConfigInfo configInfo = VirtualTextureConfigInfo{});
+
+	// not copyable
+	VirtualTexture(const VirtualTexture&) = delete;
+	VirtualTexture& operator=(const VirtualTexture&) = delete;
+
+	void processFeedback(const uint32_t* feedback, UploadBatch& batch);
+	static uint32_t feedbackWordCount(uint32_t width, uint32_t height);
+
+	// getters
+	uint32_t getWidth() const { return m_width; }
+	uint32_t getHeight() const { return m_height; }
+	glm::vec2 getUVScale() const;
+	uint32_t getShaderInfo(uint32_t pageTableIndex) const;
+	uint32_t getFeedbackOffset() const { return m_feedbackOffset; }
+	uint32_t getFeedbackWordCount() const;
+	uint32_t getResidentTileCount() const;
+	std::shared_ptr<Texture> getPageTable() const { return m_pageTable; }
+	std::shared_ptr<Texture> getAlbedoCache() const { return m_albedoCache; }
+	std::shared_ptr<Texture> getNormalCache() const { return m_normalCache; }
+
+private:
+	static constexpr uint32_t NO_SLOT = ~0u;
+	static constexpr uint32_t NO_TILE = ~0u;
+
+	struct Level
+	{
+		// content size in texels, the rest of the level's tile grid is empty
+		uint32_t width = 0;
+		uint32_t height = 0;
+		uint32_t gridWidth = 1;
+		uint32_t gridHeight = 1;
+
+		// index of the level's first tile, in tile and feedback bit order
+		uint32_t firstTile = 0;
+
+		// position of the level in the page table texture
+		uint32_t pageTableX = 0;
+		uint32_t pageTableY = 0;
+
+		std::vector<uint8_t> albedo;
+		std::vector<uint8_t> normal;
+	};
+
+	struct Tile
+	{
+		uint32_t slot = NO_SLOT;
+		uint64_t lastUse = 0;
+	};
+
+	static void tileGrid(
+		uint32_t width,
+		uint32_t height,
+		uint32_t& gridWidth,
+		uint32_t& gridHeight,
+		uint32_t& levelCount);
+	void createLevels(std::vector<uint8_t> albedo, std::vector<uint8_t> normal);
+	void createTextures();
+	uint32_t tileLevel(uint32_t tile) const;
+	uint32_t parentTile(uint32_t tile) const;
+	uint32_t allocateSlot();
+	void uploadTile(uint32_t tile, uint32_t slot, UploadBatch& batch);
+	void copyTileTexels(
+		const Level& level,
+		const std::vector<uint8_t>& texels,
+		uint32_t tileX,
+		uint32_t tileY,
+		std::vector<uint8_t>& slotTexels) const;
+	void updatePageTable(UploadBatch& batch);
+
+	Device& m_device;
+	VirtualTextureConfigInfo m_configInfo;
+	uint32_t m_width;
+	uint32_t m_height;
+	uint32_t m_feedbackOffset;
+
+	std::vector<Level> m_levels;
+	std::vector<Tile> m_tiles;
+
+	// tile held by each cache slot, and slots holding no tile
+	std::vector<uint32_t> m_slotTiles;
+	std::vector<uint32_t> m_freeSlots;
+	uint32_t m_slotsPerRow = 0;
+	uint64_t m_frame = 0;
+
+	// RGBA8 page table entries, the cache slot x and y, the level of the tile
+	// held there, and 255 in alpha once a tile is mapped
+	std::vector<uint8_t> m_pageTableData;
+	uint32_t m_pageTableWidth = 0;
+	uint32_t m_pageTableHeight = 0;
+
+	std::shared_ptr<Texture> m_pageTable;
+	std::shared_ptr<Texture> m_albedoCache;
+	std::shared_ptr<Texture> m_normalCache;
+};
+} // namespace wrengine
\ No newline at end of file
@@ -35,6 +35,7 @@ Window::Window(
 	{
 		throw std::runtime_error("Failed to create GLFW window!");
 	}
+	installEventCallbacks();
 }
 
 Window::~Window()
@@ -96,7 +97,91 @@ void Window::framebufferResizedCallback(
 	Window* recreateWindow = reinterpret_cast<Window*>(
 		glfwGetWindowUserPointer(window));
 	recreateWindow->bFramebufferResized = true;
+	recreateWindow->bEventsReceived = true;
 	recreateWindow->m_width = static_cast<uint32_t>(width);
 	recreateWindow->m_height = static_cast<uint32_t>(height);
 }
+
+/**
+* Flags that the window received an event which may change what is drawn.
+* 
+* @param window Pointer to underlying glfw window.
+*/
+void Window::markEvents(GLFWwindow* window)
+{
+	reinterpret_cast<Window*>(glfwGetWindowUserPointer(window))->bEventsReceived = true;
+}
+
+/**
+* Flags an input event, keeping its time if no earlier input is pending.
+* 
+* @param window Pointer to underlying glfw window.
+*/
+void Window::markInput(GLFWwindow* window)
+{
+	Window* inputWindow = reinterpret_cast<Window*>(glfwGetWindowUserPointer(window));
+	inputWindow->bEventsReceived = true;
+	if (!inputWindow->bInputPending)
+	{
+		inputWindow->bInputPending = true;
+		inputWindow->m_inputTime = std::chrono::steady_clock::now();
+	}
+}
+
+/**
+* Takes the time of the earliest input received since the last call, which the
+* frame about to be drawn responds to.
+* 
+* @param inputTime Set to the time of the input, if any is pending.
+* 
+* @return Whether input was pending.
+*/
+bool Window::takeInputTime(std::chrono::steady_clock::time_point& inputTime)
+{
+	if (!bInputPending) return false;
+	inputTime = m_inputTime;
+	bInputPending = false;
+	return true;
+}
+
+/**
+* Registers callbacks flagging input, focus and refresh events. They are set
+* before ImGui registers its callbacks, which chain to previously set ones, so
+* both receive the events.
+*/
+void Window::installEventCallbacks()
+{
+	glfwSetCursorPosCallback(m_window, [](GLFWwindow* window, double, double)
+		{
+			markInput(window);
+		});
+	glfwSetCursorEnterCallback(m_window, [](GLFWwindow* window, int)
+		{
+			markInput(window);
+		});
+	glfwSetMouseButtonCallback(m_window, [](GLFWwindow* window, int, int, int)
+		{
+			markInput(window);
+		});
+	glfwSetScrollCallback(m_window, [](GLFWwindow* window, double, double)
+		{
+			markInput(window);
+		});
+	glfwSetKeyCallback(m_window, [](GLFWwindow* window, int, int, int, int)
+		{
+			markInput(window);
+		});
+	glfwSetCharCallback(m_window, [](GLFWwindow* window, unsigned int)
+		{
+			markInput(window);
+		});
+	glfwSetWindowFocusCallback(m_window, [](GLFWwindow* window, int)
+		{
+			markEvents(window);
+		});
+	glfwSetWindowRefreshCallback(m_window, [](GLFWwindow* window)
+		{
+			markEvents(window);
+		});
+}
 } // namespace wrengine
\ No newline at end of file
@@ -11,6 +11,7 @@
 #include <stdexcept>
 #include <string>
 #include <iostream>
+#include <chrono>
 
 namespace wrengine
 {
@@ -35,6 +36,9 @@ public:
 	bool shouldClose() { return glfwWindowShouldClose(m_window); }
 	bool wasResized() { return bFramebufferResized; }
 	void resetWindowResizeFlag() { bFramebufferResized = false; }
+	bool hadEvents() { return bEventsReceived; }
+	void resetEventsFlag() { bEventsReceived = false; }
+	bool takeInputTime(std::chrono::steady_clock::time_point& inputTime);
 	VkExtent2D getExtent() { return { m_width, m_height }; }
 	void createWindowSurface(VkInstance instance, VkSurfaceKHR* surface);
 	void windowInitImGui(bool installCallbacks);
@@ -42,10 +46,21 @@ public:
 
 private:
 	static void framebufferResizedCallback(GLFWwindow* window, int width, int height);
+	static void markEvents(GLFWwindow* window);
+	static void markInput(GLFWwindow* window);
+	void installEventCallbacks();
 	uint32_t m_width;
 	uint32_t m_height;
 	std::string m_windowName;
 	GLFWwindow* m_window = nullptr;
 	bool bFramebufferResized = false;
+
+	// set by any input, focus or refresh event, so an idle engine knows to
+	// render
+	bool bEventsReceived = true;
+
+	// time of the earliest input not yet taken, for latency measurement
+	bool bInputPending = false;
+	std::chrono::steady_clock::time_point m_inputTime;
 };
 } // namespace wrengine
\ No newline at end of file
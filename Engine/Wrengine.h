@@ -3,6 +3,10 @@
 // core engine
 #include "Engine.h"
 #include "Texture.h"
+#include "AsepriteFile.h"
+#include "FileWatcher.h"
+#include "VirtualTexture.h"
+#include "Tilemap.h"
 #include "Window.h"
 
 // renderer
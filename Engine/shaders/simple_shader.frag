@@ -1,9 +1,11 @@
 #version 450
 #extension GL_KHR_vulkan_glsl: enable
 #extension GL_EXT_debug_printf: enable
+#extension GL_EXT_nonuniform_qualifier: enable
 
 layout(location = 0) in vec3 fragPos;
 layout(location = 1) in vec2 fragTexCoord;
+layout(location = 2) flat in uint fragInstance;
 
 layout(location = 0) out vec4 outColor;
 
@@ -17,55 +19,232 @@ layout(set = 0, binding = 0) uniform GlobalUbo
 {
 	mat4 projView;
 	vec4 ambientLight;
-	PointLight[10] pointLights;
-	int numLights;
+	uint numLights;
+	uint lightTileSize;
+	vec2 viewportSize;
 } ubo;
 
-layout(set = 1, binding = 0) uniform sampler2D texSampler;
-layout(set = 1, binding = 1) uniform sampler2D normalSampler;
+// tiles drawn from virtual textures, a bit per tile of every level
+layout(std430, set = 0, binding = 1) buffer Feedback
+{
+	uint tiles[];
+} feedback;
+
+// position.w holds the radius of influence of each light
+layout(std430, set = 0, binding = 2) readonly buffer Lights
+{
+	PointLight lights[];
+} pointLights;
 
-layout(push_constant) uniform Push
+// lights reaching each screen tile, written by light_cull.comp
+layout(std430, set = 0, binding = 3) readonly buffer LightTiles
 {
-	mat4 transform;
+	uint indices[];
+} lightTiles;
+
+// bindless texture table, indexed by the material slots of each sprite. The
+// slots differ between instances of a draw, so indexing is nonuniform
+layout(set = 1, binding = 0) uniform sampler2D textures[];
+
+// per sprite data, see SpriteInstance in RenderSystem.h
+struct SpriteInstance
+{
+	mat4 model;
+	vec4 uvTransform;
 	uint config;
-	vec4 normalTransform;
-} push;
+	uint albedoIndex;
+	uint normalMapIndex;
+	uint virtualTexture;
+	uint feedbackOffset;
+};
+
+layout(std430, set = 2, binding = 0) readonly buffer Instances
+{
+	SpriteInstance sprites[];
+} instances;
+
+// pipeline variant constants, see RenderSystem::createVariant. SHADER_CONFIG
+// matches ShaderConfig in Components.h. VIRTUAL_TEXTURE is set when the albedo
+// and normal map slots are the tile caches of a virtual texture, see
+// VirtualTexture.h. NORMAL_SCALE flips the normal map axes
+layout(constant_id = 0) const uint SHADER_CONFIG = 0u;
+layout(constant_id = 1) const bool VIRTUAL_TEXTURE = false;
+layout(constant_id = 2) const float NORMAL_SCALE_X = 1.0;
+layout(constant_id = 3) const float NORMAL_SCALE_Y = -1.0;
+layout(constant_id = 4) const float NORMAL_SCALE_Z = 1.0;
+
+const uint SHADER_CONFIG_EMISSIVE = 0u;
+const uint SHADER_CONFIG_NORMAL_MAPPED = 1u;
+
+const float TILE_SIZE = 128.0;
+const float TILE_BORDER = 1.0;
+const float SLOT_SIZE = TILE_SIZE + 2.0 * TILE_BORDER;
+
+// a light count and MAX_LIGHTS_PER_TILE indices, see PointLightSystem.h
+const uint LIGHT_TILE_STRIDE = 128u;
+
+// texture coordinates sampled by the material
+vec2 texCoord;
+
+// the sprite being drawn
+SpriteInstance sprite;
+
+/**
+* Gets the tile grid of a virtual texture level. The grid of the first level is
+* packed as log2 width and height above the page table slot.
+*/
+uvec2 virtualGrid(uint level)
+{
+	uvec2 log2Grid = (uvec2(sprite.virtualTexture) >> uvec2(16, 20)) & 0xFu;
+	return max(uvec2(1u) << log2Grid >> level, uvec2(1u));
+}
+
+/**
+* Gets the first page table texel of a virtual texture level. Levels past the
+* first are packed in a column to the right of the first.
+*/
+ivec2 pageTableOrigin(uint level)
+{
+	if (level == 0u) return ivec2(0);
+
+	uint y = 0u;
+	for (uint i = 1u; i < level; ++i)
+	{
+		y += virtualGrid(i).y;
+	}
+	return ivec2(virtualGrid(0u).x, y);
+}
+
+/**
+* Sets the feedback bit of a tile. Only one fragment in each 4x4 block reports,
+* which is enough to find tiles at least a few pixels across.
+*/
+void recordFeedback(uint level, uvec2 tile)
+{
+	if (any(notEqual(uvec2(gl_FragCoord.xy) & 3u, uvec2(0u)))) return;
+
+	uint bit = 0u;
+	for (uint i = 0u; i < level; ++i)
+	{
+		uvec2 grid = virtualGrid(i);
+		bit += grid.x * grid.y;
+	}
+	bit += tile.y * virtualGrid(level).x + tile.x;
+
+	uint word = sprite.feedbackOffset + bit / 32u;
+	uint mask = 1u << (bit % 32u);
+	if ((feedback.tiles[word] & mask) == 0u)
+	{
+		atomicOr(feedback.tiles[word], mask);
+	}
+}
+
+/**
+* Maps a virtual texture coordinate to the tile caches. The level is chosen from
+* the screen space footprint, and the page table gives the cache slot of that
+* tile, or of its nearest resident ancestor.
+*/
+vec2 virtualTexCoord(vec2 uv)
+{
+	uvec2 grid = virtualGrid(0u);
+	uint levelCount = uint(findMSB(max(grid.x, grid.y))) + 1u;
+
+	vec2 texel = uv * vec2(grid) * TILE_SIZE;
+	vec2 dx = dFdx(texel);
+	vec2 dy = dFdy(texel);
+	float lod = 0.5 * log2(max(dot(dx, dx), dot(dy, dy)));
+	uint level = uint(clamp(floor(lod), 0.0, float(levelCount - 1u)));
+
+	vec2 levelExtent = max(vec2(grid) * TILE_SIZE / float(1u << level), vec2(1.0));
+	uvec2 tile = min(uvec2(uv * levelExtent / TILE_SIZE), virtualGrid(level) - 1u);
+	recordFeedback(level, tile);
+
+	uint pageTable = sprite.virtualTexture & 0xFFFFu;
+	vec4 entry = round(texelFetch(
+		textures[nonuniformEXT(pageTable)],
+		pageTableOrigin(level) + ivec2(tile),
+		0) * 255.0);
+
+	// the entry may hold a coarser level, so find the texel within its tile
+	float residentLevel = entry.b;
+	vec2 residentExtent = max(vec2(grid) * TILE_SIZE / exp2(residentLevel), vec2(1.0));
+	vec2 residentTexel = uv * residentExtent;
+	vec2 tileTexel = clamp(
+		residentTexel - floor(residentTexel / TILE_SIZE) * TILE_SIZE,
+		vec2(0.0),
+		vec2(TILE_SIZE));
+
+	vec2 cacheTexel = entry.rg * SLOT_SIZE + TILE_BORDER + tileTexel;
+	return cacheTexel / vec2(textureSize(textures[nonuniformEXT(sprite.albedoIndex)], 0));
+}
 
 vec4 emmisiveColor(vec4 tex)
 {
 	return tex;
 }
 
-vec4 diffuseColor(vec4 tex)
+/**
+* Sums the light reaching a fragment from the lights binned into its screen
+* tile, see light_cull.comp. Lights fade out towards their radius of influence,
+* past which they are culled.
+*/
+vec3 tileLighting(vec3 N)
 {
-	vec4 normalMap = texture(normalSampler, fragTexCoord);
-	//vec4 normalMap = vec4(0.0, 0.0, 1.0, 0.0);
-	PointLight light = ubo.pointLights[0];
+	uvec2 tile = uvec2(gl_FragCoord.xy) / ubo.lightTileSize;
+	uint tileCountX = (uint(ubo.viewportSize.x) + ubo.lightTileSize - 1u) / ubo.lightTileSize;
+	uint base = (tile.y * tileCountX + tile.x) * LIGHT_TILE_STRIDE;
 
-	vec3 lightDir = vec3(light.position.xyz - fragPos);
+	vec3 lighting = vec3(0.0);
+	uint count = lightTiles.indices[base];
+	for (uint i = 0u; i < count; ++i)
+	{
+		PointLight light = pointLights.lights[lightTiles.indices[base + 1u + i]];
+
+		vec3 lightDir = vec3(light.position.xyz - fragPos);
+
+		float D = length(lightDir);
+		float radius = light.position.w;
+		if (D >= radius) continue;
+
+		vec3 L = normalize(lightDir);
 
-	float D = length(lightDir);
-	vec3 N = normalize(2 * normalMap.rgb - 1);
-	vec3 L = normalize(lightDir);
+		vec3 diffuse = (light.color.rgb * light.color.a) * max(acos((dot(N, L))), 0);
+		//vec3 diffuse = (light.color.rgb * light.color.a) * max(dot(N, L), 0);
 
-	N *= push.normalTransform.xyz;
+		float attenuation = 50000.0 / (0.4 + (3 * D) + (20 * D * D));
+		float fade = clamp(1.0 - pow(D / radius, 4.0), 0.0, 1.0);
+
+		lighting += diffuse * attenuation * fade * fade;
+	}
+	return lighting;
+}
 
-	vec3 diffuse = (light.color.rgb * light.color.a) * max(acos((dot(N, L))), 0);
-	//vec3 diffuse = (light.color.rgb * light.color.a) * max(dot(N, L), 0);
+vec4 diffuseColor(vec4 tex)
+{
+	// normal maps are stored as two channels, reconstruct z on the hemisphere
+	vec2 normalXY = 2 * texture(textures[nonuniformEXT(sprite.normalMapIndex)], texCoord).rg - 1;
+	float normalZ = sqrt(max(1.0 - dot(normalXY, normalXY), 0.0));
+	vec3 N = normalize(vec3(normalXY, normalZ));
+	N *= vec3(NORMAL_SCALE_X, NORMAL_SCALE_Y, NORMAL_SCALE_Z);
 
 	vec3 ambient = ubo.ambientLight.rgb * ubo.ambientLight.a;
 
-	float attenuation = 50000.0 / (0.4 + (3 * D) + (20 * D * D));
+	vec3 intensity = ambient + tileLighting(N);
 
-	vec3 intensity = ambient + (diffuse * attenuation);
-	
 	//return vec4(vec3(0.2) * intensity, tex.a);
 	return vec4(tex.rgb * intensity, tex.a);
 }
 
 void main()
 {
-	vec4 texColor = texture(texSampler, fragTexCoord);
+	sprite = instances.sprites[fragInstance];
+	texCoord = fragTexCoord;
+	if (VIRTUAL_TEXTURE)
+	{
+		texCoord = virtualTexCoord(fragTexCoord);
+	}
+
+	vec4 texColor = texture(textures[nonuniformEXT(sprite.albedoIndex)], texCoord);
 
 	// using alpha from texcolor as a binary mask on opacity, not using any kind
 	// of smooth transparency
@@ -74,16 +253,11 @@ void main()
 		discard;
 	}
 
-	vec4 color;
-
-	switch (push.config)
+	// branches on constants, which specialization removes
+	vec4 color = emmisiveColor(texColor);
+	if (SHADER_CONFIG == SHADER_CONFIG_NORMAL_MAPPED)
 	{
-		case 0:
-			color = emmisiveColor(texColor); 
-			break;
-		case 1:
-			color = diffuseColor(texColor); 
-			break;
+		color = diffuseColor(texColor);
 	}
 
 	// gamma correction
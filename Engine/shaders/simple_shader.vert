@@ -2,40 +2,63 @@
 #extension GL_KHR_vulkan_glsl: enable
 #extension GL_EXT_debug_printf: enable
 
-layout(location = 0) in vec3 position;
-layout(location = 1) in vec3 color;
-layout(location = 2) in vec2 uv;
-
 layout(location = 0) out vec3 fragPos;
 layout(location = 1) out vec2 fragTexCoord;
-
-struct PointLight
-{
-	vec4 position;
-	vec4 color;
-};
+layout(location = 2) flat out uint fragInstance;
 
 layout(set = 0, binding = 0) uniform GlobalUbo
 {
 	mat4 projView;
 	vec4 ambientLight;
-	PointLight[10] pointLights;
-	int numLights;
+	uint numLights;
+	uint lightTileSize;
+	vec2 viewportSize;
 } ubo;
 
-layout(push_constant) uniform Push
+// per sprite data, see SpriteInstance in RenderSystem.h
+struct SpriteInstance
 {
 	mat4 model;
+	vec4 uvTransform;
 	uint config;
-	vec4 normalTransform;
-} push;
+	uint albedoIndex;
+	uint normalMapIndex;
+	uint virtualTexture;
+	uint feedbackOffset;
+};
+
+layout(std430, set = 2, binding = 0) readonly buffer Instances
+{
+	SpriteInstance sprites[];
+} instances;
+
+// instances that survived culling, in draw order, written by cull.comp
+layout(std430, set = 2, binding = 1) readonly buffer Visible
+{
+	uint indices[];
+} visible;
+
+// corners of the two triangles of the quad, as texture coordinates
+const vec2 QUAD_CORNERS[6] = vec2[](
+	vec2(0.0, 0.0),
+	vec2(1.0, 0.0),
+	vec2(1.0, 1.0),
+	vec2(1.0, 1.0),
+	vec2(0.0, 1.0),
+	vec2(0.0, 0.0));
 
 void main()
 {
-	vec4 vertexWorldPosition = push.model * vec4(position, 1.0);
+	uint instance = visible.indices[gl_InstanceIndex];
+	SpriteInstance sprite = instances.sprites[instance];
+	vec2 uv = QUAD_CORNERS[gl_VertexIndex];
+	vec3 position = vec3(uv - 0.5, 0.0);
+
+	vec4 vertexWorldPosition = sprite.model * vec4(position, 1.0);
 	gl_Position = ubo.projView * vertexWorldPosition;
 	fragPos = vertexWorldPosition.xyz;
 	//debugPrintfEXT("fragPos.x : %f", fragPos.x);
 	//debugPrintfEXT("fragPos.y : %f", fragPos.y);
-	fragTexCoord = uv;
+	fragTexCoord = uv * sprite.uvTransform.xy + sprite.uvTransform.zw;
+	fragInstance = instance;
 }
\ No newline at end of file
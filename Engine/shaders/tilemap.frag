@@ -0,0 +1,173 @@
+#version 450
+#extension GL_KHR_vulkan_glsl: enable
+#extension GL_EXT_nonuniform_qualifier: enable
+
+layout(location = 0) in vec3 fragPos;
+layout(location = 1) in vec2 fragTexCoord;
+
+layout(location = 0) out vec4 outColor;
+
+struct PointLight
+{
+	vec4 position;
+	vec4 color;
+};
+
+layout(set = 0, binding = 0) uniform GlobalUbo
+{
+	mat4 projView;
+	vec4 ambientLight;
+	uint numLights;
+	uint lightTileSize;
+	vec2 viewportSize;
+} ubo;
+
+// position.w holds the radius of influence of each light
+layout(std430, set = 0, binding = 2) readonly buffer Lights
+{
+	PointLight lights[];
+} pointLights;
+
+// lights reaching each screen tile, written by light_cull.comp
+layout(std430, set = 0, binding = 3) readonly buffer LightTiles
+{
+	uint indices[];
+} lightTiles;
+
+// bindless texture table, indexed by the slots in the push constants
+layout(set = 1, binding = 0) uniform sampler2D textures[];
+
+// textures holds the grid, albedo tileset and normal tileset slots, and the
+// shader config. tiling holds the grid size, the tile size packed as 16 bits
+// each, and the number of tiles across the tileset, see TilemapSystem.cpp
+layout(push_constant) uniform Push
+{
+	mat4 model;
+	vec4 normalTransform;
+	uvec4 textures;
+	uvec4 tiling;
+} push;
+
+// flip flags in the blue channel of the grid, see Tilemap::encodeTile
+const uint FLIP_X = 1u;
+const uint FLIP_Y = 2u;
+const uint FLIP_DIAGONAL = 4u;
+
+// a light count and MAX_LIGHTS_PER_TILE indices, see PointLightSystem.h
+const uint LIGHT_TILE_STRIDE = 128u;
+
+vec4 emmisiveColor(vec4 tex)
+{
+	return tex;
+}
+
+/**
+* Sums the light reaching a fragment from the lights binned into its screen
+* tile, see light_cull.comp. Lights fade out towards their radius of influence,
+* past which they are culled.
+*/
+vec3 tileLighting(vec3 N)
+{
+	uvec2 tile = uvec2(gl_FragCoord.xy) / ubo.lightTileSize;
+	uint tileCountX = (uint(ubo.viewportSize.x) + ubo.lightTileSize - 1u) / ubo.lightTileSize;
+	uint base = (tile.y * tileCountX + tile.x) * LIGHT_TILE_STRIDE;
+
+	vec3 lighting = vec3(0.0);
+	uint count = lightTiles.indices[base];
+	for (uint i = 0u; i < count; ++i)
+	{
+		PointLight light = pointLights.lights[lightTiles.indices[base + 1u + i]];
+
+		vec3 lightDir = vec3(light.position.xyz - fragPos);
+
+		float D = length(lightDir);
+		float radius = light.position.w;
+		if (D >= radius) continue;
+
+		vec3 L = normalize(lightDir);
+
+		vec3 diffuse = (light.color.rgb * light.color.a) * max(acos((dot(N, L))), 0);
+
+		float attenuation = 50000.0 / (0.4 + (3 * D) + (20 * D * D));
+		float fade = clamp(1.0 - pow(D / radius, 4.0), 0.0, 1.0);
+
+		lighting += diffuse * attenuation * fade * fade;
+	}
+	return lighting;
+}
+
+vec4 diffuseColor(vec4 tex, vec2 normalXY)
+{
+	float normalZ = sqrt(max(1.0 - dot(normalXY, normalXY), 0.0));
+	vec3 N = normalize(vec3(normalXY, normalZ));
+
+	N *= push.normalTransform.xyz;
+
+	vec3 ambient = ubo.ambientLight.rgb * ubo.ambientLight.a;
+
+	vec3 intensity = ambient + tileLighting(N);
+
+	return vec4(tex.rgb * intensity, tex.a);
+}
+
+void main()
+{
+	uvec2 gridSize = push.tiling.xy;
+	uvec2 tileSize = uvec2(push.tiling.z & 0xFFFFu, push.tiling.z >> 16);
+
+	vec2 gridCoord = fragTexCoord * vec2(gridSize);
+	ivec2 cell = ivec2(min(uvec2(gridCoord), gridSize - 1u));
+	uvec4 entry = uvec4(round(
+		texelFetch(textures[push.textures.x], cell, 0) * 255.0));
+
+	// tile 0 is the empty tile
+	uint tile = entry.r | (entry.g << 8);
+	if (tile == 0u)
+	{
+		discard;
+	}
+
+	// undo the tile flips to find the tileset texel, flags apply as diagonal
+	// then horizontal then vertical
+	vec2 local = clamp(gridCoord - vec2(cell), vec2(0.0), vec2(1.0));
+	uint flags = entry.b;
+	if ((flags & FLIP_X) != 0u) local.x = 1.0 - local.x;
+	if ((flags & FLIP_Y) != 0u) local.y = 1.0 - local.y;
+	if ((flags & FLIP_DIAGONAL) != 0u) local = local.yx;
+
+	uvec2 tileOrigin =
+		uvec2(tile % push.tiling.w, tile / push.tiling.w) * tileSize;
+	ivec2 texel = ivec2(tileOrigin + min(uvec2(local * vec2(tileSize)), tileSize - 1u));
+
+	vec4 texColor = texelFetch(textures[push.textures.y], texel, 0);
+
+	// using alpha from texcolor as a binary mask on opacity, as sprites do
+	if (texColor.a < 0.01)
+	{
+		discard;
+	}
+
+	vec4 color;
+
+	switch (push.textures.w)
+	{
+		case 0:
+			color = emmisiveColor(texColor);
+			break;
+		case 1:
+		{
+			// normals turn with the tile, so apply the flips in order
+			vec2 normalXY = 2 * texelFetch(textures[push.textures.z], texel, 0).rg - 1;
+			if ((flags & FLIP_DIAGONAL) != 0u) normalXY = normalXY.yx;
+			if ((flags & FLIP_X) != 0u) normalXY.x = -normalXY.x;
+			if ((flags & FLIP_Y) != 0u) normalXY.y = -normalXY.y;
+			color = diffuseColor(texColor, normalXY);
+			break;
+		}
+	}
+
+	// gamma correction
+	float gamma = 2.2;
+	vec3 correctedColor = pow(color.rgb, vec3(1.0 / gamma));
+	outColor = vec4(correctedColor, color.a);
+}
\ No newline at end of file
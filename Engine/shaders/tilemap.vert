@@ -0,0 +1,34 @@
+#version 450
+#extension GL_KHR_vulkan_glsl: enable
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 color;
+layout(location = 2) in vec2 uv;
+
+layout(location = 0) out vec3 fragPos;
+layout(location = 1) out vec2 fragTexCoord;
+
+layout(set = 0, binding = 0) uniform GlobalUbo
+{
+	mat4 projView;
+	vec4 ambientLight;
+	uint numLights;
+	uint lightTileSize;
+	vec2 viewportSize;
+} ubo;
+
+layout(push_constant) uniform Push
+{
+	mat4 model;
+	vec4 normalTransform;
+	uvec4 textures;
+	uvec4 tiling;
+} push;
+
+void main()
+{
+	vec4 vertexWorldPosition = push.model * vec4(position, 1.0);
+	gl_Position = ubo.projView * vertexWorldPosition;
+	fragPos = vertexWorldPosition.xyz;
+	fragTexCoord = uv;
+}
\ No newline at end of file